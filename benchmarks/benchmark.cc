@@ -9,28 +9,62 @@
 
 #include <math.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <random>
 #include <string>
 #include <vector>
 
 #include "google/ads/googleads/v16/services/google_ads_service.upbdefs.h"
 #include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/wrappers.pb.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/absl_check.h"
+#include "absl/log/absl_log.h"
+#include "absl/strings/str_cat.h"
+#include "google/protobuf/arena_pool.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor_database.h"
 #include "google/protobuf/dynamic_message.h"
+#include "google/protobuf/io/strtod.h"
+#include "google/protobuf/io/tokenizer.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/json/json.h"
+#include "google/protobuf/packed_varint.h"
+#include "google/protobuf/text_format.h"
+#include "google/protobuf/util/type_resolver.h"
+#include "google/protobuf/util/type_resolver_util.h"
 #include "benchmarks/descriptor.pb.h"
 #include "benchmarks/descriptor.upb.h"
 #include "benchmarks/descriptor.upbdefs.h"
 #include "benchmarks/descriptor_sv.pb.h"
 #include "upb/base/string_view.h"
 #include "upb/base/upcast.h"
+#include "upb/hash/int_table.h"
+#include "upb/hash/str_table.h"
 #include "upb/json/decode.h"
 #include "upb/json/encode.h"
+#include "upb/mem/alloc.h"
 #include "upb/mem/arena.h"
+#include "upb/mem/arena.hpp"
+#include "upb/mini_table/field.h"
+#include "upb/mini_table/internal/message.h"
+#include "upb/mini_table/message.h"
 #include "upb/reflection/def.hpp"
 #include "upb/wire/decode.h"
+#include "upb/wire/internal/decode_fast.h"
+
+// Must be last.
+#include "upb/port/def.inc"
 
 upb_StringView descriptor =
     benchmarks_descriptor_proto_upbdefinit.descriptor;
@@ -51,14 +85,59 @@ void CollectFileDescriptors(
   serialized_files.push_back(file->descriptor);
 }
 
+// Counts the allocations that go through upb_alloc_global while it is alive,
+// so that arena benchmarks can report how often they call malloc(). The
+// original function is restored afterwards, so later benchmarks don't pay for
+// the counting. Swapping the function is not thread-safe, so only use this in
+// single-threaded runs.
+class CountGlobalMallocs {
+ public:
+  CountGlobalMallocs() : real_(upb_alloc_global.func) {
+    real_func_ = real_;
+    count_ = 0;
+    upb_alloc_global.func = &CountingFunc;
+  }
+  ~CountGlobalMallocs() { upb_alloc_global.func = real_; }
+
+  size_t count() const { return count_; }
+
+ private:
+  static void* CountingFunc(upb_alloc* alloc, void* ptr, size_t oldsize,
+                            size_t size) {
+    if (size != 0) count_++;
+    return real_func_(alloc, ptr, oldsize, size);
+  }
+
+  static inline upb_alloc_func* real_func_;
+  static inline size_t count_;
+  upb_alloc_func* real_;
+};
+
+enum BlockCacheMode { NoBlockCache, UseBlockCache };
+
+template <BlockCacheMode CacheMode>
 static void BM_ArenaOneAlloc(benchmark::State& state) {
+  std::optional<CountGlobalMallocs> mallocs;
+  if (state.threads() == 1) mallocs.emplace();
+  if (CacheMode == UseBlockCache && state.thread_index() == 0) {
+    upb_Arena_SetBlockCacheLimits(64, 1 << 20);
+  }
   for (auto _ : state) {
     upb_Arena* arena = upb_Arena_New();
     upb_Arena_Malloc(arena, 1);
     upb_Arena_Free(arena);
   }
+  if (mallocs) {
+    state.counters["mallocs"] = benchmark::Counter(
+        mallocs->count(), benchmark::Counter::kAvgIterations);
+  }
+  if (CacheMode == UseBlockCache) {
+    upb_Arena_FlushThreadBlockCache();
+    if (state.thread_index() == 0) upb_Arena_SetBlockCacheLimits(0, 0);
+  }
 }
-BENCHMARK(BM_ArenaOneAlloc);
+BENCHMARK_TEMPLATE(BM_ArenaOneAlloc, NoBlockCache)->ThreadRange(1, 4);
+BENCHMARK_TEMPLATE(BM_ArenaOneAlloc, UseBlockCache)->ThreadRange(1, 4);
 
 static void BM_ArenaInitialBlockOneAlloc(benchmark::State& state) {
   for (auto _ : state) {
@@ -115,6 +194,213 @@ static void BM_ArenaFuseBalanced(benchmark::State& state) {
 }
 BENCHMARK(BM_ArenaFuseBalanced)->Range(2, 128);
 
+// Fuses arenas from a pool shared by all threads, while also replacing pool
+// entries with fresh arenas, so that threads race to fuse into the same
+// groups and groups keep getting freed.
+static void BM_ArenaFuseContended(benchmark::State& state) {
+  static std::array<std::atomic<upb_Arena*>, 64> pool = {};
+  std::minstd_rand rng(state.thread_index() + 1);
+  auto swap = [&](upb_Arena* a) {
+    return pool[rng() % pool.size()].exchange(a, std::memory_order_acq_rel);
+  };
+  for (auto _ : state) {
+    upb_Arena* a = swap(nullptr);
+    upb_Arena* b = swap(nullptr);
+    if (a == nullptr) a = upb_Arena_New();
+    if (b == nullptr) b = upb_Arena_New();
+    upb_Arena_Fuse(a, b);
+    for (upb_Arena* arena : {a, b, upb_Arena_New()}) {
+      upb_Arena* old = swap(arena);
+      if (old != nullptr) upb_Arena_Free(old);
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ArenaFuseContended)->ThreadRange(1, 16);
+
+enum HashTableImpl { UpbTable, AbslTable };
+
+std::vector<uintptr_t> HashTableIntKeys(size_t n) {
+  std::mt19937 rng(n);
+  std::vector<uintptr_t> keys(n);
+  // Keep keys out of the array part of upb_inttable so the hash part is what
+  // gets measured.
+  for (auto& key : keys) key = (rng() | (1 << 20));
+  return keys;
+}
+
+std::vector<std::string> HashTableStrKeys(size_t n) {
+  std::vector<std::string> keys;
+  keys.reserve(n);
+  for (uintptr_t key : HashTableIntKeys(n)) {
+    keys.push_back(absl::StrCat("google.protobuf.Message", key));
+  }
+  return keys;
+}
+
+template <HashTableImpl Impl>
+static void BM_IntTableInsert(benchmark::State& state) {
+  std::vector<uintptr_t> keys = HashTableIntKeys(state.range(0));
+  for (auto _ : state) {
+    if (Impl == UpbTable) {
+      upb::Arena arena;
+      upb_inttable table;
+      upb_inttable_init(&table, arena.ptr());
+      for (uintptr_t key : keys) {
+        upb_inttable_insert(&table, key, upb_value_uintptr(key), arena.ptr());
+      }
+    } else {
+      absl::flat_hash_map<uintptr_t, uintptr_t> table;
+      for (uintptr_t key : keys) table.emplace(key, key);
+      benchmark::DoNotOptimize(table);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK_TEMPLATE(BM_IntTableInsert, UpbTable)
+    ->RangeMultiplier(10)
+    ->Range(10, 10000000);
+BENCHMARK_TEMPLATE(BM_IntTableInsert, AbslTable)
+    ->RangeMultiplier(10)
+    ->Range(10, 10000000);
+
+template <HashTableImpl Impl>
+static void BM_IntTableLookup(benchmark::State& state) {
+  std::vector<uintptr_t> keys = HashTableIntKeys(state.range(0));
+  upb::Arena arena;
+  upb_inttable upb_table;
+  upb_inttable_init(&upb_table, arena.ptr());
+  absl::flat_hash_map<uintptr_t, uintptr_t> absl_table;
+  for (uintptr_t key : keys) {
+    if (Impl == UpbTable) {
+      upb_inttable_insert(&upb_table, key, upb_value_uintptr(key),
+                          arena.ptr());
+    } else {
+      absl_table.emplace(key, key);
+    }
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+  size_t i = 0;
+  for (auto _ : state) {
+    uintptr_t key = keys[i++ % keys.size()];
+    if (Impl == UpbTable) {
+      upb_value val;
+      upb_inttable_lookup(&upb_table, key, &val);
+      benchmark::DoNotOptimize(val);
+    } else {
+      benchmark::DoNotOptimize(absl_table.find(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_IntTableLookup, UpbTable)
+    ->RangeMultiplier(10)
+    ->Range(10, 10000000);
+BENCHMARK_TEMPLATE(BM_IntTableLookup, AbslTable)
+    ->RangeMultiplier(10)
+    ->Range(10, 10000000);
+
+template <HashTableImpl Impl>
+static void BM_IntTableIterate(benchmark::State& state) {
+  std::vector<uintptr_t> keys = HashTableIntKeys(state.range(0));
+  upb::Arena arena;
+  upb_inttable upb_table;
+  upb_inttable_init(&upb_table, arena.ptr());
+  absl::flat_hash_map<uintptr_t, uintptr_t> absl_table;
+  for (uintptr_t key : keys) {
+    if (Impl == UpbTable) {
+      upb_inttable_insert(&upb_table, key, upb_value_uintptr(key),
+                          arena.ptr());
+    } else {
+      absl_table.emplace(key, key);
+    }
+  }
+  for (auto _ : state) {
+    uintptr_t sum = 0;
+    if (Impl == UpbTable) {
+      intptr_t iter = UPB_INTTABLE_BEGIN;
+      uintptr_t key;
+      upb_value val;
+      while (upb_inttable_next(&upb_table, &key, &val, &iter)) {
+        sum += upb_value_getuintptr(val);
+      }
+    } else {
+      for (const auto& [key, val] : absl_table) sum += val;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK_TEMPLATE(BM_IntTableIterate, UpbTable)
+    ->RangeMultiplier(10)
+    ->Range(10, 10000000);
+BENCHMARK_TEMPLATE(BM_IntTableIterate, AbslTable)
+    ->RangeMultiplier(10)
+    ->Range(10, 10000000);
+
+template <HashTableImpl Impl>
+static void BM_StrTableInsert(benchmark::State& state) {
+  std::vector<std::string> keys = HashTableStrKeys(state.range(0));
+  for (auto _ : state) {
+    if (Impl == UpbTable) {
+      upb::Arena arena;
+      upb_strtable table;
+      upb_strtable_init(&table, 4, arena.ptr());
+      for (const std::string& key : keys) {
+        upb_strtable_insert(&table, key.data(), key.size(),
+                            upb_value_int32(0), arena.ptr());
+      }
+    } else {
+      absl::flat_hash_map<std::string, int32_t> table;
+      for (const std::string& key : keys) table.emplace(key, 0);
+      benchmark::DoNotOptimize(table);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK_TEMPLATE(BM_StrTableInsert, UpbTable)
+    ->RangeMultiplier(10)
+    ->Range(10, 10000000);
+BENCHMARK_TEMPLATE(BM_StrTableInsert, AbslTable)
+    ->RangeMultiplier(10)
+    ->Range(10, 10000000);
+
+template <HashTableImpl Impl>
+static void BM_StrTableLookup(benchmark::State& state) {
+  std::vector<std::string> keys = HashTableStrKeys(state.range(0));
+  upb::Arena arena;
+  upb_strtable upb_table;
+  upb_strtable_init(&upb_table, 4, arena.ptr());
+  absl::flat_hash_map<std::string, int32_t> absl_table;
+  for (const std::string& key : keys) {
+    if (Impl == UpbTable) {
+      upb_strtable_insert(&upb_table, key.data(), key.size(),
+                          upb_value_int32(0), arena.ptr());
+    } else {
+      absl_table.emplace(key, 0);
+    }
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+  size_t i = 0;
+  for (auto _ : state) {
+    const std::string& key = keys[i++ % keys.size()];
+    if (Impl == UpbTable) {
+      upb_value val;
+      upb_strtable_lookup2(&upb_table, key.data(), key.size(), &val);
+      benchmark::DoNotOptimize(val);
+    } else {
+      benchmark::DoNotOptimize(absl_table.find(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_StrTableLookup, UpbTable)
+    ->RangeMultiplier(10)
+    ->Range(10, 10000000);
+BENCHMARK_TEMPLATE(BM_StrTableLookup, AbslTable)
+    ->RangeMultiplier(10)
+    ->Range(10, 10000000);
+
 enum LoadDescriptorMode {
   NoLayout,
   WithLayout,
@@ -251,6 +537,35 @@ enum ArenaMode {
   InitBlock,
 };
 
+// Counts the fields reachable from |m| that the fast table decoder parses
+// itself, rather than handing them to _upb_FastDecoder_DecodeGeneric().
+static void CountFastFields(const upb_MiniTable* m,
+                            absl::flat_hash_set<const upb_MiniTable*>& seen,
+                            int* fast, int* generic) {
+  if (!seen.insert(m).second) return;
+  int n = upb_MiniTable_FieldCount(m);
+  int fast_here = 0;
+#if UPB_FASTTABLE
+  if (m->UPB_PRIVATE(table_mask) != (uint8_t)-1) {
+    int slots = (m->UPB_PRIVATE(table_mask) >> 3) + 1;
+    for (int i = 0; i < slots; i++) {
+      if (m->UPB_PRIVATE(fasttable)[i].field_parser !=
+          &_upb_FastDecoder_DecodeGeneric) {
+        fast_here++;
+      }
+    }
+  }
+#endif
+  *fast += fast_here;
+  *generic += n - fast_here;
+  for (int i = 0; i < n; i++) {
+    const upb_MiniTableField* f = upb_MiniTable_GetFieldByIndex(m, i);
+    if (upb_MiniTableField_CType(f) != kUpb_CType_Message) continue;
+    const upb_MiniTable* sub = upb_MiniTable_GetSubMessageTable(m, f);
+    if (sub) CountFastFields(sub, seen, fast, generic);
+  }
+}
+
 template <ArenaMode AMode, CopyStrings Copy>
 static void BM_Parse_Upb_FileDesc(benchmark::State& state) {
   for (auto _ : state) {
@@ -271,6 +586,14 @@ static void BM_Parse_Upb_FileDesc(benchmark::State& state) {
     upb_Arena_Free(arena);
   }
   state.SetBytesProcessed(state.iterations() * descriptor.size);
+
+  absl::flat_hash_set<const upb_MiniTable*> seen;
+  int fast = 0;
+  int generic = 0;
+  CountFastFields(&upb_benchmark__FileDescriptorProto_msg_init, seen, &fast,
+                  &generic);
+  state.counters["fast_fields"] = fast;
+  state.counters["generic_fields"] = generic;
 }
 BENCHMARK_TEMPLATE(BM_Parse_Upb_FileDesc, UseArena, Copy);
 BENCHMARK_TEMPLATE(BM_Parse_Upb_FileDesc, UseArena, Alias);
@@ -341,6 +664,151 @@ BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDesc, UseArena, Copy);
 BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDesc, InitBlock, Copy);
 BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDescSV, InitBlock, Alias);
 
+// Counts arena block allocations, i.e. the malloc calls an arena makes.
+std::atomic<int64_t> arena_block_allocs{0};
+
+void* CountingBlockAlloc(size_t size) {
+  arena_block_allocs.fetch_add(1, std::memory_order_relaxed);
+  return malloc(size);
+}
+
+void CountingBlockDealloc(void* p, size_t) { free(p); }
+
+enum RequestArenaMode {
+  CreateDestroy,
+  Pooled,
+};
+
+// Models a request handler that parses one message into a request-scoped
+// arena, comparing a fresh arena per request against a recycled ArenaPool
+// arena. Reports arena mallocs per request and the p99 request latency.
+template <RequestArenaMode Mode>
+static void BM_RequestArena_Proto2(benchmark::State& state) {
+  protobuf::ArenaOptions arena_options;
+  arena_options.block_alloc = CountingBlockAlloc;
+  arena_options.block_dealloc = CountingBlockDealloc;
+  protobuf::ArenaPoolOptions pool_options;
+  pool_options.block_alloc = CountingBlockAlloc;
+  pool_options.block_dealloc = CountingBlockDealloc;
+  protobuf::ArenaPool pool(pool_options);
+
+  auto handle_request = [](protobuf::Arena* arena) {
+    auto* proto = protobuf::Arena::Create<FileDesc>(arena);
+    absl::string_view input(descriptor.data, descriptor.size);
+    if (!proto->ParseFromString(input)) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+  };
+
+  std::vector<int64_t> latencies;
+  arena_block_allocs = 0;
+  for (auto _ : state) {
+    auto start = std::chrono::steady_clock::now();
+    if (Mode == Pooled) {
+      protobuf::Arena* arena = pool.Acquire();
+      handle_request(arena);
+      pool.Release(arena);
+    } else {
+      protobuf::Arena arena(arena_options);
+      handle_request(&arena);
+    }
+    latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count());
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  state.counters["p99_ns"] =
+      static_cast<double>(latencies[latencies.size() * 99 / 100]);
+  state.counters["mallocs_per_request"] =
+      benchmark::Counter(static_cast<double>(arena_block_allocs.load()),
+                         benchmark::Counter::kAvgIterations);
+  state.SetBytesProcessed(state.iterations() * descriptor.size);
+}
+BENCHMARK_TEMPLATE(BM_RequestArena_Proto2, CreateDestroy);
+BENCHMARK_TEMPLATE(BM_RequestArena_Proto2, Pooled);
+
+// Returns `n` int32 values whose varints are `len` bytes long (10 for negative
+// values), or a mix of all lengths if `len` is 0.
+std::vector<int32_t> PackedVarintValues(int len, int n) {
+  static constexpr int kMixedLengths[] = {1, 2, 3, 4, 5, 10};
+  std::mt19937 rng(len);
+  std::vector<int32_t> values;
+  for (int i = 0; i < n; ++i) {
+    const int l = len != 0 ? len : kMixedLengths[i % 6];
+    if (l >= 10) {
+      values.push_back(-1 - static_cast<int32_t>(rng() & 0xffff));
+    } else if (l >= 5) {
+      values.push_back(static_cast<int32_t>((rng() | (1u << 28)) & 0x7fffffff));
+    } else {
+      const uint32_t min = l == 1 ? 0 : 1u << (7 * (l - 1));
+      const uint32_t max = (1u << (7 * l)) - 1;
+      values.push_back(static_cast<int32_t>(min + rng() % (max - min + 1)));
+    }
+  }
+  return values;
+}
+
+// Decodes a packed varint payload with each of the bulk decoding kernels.
+// The argument is the varint length, 0 meaning mixed lengths.
+template <protobuf::internal::PackedVarintKernel kKernel>
+static void BM_DecodePackedVarints(benchmark::State& state) {
+  upb_benchmark::SourceCodeInfo::Location location;
+  for (int32_t v : PackedVarintValues(state.range(0), 1 << 16)) {
+    location.add_path(v);
+  }
+  const std::string payload = location.SerializeAsString();
+  // Skip the tag and length of the packed field.
+  const char* begin = payload.data() + 1;
+  while (*begin++ & 0x80) {
+  }
+  const char* end = payload.data() + payload.size();
+  std::vector<uint32_t> out(end - begin + 1 +
+                            protobuf::internal::kPackedVarintOutputSlop);
+  for (auto _ : state) {
+    int count = 0;
+    benchmark::DoNotOptimize(
+        protobuf::internal::DecodePackedVarints<uint32_t, false>(
+            kKernel, begin, end, out.data(), &count));
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * (end - begin));
+}
+BENCHMARK_TEMPLATE(BM_DecodePackedVarints,
+                   protobuf::internal::PackedVarintKernel::kScalar)
+    ->DenseRange(0, 5)
+    ->Arg(10);
+BENCHMARK_TEMPLATE(BM_DecodePackedVarints,
+                   protobuf::internal::PackedVarintKernel::kSse41)
+    ->DenseRange(0, 5)
+    ->Arg(10);
+BENCHMARK_TEMPLATE(BM_DecodePackedVarints,
+                   protobuf::internal::PackedVarintKernel::kAvx2)
+    ->DenseRange(0, 5)
+    ->Arg(10);
+
+// Parses a message holding one large packed int32 field.
+static void BM_ParsePackedVarint_Proto2(benchmark::State& state) {
+  upb_benchmark::SourceCodeInfo::Location location;
+  for (int32_t v : PackedVarintValues(state.range(0), 1 << 16)) {
+    location.add_path(v);
+  }
+  const std::string payload = location.SerializeAsString();
+  for (auto _ : state) {
+    protobuf::Arena arena;
+    auto* proto =
+        protobuf::Arena::Create<upb_benchmark::SourceCodeInfo::Location>(
+            &arena);
+    if (!proto->ParseFromString(payload)) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BM_ParsePackedVarint_Proto2)->DenseRange(0, 5)->Arg(10);
+
 static void BM_SerializeDescriptor_Proto2(benchmark::State& state) {
   upb_benchmark::FileDescriptorProto proto;
   proto.ParseFromArray(descriptor.data, descriptor.size);
@@ -432,6 +900,25 @@ static void BM_JsonParse_Proto2(benchmark::State& state) {
 }
 BENCHMARK(BM_JsonParse_Proto2);
 
+// Pretty-printed JSON, as is common for hand-written or logged payloads, is
+// mostly whitespace and string contents, which the lexer scans in bulk.
+static void BM_JsonParse_Proto2_Pretty(benchmark::State& state) {
+  protobuf::FileDescriptorProto proto;
+  absl::string_view input(descriptor.data, descriptor.size);
+  proto.ParseFromString(input);
+  google::protobuf::json::PrintOptions options;
+  options.add_whitespace = true;
+  std::string json;
+  ABSL_CHECK_OK(
+      google::protobuf::json::MessageToJsonString(proto, &json, options));
+  for (auto _ : state) {
+    protobuf::FileDescriptorProto proto;
+    ABSL_CHECK_OK(google::protobuf::json::JsonStringToMessage(json, &proto));
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_JsonParse_Proto2_Pretty);
+
 static void BM_JsonSerialize_Upb(benchmark::State& state) {
   upb_Arena* arena = upb_Arena_New();
   upb_benchmark_FileDescriptorProto* set =
@@ -469,3 +956,243 @@ static void BM_JsonSerialize_Proto2(benchmark::State& state) {
   state.SetBytesProcessed(state.iterations() * json.size());
 }
 BENCHMARK(BM_JsonSerialize_Proto2);
+
+// Metric dumps are mostly doubles with arbitrary bits in the low digits.
+static std::vector<double> MetricDoubles() {
+  std::mt19937 rng;
+  std::uniform_real_distribution<double> dist(0, 1000);
+  std::vector<double> values(1024);
+  for (double& v : values) v = dist(rng);
+  return values;
+}
+
+static void BM_Dtoa_Simple(benchmark::State& state) {
+  std::vector<double> values = MetricDoubles();
+  for (auto _ : state) {
+    for (double v : values) {
+      benchmark::DoNotOptimize(protobuf::io::SimpleDtoa(v));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_Dtoa_Simple);
+
+static void BM_Dtoa_Shortest(benchmark::State& state) {
+  std::vector<double> values = MetricDoubles();
+  char buffer[protobuf::io::kShortestToBufferSize];
+  for (auto _ : state) {
+    for (double v : values) {
+      benchmark::DoNotOptimize(protobuf::io::ShortestDtoa(v, buffer));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_Dtoa_Shortest);
+
+// Large `bytes` payloads, such as images or embeddings, are dominated by the
+// base64 conversion. A BytesValue is printed as a bare JSON string.
+static std::string BytesBlob(size_t size) {
+  std::string blob(size, '\0');
+  std::mt19937 rng;
+  for (char& c : blob) c = static_cast<char>(rng());
+  return blob;
+}
+
+static void BM_JsonSerialize_Bytes(benchmark::State& state) {
+  protobuf::BytesValue proto;
+  proto.set_value(BytesBlob(state.range(0)));
+  std::string json;
+  for (auto _ : state) {
+    json.clear();
+    ABSL_CHECK_OK(google::protobuf::json::MessageToJsonString(proto, &json));
+  }
+  state.SetBytesProcessed(state.iterations() * proto.value().size());
+}
+BENCHMARK(BM_JsonSerialize_Bytes)->Range(1 << 10, 10 << 20);
+
+static void BM_JsonParse_Bytes(benchmark::State& state) {
+  protobuf::BytesValue proto;
+  proto.set_value(BytesBlob(state.range(0)));
+  std::string json;
+  ABSL_CHECK_OK(google::protobuf::json::MessageToJsonString(proto, &json));
+  for (auto _ : state) {
+    protobuf::BytesValue proto;
+    ABSL_CHECK_OK(google::protobuf::json::JsonStringToMessage(json, &proto));
+  }
+  state.SetBytesProcessed(state.iterations() * proto.value().size());
+}
+BENCHMARK(BM_JsonParse_Bytes)->Range(1 << 10, 10 << 20);
+
+// Converts the serialized FileDescriptorProto straight to JSON through a
+// TypeResolver, as a proxy or gateway would, without building a message.
+static void BM_BinaryToJson_Proto2(benchmark::State& state) {
+  std::unique_ptr<google::protobuf::util::TypeResolver> resolver(
+      google::protobuf::util::NewTypeResolverForDescriptorPool(
+          "type.googleapis.com", protobuf::DescriptorPool::generated_pool()));
+  const std::string type_url = absl::StrCat(
+      "type.googleapis.com/",
+      protobuf::FileDescriptorProto::descriptor()->full_name());
+  std::string input(descriptor.data, descriptor.size);
+  std::string json;
+  for (auto _ : state) {
+    json.clear();
+    ABSL_CHECK_OK(google::protobuf::json::BinaryToJsonString(
+        resolver.get(), type_url, input, &json));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_BinaryToJson_Proto2);
+
+// Looks up the message types of descriptor.proto from many threads at once,
+// in a pool that loaded them from a DescriptorDatabase.  Lookups of symbols
+// that are already built don't lock, so this should scale with the threads.
+static void BM_FindMessageTypeByName_Proto2(benchmark::State& state) {
+  struct Setup {
+    protobuf::SimpleDescriptorDatabase database;
+    std::unique_ptr<protobuf::DescriptorPool> pool;
+    std::vector<std::string> names;
+  };
+  static const Setup* setup = [] {
+    auto* setup = new Setup;
+    protobuf::FileDescriptorProto file;
+    upb_benchmark::FileDescriptorProto::descriptor()->file()->CopyTo(&file);
+    ABSL_CHECK(setup->database.Add(file));
+    setup->pool = std::make_unique<protobuf::DescriptorPool>(&setup->database);
+    for (const auto& message : file.message_type()) {
+      setup->names.push_back(absl::StrCat(file.package(), ".", message.name()));
+    }
+    // Load the file up front, so that only lookups are measured.
+    ABSL_CHECK(setup->pool->FindFileByName(file.name()) != nullptr);
+    return setup;
+  }();
+  size_t i = state.thread_index();
+  for (auto _ : state) {
+    const protobuf::Descriptor* d = setup->pool->FindMessageTypeByName(
+        setup->names[i++ % setup->names.size()]);
+    benchmark::DoNotOptimize(d);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindMessageTypeByName_Proto2)->ThreadRange(1, 64);
+
+enum TextPrinterPath {
+  FastPrinter,
+  GeneralPrinter,
+};
+
+// The printer formats values directly unless custom field value printers are
+// registered; registering one for a field that is never printed forces the
+// general, virtual-dispatch path for comparison.
+template <TextPrinterPath Path>
+static void PrintTextFormat(const protobuf::Message& message,
+                            benchmark::State& state) {
+  protobuf::TextFormat::Printer printer;
+  if (Path == GeneralPrinter) {
+    printer.RegisterFieldValuePrinter(
+        protobuf::DoubleValue::descriptor()->field(0),
+        new protobuf::TextFormat::FastFieldValuePrinter());
+  }
+  std::string text;
+  for (auto _ : state) {
+    printer.PrintToString(message, &text);
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+
+// A deeply nested message: the parsed descriptor.proto.
+template <TextPrinterPath Path>
+static void BM_TextFormatPrint_Proto2(benchmark::State& state) {
+  protobuf::FileDescriptorProto proto;
+  proto.ParseFromString(absl::string_view(descriptor.data, descriptor.size));
+  PrintTextFormat<Path>(proto, state);
+}
+BENCHMARK_TEMPLATE(BM_TextFormatPrint_Proto2, FastPrinter);
+BENCHMARK_TEMPLATE(BM_TextFormatPrint_Proto2, GeneralPrinter);
+
+// A flat message with `state.range(0)` int64, double and string fields.
+template <TextPrinterPath Path>
+static void BM_TextFormatPrint_Wide(benchmark::State& state) {
+  protobuf::FileDescriptorProto file;
+  file.set_name("wide.proto");
+  protobuf::DescriptorProto* type = file.add_message_type();
+  type->set_name("Wide");
+  for (int i = 0; i < state.range(0); ++i) {
+    protobuf::FieldDescriptorProto* field = type->add_field();
+    field->set_name(absl::StrCat("field_", i));
+    field->set_number(i + 1);
+    field->set_label(protobuf::FieldDescriptorProto::LABEL_OPTIONAL);
+    field->set_type(i % 3 == 0   ? protobuf::FieldDescriptorProto::TYPE_INT64
+                    : i % 3 == 1 ? protobuf::FieldDescriptorProto::TYPE_DOUBLE
+                                 : protobuf::FieldDescriptorProto::TYPE_STRING);
+  }
+  protobuf::DescriptorPool pool;
+  const protobuf::Descriptor* d = pool.BuildFile(file)->message_type(0);
+  protobuf::DynamicMessageFactory factory;
+  std::unique_ptr<protobuf::Message> message(factory.GetPrototype(d)->New());
+  const protobuf::Reflection* reflection = message->GetReflection();
+  for (int i = 0; i < d->field_count(); ++i) {
+    const protobuf::FieldDescriptor* field = d->field(i);
+    switch (field->cpp_type()) {
+      case protobuf::FieldDescriptor::CPPTYPE_INT64:
+        reflection->SetInt64(message.get(), field, i * int64_t{1234567});
+        break;
+      case protobuf::FieldDescriptor::CPPTYPE_DOUBLE:
+        reflection->SetDouble(message.get(), field, i / 7.0);
+        break;
+      default:
+        reflection->SetString(message.get(), field, absl::StrCat("value_", i));
+        break;
+    }
+  }
+  PrintTextFormat<Path>(*message, state);
+}
+BENCHMARK_TEMPLATE(BM_TextFormatPrint_Wide, FastPrinter)->Arg(16)->Arg(256);
+BENCHMARK_TEMPLATE(BM_TextFormatPrint_Wide, GeneralPrinter)->Arg(16)->Arg(256);
+
+enum TokenizerInput { ProtoSource, TextProto };
+
+class CheckingErrorCollector : public protobuf::io::ErrorCollector {
+ public:
+  void RecordError(int line, protobuf::io::ColumnNumber column,
+                   absl::string_view message) override {
+    ABSL_LOG(FATAL) << line << ":" << column << ": " << message;
+  }
+};
+
+// Splits .proto source the way protoc does, or a text proto the way
+// TextFormat::Parser does.
+template <TokenizerInput Input>
+static void BM_Tokenize(benchmark::State& state) {
+  std::string text;
+  if (Input == ProtoSource) {
+    text = protobuf::FileDescriptorProto::descriptor()->file()->DebugString();
+  } else {
+    protobuf::FileDescriptorProto proto;
+    proto.ParseFromString(absl::string_view(descriptor.data, descriptor.size));
+    protobuf::TextFormat::PrintToString(proto, &text);
+  }
+  CheckingErrorCollector error_collector;
+  for (auto _ : state) {
+    protobuf::io::ArrayInputStream input(text.data(),
+                                         static_cast<int>(text.size()));
+    protobuf::io::Tokenizer tokenizer(&input, &error_collector);
+    std::string prev_trailing_comments;
+    std::vector<std::string> detached_comments;
+    std::string next_leading_comments;
+    if (Input == ProtoSource) {
+      while (tokenizer.NextWithComments(&prev_trailing_comments,
+                                        &detached_comments,
+                                        &next_leading_comments)) {
+      }
+    } else {
+      while (tokenizer.Next()) {
+      }
+    }
+    benchmark::DoNotOptimize(tokenizer.current());
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK_TEMPLATE(BM_Tokenize, ProtoSource);
+BENCHMARK_TEMPLATE(BM_Tokenize, TextProto);
+
+#include "upb/port/undef.inc"
@@ -37,4 +37,4 @@ set_target_properties(libupb PROPERTIES
     VISIBILITY_INLINES_HIDDEN ON
 )
 add_library(protobuf::libupb ALIAS libupb)
-target_link_libraries(libupb PRIVATE utf8_range)
+target_link_libraries(libupb PRIVATE utf8_range ${CMAKE_THREAD_LIBS_INIT})
@@ -806,6 +806,16 @@ uint64_t ThreadSafeArena::Reset() {
   return space_allocated;
 }
 
+void ThreadSafeArena::AdoptFirstSerialArena() {
+  // Only valid right after construction or Reset(), when no other SerialArena
+  // can hold a reference to the previous owner.
+  ABSL_DCHECK(head_.load(std::memory_order_relaxed)->IsSentry());
+  // A new lifecycle id invalidates the previous owner's thread cache entry.
+  tag_and_id_ = GetNextLifeCycleId();
+  first_owner_ = &thread_cache();
+  CacheSerialArena(&first_arena_);
+}
+
 void* ThreadSafeArena::AllocateAlignedWithCleanup(size_t n, size_t align,
                                                   void (*destructor)(void*)) {
   SerialArena* arena;
@@ -50,6 +50,7 @@ namespace google {
 namespace protobuf {
 
 struct ArenaOptions;  // defined below
+class ArenaPool;      // defined in arena_pool.h
 class Arena;    // defined below
 class Message;  // defined in message.h
 class MessageLite;
@@ -674,6 +675,7 @@ class PROTOBUF_EXPORT PROTOBUF_ALIGNAS(8) Arena final {
   friend class internal::UntypedMapBase;        // For ReturnArrayMemory
   friend class internal::ExtensionSet;          // For ReturnArrayMemory
 
+  friend class ArenaPool;  // For AdoptFirstSerialArena
   friend struct internal::ArenaTestPeer;
 };
 
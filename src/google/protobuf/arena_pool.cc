@@ -0,0 +1,175 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/arena_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/arena_allocation_policy.h"
+#include "google/protobuf/port.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+internal::SizedPtr AllocateRetainedBlock(const ArenaPoolOptions& options,
+                                         size_t size) {
+  if (options.block_alloc == nullptr) {
+    return internal::AllocateAtLeast(size);
+  }
+  return {options.block_alloc(size), size};
+}
+
+void DeallocateRetainedBlock(const ArenaPoolOptions& options, void* p,
+                             size_t size) {
+  if (options.block_dealloc == nullptr) {
+    internal::SizedDelete(p, size);
+  } else {
+    options.block_dealloc(p, size);
+  }
+}
+
+}  // namespace
+
+// An Entry owns one pooled Arena together with the block it was constructed
+// on. The arena is stored first so that an Arena* handed out by the pool maps
+// back to its Entry.
+struct ArenaPool::Entry {
+  alignas(Arena) unsigned char arena_storage[sizeof(Arena)];
+  void* block;
+  size_t block_size;
+
+  Arena* arena() { return reinterpret_cast<Arena*>(arena_storage); }
+  static Entry* FromArena(Arena* arena) {
+    return reinterpret_cast<Entry*>(arena);
+  }
+
+  void ConstructArena(const ArenaPoolOptions& options) {
+    ArenaOptions arena_options;
+    arena_options.max_block_size = options.max_block_size;
+    arena_options.initial_block = static_cast<char*>(block);
+    arena_options.initial_block_size = block_size;
+    arena_options.block_alloc = options.block_alloc;
+    arena_options.block_dealloc = options.block_dealloc;
+    new (arena_storage) Arena(arena_options);
+  }
+};
+
+ArenaPool::ArenaPool(const ArenaPoolOptions& options) : options_(options) {}
+
+ArenaPool::~ArenaPool() { Clear(); }
+
+Arena* ArenaPool::Acquire() {
+  Entry* entry = nullptr;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (!idle_.empty()) {
+      entry = idle_.back();
+      idle_.pop_back();
+      retained_bytes_ -= entry->block_size;
+    }
+  }
+  if (entry == nullptr) {
+    return NewEntry(options_.initial_block_size)->arena();
+  }
+  // The arena was reset on the releasing thread; let this thread allocate from
+  // the retained block.
+  entry->arena()->impl_.AdoptFirstSerialArena();
+  return entry->arena();
+}
+
+void ArenaPool::Release(Arena* arena) {
+  Entry* entry = Entry::FromArena(arena);
+
+  // Everything beyond the retained block was allocated on demand during this
+  // lifetime. Grow the retained block geometrically towards that footprint so
+  // that repeated workloads of the same shape stop allocating.
+  const uint64_t footprint = arena->SpaceAllocated();
+  if (footprint > entry->block_size &&
+      entry->block_size < options_.max_retained_block_size) {
+    const size_t grown = std::max(static_cast<size_t>(footprint),
+                                  2 * entry->block_size);
+    Regrow(entry, std::min(grown, options_.max_retained_block_size));
+  } else {
+    arena->Reset();
+  }
+
+  {
+    absl::MutexLock lock(&mutex_);
+    if (idle_.size() < options_.max_idle_arenas) {
+      idle_.push_back(entry);
+      retained_bytes_ += entry->block_size;
+      return;
+    }
+  }
+  DeleteEntry(entry);
+}
+
+void ArenaPool::Clear() {
+  std::vector<Entry*> idle;
+  {
+    absl::MutexLock lock(&mutex_);
+    idle.swap(idle_);
+    retained_bytes_ = 0;
+  }
+  for (Entry* entry : idle) {
+    DeleteEntry(entry);
+  }
+}
+
+size_t ArenaPool::idle_arenas() const {
+  absl::MutexLock lock(&mutex_);
+  return idle_.size();
+}
+
+uint64_t ArenaPool::retained_bytes() const {
+  absl::MutexLock lock(&mutex_);
+  return retained_bytes_;
+}
+
+ArenaPool::Entry* ArenaPool::NewEntry(size_t block_size) {
+  // The block must at least hold the block header and an AllocationPolicy.
+  block_size = std::max(block_size,
+                        internal::AllocationPolicy::kDefaultStartBlockSize);
+  internal::SizedPtr mem = AllocateRetainedBlock(options_, block_size);
+  Entry* entry = new Entry;
+  entry->block = mem.p;
+  entry->block_size = mem.n;
+  entry->ConstructArena(options_);
+  return entry;
+}
+
+void ArenaPool::DeleteEntry(Entry* entry) {
+  entry->arena()->~Arena();
+  DeallocateRetainedBlock(options_, entry->block, entry->block_size);
+  delete entry;
+}
+
+void ArenaPool::Regrow(Entry* entry, size_t block_size) {
+  // Destroying the arena runs its cleanups and frees every block except the
+  // user-owned initial one, which is ours to replace.
+  entry->arena()->~Arena();
+  DeallocateRetainedBlock(options_, entry->block, entry->block_size);
+  internal::SizedPtr mem = AllocateRetainedBlock(options_, block_size);
+  entry->block = mem.p;
+  entry->block_size = mem.n;
+  entry->ConstructArena(options_);
+}
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
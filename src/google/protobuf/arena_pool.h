@@ -0,0 +1,122 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines ArenaPool, a thread-safe cache of Arenas for
+// request-scoped message allocation.
+
+#ifndef GOOGLE_PROTOBUF_ARENA_POOL_H__
+#define GOOGLE_PROTOBUF_ARENA_POOL_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/port.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+// ArenaPoolOptions controls the memory retained by an ArenaPool.
+struct ArenaPoolOptions {
+  // Size of the first block given to a newly created arena.
+  size_t initial_block_size = 4 << 10;
+
+  // High-water mark for the block retained by each idle arena. When an arena
+  // is released after its lifetime spilled into additional blocks, its
+  // retained block is regrown to the total footprint, but never beyond this
+  // limit. Arenas exceeding it are simply Reset() and keep their current
+  // block.
+  size_t max_retained_block_size = 1 << 20;
+
+  // Maximum number of idle arenas kept in the pool. Arenas released while the
+  // pool is full are destroyed and their memory returned.
+  size_t max_idle_arenas = 64;
+
+  // Upper bound for blocks allocated by an arena once its retained block is
+  // full. See ArenaOptions::max_block_size.
+  size_t max_block_size = internal::AllocationPolicy::kDefaultMaxBlockSize;
+
+  // Optional block allocation functions used both for retained blocks and for
+  // the overflow blocks of pooled arenas. See ArenaOptions.
+  void* (*block_alloc)(size_t) = nullptr;
+  void (*block_dealloc)(void*, size_t) = nullptr;
+};
+
+// ArenaPool hands out Arenas that are recycled instead of destroyed. Releasing
+// an arena runs its destructors and frees every block except one retained
+// block, which the next user of the arena allocates from. The retained block
+// grows to the largest footprint observed (up to
+// ArenaPoolOptions::max_retained_block_size), so a steady-state workload whose
+// per-request allocations fit in it performs no block allocation at all.
+//
+// Example:
+//
+//   ArenaPool pool;
+//   ...
+//   Arena* arena = pool.Acquire();
+//   auto* request = Arena::Create<MyRequest>(arena);
+//   ...
+//   pool.Release(arena);  // `request` is unusable from here on.
+//
+// Acquire() and Release() are thread-safe and may be called from different
+// threads for the same arena. Like destruction, Release() must not race with
+// other uses of the arena being released.
+class PROTOBUF_EXPORT ArenaPool {
+ public:
+  ArenaPool() : ArenaPool(ArenaPoolOptions()) {}
+  explicit ArenaPool(const ArenaPoolOptions& options);
+
+  ArenaPool(const ArenaPool&) = delete;
+  ArenaPool& operator=(const ArenaPool&) = delete;
+
+  // All arenas must have been released before the pool is destroyed.
+  ~ArenaPool();
+
+  // Returns an empty arena owned by the pool. The calling thread becomes the
+  // arena's primary allocating thread.
+  Arena* Acquire();
+
+  // Resets `arena` and returns it to the pool. `arena` must have been obtained
+  // from Acquire() on this pool.
+  void Release(Arena* arena);
+
+  // Destroys all idle arenas and frees their retained blocks.
+  void Clear();
+
+  // Number of arenas currently idle in the pool.
+  size_t idle_arenas() const;
+
+  // Total size of the blocks retained by idle arenas.
+  uint64_t retained_bytes() const;
+
+ private:
+  struct Entry;
+
+  Entry* NewEntry(size_t block_size);
+  void DeleteEntry(Entry* entry);
+  // Replaces the retained block of `entry` by one of `block_size` bytes.
+  void Regrow(Entry* entry, size_t block_size);
+
+  const ArenaPoolOptions options_;
+
+  mutable absl::Mutex mutex_;
+  std::vector<Entry*> idle_ ABSL_GUARDED_BY(mutex_);
+  uint64_t retained_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_ARENA_POOL_H__
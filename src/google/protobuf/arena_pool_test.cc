@@ -0,0 +1,163 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/arena_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/arena.h"
+#include "google/protobuf/unittest.pb.h"
+
+// Must be included last
+#include "google/protobuf/port_def.inc"
+
+using protobuf_unittest::TestAllTypes;
+
+namespace google {
+namespace protobuf {
+namespace {
+
+int block_allocs = 0;
+int block_deallocs = 0;
+
+void* CountingAlloc(size_t size) {
+  ++block_allocs;
+  return malloc(size);
+}
+
+void CountingDealloc(void* p, size_t) {
+  ++block_deallocs;
+  free(p);
+}
+
+class ArenaPoolTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    block_allocs = 0;
+    block_deallocs = 0;
+    options_.initial_block_size = 1024;
+    options_.block_alloc = CountingAlloc;
+    options_.block_dealloc = CountingDealloc;
+  }
+
+  // Populates a message large enough to spill out of a 1KB block.
+  static void FillRequest(Arena* arena) {
+    auto* message = Arena::Create<TestAllTypes>(arena);
+    for (int i = 0; i < 64; ++i) {
+      message->add_repeated_int64(i);
+      message->add_repeated_nested_message()->set_bb(i);
+    }
+  }
+
+  ArenaPoolOptions options_;
+};
+
+TEST_F(ArenaPoolTest, ReusesReleasedArena) {
+  ArenaPool pool(options_);
+  Arena* arena = pool.Acquire();
+  EXPECT_EQ(pool.idle_arenas(), 0u);
+  pool.Release(arena);
+  EXPECT_EQ(pool.idle_arenas(), 1u);
+  EXPECT_EQ(pool.Acquire(), arena);
+  EXPECT_EQ(pool.idle_arenas(), 0u);
+  pool.Release(arena);
+}
+
+TEST_F(ArenaPoolTest, SteadyStateDoesNotAllocate) {
+  ArenaPool pool(options_);
+  // Let the retained block grow to the footprint of the workload.
+  for (int i = 0; i < 8; ++i) {
+    Arena* arena = pool.Acquire();
+    FillRequest(arena);
+    pool.Release(arena);
+  }
+
+  const int allocs = block_allocs;
+  for (int i = 0; i < 100; ++i) {
+    Arena* arena = pool.Acquire();
+    FillRequest(arena);
+    pool.Release(arena);
+  }
+  EXPECT_EQ(block_allocs, allocs);
+  EXPECT_GT(pool.retained_bytes(), options_.initial_block_size);
+}
+
+TEST_F(ArenaPoolTest, RetainedBlockIsCappedByHighWaterMark) {
+  options_.max_retained_block_size = 2048;
+  ArenaPool pool(options_);
+  for (int i = 0; i < 8; ++i) {
+    Arena* arena = pool.Acquire();
+    FillRequest(arena);
+    pool.Release(arena);
+  }
+  EXPECT_LE(pool.retained_bytes(), options_.max_retained_block_size);
+}
+
+TEST_F(ArenaPoolTest, RespectsMaxIdleArenas) {
+  options_.max_idle_arenas = 1;
+  ArenaPool pool(options_);
+  Arena* a = pool.Acquire();
+  Arena* b = pool.Acquire();
+  pool.Release(a);
+  pool.Release(b);
+  EXPECT_EQ(pool.idle_arenas(), 1u);
+}
+
+TEST_F(ArenaPoolTest, ClearFreesRetainedBlocks) {
+  {
+    ArenaPool pool(options_);
+    Arena* arena = pool.Acquire();
+    FillRequest(arena);
+    pool.Release(arena);
+    pool.Clear();
+    EXPECT_EQ(pool.idle_arenas(), 0u);
+    EXPECT_EQ(pool.retained_bytes(), 0u);
+    EXPECT_EQ(block_allocs, block_deallocs);
+  }
+  EXPECT_EQ(block_allocs, block_deallocs);
+}
+
+TEST_F(ArenaPoolTest, ReleaseRunsDestructors) {
+  ArenaPool pool(options_);
+  Arena* arena = pool.Acquire();
+  bool destroyed = false;
+  struct SetOnDestroy {
+    explicit SetOnDestroy(bool* flag) : flag(flag) {}
+    ~SetOnDestroy() { *flag = true; }
+    bool* flag;
+  };
+  Arena::Create<SetOnDestroy>(arena, &destroyed);
+  pool.Release(arena);
+  EXPECT_TRUE(destroyed);
+}
+
+TEST_F(ArenaPoolTest, AcquireOnAnotherThreadUsesRetainedBlock) {
+  ArenaPool pool(options_);
+  for (int i = 0; i < 8; ++i) {
+    Arena* arena = pool.Acquire();
+    FillRequest(arena);
+    pool.Release(arena);
+  }
+
+  const int allocs = block_allocs;
+  std::thread([&] {
+    Arena* arena = pool.Acquire();
+    FillRequest(arena);
+    pool.Release(arena);
+  }).join();
+  EXPECT_EQ(block_allocs, allocs);
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -89,6 +89,14 @@ class PROTOC_EXPORT CodeGenerator {
                            GeneratorContext* generator_context,
                            std::string* error) const;
 
+  // Returns true if this generator can run on several threads at once, each
+  // calling GenerateAll() for a single file with a GeneratorContext of its
+  // own.  protoc --jobs only generates files in parallel for generators that
+  // return true.  Such generators must produce the same output for a file
+  // regardless of which other files are compiled with it, and must only
+  // write files with GeneratorContext::Open().
+  virtual bool SupportsParallelGeneration() const { return false; }
+
   // This must be kept in sync with plugin.proto. See that file for
   // documentation on each value.
   // TODO Use CodeGeneratorResponse.Feature here.
@@ -18,6 +18,7 @@
 #include <sys/types.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
@@ -26,6 +27,7 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
 #ifdef major
@@ -61,6 +63,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_replace.h"
@@ -455,6 +458,11 @@ class CommandLineInterface::GeneratorContextImpl : public GeneratorContext {
 
   // Get name of all output files.
   void GetOutputFilenames(std::vector<std::string>* output_filenames);
+
+  // Move all the files written to other into this directory, as if they had
+  // been written here with Open().
+  void TakeFilesFrom(GeneratorContextImpl& other);
+
   // implements GeneratorContext --------------------------------------
   io::ZeroCopyOutputStream* Open(const std::string& filename) override;
   io::ZeroCopyOutputStream* OpenForAppend(const std::string& filename) override;
@@ -675,6 +683,22 @@ void CommandLineInterface::GeneratorContextImpl::GetOutputFilenames(
   }
 }
 
+void CommandLineInterface::GeneratorContextImpl::TakeFilesFrom(
+    GeneratorContextImpl& other) {
+  for (auto& pair : other.files_) {
+    auto it = files_.insert({pair.first, ""});
+    if (!it.second) {
+      std::cerr << pair.first << ": Tried to write the same file twice."
+                << std::endl;
+      had_error_ = true;
+      continue;
+    }
+    it.first->second.swap(pair.second);
+  }
+  other.files_.clear();
+  had_error_ = had_error_ || other.had_error_;
+}
+
 io::ZeroCopyOutputStream* CommandLineInterface::GeneratorContextImpl::Open(
     const std::string& filename) {
   return new MemoryOutputStream(this, filename, false);
@@ -1264,6 +1288,12 @@ int CommandLineInterface::Run(int argc, const char* const argv[]) {
   ) {
     descriptor_pool->EnforceExtensionDeclarations(true);
   }
+  // With --jobs, parse the input files and their imports up front on several
+  // threads.  The pool still builds them one at a time, in dependency order,
+  // as ParseInputFiles() asks for them.
+  if (jobs_ > 1 && source_tree_database != nullptr) {
+    source_tree_database->PreparseFiles(input_files_, jobs_);
+  }
   if (!ParseInputFiles(descriptor_pool.get(), disk_source_tree.get(),
                        &parsed_files)) {
     return 1;
@@ -1674,6 +1704,7 @@ void CommandLineInterface::Clear() {
   disallow_services_ = false;
   direct_dependencies_explicitly_set_ = false;
   deterministic_output_ = false;
+  jobs_ = 1;
 }
 
 bool CommandLineInterface::MakeProtoProtoPathRelative(
@@ -2272,6 +2303,13 @@ CommandLineInterface::InterpretArgument(const std::string& name,
       return PARSE_ARGUMENT_FAIL;
     }
 
+  } else if (name == "--jobs") {
+    if (!absl::SimpleAtoi(value, &jobs_) || jobs_ < 1) {
+      std::cerr << "Invalid value for --jobs: " << value
+                << ". Expected a positive number of threads." << std::endl;
+      return PARSE_ARGUMENT_FAIL;
+    }
+
   } else if (name == "--fatal_warnings") {
     if (fatal_warnings_) {
       std::cerr << name << " may only be passed once." << std::endl;
@@ -2501,6 +2539,10 @@ Parse PROTO_FILES and generate output based on the options given:
   --error_format=FORMAT       Set the format in which to print errors.
                               FORMAT may be 'gcc' (the default) or 'msvs'
                               (Microsoft Visual Studio format).
+  --jobs=N                    Use up to N threads to parse the input files
+                              and their imports, and to run the built-in
+                              code generators that support it.  The output
+                              is the same as without --jobs.
   --fatal_warnings            Make warnings be fatal (similar to -Werr in
                               gcc). This flag will make protoc return
                               with a non-zero exit code if any warnings
@@ -2620,7 +2662,7 @@ bool CommandLineInterface::EnforceEditionsSupport(
 bool CommandLineInterface::GenerateOutput(
     const std::vector<const FileDescriptor*>& parsed_files,
     const OutputDirective& output_directive,
-    GeneratorContext* generator_context) {
+    GeneratorContextImpl* generator_context) {
   // Call the generator.
   std::string error;
   if (output_directive.generator == nullptr) {
@@ -2665,8 +2707,14 @@ bool CommandLineInterface::GenerateOutput(
       return false;
     }
 
-    if (!output_directive.generator->GenerateAll(parsed_files, parameters,
-                                                 generator_context, &error)) {
+    bool succeeded =
+        jobs_ > 1 && parsed_files.size() > 1 &&
+                output_directive.generator->SupportsParallelGeneration()
+            ? GenerateAllInParallel(*output_directive.generator, parsed_files,
+                                    parameters, generator_context, &error)
+            : output_directive.generator->GenerateAll(
+                  parsed_files, parameters, generator_context, &error);
+    if (!succeeded) {
       // Generator returned an error.
       std::cerr << output_directive.name << ": " << error << std::endl;
       return false;
@@ -2676,6 +2724,51 @@ bool CommandLineInterface::GenerateOutput(
   return true;
 }
 
+bool CommandLineInterface::GenerateAllInParallel(
+    const CodeGenerator& generator,
+    const std::vector<const FileDescriptor*>& parsed_files,
+    const std::string& parameter, GeneratorContextImpl* generator_context,
+    std::string* error) {
+  struct FileOutput {
+    std::unique_ptr<GeneratorContextImpl> directory;
+    std::string error;
+    bool succeeded = false;
+  };
+  std::vector<FileOutput> outputs(parsed_files.size());
+
+  // Files are handed out one at a time, since their sizes vary a lot.
+  std::atomic<size_t> next_file{0};
+  auto worker = [&] {
+    for (size_t i = next_file++; i < parsed_files.size(); i = next_file++) {
+      FileOutput& output = outputs[i];
+      output.directory = std::make_unique<GeneratorContextImpl>(parsed_files);
+      output.succeeded = generator.GenerateAll(
+          {parsed_files[i]}, parameter, output.directory.get(), &output.error);
+    }
+  };
+  std::vector<std::thread> threads;
+  size_t num_threads =
+      std::min(static_cast<size_t>(jobs_), parsed_files.size());
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Collect the output in input order, stopping at the first file that
+  // failed, as GenerateAll() would.
+  for (FileOutput& output : outputs) {
+    if (!output.succeeded) {
+      *error = std::move(output.error);
+      return false;
+    }
+    generator_context->TakeFilesFrom(*output.directory);
+  }
+  return true;
+}
+
 bool CommandLineInterface::GenerateDependencyManifestFile(
     const std::vector<const FileDescriptor*>& parsed_files,
     const GeneratorContextMap& output_directories,
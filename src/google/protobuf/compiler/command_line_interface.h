@@ -287,7 +287,15 @@ class PROTOC_EXPORT CommandLineInterface {
   struct OutputDirective;  // see below
   bool GenerateOutput(const std::vector<const FileDescriptor*>& parsed_files,
                       const OutputDirective& output_directive,
-                      GeneratorContext* generator_context);
+                      GeneratorContextImpl* generator_context);
+  // Implements --jobs for generators that support it: calls GenerateAll()
+  // for each file on its own thread, then adds the output to
+  // generator_context in the order of parsed_files.
+  bool GenerateAllInParallel(
+      const CodeGenerator& generator,
+      const std::vector<const FileDescriptor*>& parsed_files,
+      const std::string& parameter, GeneratorContextImpl* generator_context,
+      std::string* error);
   bool GeneratePluginOutput(
       const std::vector<const FileDescriptor*>& parsed_files,
       const std::string& plugin_name, const std::string& parameter,
@@ -472,6 +480,9 @@ class PROTOC_EXPORT CommandLineInterface {
   // When using --encode, this will be passed to SetSerializationDeterministic.
   bool deterministic_output_ = false;
 
+  // Number of threads to parse and generate with, set by --jobs.
+  int jobs_ = 1;
+
   bool opensource_runtime_ = google::protobuf::internal::IsOss();
 
 };
@@ -239,6 +239,14 @@ class CommandLineInterfaceTest::NullCodeGenerator : public CodeGenerator {
   }
 };
 
+// A MockCodeGenerator that lets --jobs run it on several files at once.
+class ParallelMockCodeGenerator : public MockCodeGenerator {
+ public:
+  using MockCodeGenerator::MockCodeGenerator;
+
+  bool SupportsParallelGeneration() const override { return true; }
+};
+
 class ProtocMinimalCLITest : public CommandLineInterfaceTest {
  protected:
   void SetUp() override {}
@@ -746,6 +754,115 @@ TEST_F(CommandLineInterfaceTest, MultipleInputsWithImport) {
                                     "bar.proto", "Bar");
 }
 
+TEST_F(CommandLineInterfaceTest, MultipleInputsWithImport_Jobs) {
+  // Same as above, but with the files parsed and generated on several threads.
+  RegisterGenerator(
+      "--par_out", std::make_unique<ParallelMockCodeGenerator>("par_generator"),
+      "Parallel output.");
+
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Foo {}\n");
+  CreateTempFile("bar.proto",
+                 "syntax = \"proto2\";\n"
+                 "import \"baz.proto\";\n"
+                 "message Bar {\n"
+                 "  optional Baz a = 1;\n"
+                 "}\n");
+  CreateTempFile("baz.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Baz {}\n");
+
+  Run("protocol_compiler --jobs=4 --test_out=$tmpdir --par_out=$tmpdir "
+      "--plug_out=$tmpdir --proto_path=$tmpdir foo.proto bar.proto");
+
+  ExpectNoErrors();
+  ExpectGeneratedWithMultipleInputs("test_generator", "foo.proto,bar.proto",
+                                    "foo.proto", "Foo");
+  ExpectGeneratedWithMultipleInputs("test_generator", "foo.proto,bar.proto",
+                                    "bar.proto", "Bar");
+  ExpectGeneratedWithMultipleInputs("par_generator", "foo.proto,bar.proto",
+                                    "foo.proto", "Foo");
+  ExpectGeneratedWithMultipleInputs("par_generator", "foo.proto,bar.proto",
+                                    "bar.proto", "Bar");
+  ExpectGeneratedWithMultipleInputs("test_plugin", "foo.proto,bar.proto",
+                                    "foo.proto", "Foo");
+  ExpectGeneratedWithMultipleInputs("test_plugin", "foo.proto,bar.proto",
+                                    "bar.proto", "Bar");
+}
+
+TEST_F(CommandLineInterfaceTest, ManyInputsWithImports_JobsMatchesSerial) {
+  // Parsing and generating on several threads must produce the same
+  // descriptors and generated files as doing everything on one thread.
+  RegisterGenerator(
+      "--par_out", std::make_unique<ParallelMockCodeGenerator>("par_generator"),
+      "Parallel output.");
+
+  constexpr int kNumDeps = 4;
+  constexpr int kNumInputs = 8;
+  for (int i = 0; i < kNumDeps; ++i) {
+    CreateTempFile(absl::StrCat("dep", i, ".proto"),
+                   absl::StrCat("syntax = \"proto2\";\n"
+                                "message Dep",
+                                i,
+                                " {\n"
+                                "  optional int32 a = 1;\n"
+                                "}\n"));
+  }
+  std::string inputs;
+  for (int i = 0; i < kNumInputs; ++i) {
+    const int dep = i % kNumDeps;
+    const std::string name = absl::StrCat("file", i, ".proto");
+    CreateTempFile(name, absl::StrCat("syntax = \"proto2\";\n"
+                                      "import \"dep",
+                                      dep,
+                                      ".proto\";\n"
+                                      "message File",
+                                      i,
+                                      " {\n"
+                                      "  optional Dep",
+                                      dep,
+                                      " dep = 1;\n"
+                                      "}\n"));
+    absl::StrAppend(&inputs, " ", name);
+  }
+  CreateTempDir("serial");
+  CreateTempDir("parallel");
+
+  Run(absl::StrCat(
+      "protocol_compiler --par_out=$tmpdir/serial --include_imports "
+      "--include_source_info --descriptor_set_out=$tmpdir/serial.bin "
+      "--proto_path=$tmpdir",
+      inputs));
+  ExpectNoErrors();
+  Run(absl::StrCat(
+      "protocol_compiler --jobs=4 --par_out=$tmpdir/parallel --include_imports "
+      "--include_source_info --descriptor_set_out=$tmpdir/parallel.bin "
+      "--proto_path=$tmpdir",
+      inputs));
+  ExpectNoErrors();
+
+  EXPECT_EQ(ReadFile("parallel.bin"), ReadFile("serial.bin"));
+  for (int i = 0; i < kNumInputs; ++i) {
+    const std::string output = MockCodeGenerator::GetOutputFileName(
+        "par_generator", absl::StrCat("file", i, ".proto"));
+    SCOPED_TRACE(output);
+    EXPECT_EQ(ReadFile(absl::StrCat("parallel/", output)),
+              ReadFile(absl::StrCat("serial/", output)));
+  }
+}
+
+TEST_F(CommandLineInterfaceTest, JobsMustBePositive) {
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Foo {}\n");
+
+  Run("protocol_compiler --jobs=0 --test_out=$tmpdir "
+      "--proto_path=$tmpdir foo.proto");
+
+  ExpectErrorText(
+      "Invalid value for --jobs: 0. Expected a positive number of threads.\n");
+}
 
 TEST_F(CommandLineInterfaceTest, MultipleInputsWithImport_DescriptorSetIn) {
   // Test parsing multiple input files with an import of a separate file.
@@ -2777,6 +2894,32 @@ TEST_F(CommandLineInterfaceTest, ParseErrorsMultipleFiles) {
       "foo.proto:3:1: Import \"baz.proto\" was not found or had errors.\n");
 }
 
+TEST_F(CommandLineInterfaceTest, ParseErrorsMultipleFiles_Jobs) {
+  // Preparsing on several threads must not change which errors are reported
+  // or their order.
+  CreateTempFile("bar.proto",
+                 "syntax = \"proto2\";\n"
+                 "badsyntax\n");
+  CreateTempFile("baz.proto",
+                 "syntax = \"proto2\";\n"
+                 "import \"bar.proto\";\n"
+                 "message Baz {\n");
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "import \"bar.proto\";\n"
+                 "import \"baz.proto\";\n");
+
+  Run("protocol_compiler --jobs=3 --test_out=$tmpdir "
+      "--proto_path=$tmpdir foo.proto");
+
+  ExpectErrorText(
+      "bar.proto:2:1: Expected top-level statement (e.g. \"message\").\n"
+      "baz.proto:4:1: Reached end of input in message definition (missing "
+      "'}').\n"
+      "foo.proto:2:1: Import \"bar.proto\" was not found or had errors.\n"
+      "foo.proto:3:1: Import \"baz.proto\" was not found or had errors.\n");
+}
+
 TEST_F(CommandLineInterfaceTest, RecursiveImportFails) {
   // Create a proto file that imports itself.
   CreateTempFile("foo.proto",
@@ -493,6 +493,10 @@ void FileGenerator::GenerateSourceIncludes(io::Printer* p) {
   IncludeFile("third_party/protobuf/generated_message_util.h", p);
   IncludeFile("third_party/protobuf/wire_format_lite.h", p);
 
+  if (options_.table_driven_serialization) {
+    IncludeFile("third_party/protobuf/generated_message_tcserializer.h", p);
+  }
+
   if (ShouldVerify(file_, options_, &scc_analyzer_)) {
     IncludeFile("third_party/protobuf/wire_format_verify.h", p);
   }
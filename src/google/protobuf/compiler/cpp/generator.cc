@@ -119,6 +119,10 @@ bool CppGenerator::Generate(const FileDescriptor* file,
   //
   // If the lite option is passed to the compiler, we will generate the
   // current files and all transitive dependencies using the LITE runtime.
+  //
+  // If the table_driven_serialization option is passed to the compiler,
+  // messages will serialize themselves by walking their parse table instead of
+  // generating code for each field, which trades some speed for code size.
   Options file_options;
 
   file_options.opensource_runtime = opensource_runtime_;
@@ -184,6 +188,8 @@ bool CppGenerator::Generate(const FileDescriptor* file,
       file_options.force_eagerly_verified_lazy = true;
     } else if (key == "experimental_strip_nonfunctional_codegen") {
       file_options.strip_nonfunctional_codegen = true;
+    } else if (key == "table_driven_serialization") {
+      file_options.table_driven_serialization = true;
     } else {
       *error = absl::StrCat("Unknown generator option: ", key);
       return false;
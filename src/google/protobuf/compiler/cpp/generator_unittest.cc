@@ -8,9 +8,14 @@
 #include "google/protobuf/compiler/cpp/generator.h"
 
 #include <memory>
+#include <string>
 
+#include "google/protobuf/testing/file.h"
 #include "google/protobuf/descriptor.pb.h"
 #include <gtest/gtest.h>
+#include "absl/log/absl_check.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "google/protobuf/compiler/command_line_interface_tester.h"
 #include "google/protobuf/cpp_features.pb.h"
 
@@ -289,6 +294,36 @@ TEST_F(CppGeneratorTest, CtypeOnExtensionTest) {
       "Extension bar specifies ctype=CORD which is "
       "not supported for extensions.");
 }
+
+TEST_F(CppGeneratorTest, TableDrivenSerialization) {
+  CreateTempFile("foo.proto",
+                 R"schema(
+    syntax = "proto2";
+    message Foo {
+      optional int32 bar = 1;
+      repeated string baz = 2;
+      optional Foo child = 3;
+    }
+    message WithMap {
+      map<int32, int32> m = 1;
+    })schema");
+
+  RunProtoc(
+      "protocol_compiler --proto_path=$tmpdir "
+      "--cpp_out=table_driven_serialization:$tmpdir foo.proto");
+
+  ExpectNoErrors();
+  std::string source;
+  ABSL_CHECK_OK(File::GetContents(absl::StrCat(temp_directory(), "/foo.pb.cc"),
+                                  &source, true));
+  EXPECT_TRUE(absl::StrContains(
+      source, "#include \"google/protobuf/generated_message_tcserializer.h\""));
+  // Foo delegates to the serializer; WithMap has a map field, which it does
+  // not support.
+  EXPECT_TRUE(absl::StrContains(source, "::_pbi::TcSerializer::Serialize("));
+  EXPECT_TRUE(absl::StrContains(source, "::_pbi::TcSerializer::ByteSizeLong("));
+  EXPECT_TRUE(absl::StrContains(source, "this_._internal_m()"));
+}
 }  // namespace
 }  // namespace cpp
 }  // namespace compiler
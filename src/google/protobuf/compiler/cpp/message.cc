@@ -4520,6 +4520,25 @@ void MessageGenerator::GenerateSerializeOneExtensionRange(io::Printer* p,
           )cc");
 }
 
+bool MessageGenerator::UseTableDrivenSerialization() const {
+  if (!options_.table_driven_serialization) return false;
+  if (HasSimpleBaseClass(descriptor_, options_)) return false;
+  // The serializer walks the field entries of the parse table, which describe
+  // neither extensions nor the layout of split fields.
+  if (descriptor_->extension_range_count() > 0) return false;
+  if (descriptor_->options().message_set_wire_format()) return false;
+  if (ShouldSplit(descriptor_, options_)) return false;
+  for (const auto* field : FieldRange(descriptor_)) {
+    if (field->is_map() || IsWeak(field, options_) ||
+        IsLazy(field, options_, scc_analyzer_) ||
+        IsImplicitWeakField(field, options_, scc_analyzer_) ||
+        IsStringPiece(field)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void MessageGenerator::GenerateSerializeWithCachedSizesToArray(io::Printer* p) {
   if (HasSimpleBaseClass(descriptor_, options_)) return;
   if (descriptor_->options().message_set_wire_format()) {
@@ -4557,7 +4576,8 @@ void MessageGenerator::GenerateSerializeWithCachedSizesToArray(io::Printer* p) {
           {"debug", [&] { GenerateSerializeWithCachedSizesBodyShuffled(p); }},
           {"ifdef",
            [&] {
-             if (ShouldSerializeInOrder(descriptor_, options_)) {
+             if (ShouldSerializeInOrder(descriptor_, options_) ||
+                 UseTableDrivenSerialization()) {
                p->Emit("$ndebug$");
              } else {
                p->Emit(R"cc(
@@ -4743,6 +4763,13 @@ void MessageGenerator::GenerateSerializeWithCachedSizesBody(io::Printer* p) {
            }},
           {"handle_lazy_fields",
            [&] {
+             if (UseTableDrivenSerialization()) {
+               p->Emit(R"cc(
+                 target = ::_pbi::TcSerializer::Serialize(
+                     this_, &_table_.header, target, stream);
+               )cc");
+               return;
+             }
              // Merge fields and extension ranges, sorted by field number.
              LazySerializerEmitter e(this, p);
              LazyExtensionRangeEmitter re(this, p);
@@ -4985,6 +5012,13 @@ void MessageGenerator::GenerateByteSize(io::Printer* p) {
         }},
        {"handle_fields",
         [&] {
+          if (UseTableDrivenSerialization()) {
+            p->Emit(R"cc(
+              total_size +=
+                  ::_pbi::TcSerializer::ByteSizeLong(this_, &_table_.header);
+            )cc");
+            return;
+          }
           auto it = chunks.begin();
           auto end = chunks.end();
           int cached_has_word_index = -1;
@@ -5070,6 +5104,7 @@ void MessageGenerator::GenerateByteSize(io::Printer* p) {
         }},
        {"handle_oneof_fields",
         [&] {
+          if (UseTableDrivenSerialization()) return;
           // Fields inside a oneof don't use _has_bits_ so we count them in a
           // separate pass.
           for (auto oneof : OneOfRange(descriptor_)) {
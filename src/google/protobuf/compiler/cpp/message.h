@@ -124,6 +124,9 @@ class MessageGenerator {
   void GenerateSerializeWithCachedSizesBody(io::Printer* p);
   void GenerateSerializeWithCachedSizesBodyShuffled(io::Printer* p);
   void GenerateByteSize(io::Printer* p);
+  // Whether _InternalSerialize() and ByteSizeLong() delegate to the
+  // table-driven serializer instead of generating code for each field.
+  bool UseTableDrivenSerialization() const;
   void GenerateClassData(io::Printer* p);
   void GenerateMapEntryClassDefinition(io::Printer* p);
   void GenerateAnyMethodDefinition(io::Printer* p);
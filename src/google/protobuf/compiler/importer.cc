@@ -23,14 +23,19 @@
 
 #include <algorithm>
 #include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/compiler/parser.h"
 #include "google/protobuf/io/io_win32.h"
 #include "google/protobuf/io/tokenizer.h"
@@ -96,6 +101,46 @@ class SourceTreeDescriptorDatabase::SingleFileErrorCollector
   bool had_errors_;
 };
 
+// Holds on to the errors found while preparsing a file, so that they can be
+// reported when the file is actually requested.
+class SourceTreeDescriptorDatabase::BufferedErrorCollector
+    : public MultiFileErrorCollector {
+ public:
+  BufferedErrorCollector() {}
+  ~BufferedErrorCollector() override {}
+
+  // Reports all the buffered errors to error_collector, in order.
+  void ReplayTo(MultiFileErrorCollector* error_collector) const {
+    for (const Error& error : errors_) {
+      error_collector->RecordError(error.filename, error.line, error.column,
+                                   error.message);
+    }
+  }
+
+  // implements MultiFileErrorCollector ------------------------------
+  void RecordError(absl::string_view filename, int line, int column,
+                   absl::string_view message) override {
+    errors_.push_back(
+        {std::string(filename), line, column, std::string(message)});
+  }
+
+ private:
+  struct Error {
+    std::string filename;
+    int line;
+    int column;
+    std::string message;
+  };
+  std::vector<Error> errors_;
+};
+
+struct SourceTreeDescriptorDatabase::PreparsedFile {
+  FileDescriptorProto proto;
+  SourceLocationTable source_locations;
+  BufferedErrorCollector errors;
+  bool success = false;
+};
+
 // ===================================================================
 
 SourceTreeDescriptorDatabase::SourceTreeDescriptorDatabase(
@@ -116,8 +161,93 @@ SourceTreeDescriptorDatabase::SourceTreeDescriptorDatabase(
 
 SourceTreeDescriptorDatabase::~SourceTreeDescriptorDatabase() {}
 
+void SourceTreeDescriptorDatabase::PreparseFiles(
+    const std::vector<std::string>& filenames, int num_threads) {
+  absl::Mutex mutex;
+  absl::CondVar queue_changed;
+  // Files that are waiting for a thread, every file that was ever queued, and
+  // the number of files being parsed.  All under mutex, as are source_tree_
+  // and preparsed_files_.
+  std::vector<std::string> queue;
+  absl::flat_hash_set<std::string> queued;
+  int num_parsing = 0;
+
+  auto enqueue = [&](const std::string& filename) {
+    if (!preparsed_files_.contains(filename) && queued.insert(filename).second) {
+      queue.push_back(filename);
+    }
+  };
+  for (const std::string& filename : filenames) {
+    enqueue(filename);
+  }
+
+  auto worker = [&] {
+    mutex.Lock();
+    while (true) {
+      while (queue.empty() && num_parsing > 0) {
+        queue_changed.Wait(&mutex);
+      }
+      // Only files being parsed can queue more, so if nothing is being parsed
+      // either, we are done.
+      if (queue.empty()) break;
+
+      std::string filename = std::move(queue.back());
+      queue.pop_back();
+      std::unique_ptr<io::ZeroCopyInputStream> input(
+          source_tree_->Open(filename));
+      if (input == nullptr) continue;
+      ++num_parsing;
+      mutex.Unlock();
+
+      auto file = std::make_unique<PreparsedFile>();
+      file->success =
+          Parse(filename, input.get(),
+                error_collector_ == nullptr ? nullptr : &file->errors,
+                using_validation_error_collector_ ? &file->source_locations
+                                                  : nullptr,
+                &file->proto);
+      input.reset();
+
+      mutex.Lock();
+      --num_parsing;
+      for (const std::string& dependency : file->proto.dependency()) {
+        enqueue(dependency);
+      }
+      preparsed_files_[filename] = std::move(file);
+      queue_changed.SignalAll();
+    }
+    mutex.Unlock();
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
 bool SourceTreeDescriptorDatabase::FindFileByName(const std::string& filename,
                                                   FileDescriptorProto* output) {
+  auto it = preparsed_files_.find(filename);
+  // The source locations are keyed by address, so the preparsed proto has to
+  // be swapped into output rather than copied.
+  if (it != preparsed_files_.end() && output->GetArena() == nullptr) {
+    std::unique_ptr<PreparsedFile> file = std::move(it->second);
+    preparsed_files_.erase(it);
+    if (error_collector_ != nullptr) {
+      file->errors.ReplayTo(error_collector_);
+    }
+    output->Swap(&file->proto);
+    if (using_validation_error_collector_) {
+      source_locations_.MergeFrom(file->source_locations, &file->proto,
+                                  output);
+    }
+    return file->success;
+  }
+
   std::unique_ptr<io::ZeroCopyInputStream> input(source_tree_->Open(filename));
   if (input == nullptr) {
     if (fallback_database_ != nullptr &&
@@ -131,16 +261,25 @@ bool SourceTreeDescriptorDatabase::FindFileByName(const std::string& filename,
     return false;
   }
 
+  return Parse(filename, input.get(), error_collector_,
+               using_validation_error_collector_ ? &source_locations_ : nullptr,
+               output);
+}
+
+bool SourceTreeDescriptorDatabase::Parse(
+    const std::string& filename, io::ZeroCopyInputStream* input,
+    MultiFileErrorCollector* error_collector,
+    SourceLocationTable* source_locations, FileDescriptorProto* output) {
   // Set up the tokenizer and parser.
-  SingleFileErrorCollector file_error_collector(filename, error_collector_);
-  io::Tokenizer tokenizer(input.get(), &file_error_collector);
+  SingleFileErrorCollector file_error_collector(filename, error_collector);
+  io::Tokenizer tokenizer(input, &file_error_collector);
 
   Parser parser;
-  if (error_collector_ != nullptr) {
+  if (error_collector != nullptr) {
     parser.RecordErrorsTo(&file_error_collector);
   }
-  if (using_validation_error_collector_) {
-    parser.RecordSourceLocationsTo(&source_locations_);
+  if (source_locations != nullptr) {
+    parser.RecordSourceLocationsTo(source_locations);
   }
 
   // Parse it.
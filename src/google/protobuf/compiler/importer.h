@@ -14,10 +14,12 @@
 #ifndef GOOGLE_PROTOBUF_COMPILER_IMPORTER_H__
 #define GOOGLE_PROTOBUF_COMPILER_IMPORTER_H__
 
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/compiler/parser.h"
 #include "google/protobuf/descriptor.h"
@@ -83,6 +85,17 @@ class PROTOBUF_EXPORT SourceTreeDescriptorDatabase : public DescriptorDatabase {
     return &validation_error_collector_;
   }
 
+  // Parses the given files and everything they import, transitively, on up
+  // to num_threads threads, and keeps the results for FindFileByName().
+  // Errors are held back and reported when FindFileByName() is called for
+  // the file they belong to, so they come out in the same order as they would
+  // without preparsing.  Files that can't be opened are left for
+  // FindFileByName() to find and report.
+  //
+  // The source tree's Open() is only ever called by one thread at a time.
+  void PreparseFiles(const std::vector<std::string>& filenames,
+                     int num_threads);
+
   // implements DescriptorDatabase -----------------------------------
   bool FindFileByName(const std::string& filename,
                       FileDescriptorProto* output) override;
@@ -94,6 +107,16 @@ class PROTOBUF_EXPORT SourceTreeDescriptorDatabase : public DescriptorDatabase {
 
  private:
   class SingleFileErrorCollector;
+  class BufferedErrorCollector;
+  struct PreparsedFile;
+
+  // Parses the file read from input into output.  Returns false if there were
+  // any errors.  Safe to call from several threads at once.
+  static bool Parse(const std::string& filename,
+                    io::ZeroCopyInputStream* input,
+                    MultiFileErrorCollector* error_collector,
+                    SourceLocationTable* source_locations,
+                    FileDescriptorProto* output);
 
   SourceTree* source_tree_;
   DescriptorDatabase* fallback_database_;
@@ -123,6 +146,10 @@ class PROTOBUF_EXPORT SourceTreeDescriptorDatabase : public DescriptorDatabase {
   bool using_validation_error_collector_;
   SourceLocationTable source_locations_;
   ValidationErrorCollector validation_error_collector_;
+
+  // Results of PreparseFiles() that FindFileByName() has yet to hand out.
+  absl::flat_hash_map<std::string, std::unique_ptr<PreparsedFile>>
+      preparsed_files_;
 };
 
 // Simple interface for parsing .proto files.  This wraps the process
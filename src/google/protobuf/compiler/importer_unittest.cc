@@ -231,6 +231,62 @@ TEST_F(ImporterTest, LiteRuntimeImport) {
       error_collector_.text_);
 }
 
+// ===================================================================
+
+// Builds foo.proto from source_tree with a pool on top of a
+// SourceTreeDescriptorDatabase, optionally preparsing it on several threads
+// first, and returns the errors reported.
+std::string BuildWithSourceTreeDatabase(SourceTree* source_tree,
+                                        int preparse_threads) {
+  MockErrorCollector error_collector;
+  SourceTreeDescriptorDatabase database(source_tree);
+  database.RecordErrorsTo(&error_collector);
+  DescriptorPool pool(&database, database.GetValidationErrorCollector());
+  if (preparse_threads > 0) {
+    database.PreparseFiles({"foo.proto"}, preparse_threads);
+  }
+  EXPECT_TRUE(pool.FindFileByName("foo.proto") == nullptr);
+  return error_collector.text_;
+}
+
+TEST(SourceTreeDescriptorDatabaseTest, PreparseFiles) {
+  // Parse errors, validation errors located through the parsed source, and
+  // import errors located on the importing file should all come out the same
+  // way, in the same order, whether or not the files were preparsed.
+  MockSourceTree source_tree;
+  source_tree.AddFile("foo.proto",
+                      "syntax = \"proto2\";\n"
+                      "import \"bar.proto\";\n"
+                      "import \"lite.proto\";\n"
+                      "import \"baz.proto\";\n"
+                      "message Foo {\n"
+                      "  optional int32 foo = 1;\n"
+                      "  optional int32 foo = 2;\n"
+                      "}\n");
+  source_tree.AddFile("bar.proto",
+                      "syntax = \"proto2\";\n"
+                      "import \"qux.proto\";\n"
+                      "message Bar {}\n");
+  source_tree.AddFile("lite.proto",
+                      "syntax = \"proto2\";\n"
+                      "option optimize_for = LITE_RUNTIME;\n");
+  source_tree.AddFile("baz.proto",
+                      "syntax = \"proto2\";\n"
+                      "message Baz {\n");
+  source_tree.AddFile("qux.proto",
+                      "syntax = \"proto2\";\n"
+                      "message Qux { optional Missing missing = 1; }\n");
+
+  std::string expected = BuildWithSourceTreeDatabase(&source_tree, 0);
+  EXPECT_SUBSTRING("baz.proto:2:0: ", expected);
+  EXPECT_SUBSTRING("qux.proto:1:23: ", expected);
+  EXPECT_SUBSTRING("foo.proto:1:0: ", expected);
+  EXPECT_SUBSTRING("foo.proto:3:0: ", expected);
+  EXPECT_SUBSTRING("foo.proto:6:17: ", expected);
+
+  EXPECT_EQ(expected, BuildWithSourceTreeDatabase(&source_tree, 1));
+  EXPECT_EQ(expected, BuildWithSourceTreeDatabase(&source_tree, 4));
+}
 
 // ===================================================================
 
@@ -2647,6 +2647,23 @@ void SourceLocationTable::AddImport(const Message* descriptor,
       std::make_pair(line, column);
 }
 
+void SourceLocationTable::MergeFrom(const SourceLocationTable& other,
+                                    const Message* old_file,
+                                    const Message* new_file) {
+  for (const auto& entry : other.location_map_) {
+    const Message* descriptor = entry.first.first;
+    if (descriptor == old_file) descriptor = new_file;
+    location_map_[std::make_pair(descriptor, entry.first.second)] =
+        entry.second;
+  }
+  for (const auto& entry : other.import_location_map_) {
+    const Message* descriptor = entry.first.first;
+    if (descriptor == old_file) descriptor = new_file;
+    import_location_map_[std::make_pair(descriptor, entry.first.second)] =
+        entry.second;
+  }
+}
+
 void SourceLocationTable::Clear() { location_map_.clear(); }
 
 }  // namespace compiler
@@ -608,6 +608,14 @@ class PROTOBUF_EXPORT SourceLocationTable {
   void AddImport(const Message* descriptor, const std::string& name, int line,
                  int column);
 
+  // Adds every location in `other`.  Locations recorded for `old_file`, the
+  // FileDescriptorProto that `other` was filled in for, are added for
+  // `new_file` instead.  This lets a file be parsed into one proto and then
+  // swapped into another: nested messages keep their addresses across the
+  // swap, but the file proto itself does not.
+  void MergeFrom(const SourceLocationTable& other, const Message* old_file,
+                 const Message* new_file);
+
   // Clears the contents of the table.
   void Clear();
 
@@ -33,6 +33,7 @@
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/base/attributes.h"
 #include "absl/base/call_once.h"
 #include "absl/base/casts.h"
@@ -1025,6 +1026,10 @@ using FieldsByNameMap =
     absl::flat_hash_map<std::pair<const void*, absl::string_view>,
                         const FieldDescriptor*>;
 
+using JsonNameTablesMap =
+    absl::flat_hash_map<const Descriptor*,
+                        std::unique_ptr<const internal::JsonNameTable>>;
+
 struct ParentNumberQuery {
   std::pair<const void*, int> query;
 };
@@ -1069,6 +1074,93 @@ using ExtensionsGroupedByDescriptorMap =
 using LocationsByPathMap =
     absl::flat_hash_map<std::string, const SourceCodeInfo_Location*>;
 
+inline bool IsEmptySlot(Symbol symbol) { return symbol.IsNull(); }
+inline bool IsEmptySlot(const FileDescriptor* file) { return file == nullptr; }
+
+// An insert-only hash set that can be read without locking, while a single
+// writer (holding the pool's mutex) adds to it.
+//
+// Readers find the current slot array through an acquire load, and each slot
+// is published with a release store once the element it points to is fully
+// built. When the set grows, the elements are copied into a new array, which
+// then replaces the old one. Readers may still be probing the old array, so
+// it is only freed with the set itself, much like RCU with a grace period
+// lasting until the pool is destroyed. The arrays double in size, so retired
+// arrays never take more memory than the current one.
+//
+// `T` is a pointer-sized handle (Symbol or a descriptor pointer) whose default
+// value marks an empty slot.
+template <typename T, typename Hash, typename Eq>
+class PublishedSet {
+ public:
+  PublishedSet() = default;
+  PublishedSet(const PublishedSet&) = delete;
+  PublishedSet& operator=(const PublishedSet&) = delete;
+
+  // Returns T() if no element matches `key`. Safe to call concurrently with
+  // Insert().
+  template <typename K>
+  T Find(const K& key) const {
+    const Slots* slots = current_.load(std::memory_order_acquire);
+    if (slots == nullptr) return T();
+    for (size_t i = Hash()(key) & slots->mask;; i = (i + 1) & slots->mask) {
+      T value = slots->values[i].load(std::memory_order_acquire);
+      if (IsEmptySlot(value)) return T();
+      if (Eq()(value, key)) return value;
+    }
+  }
+
+  // Adds `value`, which must not be in the set yet. Calls must be serialized.
+  void Insert(T value) {
+    const Slots* slots = current_.load(std::memory_order_relaxed);
+    if (slots == nullptr || (size_ + 1) * 2 > slots->mask + 1) {
+      slots = Grow(slots);
+    }
+    Place(*slots, value);
+    ++size_;
+  }
+
+ private:
+  struct Slots {
+    explicit Slots(size_t capacity)
+        : mask(capacity - 1), values(new std::atomic<T>[capacity]) {
+      for (size_t i = 0; i < capacity; ++i) {
+        values[i].store(T(), std::memory_order_relaxed);
+      }
+    }
+    size_t mask;
+    std::unique_ptr<std::atomic<T>[]> values;
+  };
+
+  static void Place(const Slots& slots, T value) {
+    size_t i = Hash()(value) & slots.mask;
+    while (!IsEmptySlot(slots.values[i].load(std::memory_order_relaxed))) {
+      i = (i + 1) & slots.mask;
+    }
+    slots.values[i].store(value, std::memory_order_release);
+  }
+
+  const Slots* Grow(const Slots* old) {
+    const size_t capacity = old == nullptr ? 64 : (old->mask + 1) * 2;
+    auto slots = std::make_unique<Slots>(capacity);
+    if (old != nullptr) {
+      for (size_t i = 0; i <= old->mask; ++i) {
+        T value = old->values[i].load(std::memory_order_relaxed);
+        if (!IsEmptySlot(value)) Place(*slots, value);
+      }
+    }
+    const Slots* result = slots.get();
+    all_slots_.push_back(std::move(slots));
+    current_.store(result, std::memory_order_release);
+    return result;
+  }
+
+  std::atomic<const Slots*> current_{nullptr};
+  size_t size_ = 0;
+  // Every array ever published, including the current one.
+  std::vector<std::unique_ptr<Slots>> all_slots_;
+};
+
 absl::flat_hash_set<std::string>* NewAllowedProto3Extendee() {
   const char* kOptionNames[] = {
       "FileOptions",   "MessageOptions",   "FieldOptions",
@@ -1235,6 +1327,8 @@ class FileDescriptorTables {
       const void* parent, absl::string_view lowercase_name) const;
   inline const FieldDescriptor* FindFieldByCamelcaseName(
       const void* parent, absl::string_view camelcase_name) const;
+  inline const internal::JsonNameTable* FindJsonNameTable(
+      const Descriptor* parent) const;
   inline const EnumValueDescriptor* FindEnumValueByNumber(
       const EnumDescriptor* parent, int number) const;
   // This creates a new EnumValueDescriptor if not found, in a thread-safe way.
@@ -1275,6 +1369,8 @@ class FileDescriptorTables {
   static void FieldsByCamelcaseNamesLazyInitStatic(
       const FileDescriptorTables* tables);
   void FieldsByCamelcaseNamesLazyInitInternal() const;
+  static void JsonNameTablesLazyInitStatic(const FileDescriptorTables* tables);
+  void JsonNameTablesLazyInitInternal() const;
 
   SymbolsByParentSet symbols_by_parent_;
   mutable absl::once_flag fields_by_lowercase_name_once_;
@@ -1284,6 +1380,8 @@ class FileDescriptorTables {
   // change anymore.
   mutable std::atomic<const FieldsByNameMap*> fields_by_lowercase_name_{};
   mutable std::atomic<const FieldsByNameMap*> fields_by_camelcase_name_{};
+  mutable absl::once_flag json_name_tables_once_;
+  mutable std::atomic<const JsonNameTablesMap*> json_name_tables_{};
   FieldsByNumberSet fields_by_number_;  // Not including extensions.
   EnumValuesByNumberSet enum_values_by_number_;
   mutable EnumValuesByNumberSet unknown_enum_values_by_number_
@@ -1428,7 +1526,9 @@ class DescriptorPool::DeferredValidation {
 
 class DescriptorPool::Tables {
  public:
-  Tables();
+  // If `lock_free_lookups` is true, committed symbols and files are also
+  // published for FindPublishedSymbol() and FindPublishedFile().
+  explicit Tables(bool lock_free_lookups = false);
   ~Tables();
 
   // Record the current state of the tables to the stack of checkpoints.
@@ -1456,7 +1556,8 @@ class DescriptorPool::Tables {
   void AddCheckpoint();
 
   // Mark the last checkpoint as having cleared successfully, removing it from
-  // the stack. If the stack is empty, all pending symbols will be committed.
+  // the stack. If the stack is empty, all pending symbols will be committed,
+  // and published for lock-free lookups if enabled.
   //
   // Note that this does not guarantee that the symbols added since the last
   // checkpoint won't be rolled back: if a checkpoint gets rolled back,
@@ -1503,6 +1604,12 @@ class DescriptorPool::Tables {
   // if not found.
   inline Symbol FindSymbol(absl::string_view key) const;
 
+  // Like FindSymbol() and FindFile(), but only finds committed items, and
+  // does not require the pool's mutex to be held.  These always fail unless
+  // lock-free lookups were enabled on construction.
+  inline Symbol FindPublishedSymbol(absl::string_view key) const;
+  inline const FileDescriptor* FindPublishedFile(absl::string_view key) const;
+
   // This implements the body of DescriptorPool::Find*ByName().  It should
   // really be a private method of DescriptorPool, but that would require
   // declaring Symbol in descriptor.h, which would drag all kinds of other
@@ -1576,6 +1683,15 @@ class DescriptorPool::Tables {
   DescriptorsByNameSet<FileDescriptor> files_by_name_;
   ExtensionsGroupedByDescriptorMap extensions_;
 
+  // Copies of the committed parts of symbols_by_name_ and files_by_name_,
+  // which can be read without holding the pool's mutex.
+  const bool lock_free_lookups_;
+  PublishedSet<Symbol, SymbolByFullNameHash, SymbolByFullNameEq>
+      published_symbols_;
+  PublishedSet<const FileDescriptor*, DescriptorsByNameHash<FileDescriptor>,
+               DescriptorsByNameEq<FileDescriptor>>
+      published_files_;
+
   // A cache of all unique feature sets seen.  Since we expect this number to be
   // relatively low compared to descriptors, it's significantly cheaper to share
   // these within the pool than have each file create its own feature sets.
@@ -1606,7 +1722,8 @@ class DescriptorPool::Tables {
   std::vector<std::pair<const Descriptor*, int>> extensions_after_checkpoint_;
 };
 
-DescriptorPool::Tables::Tables() {
+DescriptorPool::Tables::Tables(bool lock_free_lookups)
+    : lock_free_lookups_(lock_free_lookups) {
   well_known_types_.insert({
       {"google.protobuf.DoubleValue", Descriptor::WELLKNOWNTYPE_DOUBLEVALUE},
       {"google.protobuf.FloatValue", Descriptor::WELLKNOWNTYPE_FLOATVALUE},
@@ -1634,6 +1751,7 @@ FileDescriptorTables::FileDescriptorTables() = default;
 FileDescriptorTables::~FileDescriptorTables() {
   delete fields_by_lowercase_name_.load(std::memory_order_acquire);
   delete fields_by_camelcase_name_.load(std::memory_order_acquire);
+  delete json_name_tables_.load(std::memory_order_acquire);
 }
 
 inline const FileDescriptorTables& FileDescriptorTables::GetEmptyInstance() {
@@ -1652,6 +1770,14 @@ void DescriptorPool::Tables::ClearLastCheckpoint() {
   if (checkpoints_.empty()) {
     // All checkpoints have been cleared: we can now commit all of the pending
     // data.
+    if (lock_free_lookups_) {
+      for (Symbol symbol : symbols_after_checkpoint_) {
+        published_symbols_.Insert(symbol);
+      }
+      for (const FileDescriptor* file : files_after_checkpoint_) {
+        published_files_.Insert(file);
+      }
+    }
     symbols_after_checkpoint_.clear();
     files_after_checkpoint_.clear();
     extensions_after_checkpoint_.clear();
@@ -1695,6 +1821,16 @@ inline Symbol DescriptorPool::Tables::FindSymbol(absl::string_view key) const {
   return it == symbols_by_name_.end() ? Symbol() : *it;
 }
 
+inline Symbol DescriptorPool::Tables::FindPublishedSymbol(
+    absl::string_view key) const {
+  return published_symbols_.Find(FullNameQuery{key});
+}
+
+inline const FileDescriptor* DescriptorPool::Tables::FindPublishedFile(
+    absl::string_view key) const {
+  return published_files_.Find(key);
+}
+
 inline Symbol FileDescriptorTables::FindNestedSymbol(
     const void* parent, absl::string_view name) const {
   auto it = symbols_by_parent_.find(ParentNameQuery{{parent, name}});
@@ -1704,12 +1840,10 @@ inline Symbol FileDescriptorTables::FindNestedSymbol(
 Symbol DescriptorPool::Tables::FindByNameHelper(const DescriptorPool* pool,
                                                 absl::string_view name) {
   if (pool->mutex_ != nullptr) {
-    // Fast path: the Symbol is already cached.  This is just a hash lookup.
-    absl::ReaderMutexLock lock(pool->mutex_);
-    if (known_bad_symbols_.empty() && known_bad_files_.empty()) {
-      Symbol result = FindSymbol(name);
-      if (!result.IsNull()) return result;
-    }
+    // Fast path: the Symbol is already built.  This is just a hash lookup,
+    // which doesn't take the mutex.
+    Symbol result = FindPublishedSymbol(name);
+    if (!result.IsNull()) return result;
   }
   DescriptorPool::DeferredValidation deferred_validation(pool);
   Symbol result;
@@ -1833,6 +1967,32 @@ inline const FieldDescriptor* FileDescriptorTables::FindFieldByCamelcaseName(
   return it->second;
 }
 
+void FileDescriptorTables::JsonNameTablesLazyInitStatic(
+    const FileDescriptorTables* tables) {
+  tables->JsonNameTablesLazyInitInternal();
+}
+
+void FileDescriptorTables::JsonNameTablesLazyInitInternal() const {
+  auto* map = new JsonNameTablesMap;
+  for (Symbol symbol : symbols_by_parent_) {
+    const Descriptor* descriptor = symbol.descriptor();
+    if (!descriptor) continue;
+    (*map)[descriptor] =
+        absl::WrapUnique(new internal::JsonNameTable(descriptor));
+  }
+  json_name_tables_.store(map, std::memory_order_release);
+}
+
+inline const internal::JsonNameTable* FileDescriptorTables::FindJsonNameTable(
+    const Descriptor* parent) const {
+  absl::call_once(json_name_tables_once_,
+                  FileDescriptorTables::JsonNameTablesLazyInitStatic, this);
+  auto* tables = json_name_tables_.load(std::memory_order_acquire);
+  auto it = tables->find(parent);
+  if (it == tables->end()) return nullptr;
+  return it->second.get();
+}
+
 inline const EnumValueDescriptor* FileDescriptorTables::FindEnumValueByNumber(
     const EnumDescriptor* parent, int number) const {
   // If `number` is within the sequential range, just index into the parent
@@ -2114,7 +2274,7 @@ DescriptorPool::DescriptorPool(DescriptorDatabase* fallback_database,
       fallback_database_(fallback_database),
       default_error_collector_(error_collector),
       underlay_(nullptr),
-      tables_(new Tables),
+      tables_(new Tables(/*lock_free_lookups=*/true)),
       enforce_dependencies_(true),
       lazily_build_dependencies_(false),
       allow_unknown_(false),
@@ -2257,6 +2417,11 @@ void DescriptorPool::InternalAddGeneratedFile(
 
 const FileDescriptor* DescriptorPool::FindFileByName(
     absl::string_view name) const {
+  if (mutex_ != nullptr) {
+    // Fast path: the file is already built.
+    const FileDescriptor* result = tables_->FindPublishedFile(name);
+    if (result != nullptr) return result;
+  }
   DeferredValidation deferred_validation(this);
   const FileDescriptor* result = nullptr;
   {
@@ -2283,6 +2448,11 @@ const FileDescriptor* DescriptorPool::FindFileByName(
 
 const FileDescriptor* DescriptorPool::FindFileContainingSymbol(
     absl::string_view symbol_name) const {
+  if (mutex_ != nullptr) {
+    // Fast path: the symbol is already built.
+    Symbol result = tables_->FindPublishedSymbol(symbol_name);
+    if (!result.IsNull()) return result.GetFile();
+  }
   const FileDescriptor* file_result = nullptr;
   DeferredValidation deferred_validation(this);
   {
@@ -9888,6 +10058,156 @@ absl::string_view ShortEditionName(Edition edition) {
 Edition InternalFeatureHelper::GetEdition(const FileDescriptor& desc) {
   return desc.edition();
 }
+
+namespace {
+// Field names never need escaping in JSON, but a custom json_name might.
+bool IsPlainJsonKey(absl::string_view key) {
+  return !key.empty() && absl::c_all_of(key, [](char c) {
+    return absl::ascii_isalnum(c) || c == '_';
+  });
+}
+}  // namespace
+
+JsonNameTable::JsonNameTable(const Descriptor* descriptor)
+    : descriptor_(descriptor) {
+  const int field_count = descriptor == nullptr ? 0 : descriptor->field_count();
+
+  // Collect the keys in order of precedence; the first field to claim a key
+  // keeps it.  This matches looking up a camelCase name, then a proto name,
+  // then scanning the custom json_names.
+  std::vector<std::pair<absl::string_view, int>> keys;
+  absl::flat_hash_map<absl::string_view, size_t> positions;
+  for (int i = 0; i < field_count; ++i) {
+    const FieldDescriptor* field = descriptor->field(i);
+    auto inserted = positions.try_emplace(field->camelcase_name(), keys.size());
+    if (inserted.second) {
+      keys.emplace_back(field->camelcase_name(), i);
+    } else {
+      // Like FindFieldByCamelcaseName(), prefer the smallest field number.
+      int& index = keys[inserted.first->second].second;
+      if (descriptor->field(index)->number() > field->number()) index = i;
+    }
+  }
+  for (int i = 0; i < field_count; ++i) {
+    absl::string_view name = descriptor->field(i)->name();
+    if (positions.try_emplace(name, keys.size()).second) {
+      keys.emplace_back(name, i);
+    }
+  }
+  for (int i = 0; i < field_count; ++i) {
+    const FieldDescriptor* field = descriptor->field(i);
+    if (!field->has_json_name()) continue;
+    if (positions.try_emplace(field->json_name(), keys.size()).second) {
+      keys.emplace_back(field->json_name(), i);
+    }
+  }
+
+  // Build a perfect hash by hashing and displacing: each key's hash picks a
+  // bucket, and each bucket searches for a seed that sends all of its keys to
+  // free slots.  Filling the largest buckets first, while most slots are
+  // free, makes the search short.
+  std::vector<uint64_t> hashes;
+  hashes.reserve(keys.size());
+  for (const auto& key : keys) {
+    hashes.push_back(absl::HashOf(key.first));
+  }
+  size_t bucket_count = 1;
+  while (bucket_count * 2 < keys.size()) bucket_count *= 2;
+  size_t slot_count = 1;
+  while (slot_count < keys.size() * 2) slot_count *= 2;
+
+  std::vector<std::vector<size_t>> buckets(bucket_count);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    buckets[hashes[i] & (bucket_count - 1)].push_back(i);
+  }
+  std::vector<size_t> order(bucket_count);
+  for (size_t i = 0; i < bucket_count; ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return buckets[a].size() > buckets[b].size();
+  });
+
+  constexpr uint64_t kMaxSeeds = 1 << 12;
+  std::vector<size_t> chosen;
+  bool done = false;
+  while (!done) {
+    seeds_.assign(bucket_count, 0);
+    slots_.assign(slot_count, Slot());
+    done = true;
+    for (size_t b : order) {
+      if (buckets[b].empty()) break;
+      bool placed = false;
+      for (uint64_t n = 1; n <= kMaxSeeds && !placed; ++n) {
+        const uint64_t seed = n * uint64_t{0xbf58476d1ce4e5b9};
+        chosen.clear();
+        placed = true;
+        for (size_t k : buckets[b]) {
+          size_t slot = SlotFor(hashes[k], seed, slot_count - 1);
+          if (slots_[slot].index >= 0 || absl::c_linear_search(chosen, slot)) {
+            placed = false;
+            break;
+          }
+          chosen.push_back(slot);
+        }
+        if (placed) {
+          seeds_[b] = seed;
+          for (size_t j = 0; j < chosen.size(); ++j) {
+            const auto& key = keys[buckets[b][j]];
+            slots_[chosen[j]] = {key.first.data(),
+                                 static_cast<uint32_t>(key.first.size()),
+                                 key.second};
+          }
+        }
+      }
+      if (!placed) {
+        // Unlucky; retry with more room.
+        slot_count *= 2;
+        done = false;
+        break;
+      }
+    }
+  }
+
+  quoted_offsets_.reserve(2 * field_count + 1);
+  quoted_offsets_.push_back(0);
+  auto add_quoted = [&](absl::string_view name) {
+    if (IsPlainJsonKey(name)) absl::StrAppend(&quoted_, "\"", name, "\":");
+    quoted_offsets_.push_back(static_cast<uint32_t>(quoted_.size()));
+  };
+  for (int i = 0; i < field_count; ++i) {
+    const FieldDescriptor* field = descriptor->field(i);
+    add_quoted(field->name());
+    add_quoted(field->has_json_name() ? field->json_name()
+                                      : field->camelcase_name());
+  }
+}
+
+size_t JsonNameTable::SlotFor(uint64_t hash, uint64_t seed, size_t mask) {
+  const uint64_t mixed = (hash ^ seed) * uint64_t{0x9e3779b97f4a7c15};
+  return static_cast<size_t>(mixed >> 32) & mask;
+}
+
+const JsonNameTable& JsonNameTable::For(const Descriptor& descriptor) {
+  const JsonNameTable* table =
+      descriptor.file()->tables_->FindJsonNameTable(&descriptor);
+  if (table != nullptr) return *table;
+
+  // Placeholder types share the empty file tables, and have no fields.
+  static const JsonNameTable* const kEmpty =
+      OnShutdownDelete(new JsonNameTable(nullptr));
+  return *kEmpty;
+}
+
+const FieldDescriptor* JsonNameTable::FindField(absl::string_view key) const {
+  const uint64_t hash = absl::HashOf(key);
+  const Slot& slot =
+      slots_[SlotFor(hash, seeds_[hash & (seeds_.size() - 1)],
+                     slots_.size() - 1)];
+  if (slot.index < 0 || slot.size != key.size() ||
+      memcmp(slot.key, key.data(), key.size()) != 0) {
+    return nullptr;
+  }
+  return descriptor_->field(slot.index);
+}
 }  // namespace internal
 
 }  // namespace protobuf
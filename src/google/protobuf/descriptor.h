@@ -289,6 +289,66 @@ class PROTOBUF_EXPORT InternalFeatureHelper {
   static Edition GetEdition(const FileDescriptor& desc);
 };
 
+// This class is for internal use only.  It maps the keys a JSON object may
+// use for the fields of a message type to those fields, and holds the quoted
+// keys the JSON printer writes for them.
+//
+// A key is a field's camelCase name, its name in the .proto file or its
+// custom json_name, in that order of precedence if fields share a key.  Keys
+// are found through a perfect hash, so a lookup takes one probe and one
+// string comparison, and never allocates.
+//
+// The tables of a file are built on first use and live as long as its pool.
+// They may be used from any thread.
+class PROTOBUF_EXPORT JsonNameTable {
+ public:
+  JsonNameTable(const JsonNameTable&) = delete;
+  JsonNameTable& operator=(const JsonNameTable&) = delete;
+
+  static const JsonNameTable& For(const Descriptor& descriptor);
+
+  // Returns nullptr if no field of the message has this key.  Extensions are
+  // never found.
+  const FieldDescriptor* FindField(absl::string_view key) const;
+
+  // Returns the field with the given index() as `"key":`, using either its
+  // name or its JSON name (the custom json_name if set, and the camelCase name
+  // otherwise).  Returns an empty string if the key would need escaping.
+  absl::string_view QuotedName(int index) const {
+    return Quoted(2 * index);
+  }
+  absl::string_view QuotedJsonName(int index) const {
+    return Quoted(2 * index + 1);
+  }
+
+ private:
+  friend class google::protobuf::FileDescriptorTables;
+
+  struct Slot {
+    const char* key = nullptr;
+    uint32_t size = 0;
+    // The index() of the field, or -1 if the slot is empty.
+    int32_t index = -1;
+  };
+
+  explicit JsonNameTable(const Descriptor* descriptor);
+
+  static size_t SlotFor(uint64_t hash, uint64_t seed, size_t mask);
+
+  absl::string_view Quoted(int i) const {
+    return absl::string_view(quoted_).substr(
+        quoted_offsets_[i], quoted_offsets_[i + 1] - quoted_offsets_[i]);
+  }
+
+  const Descriptor* descriptor_;
+  // Keys first pick a bucket, whose seed then picks their slot.
+  std::vector<uint64_t> seeds_;
+  std::vector<Slot> slots_;
+  // The quoted names and json_names of the fields, back to back.
+  std::string quoted_;
+  std::vector<uint32_t> quoted_offsets_;
+};
+
 PROTOBUF_EXPORT absl::string_view ShortEditionName(Edition edition);
 
 bool IsEnumFullySequential(const EnumDescriptor* enum_desc);
@@ -2030,6 +2090,7 @@ class PROTOBUF_EXPORT FileDescriptor : private internal::SymbolBase {
   friend class DescriptorPool;
   friend class Descriptor;
   friend class FieldDescriptor;
+  friend class internal::JsonNameTable;
   friend class internal::LazyDescriptor;
   friend class OneofDescriptor;
   friend class EnumDescriptor;
@@ -2085,6 +2146,8 @@ class PROTOBUF_EXPORT DescriptorPool {
   //   them slower even when they don't have to fall back to the database.
   //   In fact, even the Find*By*() methods of descriptor objects owned by
   //   this pool will be slower, since they will have to obtain locks too.
+  //   The exceptions are lookups by name of files and symbols that have
+  //   already been loaded, which don't lock.
   // - An ErrorCollector may optionally be given to collect validation errors
   //   in files loaded from the database.  If not given, errors will be printed
   //   to ABSL_LOG(ERROR).  Remember that files are built on-demand, so this
@@ -23,6 +23,7 @@
 #include <limits>
 #include <memory>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -1034,6 +1035,38 @@ TEST_F(DescriptorTest, FieldJsonName) {
   EXPECT_EQ("fieldname7", generated->field(6)->json_name());
 }
 
+TEST_F(DescriptorTest, JsonNameTable) {
+  const internal::JsonNameTable& table =
+      internal::JsonNameTable::For(*message4_);
+  EXPECT_EQ(&table, &internal::JsonNameTable::For(*message4_));
+  for (int i = 0; i < message4_->field_count(); ++i) {
+    const FieldDescriptor* field = message4_->field(i);
+    EXPECT_EQ(table.FindField(field->name()), field);
+    EXPECT_EQ(table.FindField(field->camelcase_name()),
+              message4_->FindFieldByCamelcaseName(field->camelcase_name()));
+  }
+  EXPECT_EQ(table.FindField("@type"), message4_->field(5));
+  EXPECT_EQ(table.FindField("type"), nullptr);
+  EXPECT_EQ(table.FindField(""), nullptr);
+
+  EXPECT_EQ(table.QuotedName(0), "\"field_name1\":");
+  EXPECT_EQ(table.QuotedJsonName(0), "\"fieldName1\":");
+  // Only keys made of identifier characters are precomputed.
+  EXPECT_EQ(table.QuotedName(5), "\"field_name6\":");
+  EXPECT_EQ(table.QuotedJsonName(5), "");
+
+  // A wide message, with many keys per table.
+  const Descriptor* all_types = protobuf_unittest::TestAllTypes::descriptor();
+  const internal::JsonNameTable& wide =
+      internal::JsonNameTable::For(*all_types);
+  for (int i = 0; i < all_types->field_count(); ++i) {
+    const FieldDescriptor* field = all_types->field(i);
+    EXPECT_EQ(wide.FindField(field->name()), field);
+    EXPECT_EQ(wide.FindField(field->camelcase_name()), field);
+    EXPECT_EQ(wide.FindField(absl::StrCat(field->name(), "_")), nullptr);
+  }
+}
+
 TEST_F(DescriptorTest, FieldFile) {
   EXPECT_EQ(foo_file_, foo_->file());
   EXPECT_EQ(foo_file_, bar_->file());
@@ -12723,6 +12756,44 @@ TEST_F(DatabaseBackedPoolTest, DoesntFallbackOnWrongType) {
   EXPECT_EQ(0, call_counter.call_count_);
 }
 
+TEST_F(DatabaseBackedPoolTest, ConcurrentLookups) {
+  // Lookups of symbols and files that are already loaded don't lock, so they
+  // run concurrently with other threads loading files from the database.
+  constexpr int kFiles = 100;
+  SimpleDescriptorDatabase database;
+  for (int i = 0; i < kFiles; ++i) {
+    AddToDatabase(&database, absl::Substitute(
+                                 "name: 'file$0.proto' package: 'pkg' "
+                                 "message_type { name: 'Message$0' field { "
+                                 "  name: 'value' number: 1 "
+                                 "  label: LABEL_OPTIONAL type: TYPE_INT32 "
+                                 "} }",
+                                 i));
+  }
+  DescriptorPool pool(&database);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&pool, t] {
+      for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < kFiles; ++i) {
+          const int n = (i * 7 + t * 13) % kFiles;
+          const std::string name = absl::StrCat("pkg.Message", n);
+          const Descriptor* descriptor = pool.FindMessageTypeByName(name);
+          ASSERT_NE(descriptor, nullptr);
+          EXPECT_EQ(descriptor->full_name(), name);
+          EXPECT_EQ(pool.FindFieldByName(absl::StrCat(name, ".value")),
+                    descriptor->field(0));
+          EXPECT_EQ(pool.FindFileByName(absl::StrCat("file", n, ".proto")),
+                    descriptor->file());
+          EXPECT_EQ(pool.FindFileContainingSymbol(name), descriptor->file());
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+}
+
 // ===================================================================
 
 class AbortingErrorCollector : public DescriptorPool::ErrorCollector {
@@ -0,0 +1,450 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/generated_message_tcserializer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "absl/base/config.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/arenastring.h"
+#include "google/protobuf/generated_message_tctable_decl.h"
+#include "google/protobuf/generated_message_tctable_impl.h"
+#include "google/protobuf/inlined_string_field.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/message_lite.h"
+#include "google/protobuf/repeated_field.h"
+#include "google/protobuf/repeated_ptr_field.h"
+#include "google/protobuf/wire_format_lite.h"
+#include "utf8_validity.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+// Defined in wire_format_lite.cc
+void PrintUTF8ErrorLog(absl::string_view message_name,
+                       absl::string_view field_name, const char* operation_str,
+                       bool emit_stacktrace);
+
+namespace {
+
+namespace fl = field_layout;
+using FieldEntry = TcParseTableBase::FieldEntry;
+using CodedOutputStream = io::CodedOutputStream;
+
+size_t LengthDelimitedSize(size_t size) {
+  return size + CodedOutputStream::VarintSize32(static_cast<uint32_t>(size));
+}
+
+uint8_t* WriteFixed(uint32_t value, uint8_t* target) {
+  return CodedOutputStream::WriteLittleEndian32ToArray(value, target);
+}
+uint8_t* WriteFixed(uint64_t value, uint8_t* target) {
+  return CodedOutputStream::WriteLittleEndian64ToArray(value, target);
+}
+
+constexpr WireFormatLite::WireType FixedWireType(uint32_t) {
+  return WireFormatLite::WIRETYPE_FIXED32;
+}
+constexpr WireFormatLite::WireType FixedWireType(uint64_t) {
+  return WireFormatLite::WIRETYPE_FIXED64;
+}
+
+const std::string& GetString(const MessageLite& msg, const FieldEntry& entry) {
+  if ((entry.type_card & fl::kRepMask) == fl::kRepIString) {
+    return TcSerializer::RefAt<InlinedStringField>(&msg, entry.offset).Get();
+  }
+  return TcSerializer::RefAt<ArenaStringPtr>(&msg, entry.offset).Get();
+}
+
+const absl::Cord& GetCord(const MessageLite& msg, const FieldEntry& entry) {
+  // Cords in oneofs are allocated separately.
+  if ((entry.type_card & fl::kFcMask) == fl::kFcOneof) {
+    return *TcSerializer::RefAt<absl::Cord*>(&msg, entry.offset);
+  }
+  return TcSerializer::RefAt<absl::Cord>(&msg, entry.offset);
+}
+
+const RepeatedPtrField<MessageLite>& GetRepeatedMessages(
+    const MessageLite& msg, const FieldEntry& entry) {
+  return TcSerializer::RefAt<RepeatedPtrField<MessageLite>>(&msg,
+                                                             entry.offset);
+}
+
+}  // namespace
+
+bool TcSerializer::IsSupported(uint16_t type_card) {
+  if ((type_card & fl::kSplitMask) != 0) return false;
+  const uint16_t rep = type_card & fl::kRepMask;
+  const bool repeated = (type_card & fl::kFcMask) == fl::kFcRepeated;
+  switch (type_card & fl::kFkMask) {
+    case fl::kFkVarint:
+    case fl::kFkPackedVarint:
+    case fl::kFkFixed:
+    case fl::kFkPackedFixed:
+      return true;
+    case fl::kFkString:
+      return repeated ? rep == fl::kRepSString || rep == fl::kRepCord
+                      : rep == fl::kRepAString || rep == fl::kRepIString ||
+                            rep == fl::kRepCord;
+    case fl::kFkMessage:
+      return (rep == fl::kRepMessage || rep == fl::kRepGroup) &&
+             (type_card & fl::kTvMask) != fl::kTvWeakPtr;
+    default:
+      // kFkNone and kFkMap.
+      return false;
+  }
+}
+
+size_t TcSerializer::ByteSizeLong(const MessageLite& msg,
+                                  const TcParseTableBase* table) {
+  size_t total_size = 0;
+  ForEachField(table, [&](const FieldEntry& entry, uint32_t number) {
+    ABSL_DCHECK(IsSupported(entry.type_card));
+    const uint16_t type_card = entry.type_card;
+    if ((type_card & fl::kFcMask) != fl::kFcRepeated &&
+        !HasField(msg, entry, number)) {
+      return;
+    }
+    const size_t tag_size = CodedOutputStream::VarintSize32(number << 3);
+    const uint16_t rep = type_card & fl::kRepMask;
+    switch (type_card & fl::kFkMask) {
+      case fl::kFkVarint:
+      case fl::kFkPackedVarint:
+        total_size += rep == fl::kRep8Bits
+                          ? VarintFieldSize<bool>(msg, entry, tag_size)
+                      : rep == fl::kRep32Bits
+                          ? VarintFieldSize<uint32_t>(msg, entry, tag_size)
+                          : VarintFieldSize<uint64_t>(msg, entry, tag_size);
+        break;
+      case fl::kFkFixed:
+      case fl::kFkPackedFixed:
+        total_size += rep == fl::kRep32Bits
+                          ? FixedFieldSize<uint32_t>(msg, entry, tag_size)
+                          : FixedFieldSize<uint64_t>(msg, entry, tag_size);
+        break;
+      case fl::kFkString:
+        total_size += StringFieldSize(msg, entry, tag_size);
+        break;
+      case fl::kFkMessage:
+        total_size += MessageFieldSize(msg, entry, tag_size);
+        break;
+    }
+  });
+  return total_size;
+}
+
+uint8_t* TcSerializer::Serialize(const MessageLite& msg,
+                                 const TcParseTableBase* table,
+                                 uint8_t* target,
+                                 io::EpsCopyOutputStream* stream) {
+  ForEachField(table, [&](const FieldEntry& entry, uint32_t number) {
+    const uint16_t type_card = entry.type_card;
+    if ((type_card & fl::kFcMask) != fl::kFcRepeated &&
+        !HasField(msg, entry, number)) {
+      return;
+    }
+    const uint16_t rep = type_card & fl::kRepMask;
+    switch (type_card & fl::kFkMask) {
+      case fl::kFkVarint:
+      case fl::kFkPackedVarint:
+        target =
+            rep == fl::kRep8Bits
+                ? WriteVarintField<bool>(msg, entry, number, target, stream)
+            : rep == fl::kRep32Bits
+                ? WriteVarintField<uint32_t>(msg, entry, number, target, stream)
+                : WriteVarintField<uint64_t>(msg, entry, number, target,
+                                             stream);
+        break;
+      case fl::kFkFixed:
+      case fl::kFkPackedFixed:
+        target =
+            rep == fl::kRep32Bits
+                ? WriteFixedField<uint32_t>(msg, entry, number, target, stream)
+                : WriteFixedField<uint64_t>(msg, entry, number, target, stream);
+        break;
+      case fl::kFkString:
+        target = WriteStringField(msg, table, entry, number, target, stream);
+        break;
+      case fl::kFkMessage:
+        target = WriteMessageField(msg, entry, number, target, stream);
+        break;
+    }
+  });
+  return target;
+}
+
+size_t TcSerializer::ByteSizeLong(const MessageLite& msg) {
+  return ByteSizeLong(msg, msg.GetTcParseTable());
+}
+
+uint8_t* TcSerializer::Serialize(const MessageLite& msg, uint8_t* target,
+                                 io::EpsCopyOutputStream* stream) {
+  return Serialize(msg, msg.GetTcParseTable(), target, stream);
+}
+
+template <typename T>
+size_t TcSerializer::VarintFieldSize(const MessageLite& msg,
+                                     const FieldEntry& entry,
+                                     size_t tag_size) {
+  const uint16_t type_card = entry.type_card;
+  const uint16_t card = type_card & fl::kFcMask;
+  if (card != fl::kFcRepeated) {
+    const T value = RefAt<T>(&msg, entry.offset);
+    if (card == fl::kFcSingular && value == 0) return 0;
+    return tag_size +
+           CodedOutputStream::VarintSize64(ToVarint(value, type_card));
+  }
+  const auto& field = RefAt<RepeatedField<T>>(&msg, entry.offset);
+  if (field.empty()) return 0;
+  size_t data_size = 0;
+  for (const T value : field) {
+    data_size += CodedOutputStream::VarintSize64(ToVarint(value, type_card));
+  }
+  if ((type_card & fl::kFkMask) == fl::kFkPackedVarint) {
+    return tag_size + LengthDelimitedSize(data_size);
+  }
+  return tag_size * field.size() + data_size;
+}
+
+template <typename T>
+uint8_t* TcSerializer::WriteVarintField(const MessageLite& msg,
+                                        const FieldEntry& entry,
+                                        uint32_t number, uint8_t* target,
+                                        io::EpsCopyOutputStream* stream) {
+  const uint16_t type_card = entry.type_card;
+  const uint16_t card = type_card & fl::kFcMask;
+  const uint32_t tag =
+      WireFormatLite::MakeTag(number, WireFormatLite::WIRETYPE_VARINT);
+  if (card != fl::kFcRepeated) {
+    const T value = RefAt<T>(&msg, entry.offset);
+    if (card == fl::kFcSingular && value == 0) return target;
+    target = stream->EnsureSpace(target);
+    target = CodedOutputStream::WriteTagToArray(tag, target);
+    return CodedOutputStream::WriteVarint64ToArray(ToVarint(value, type_card),
+                                                   target);
+  }
+  const auto& field = RefAt<RepeatedField<T>>(&msg, entry.offset);
+  if (field.empty()) return target;
+  if ((type_card & fl::kFkMask) == fl::kFkPackedVarint) {
+    // Packed fields have no cached size in the table, so their size is
+    // computed again here.
+    size_t data_size = 0;
+    for (const T value : field) {
+      data_size += CodedOutputStream::VarintSize64(ToVarint(value, type_card));
+    }
+    target = stream->EnsureSpace(target);
+    target = CodedOutputStream::WriteTagToArray(
+        WireFormatLite::MakeTag(number,
+                                WireFormatLite::WIRETYPE_LENGTH_DELIMITED),
+        target);
+    target = CodedOutputStream::WriteVarint32ToArray(
+        static_cast<uint32_t>(data_size), target);
+    for (const T value : field) {
+      target = stream->EnsureSpace(target);
+      target = CodedOutputStream::WriteVarint64ToArray(
+          ToVarint(value, type_card), target);
+    }
+    return target;
+  }
+  for (const T value : field) {
+    target = stream->EnsureSpace(target);
+    target = CodedOutputStream::WriteTagToArray(tag, target);
+    target = CodedOutputStream::WriteVarint64ToArray(ToVarint(value, type_card),
+                                                     target);
+  }
+  return target;
+}
+
+template <typename T>
+size_t TcSerializer::FixedFieldSize(const MessageLite& msg,
+                                    const FieldEntry& entry, size_t tag_size) {
+  const uint16_t card = entry.type_card & fl::kFcMask;
+  if (card != fl::kFcRepeated) {
+    // Floating point values are compared bitwise, so that -0.0 is written.
+    if (card == fl::kFcSingular && RefAt<T>(&msg, entry.offset) == 0) return 0;
+    return tag_size + sizeof(T);
+  }
+  const size_t size = RefAt<RepeatedField<T>>(&msg, entry.offset).size();
+  if (size == 0) return 0;
+  if ((entry.type_card & fl::kFkMask) == fl::kFkPackedFixed) {
+    return tag_size + LengthDelimitedSize(size * sizeof(T));
+  }
+  return (tag_size + sizeof(T)) * size;
+}
+
+template <typename T>
+uint8_t* TcSerializer::WriteFixedField(const MessageLite& msg,
+                                       const FieldEntry& entry, uint32_t number,
+                                       uint8_t* target,
+                                       io::EpsCopyOutputStream* stream) {
+  const uint16_t card = entry.type_card & fl::kFcMask;
+  const uint32_t tag = WireFormatLite::MakeTag(number, FixedWireType(T{}));
+  if (card != fl::kFcRepeated) {
+    const T value = RefAt<T>(&msg, entry.offset);
+    if (card == fl::kFcSingular && value == 0) return target;
+    target = stream->EnsureSpace(target);
+    target = CodedOutputStream::WriteTagToArray(tag, target);
+    return WriteFixed(value, target);
+  }
+  const auto& field = RefAt<RepeatedField<T>>(&msg, entry.offset);
+  if (field.empty()) return target;
+  if ((entry.type_card & fl::kFkMask) == fl::kFkPackedFixed) {
+    const size_t size = field.size() * sizeof(T);
+    target = stream->EnsureSpace(target);
+    target = CodedOutputStream::WriteTagToArray(
+        WireFormatLite::MakeTag(number,
+                                WireFormatLite::WIRETYPE_LENGTH_DELIMITED),
+        target);
+    target = CodedOutputStream::WriteVarint32ToArray(
+        static_cast<uint32_t>(size), target);
+#ifdef ABSL_IS_LITTLE_ENDIAN
+    return stream->WriteRaw(field.data(), static_cast<int>(size), target);
+#else
+    for (const T value : field) {
+      target = stream->EnsureSpace(target);
+      target = WriteFixed(value, target);
+    }
+    return target;
+#endif
+  }
+  for (const T value : field) {
+    target = stream->EnsureSpace(target);
+    target = CodedOutputStream::WriteTagToArray(tag, target);
+    target = WriteFixed(value, target);
+  }
+  return target;
+}
+
+size_t TcSerializer::StringFieldSize(const MessageLite& msg,
+                                     const FieldEntry& entry,
+                                     size_t tag_size) {
+  const uint16_t card = entry.type_card & fl::kFcMask;
+  const uint16_t rep = entry.type_card & fl::kRepMask;
+  if (card == fl::kFcRepeated) {
+    size_t total_size = 0;
+    if (rep == fl::kRepCord) {
+      const auto& field = RefAt<RepeatedField<absl::Cord>>(&msg, entry.offset);
+      for (const absl::Cord& value : field) {
+        total_size += tag_size + LengthDelimitedSize(value.size());
+      }
+    } else {
+      const auto& field =
+          RefAt<RepeatedPtrField<std::string>>(&msg, entry.offset);
+      for (const std::string& value : field) {
+        total_size += tag_size + LengthDelimitedSize(value.size());
+      }
+    }
+    return total_size;
+  }
+  const size_t size = rep == fl::kRepCord ? GetCord(msg, entry).size()
+                                          : GetString(msg, entry).size();
+  if (card == fl::kFcSingular && size == 0) return 0;
+  return tag_size + LengthDelimitedSize(size);
+}
+
+uint8_t* TcSerializer::WriteStringField(const MessageLite& msg,
+                                        const TcParseTableBase* table,
+                                        const FieldEntry& entry,
+                                        uint32_t number, uint8_t* target,
+                                        io::EpsCopyOutputStream* stream) {
+  const uint16_t card = entry.type_card & fl::kFcMask;
+  const uint16_t rep = entry.type_card & fl::kRepMask;
+  const uint16_t xform_val = entry.type_card & fl::kTvMask;
+  // Like the generated serializer, this only reports invalid UTF-8; the
+  // field is written regardless.
+  const auto verify_utf8 = [&](absl::string_view value) {
+    bool check = xform_val == fl::kTvUtf8;
+#ifndef NDEBUG
+    check |= xform_val == fl::kTvUtf8Debug;
+#endif  // NDEBUG
+    if (check && !utf8_range::IsStructurallyValid(value)) {
+      PrintUTF8ErrorLog(TcParser::MessageName(table),
+                        TcParser::FieldName(table, &entry), "serializing",
+                        false);
+    }
+  };
+  if (card == fl::kFcRepeated) {
+    if (rep == fl::kRepCord) {
+      const auto& field = RefAt<RepeatedField<absl::Cord>>(&msg, entry.offset);
+      for (const absl::Cord& value : field) {
+        target = stream->WriteString(number, value, target);
+      }
+    } else {
+      const auto& field =
+          RefAt<RepeatedPtrField<std::string>>(&msg, entry.offset);
+      for (const std::string& value : field) {
+        verify_utf8(value);
+        target = stream->WriteString(number, value, target);
+      }
+    }
+    return target;
+  }
+  if (rep == fl::kRepCord) {
+    const absl::Cord& value = GetCord(msg, entry);
+    if (card == fl::kFcSingular && value.empty()) return target;
+    return stream->WriteString(number, value, target);
+  }
+  const std::string& value = GetString(msg, entry);
+  if (card == fl::kFcSingular && value.empty()) return target;
+  verify_utf8(value);
+  return stream->WriteStringMaybeAliased(number, value, target);
+}
+
+size_t TcSerializer::MessageFieldSize(const MessageLite& msg,
+                                      const FieldEntry& entry,
+                                      size_t tag_size) {
+  const bool is_group = (entry.type_card & fl::kRepMask) == fl::kRepGroup;
+  const auto size = [&](const MessageLite& value) {
+    return is_group ? 2 * tag_size + value.ByteSizeLong()
+                    : tag_size + LengthDelimitedSize(value.ByteSizeLong());
+  };
+  if ((entry.type_card & fl::kFcMask) == fl::kFcRepeated) {
+    size_t total_size = 0;
+    for (const MessageLite& value : GetRepeatedMessages(msg, entry)) {
+      total_size += size(value);
+    }
+    return total_size;
+  }
+  const MessageLite* value = RefAt<const MessageLite*>(&msg, entry.offset);
+  return value == nullptr ? 0 : size(*value);
+}
+
+uint8_t* TcSerializer::WriteMessageField(const MessageLite& msg,
+                                         const FieldEntry& entry,
+                                         uint32_t number, uint8_t* target,
+                                         io::EpsCopyOutputStream* stream) {
+  const bool is_group = (entry.type_card & fl::kRepMask) == fl::kRepGroup;
+  const auto write = [&](const MessageLite& value) {
+    return is_group ? WireFormatLite::InternalWriteGroup(number, value, target,
+                                                         stream)
+                    : WireFormatLite::InternalWriteMessage(
+                          number, value, value.GetCachedSize(), target,
+                          stream);
+  };
+  if ((entry.type_card & fl::kFcMask) == fl::kFcRepeated) {
+    for (const MessageLite& value : GetRepeatedMessages(msg, entry)) {
+      target = write(value);
+    }
+    return target;
+  }
+  const MessageLite* value = RefAt<const MessageLite*>(&msg, entry.offset);
+  return value == nullptr ? target : write(*value);
+}
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,169 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file contains the table-driven serializer, which serializes messages by
+// walking the field entries of their TcParseTable instead of running
+// per-field generated code. Generated code uses it when the C++ generator is
+// run with the `table_driven_serialization` option.
+
+#ifndef GOOGLE_PROTOBUF_GENERATED_MESSAGE_TCSERIALIZER_H__
+#define GOOGLE_PROTOBUF_GENERATED_MESSAGE_TCSERIALIZER_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/numeric/bits.h"
+#include "google/protobuf/generated_message_tctable_decl.h"
+#include "google/protobuf/generated_message_tctable_impl.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/message_lite.h"
+#include "google/protobuf/wire_format_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+class PROTOBUF_EXPORT TcSerializer {
+ public:
+  using FieldEntry = TcParseTableBase::FieldEntry;
+
+  // Returns the serialized size of the fields of `msg` described by `table`,
+  // not including unknown fields. Like ByteSizeLong(), this caches the sizes
+  // of submessages; caching the size of `msg` itself is up to the caller.
+  static size_t ByteSizeLong(const MessageLite& msg,
+                             const TcParseTableBase* table);
+  // Serializes the fields of `msg` described by `table`, not including
+  // unknown fields. Relies on the cached sizes set by ByteSizeLong().
+  static uint8_t* Serialize(const MessageLite& msg,
+                            const TcParseTableBase* table, uint8_t* target,
+                            io::EpsCopyOutputStream* stream);
+  // Like the above, using the parse table of `msg`.
+  static size_t ByteSizeLong(const MessageLite& msg);
+  static uint8_t* Serialize(const MessageLite& msg, uint8_t* target,
+                            io::EpsCopyOutputStream* stream);
+
+  // Returns whether the serializer handles the field described by
+  // `type_card`. Maps, split, lazy and weak fields are not handled, nor are
+  // extensions, which have no field entries.
+  static bool IsSupported(uint16_t type_card);
+
+  // Calls `fn(entry, field_number)` for each field entry of `table`, in
+  // order of field number.
+  template <typename Fn>
+  static void ForEachField(const TcParseTableBase* table, Fn&& fn);
+
+  // Returns whether the non-repeated field described by `entry` is set,
+  // going by its has bit or oneof case. Fields without explicit presence are
+  // always reported as set; they are skipped if they hold a zero value.
+  static bool HasField(const MessageLite& msg, const FieldEntry& entry,
+                       uint32_t number) {
+    switch (entry.type_card & field_layout::kFcMask) {
+      case field_layout::kFcOptional: {
+        // `has_idx` counts bits from the start of the message.
+        const uint32_t has_idx = entry.has_idx;
+        const uint32_t hasblock = RefAt<uint32_t>(&msg, has_idx / 32 * 4);
+        return (hasblock & (uint32_t{1} << (has_idx % 32))) != 0;
+      }
+      case field_layout::kFcOneof:
+        return RefAt<uint32_t>(&msg, entry.has_idx) == number;
+      default:
+        return true;
+    }
+  }
+
+  // Returns the value of a varint field as it is encoded on the wire.
+  static uint64_t ToVarint(bool value, uint16_t) { return value; }
+  static uint64_t ToVarint(uint32_t value, uint16_t type_card) {
+    if ((type_card & field_layout::kTvMask) == field_layout::kTvZigZag) {
+      return WireFormatLite::ZigZagEncode32(static_cast<int32_t>(value));
+    }
+    if ((type_card & field_layout::kFmtMask) == field_layout::kFmtUnsigned) {
+      return value;
+    }
+    // int32 and enum values are sign-extended to 64 bits on the wire.
+    return static_cast<uint64_t>(static_cast<int32_t>(value));
+  }
+  static uint64_t ToVarint(uint64_t value, uint16_t type_card) {
+    if ((type_card & field_layout::kTvMask) == field_layout::kTvZigZag) {
+      return WireFormatLite::ZigZagEncode64(static_cast<int64_t>(value));
+    }
+    return value;
+  }
+
+  template <typename T>
+  static const T& RefAt(const void* x, size_t offset) {
+    return *reinterpret_cast<const T*>(static_cast<const char*>(x) + offset);
+  }
+
+ private:
+  template <typename T>
+  static size_t VarintFieldSize(const MessageLite& msg, const FieldEntry& entry,
+                                size_t tag_size);
+  template <typename T>
+  static uint8_t* WriteVarintField(const MessageLite& msg,
+                                   const FieldEntry& entry, uint32_t number,
+                                   uint8_t* target,
+                                   io::EpsCopyOutputStream* stream);
+  template <typename T>
+  static size_t FixedFieldSize(const MessageLite& msg, const FieldEntry& entry,
+                               size_t tag_size);
+  template <typename T>
+  static uint8_t* WriteFixedField(const MessageLite& msg,
+                                  const FieldEntry& entry, uint32_t number,
+                                  uint8_t* target,
+                                  io::EpsCopyOutputStream* stream);
+  static size_t StringFieldSize(const MessageLite& msg, const FieldEntry& entry,
+                                size_t tag_size);
+  static uint8_t* WriteStringField(const MessageLite& msg,
+                                   const TcParseTableBase* table,
+                                   const FieldEntry& entry, uint32_t number,
+                                   uint8_t* target,
+                                   io::EpsCopyOutputStream* stream);
+  static size_t MessageFieldSize(const MessageLite& msg,
+                                 const FieldEntry& entry, size_t tag_size);
+  static uint8_t* WriteMessageField(const MessageLite& msg,
+                                    const FieldEntry& entry, uint32_t number,
+                                    uint8_t* target,
+                                    io::EpsCopyOutputStream* stream);
+};
+
+template <typename Fn>
+void TcSerializer::ForEachField(const TcParseTableBase* table, Fn&& fn) {
+  // See TcParser::FindFieldEntry() for the layout of the lookup table.
+  const FieldEntry* const entries = table->field_entries_begin();
+  const uint32_t num_entries = table->num_field_entries;
+  uint32_t index = 0;
+  for (uint32_t present = ~table->skipmap32;
+       present != 0 && index < num_entries; present &= present - 1) {
+    fn(entries[index++], static_cast<uint32_t>(absl::countr_zero(present)) + 1);
+  }
+  const uint16_t* lookup = table->field_lookup_begin();
+  while (index < num_entries) {
+    const uint32_t fstart = lookup[0] | (uint32_t{lookup[1]} << 16);
+    const uint32_t num_skip_entries = lookup[2];
+    lookup += 3;
+    for (uint32_t i = 0; i < num_skip_entries; ++i, lookup += 2) {
+      index = lookup[1];
+      for (uint32_t present = ~uint32_t{lookup[0]} & 0xFFFF; present != 0;
+           present &= present - 1) {
+        fn(entries[index++],
+           fstart + i * 16 + static_cast<uint32_t>(absl::countr_zero(present)));
+      }
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_GENERATED_MESSAGE_TCSERIALIZER_H__
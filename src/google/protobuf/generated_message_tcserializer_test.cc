@@ -0,0 +1,137 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/generated_message_tcserializer.h"
+
+#include <cstdint>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/message_lite.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/unittest_lite.pb.h"
+#include "google/protobuf/unittest_proto3.pb.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+namespace {
+
+using ::protobuf_unittest::NestedTestAllTypes;
+using ::protobuf_unittest::TestAllTypes;
+using ::protobuf_unittest::TestOneof2;
+using ::protobuf_unittest::TestPackedTypes;
+using ::protobuf_unittest::TestUnpackedTypes;
+
+std::string TableDrivenSerialize(const MessageLite& message) {
+  const size_t size = TcSerializer::ByteSizeLong(message);
+  std::string output(size, '\0');
+  uint8_t* target = reinterpret_cast<uint8_t*>(&output[0]);
+  io::EpsCopyOutputStream stream(
+      target, static_cast<int>(size),
+      io::CodedOutputStream::IsDefaultSerializationDeterministic());
+  uint8_t* end = TcSerializer::Serialize(message, target, &stream);
+  EXPECT_EQ(end, target + size);
+  return output;
+}
+
+// The table-driven serializer does not write unknown fields, so messages
+// without them must serialize to the same bytes as the generated code.
+void ExpectSameBytes(const MessageLite& message) {
+  EXPECT_EQ(TableDrivenSerialize(message), message.SerializePartialAsString());
+}
+
+TEST(TcSerializerTest, AllTypes) {
+  TestAllTypes message;
+  ExpectSameBytes(message);
+  TestUtil::SetAllFields(&message);
+  ExpectSameBytes(message);
+}
+
+TEST(TcSerializerTest, NegativeValues) {
+  TestAllTypes message;
+  message.set_optional_int32(-1);
+  message.set_optional_sint32(-2);
+  message.set_optional_sint64(-3);
+  message.set_optional_double(-0.0);
+  message.set_optional_nested_enum(TestAllTypes::NEG);
+  message.add_repeated_int32(-4);
+  message.add_repeated_nested_enum(TestAllTypes::NEG);
+  ExpectSameBytes(message);
+}
+
+TEST(TcSerializerTest, PackedAndUnpacked) {
+  TestPackedTypes packed;
+  TestUtil::SetPackedFields(&packed);
+  ExpectSameBytes(packed);
+  TestUnpackedTypes unpacked;
+  TestUtil::SetUnpackedFields(&unpacked);
+  ExpectSameBytes(unpacked);
+}
+
+TEST(TcSerializerTest, Oneofs) {
+  TestOneof2 message;
+  message.set_foo_string("foo");
+  message.set_bar_string("bar");
+  message.set_baz_int(1);
+  ExpectSameBytes(message);
+  message.mutable_foo_message()->set_moo_int(2);
+  message.mutable_foogroup()->set_a(3);
+  ExpectSameBytes(message);
+}
+
+TEST(TcSerializerTest, ImplicitPresence) {
+  proto3_unittest::TestAllTypes message;
+  ExpectSameBytes(message);
+  message.set_optional_int32(1);
+  message.set_optional_float(-0.0f);
+  message.set_optional_string("abc");
+  message.set_optional_nested_enum(proto3_unittest::TestAllTypes::BAZ);
+  message.mutable_optional_nested_message()->set_bb(2);
+  message.add_repeated_int32(-3);
+  message.add_repeated_nested_message()->set_bb(0);
+  ExpectSameBytes(message);
+}
+
+TEST(TcSerializerTest, Lite) {
+  unittest::TestAllTypesLite message;
+  message.set_optional_int32(1);
+  message.set_optional_string("abc");
+  message.add_repeated_string("a");
+  message.mutable_optional_nested_message()->set_bb(2);
+  message.add_repeated_int32(-5);
+  ExpectSameBytes(message);
+}
+
+TEST(TcSerializerTest, CachesSubmessageSizes) {
+  NestedTestAllTypes message;
+  NestedTestAllTypes* child = &message;
+  for (int i = 0; i < 10; ++i) {
+    child->mutable_payload()->set_optional_string(std::string(i * 10, 'x'));
+    child->add_repeated_child()->mutable_payload()->add_repeated_int64(i);
+    child = child->mutable_child();
+  }
+  const size_t size = TcSerializer::ByteSizeLong(message);
+  // Serialize() relies on the sizes of submessages cached by ByteSizeLong().
+  const int child_size = message.child().GetCachedSize();
+  EXPECT_NE(child_size, 0);
+  EXPECT_EQ(child_size, message.child().ByteSizeLong());
+  EXPECT_EQ(size, message.ByteSizeLong());
+  ExpectSameBytes(message);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
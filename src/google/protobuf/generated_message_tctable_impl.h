@@ -1048,6 +1048,8 @@ class PROTOBUF_EXPORT TcParser final {
   friend class FindFieldEntryTest;
   friend struct ParseFunctionGeneratorTestPeer;
   friend struct FuzzPeer;
+  // For MessageName() and FieldName() in UTF-8 errors on serialization:
+  friend class TcSerializer;
   static constexpr const uint32_t kMtSmallScanSize = 4;
 
   // Mini parsing:
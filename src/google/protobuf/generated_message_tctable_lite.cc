@@ -957,6 +957,25 @@ PROTOBUF_NOINLINE const char* TcParser::FastZ64R2(PROTOBUF_TC_PARAM_DECL) {
       PROTOBUF_TC_PARAM_PASS);
 }
 
+namespace {
+
+// Decodes a packed varint payload into `field`. Integer fields use the bulk
+// decoder; packed bools are rare and go through the per-varint path.
+template <bool zigzag, typename FieldType>
+inline PROTOBUF_ALWAYS_INLINE const char* ReadPackedVarintField(
+    const char* ptr, ParseContext* ctx, RepeatedField<FieldType>* field) {
+  return ctx->ReadPackedVarintBulk<zigzag>(ptr, field);
+}
+
+template <bool zigzag>
+inline PROTOBUF_ALWAYS_INLINE const char* ReadPackedVarintField(
+    const char* ptr, ParseContext* ctx, RepeatedField<bool>* field) {
+  return ctx->ReadPackedVarint(
+      ptr, [field](uint64_t varint) { field->Add(varint != 0); });
+}
+
+}  // namespace
+
 template <typename FieldType, typename TagType, bool zigzag>
 inline PROTOBUF_ALWAYS_INLINE const char* TcParser::PackedVarint(
     PROTOBUF_TC_PARAM_DECL) {
@@ -968,19 +987,7 @@ inline PROTOBUF_ALWAYS_INLINE const char* TcParser::PackedVarint(
   // pending hasbits now:
   SyncHasbits(msg, hasbits, table);
   auto* field = &RefAt<RepeatedField<FieldType>>(msg, data.offset());
-  return ctx->ReadPackedVarint(ptr, [field](uint64_t varint) {
-    FieldType val;
-    if (zigzag) {
-      if (sizeof(FieldType) == 8) {
-        val = WireFormatLite::ZigZagDecode64(varint);
-      } else {
-        val = WireFormatLite::ZigZagDecode32(varint);
-      }
-    } else {
-      val = varint;
-    }
-    field->Add(val);
-  });
+  return ReadPackedVarintField<zigzag>(ptr, ctx, field);
 }
 
 PROTOBUF_NOINLINE const char* TcParser::FastV8P1(PROTOBUF_TC_PARAM_DECL) {
@@ -2032,14 +2039,10 @@ const char* TcParser::MpPackedVarintT(PROTOBUF_TC_PARAM_DECL) {
         field->Add(value);
       }
     });
+  } else if (is_zigzag) {
+    return ReadPackedVarintField<true>(ptr, ctx, field);
   } else {
-    return ctx->ReadPackedVarint(ptr, [=](uint64_t value) {
-      field->Add(is_zigzag ? (sizeof(FieldType) == 8
-                                  ? WireFormatLite::ZigZagDecode64(value)
-                                  : WireFormatLite::ZigZagDecode32(
-                                        static_cast<uint32_t>(value)))
-                           : value);
-    });
+    return ReadPackedVarintField<false>(ptr, ctx, field);
   }
 }
 
@@ -0,0 +1,259 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/io/mmap_stream.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+#include <errno.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "absl/log/absl_check.h"
+#include "absl/log/absl_log.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/io_win32.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+#ifdef _WIN32
+// DO NOT include <io.h>, instead create functions in io_win32.{h,cc} and import
+// them like we do below.
+using google::protobuf::io::win32::close;
+#endif
+
+namespace {
+
+// EINTR sucks.
+int close_no_eintr(int fd) {
+  int result;
+  do {
+    result = close(fd);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+#ifndef _WIN32
+int64_t PageSize() {
+  static const int64_t page_size = sysconf(_SC_PAGESIZE);
+  return page_size;
+}
+#endif
+
+}  // namespace
+
+// A mapped range of the file. Unmapped when the last reference goes away,
+// which may be held by a Cord returned from ReadCord().
+class MmapInputStream::Window {
+ public:
+  Window(const char* data, int64_t begin, int64_t end)
+      : data_(data), begin_(begin), end_(end) {}
+  Window(const Window&) = delete;
+  Window& operator=(const Window&) = delete;
+  ~Window() {
+#ifndef _WIN32
+    munmap(const_cast<char*>(data_), static_cast<size_t>(end_ - begin_));
+#endif
+  }
+
+  // Returns a pointer to the byte at file offset `offset`.
+  const char* At(int64_t offset) const { return data_ + (offset - begin_); }
+  // The range of file offsets that is mapped.
+  int64_t begin() const { return begin_; }
+  int64_t end() const { return end_; }
+
+ private:
+  const char* const data_;
+  const int64_t begin_;
+  const int64_t end_;
+};
+
+MmapInputStream::Options::Options()
+    : window_size(sizeof(void*) >= 8 ? int64_t{1} << 30 : int64_t{64} << 20),
+      block_size(1 << 20),
+      readahead(int64_t{8} << 20),
+      alias_cords(false) {}
+
+MmapInputStream::MmapInputStream(int file_descriptor)
+    : MmapInputStream(file_descriptor, Options()) {}
+
+MmapInputStream::MmapInputStream(int file_descriptor, const Options& options)
+    : file_(file_descriptor), options_(options) {
+  ABSL_CHECK_GT(options_.window_size, 0);
+  ABSL_CHECK_GT(options_.block_size, 0);
+#ifndef _WIN32
+  struct stat info;
+  const off_t start = lseek(file_, 0, SEEK_CUR);
+  if (start >= 0 && fstat(file_, &info) == 0 && S_ISREG(info.st_mode)) {
+    start_ = position_ = readahead_end_ = start;
+    size_ = std::max<int64_t>(start, info.st_size);
+    return;
+  }
+#endif
+  // Pipes, sockets and the like can't be mapped.
+  fallback_ = std::make_unique<FileInputStream>(file_);
+}
+
+MmapInputStream::~MmapInputStream() {
+  if (close_on_delete_ && !is_closed_) {
+    if (!Close()) {
+      ABSL_LOG(ERROR) << "close() failed: " << strerror(errno_);
+    }
+  }
+}
+
+bool MmapInputStream::Close() {
+  ABSL_CHECK(!is_closed_);
+
+  is_closed_ = true;
+  window_.reset();
+  fallback_.reset();
+  if (close_no_eintr(file_) != 0) {
+    errno_ = errno;
+    return false;
+  }
+  return true;
+}
+
+int MmapInputStream::GetErrno() const {
+  if (errno_ == 0 && fallback_ != nullptr) return fallback_->GetErrno();
+  return errno_;
+}
+
+bool MmapInputStream::Next(const void** data, int* size) {
+  if (fallback_ != nullptr) return fallback_->Next(data, size);
+  backup_limit_ = 0;
+  if (errno_ != 0 || position_ >= size_) return false;
+  if (window_ == nullptr || position_ < window_->begin() ||
+      position_ >= window_->end()) {
+    if (!MapWindowAt(position_)) return false;
+  }
+  const int64_t block =
+      std::min<int64_t>(options_.block_size, window_->end() - position_);
+  *data = window_->At(position_);
+  *size = static_cast<int>(block);
+  position_ += block;
+  backup_limit_ = static_cast<int>(block);
+  Readahead();
+  return true;
+}
+
+void MmapInputStream::BackUp(int count) {
+  if (fallback_ != nullptr) return fallback_->BackUp(count);
+  ABSL_CHECK_GE(count, 0);
+  ABSL_CHECK_LE(count, backup_limit_)
+      << "BackUp() can only be called after Next(), and cannot back up more "
+         "than Next() returned.";
+  position_ -= count;
+  backup_limit_ = 0;
+}
+
+bool MmapInputStream::Skip(int count) {
+  if (fallback_ != nullptr) return fallback_->Skip(count);
+  ABSL_CHECK_GE(count, 0);
+  backup_limit_ = 0;
+  if (errno_ != 0) return false;
+  if (count > size_ - position_) {
+    position_ = size_;
+    return false;
+  }
+  position_ += count;
+  return true;
+}
+
+int64_t MmapInputStream::ByteCount() const {
+  if (fallback_ != nullptr) return fallback_->ByteCount();
+  return position_ - start_;
+}
+
+bool MmapInputStream::ReadCord(absl::Cord* cord, int count) {
+  if (fallback_ != nullptr || !options_.alias_cords || count <= 0 ||
+      count > size_ - position_ || errno_ != 0) {
+    return ZeroCopyInputStream::ReadCord(cord, count);
+  }
+  backup_limit_ = 0;
+  if (window_ == nullptr || position_ < window_->begin() ||
+      position_ + count > window_->end()) {
+    // Remap so that the window starts at the Cord. Cords larger than a
+    // window are copied.
+    if (!MapWindowAt(position_)) return false;
+    if (position_ + count > window_->end()) {
+      return ZeroCopyInputStream::ReadCord(cord, count);
+    }
+  }
+  std::shared_ptr<const Window> window = window_;
+  cord->Append(absl::MakeCordFromExternal(
+      absl::string_view(window->At(position_), static_cast<size_t>(count)),
+      [window] {}));
+  position_ += count;
+  return true;
+}
+
+bool MmapInputStream::MapWindowAt(int64_t offset) {
+#ifndef _WIN32
+  const int64_t page_size = PageSize();
+  const int64_t window_size =
+      (options_.window_size + page_size - 1) / page_size * page_size;
+  const int64_t begin = offset - offset % page_size;
+  const int64_t end = std::min(size_, begin + window_size);
+  // Release the previous window first, so that at most one window's worth of
+  // address space is used at a time (aside from windows kept by Cords).
+  window_.reset();
+  void* data = mmap(nullptr, static_cast<size_t>(end - begin), PROT_READ,
+                    MAP_PRIVATE, file_, static_cast<off_t>(begin));
+  if (data == MAP_FAILED) {
+    errno_ = errno;
+    return false;
+  }
+#ifdef MADV_SEQUENTIAL
+  madvise(data, static_cast<size_t>(end - begin), MADV_SEQUENTIAL);
+#endif
+  window_ = std::make_shared<const Window>(static_cast<const char*>(data),
+                                           begin, end);
+  readahead_end_ = offset;
+  return true;
+#else   // _WIN32
+  return false;
+#endif  // !_WIN32
+}
+
+void MmapInputStream::Readahead() {
+#if !defined(_WIN32) && defined(MADV_WILLNEED)
+  if (options_.readahead <= 0) return;
+  // Only ask again once half of the previous request has been read, so that
+  // madvise() is called once per readahead / 2 bytes rather than per block.
+  if (readahead_end_ - position_ > options_.readahead / 2) return;
+  const int64_t begin = std::max(readahead_end_, position_);
+  const int64_t end = std::min(position_ + options_.readahead, window_->end());
+  if (begin >= end) return;
+  // madvise() requires a page-aligned address. The window itself is aligned.
+  const int64_t aligned_begin = begin - begin % PageSize();
+  madvise(const_cast<char*>(window_->At(aligned_begin)),
+          static_cast<size_t>(end - aligned_begin), MADV_WILLNEED);
+  readahead_end_ = end;
+#endif
+}
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,147 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file contains the definition for MmapInputStream, a
+// ZeroCopyInputStream that reads a file by mapping it into memory.
+//
+// Unlike FileInputStream, which read()s each block into a buffer,
+// MmapInputStream hands out the mapped pages themselves, so the parser reads
+// straight from the page cache without any copying.
+
+#ifndef GOOGLE_PROTOBUF_IO_MMAP_STREAM_H__
+#define GOOGLE_PROTOBUF_IO_MMAP_STREAM_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "absl/strings/cord.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+// A ZeroCopyInputStream which reads a file through a read-only memory
+// mapping. Reading starts at the current offset of the file descriptor, which
+// is not advanced by the stream.
+//
+// Files larger than Options::window_size are mapped one window at a time, so
+// multi-gigabyte files can be read without reserving address space for all of
+// them. The kernel is told that the mapping is read sequentially, and pages
+// ahead of the read position are prefetched with madvise(MADV_WILLNEED).
+//
+// The file must not be truncated while it is mapped. Reading a page past the
+// new end of the file raises SIGBUS, and the mapped pages are read whenever
+// the buffers returned by Next() (or Cords aliasing them) are, so the signal
+// may come long after the truncation and far from this stream. Use
+// FileInputStream for files that other processes may change while they are
+// being read.
+//
+// If the descriptor cannot be mapped (e.g. it is a pipe or socket, or the
+// platform has no mmap()), the stream falls back to reading it like
+// FileInputStream does.
+class PROTOBUF_EXPORT MmapInputStream final : public ZeroCopyInputStream {
+ public:
+  struct PROTOBUF_EXPORT Options {
+    Options();
+
+    // The number of bytes mapped at a time. Rounded up to a multiple of the
+    // page size. Defaults to 1GB on 64-bit platforms and 64MB otherwise.
+    int64_t window_size;
+
+    // The maximum number of bytes returned by each call to Next(). Smaller
+    // blocks let the stream issue readahead in finer steps. Defaults to 1MB.
+    int block_size;
+
+    // How many bytes beyond the read position are requested from the kernel
+    // with MADV_WILLNEED. Zero disables readahead hints. Defaults to 8MB.
+    int64_t readahead;
+
+    // If true, ReadCord() returns Cords that reference the mapping instead of
+    // copies of it, so Cord fields parsed from this stream share the mapped
+    // pages. Such Cords keep their window mapped until they are destroyed,
+    // and see any later changes to the file. Defaults to false.
+    bool alias_cords;
+  };
+
+  // Creates a stream that reads from the given Unix file descriptor.
+  explicit MmapInputStream(int file_descriptor);
+  MmapInputStream(int file_descriptor, const Options& options);
+  MmapInputStream(const MmapInputStream&) = delete;
+  MmapInputStream& operator=(const MmapInputStream&) = delete;
+  ~MmapInputStream() override;
+
+  // Unmaps the file and closes the underlying file descriptor. Returns false
+  // if an error occurs during the process; use GetErrno() to examine the
+  // error. Even if an error occurs, the file descriptor is closed when this
+  // returns.
+  bool Close();
+
+  // By default, the file descriptor is not closed when the stream is
+  // destroyed. Call SetCloseOnDelete(true) to change that.
+  void SetCloseOnDelete(bool value) { close_on_delete_ = value; }
+
+  // If an I/O error has occurred on this file descriptor, this is the errno
+  // from that error. Otherwise, this is zero. Once an error occurs, the
+  // stream is broken and all subsequent operations will fail.
+  int GetErrno() const;
+
+  // Returns whether the file is being read through a mapping, as opposed to
+  // the read() fallback.
+  bool IsMapped() const { return fallback_ == nullptr; }
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+  bool ReadCord(absl::Cord* cord, int count) override;
+
+ private:
+  class Window;
+
+  // Maps the window containing `offset`. Returns false on error.
+  bool MapWindowAt(int64_t offset);
+  // Issues readahead for the bytes following position_ when the previous
+  // request is about to be used up.
+  void Readahead();
+
+  const int file_;
+  const Options options_;
+  bool close_on_delete_ = false;
+  bool is_closed_ = false;
+  int errno_ = 0;
+
+  // Offsets are relative to the start of the file. The stream reads the bytes
+  // [start_, size_).
+  int64_t start_ = 0;
+  int64_t size_ = 0;
+  int64_t position_ = 0;
+  // The size of the last block returned by Next(), which may be backed up.
+  int backup_limit_ = 0;
+  // The end of the range last requested with MADV_WILLNEED.
+  int64_t readahead_end_ = 0;
+
+  // The window containing position_, if any. Shared with aliasing Cords.
+  std::shared_ptr<const Window> window_;
+
+  // Used instead of the mapping if the file cannot be mapped.
+  std::unique_ptr<FileInputStream> fallback_;
+};
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_IO_MMAP_STREAM_H__
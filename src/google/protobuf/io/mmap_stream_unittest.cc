@@ -0,0 +1,199 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/io/mmap_stream.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "google/protobuf/testing/file.h"
+#include <gtest/gtest.h>
+#include "absl/log/absl_check.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/testing/googletest.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace io {
+namespace {
+
+class MmapInputStreamTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    filename_ = absl::StrCat(TestTempDir(), "/mmap_stream_test_file");
+  }
+  void TearDown() override {
+    if (fd_ >= 0) close(fd_);
+    File::DeleteRecursively(filename_, nullptr, nullptr);
+  }
+
+  // Writes `contents` to the test file and opens it for reading.
+  int OpenWithContents(absl::string_view contents) {
+    ABSL_CHECK_OK(File::SetContents(filename_, contents, true));
+    fd_ = open(filename_.c_str(), O_RDONLY);
+    ABSL_CHECK_GE(fd_, 0);
+    return fd_;
+  }
+
+  // Options with windows and blocks small enough to be crossed often.
+  static MmapInputStream::Options SmallWindows() {
+    MmapInputStream::Options options;
+    options.window_size = 3 * sysconf(_SC_PAGESIZE);
+    options.block_size = 1000;
+    options.readahead = 4096;
+    return options;
+  }
+
+  static std::string MakeContents(int size) {
+    std::string contents;
+    for (int i = 0; i < size; ++i) contents.push_back(static_cast<char>(i * 7));
+    return contents;
+  }
+
+  // Reads everything left in `input` through Next().
+  static std::string ReadAll(ZeroCopyInputStream* input) {
+    std::string result;
+    const void* data;
+    int size;
+    while (input->Next(&data, &size)) {
+      result.append(static_cast<const char*>(data), size);
+    }
+    return result;
+  }
+
+  std::string filename_;
+  int fd_ = -1;
+};
+
+TEST_F(MmapInputStreamTest, ReadsWholeFile) {
+  const std::string contents = MakeContents(100000);
+  MmapInputStream input(OpenWithContents(contents), SmallWindows());
+  EXPECT_TRUE(input.IsMapped());
+  EXPECT_EQ(ReadAll(&input), contents);
+  EXPECT_EQ(input.ByteCount(), contents.size());
+  EXPECT_EQ(input.GetErrno(), 0);
+}
+
+TEST_F(MmapInputStreamTest, DefaultOptions) {
+  const std::string contents = MakeContents(5000);
+  MmapInputStream input(OpenWithContents(contents));
+  EXPECT_EQ(ReadAll(&input), contents);
+}
+
+TEST_F(MmapInputStreamTest, EmptyFile) {
+  MmapInputStream input(OpenWithContents(""));
+  const void* data;
+  int size;
+  EXPECT_FALSE(input.Next(&data, &size));
+  EXPECT_EQ(input.ByteCount(), 0);
+}
+
+TEST_F(MmapInputStreamTest, BackUpAndSkip) {
+  const std::string contents = MakeContents(100000);
+  MmapInputStream input(OpenWithContents(contents), SmallWindows());
+  const void* data;
+  int size;
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ(size, 1000);
+  input.BackUp(400);
+  EXPECT_EQ(input.ByteCount(), 600);
+  // Skip past the end of the current window.
+  ASSERT_TRUE(input.Skip(20000));
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ(absl::string_view(static_cast<const char*>(data), size),
+            absl::string_view(contents).substr(20600, size));
+  input.BackUp(size);
+  EXPECT_EQ(ReadAll(&input), contents.substr(20600));
+  EXPECT_FALSE(input.Skip(1));
+}
+
+TEST_F(MmapInputStreamTest, StartsAtFileOffset) {
+  const std::string contents = MakeContents(10000);
+  const int fd = OpenWithContents(contents);
+  ASSERT_EQ(lseek(fd, 1234, SEEK_SET), 1234);
+  MmapInputStream input(fd, SmallWindows());
+  EXPECT_EQ(ReadAll(&input), contents.substr(1234));
+  EXPECT_EQ(input.ByteCount(), contents.size() - 1234);
+}
+
+TEST_F(MmapInputStreamTest, FallsBackForPipes) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  ASSERT_EQ(write(fds[1], "hello", 5), 5);
+  close(fds[1]);
+  MmapInputStream input(fds[0]);
+  input.SetCloseOnDelete(true);
+  EXPECT_FALSE(input.IsMapped());
+  EXPECT_EQ(ReadAll(&input), "hello");
+  EXPECT_EQ(input.ByteCount(), 5);
+}
+
+TEST_F(MmapInputStreamTest, CopiesCordsByDefault) {
+  const std::string contents = MakeContents(10000);
+  MmapInputStream input(OpenWithContents(contents), SmallWindows());
+  absl::Cord cord;
+  ASSERT_TRUE(input.ReadCord(&cord, 5000));
+  EXPECT_EQ(cord, contents.substr(0, 5000));
+  EXPECT_EQ(ReadAll(&input), contents.substr(5000));
+}
+
+TEST_F(MmapInputStreamTest, AliasesCords) {
+  const std::string contents = MakeContents(100000);
+  MmapInputStream::Options options = SmallWindows();
+  options.alias_cords = true;
+  absl::Cord cord;
+  {
+    MmapInputStream input(OpenWithContents(contents), options);
+    const void* data;
+    int size;
+    ASSERT_TRUE(input.Next(&data, &size));
+    input.BackUp(size - 10);
+    ASSERT_TRUE(input.ReadCord(&cord, 5000));
+    // The Cord points into the mapping.
+    ASSERT_TRUE(cord.TryFlat().has_value());
+    EXPECT_EQ(cord.TryFlat()->data(), static_cast<const char*>(data) + 10);
+    // Cords that don't fit into the current window cause a remap.
+    ASSERT_TRUE(input.Skip(10000));
+    absl::Cord other;
+    ASSERT_TRUE(input.ReadCord(&other, 10000));
+    EXPECT_EQ(other, contents.substr(15010, 10000));
+    // Cords larger than a window are copied.
+    absl::Cord large;
+    ASSERT_TRUE(input.ReadCord(&large, 20000));
+    EXPECT_EQ(large, contents.substr(25010, 20000));
+    EXPECT_EQ(ReadAll(&input), contents.substr(45010));
+    EXPECT_FALSE(input.ReadCord(&large, 1));
+  }
+  // The Cord keeps its window mapped after the stream is gone.
+  EXPECT_EQ(cord, contents.substr(10, 5000));
+}
+
+TEST_F(MmapInputStreamTest, ParsesMessages) {
+  protobuf_unittest::TestCord message;
+  message.set_optional_bytes_cord(std::string(100000, 'x'));
+  MmapInputStream::Options options = SmallWindows();
+  options.window_size = 1 << 20;
+  options.alias_cords = true;
+  MmapInputStream input(OpenWithContents(message.SerializeAsString()),
+                        options);
+  protobuf_unittest::TestCord parsed;
+  ASSERT_TRUE(parsed.ParseFromZeroCopyStream(&input));
+  EXPECT_EQ(parsed.optional_bytes_cord(), message.optional_bytes_cord());
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // !_WIN32
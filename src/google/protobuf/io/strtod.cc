@@ -9,6 +9,7 @@
 
 #include <float.h>  // FLT_DIG and DBL_DIG
 
+#include <charconv>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
@@ -21,6 +22,14 @@
 #include "absl/strings/charconv.h"
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+
+// Floating-point std::to_chars, which finds the shortest digits that
+// round-trip (with Ryu in libstdc++ and MSVC), is missing from some standard
+// libraries that otherwise support C++17.
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define PROTOBUF_IO_STRTOD_TO_CHARS 1
+#endif
 
 namespace google {
 namespace protobuf {
@@ -243,8 +252,97 @@ char *DoubleToBuffer(double value, char *buffer) {
   DelocalizeRadix(buffer);
   return buffer;
 }
+
+#ifdef PROTOBUF_IO_STRTOD_TO_CHARS
+
+// Writes the shortest digits of a finite `value` as "%.*g" would with a
+// precision of `short_precision` if they fit, or `long_precision` otherwise,
+// which is the notation DoubleToBuffer() and FloatToBuffer() produce.
+template <typename T>
+absl::string_view ShortestToBuffer(T value, int short_precision,
+                                   int long_precision, char *buffer) {
+  // Scientific notation gives the digits and the exponent in a fixed layout:
+  // an optional sign, one digit, optionally a point followed by more digits,
+  // then "e", the exponent's sign and at least two exponent digits.
+  char sci[kShortestToBufferSize];
+  auto result = std::to_chars(sci, sci + sizeof(sci), value,
+                              std::chars_format::scientific);
+  ABSL_DCHECK(result.ec == std::errc());
+  const char *ptr = sci;
+  char *out = buffer;
+  if (*ptr == '-') *out++ = *ptr++;
+
+  char digits[kShortestToBufferSize];
+  int num_digits = 0;
+  for (; *ptr != 'e'; ++ptr) {
+    if (*ptr != '.') digits[num_digits++] = *ptr;
+  }
+  ++ptr;
+  const bool negative_exponent = *ptr++ == '-';
+  int exponent = 0;
+  for (; ptr < result.ptr; ++ptr) exponent = exponent * 10 + (*ptr - '0');
+  if (negative_exponent) exponent = -exponent;
+
+  const int precision =
+      num_digits <= short_precision ? short_precision : long_precision;
+  if (exponent < -4 || exponent >= precision) {
+    *out++ = digits[0];
+    if (num_digits > 1) {
+      *out++ = '.';
+      memcpy(out, digits + 1, num_digits - 1);
+      out += num_digits - 1;
+    }
+    *out++ = 'e';
+    *out++ = negative_exponent ? '-' : '+';
+    if (negative_exponent) exponent = -exponent;
+    if (exponent >= 100) *out++ = '0' + exponent / 100;
+    *out++ = '0' + exponent / 10 % 10;
+    *out++ = '0' + exponent % 10;
+  } else if (exponent < 0) {
+    *out++ = '0';
+    *out++ = '.';
+    for (int i = -1; i > exponent; --i) *out++ = '0';
+    memcpy(out, digits, num_digits);
+    out += num_digits;
+  } else {
+    for (int i = 0; i <= exponent; ++i) {
+      *out++ = i < num_digits ? digits[i] : '0';
+    }
+    if (num_digits > exponent + 1) {
+      *out++ = '.';
+      memcpy(out, digits + exponent + 1, num_digits - exponent - 1);
+      out += num_digits - exponent - 1;
+    }
+  }
+  return absl::string_view(buffer, static_cast<size_t>(out - buffer));
+}
+
+#endif  // PROTOBUF_IO_STRTOD_TO_CHARS
+
 }  // namespace
 
+absl::string_view ShortestDtoa(double value, char *buffer) {
+  static_assert(kShortestToBufferSize >= kDoubleToBufferSize,
+                "kShortestToBufferSize is too small");
+#ifdef PROTOBUF_IO_STRTOD_TO_CHARS
+  if (std::isfinite(value)) {
+    return ShortestToBuffer(value, DBL_DIG, DBL_DIG + 2, buffer);
+  }
+#endif  // PROTOBUF_IO_STRTOD_TO_CHARS
+  return DoubleToBuffer(value, buffer);
+}
+
+absl::string_view ShortestFtoa(float value, char *buffer) {
+  static_assert(kShortestToBufferSize >= kFloatToBufferSize,
+                "kShortestToBufferSize is too small");
+#ifdef PROTOBUF_IO_STRTOD_TO_CHARS
+  if (std::isfinite(value)) {
+    return ShortestToBuffer(value, FLT_DIG, FLT_DIG + 3, buffer);
+  }
+#endif  // PROTOBUF_IO_STRTOD_TO_CHARS
+  return FloatToBuffer(value, buffer);
+}
+
 std::string SimpleDtoa(double value) {
   char buffer[kDoubleToBufferSize];
   return DoubleToBuffer(value, buffer);
@@ -14,6 +14,8 @@
 
 #include <string>
 
+#include "absl/strings/string_view.h"
+
 // Must be included last.
 #include "google/protobuf/port_def.inc"
 
@@ -35,6 +37,22 @@ namespace io {
 PROTOBUF_EXPORT std::string SimpleDtoa(double value);
 PROTOBUF_EXPORT std::string SimpleFtoa(float value);
 
+// ----------------------------------------------------------------------
+// ShortestDtoa()
+// ShortestFtoa()
+//    Description: like SimpleDtoa() and SimpleFtoa(), but always use the
+//    fewest significant digits that round-trip, and write to `buffer`,
+//    which must hold at least kShortestToBufferSize chars, instead of
+//    allocating.  The notation is the same: values whose shortest form
+//    fits the first precision SimpleDtoa() tries are printed identically,
+//    and the others differ only in dropping the digits it did not need.
+//
+//    Return value: the characters written to `buffer`
+// ----------------------------------------------------------------------
+constexpr int kShortestToBufferSize = 32;
+PROTOBUF_EXPORT absl::string_view ShortestDtoa(double value, char* buffer);
+PROTOBUF_EXPORT absl::string_view ShortestFtoa(float value, char* buffer);
+
 // A locale-independent version of the standard strtod(), which always
 // uses a dot as the decimal separator.
 PROTOBUF_EXPORT double NoLocaleStrtod(const char* str, char** endptr);
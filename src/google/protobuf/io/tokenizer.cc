@@ -67,14 +67,24 @@
 
 #include "google/protobuf/io/tokenizer.h"
 
+#include <cstddef>
+#include <cstdint>
+
 #include "google/protobuf/stubs/common.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
+#include "absl/numeric/bits.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_format.h"
 #include "google/protobuf/io/strtod.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define PROTOBUF_IO_TOKENIZER_X86 1
+#endif
+
 // Must be included last.
 #include "google/protobuf/port_def.inc"
 
@@ -100,14 +110,8 @@ namespace {
     static inline bool InClass(char c) { return EXPRESSION; } \
   }
 
-CHARACTER_CLASS(Whitespace, c == ' ' || c == '\n' || c == '\t' || c == '\r' ||
-                                c == '\v' || c == '\f');
-CHARACTER_CLASS(WhitespaceNoNewline,
-                c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f');
-
 CHARACTER_CLASS(Unprintable, c<' ' && c> '\0');
 
-CHARACTER_CLASS(Digit, '0' <= c && c <= '9');
 CHARACTER_CLASS(OctalDigit, '0' <= c && c <= '7');
 CHARACTER_CLASS(HexDigit, ('0' <= c && c <= '9') || ('a' <= c && c <= 'f') ||
                               ('A' <= c && c <= 'F'));
@@ -115,16 +119,205 @@ CHARACTER_CLASS(HexDigit, ('0' <= c && c <= '9') || ('a' <= c && c <= 'f') ||
 CHARACTER_CLASS(Letter,
                 ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || (c == '_'));
 
-CHARACTER_CLASS(Alphanumeric, ('a' <= c && c <= 'z') ||
-                                  ('A' <= c && c <= 'Z') ||
-                                  ('0' <= c && c <= '9') || (c == '_'));
-
 CHARACTER_CLASS(Escape, c == 'a' || c == 'b' || c == 'f' || c == 'n' ||
                             c == 'r' || c == 't' || c == 'v' || c == '\\' ||
                             c == '?' || c == '\'' || c == '\"');
 
 #undef CHARACTER_CLASS
 
+// "Run" classes are character classes that Tokenizer::ConsumeRun() can skip
+// a block at a time.  Besides InClass(), each one has Sse2() and Avx2()
+// members that map every byte of a vector to 0xFF if it is in the class and
+// to 0 otherwise, and kOneColumnEach, which is false if the class contains
+// '\n' or '\t' and so does not advance the column by one per character.
+
+#ifdef PROTOBUF_IO_TOKENIZER_X86
+
+__attribute__((target("sse2"))) inline __m128i Eq(__m128i v, char c) {
+  return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+
+// Bytes in [lo, hi], compared as unsigned.
+__attribute__((target("sse2"))) inline __m128i InRange(__m128i v, char lo,
+                                                       char hi) {
+  __m128i offset = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+  return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(hi - lo)), offset);
+}
+
+// Bytes that are not control characters: at least ' ' as unsigned, which
+// includes DEL and every byte of a multi-byte UTF-8 sequence.
+__attribute__((target("sse2"))) inline __m128i Printable(__m128i v) {
+  return _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8(' ')), v);
+}
+
+__attribute__((target("avx2"))) inline __m256i Eq(__m256i v, char c) {
+  return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+}
+
+__attribute__((target("avx2"))) inline __m256i InRange(__m256i v, char lo,
+                                                       char hi) {
+  __m256i offset = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(hi - lo)),
+                           offset);
+}
+
+__attribute__((target("avx2"))) inline __m256i Printable(__m256i v) {
+  return _mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8(' ')), v);
+}
+
+#define RUN_CLASS_VECTORS(SSE2_EXPRESSION, AVX2_EXPRESSION)               \
+  __attribute__((target("sse2"))) static inline __m128i Sse2(__m128i v) { \
+    return SSE2_EXPRESSION;                                               \
+  }                                                                       \
+  __attribute__((target("avx2"))) static inline __m256i Avx2(__m256i v) { \
+    return AVX2_EXPRESSION;                                               \
+  }
+
+#else  // PROTOBUF_IO_TOKENIZER_X86
+
+#define RUN_CLASS_VECTORS(SSE2_EXPRESSION, AVX2_EXPRESSION)
+
+#endif  // !PROTOBUF_IO_TOKENIZER_X86
+
+#define RUN_CLASS(NAME, ONE_COLUMN_EACH, EXPRESSION, SSE2_EXPRESSION, \
+                  AVX2_EXPRESSION)                                    \
+  class NAME {                                                        \
+   public:                                                            \
+    static constexpr bool kOneColumnEach = ONE_COLUMN_EACH;           \
+    static inline bool InClass(char c) { return EXPRESSION; }         \
+    RUN_CLASS_VECTORS(SSE2_EXPRESSION, AVX2_EXPRESSION)               \
+  }
+
+// '\t' through '\r' are "\t\n\v\f\r".
+RUN_CLASS(Whitespace, false, c == ' ' || ('\t' <= c && c <= '\r'),
+          _mm_or_si128(Eq(v, ' '), InRange(v, '\t', '\r')),
+          _mm256_or_si256(Eq(v, ' '), InRange(v, '\t', '\r')));
+RUN_CLASS(WhitespaceNoNewline, false, Whitespace::InClass(c) && c != '\n',
+          _mm_andnot_si128(Eq(v, '\n'), Whitespace::Sse2(v)),
+          _mm256_andnot_si256(Eq(v, '\n'), Whitespace::Avx2(v)));
+
+RUN_CLASS(Digit, true, '0' <= c && c <= '9', InRange(v, '0', '9'),
+          InRange(v, '0', '9'));
+
+// Setting 0x20 folds 'A'-'Z' onto 'a'-'z', and maps no other byte there.
+RUN_CLASS(Alphanumeric, true,
+          ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') ||
+              ('0' <= c && c <= '9') || (c == '_'),
+          _mm_or_si128(
+              InRange(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z'),
+              _mm_or_si128(InRange(v, '0', '9'), Eq(v, '_'))),
+          _mm256_or_si256(
+              InRange(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z'),
+              _mm256_or_si256(InRange(v, '0', '9'), Eq(v, '_'))));
+
+// The characters of a string literal that need no attention from
+// ConsumeString(): anything but quotes, backslashes and control characters.
+RUN_CLASS(StringText, true,
+          static_cast<uint8_t>(c) >= ' ' && c != '\"' && c != '\'' &&
+              c != '\\',
+          _mm_andnot_si128(
+              _mm_or_si128(_mm_or_si128(Eq(v, '\"'), Eq(v, '\'')),
+                           Eq(v, '\\')),
+              Printable(v)),
+          _mm256_andnot_si256(
+              _mm256_or_si256(_mm256_or_si256(Eq(v, '\"'), Eq(v, '\'')),
+                              Eq(v, '\\')),
+              Printable(v)));
+
+// Comment text up to the next control character, or for block comments, up
+// to the next character that might end the comment.
+RUN_CLASS(LineCommentText, true, static_cast<uint8_t>(c) >= ' ', Printable(v),
+          Printable(v));
+RUN_CLASS(BlockCommentText, true,
+          static_cast<uint8_t>(c) >= ' ' && c != '*' && c != '/',
+          _mm_andnot_si128(_mm_or_si128(Eq(v, '*'), Eq(v, '/')), Printable(v)),
+          _mm256_andnot_si256(_mm256_or_si256(Eq(v, '*'), Eq(v, '/')),
+                              Printable(v)));
+
+#undef RUN_CLASS
+#undef RUN_CLASS_VECTORS
+
+// Returns the length of the run of RunClass characters at the start of
+// [ptr, end).
+template <typename RunClass>
+size_t SpanScalar(const char* ptr, const char* end) {
+  const char* begin = ptr;
+  while (ptr < end && RunClass::InClass(*ptr)) ++ptr;
+  return static_cast<size_t>(ptr - begin);
+}
+
+#ifdef PROTOBUF_IO_TOKENIZER_X86
+
+// The vector kernels stop at the first block that holds a character outside
+// the class, and leave the final partial block to the narrower kernel so
+// that no load crosses `end`.
+
+template <typename RunClass>
+__attribute__((target("sse2"))) size_t SpanSse2(const char* ptr,
+                                                const char* end) {
+  const char* begin = ptr;
+  while (end - ptr >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+    uint32_t stop =
+        ~static_cast<uint32_t>(_mm_movemask_epi8(RunClass::Sse2(v))) & 0xffff;
+    if (stop != 0) {
+      return static_cast<size_t>(ptr - begin) + absl::countr_zero(stop);
+    }
+    ptr += 16;
+  }
+  return static_cast<size_t>(ptr - begin) + SpanScalar<RunClass>(ptr, end);
+}
+
+template <typename RunClass>
+__attribute__((target("avx2"))) size_t SpanAvx2(const char* ptr,
+                                                const char* end) {
+  const char* begin = ptr;
+  while (end - ptr >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+    uint32_t stop =
+        ~static_cast<uint32_t>(_mm256_movemask_epi8(RunClass::Avx2(v)));
+    if (stop != 0) {
+      return static_cast<size_t>(ptr - begin) + absl::countr_zero(stop);
+    }
+    ptr += 32;
+  }
+  return static_cast<size_t>(ptr - begin) + SpanSse2<RunClass>(ptr, end);
+}
+
+enum class SpanKernel { kScalar, kSse2, kAvx2 };
+
+SpanKernel BestSpanKernel() {
+  static const SpanKernel kernel = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SpanKernel::kAvx2;
+    if (__builtin_cpu_supports("sse2")) return SpanKernel::kSse2;
+    return SpanKernel::kScalar;
+  }();
+  return kernel;
+}
+
+#endif  // PROTOBUF_IO_TOKENIZER_X86
+
+// Returns the length of the run of RunClass characters at the start of
+// [ptr, end), which must begin with one.
+template <typename RunClass>
+inline size_t Span(const char* ptr, const char* end) {
+  // Runs of one character, like the single spaces between tokens, are the
+  // most common kind, and not worth a call into a kernel.
+  if (end - ptr < 2 || !RunClass::InClass(ptr[1])) return 1;
+#ifdef PROTOBUF_IO_TOKENIZER_X86
+  switch (BestSpanKernel()) {
+    case SpanKernel::kAvx2:
+      return SpanAvx2<RunClass>(ptr, end);
+    case SpanKernel::kSse2:
+      return SpanSse2<RunClass>(ptr, end);
+    case SpanKernel::kScalar:
+      break;
+  }
+#endif
+  return SpanScalar<RunClass>(ptr, end);
+}
+
 // Given a char, interpret it as a numeric digit and return its value.
 // This supports any number base up to 36.
 // Represents integer values of digits.
@@ -360,6 +553,39 @@ inline void Tokenizer::ConsumeZeroOrMore() {
   }
 }
 
+template <typename RunClass>
+inline void Tokenizer::ConsumeRun() {
+  while (RunClass::InClass(current_char_)) {
+    // current_char_ is never '\0' here, so it is buffer_[buffer_pos_].
+    const char* begin = buffer_ + buffer_pos_;
+    int size =
+        static_cast<int>(Span<RunClass>(begin, buffer_ + buffer_size_));
+
+    // Same as NextChar() for each character of the run.
+    if (RunClass::kOneColumnEach) {
+      column_ += size;
+    } else {
+      for (const char* ptr = begin; ptr < begin + size; ++ptr) {
+        if (*ptr == '\n') {
+          ++line_;
+          column_ = 0;
+        } else if (*ptr == '\t') {
+          column_ += kTabWidth - column_ % kTabWidth;
+        } else {
+          ++column_;
+        }
+      }
+    }
+
+    buffer_pos_ += size;
+    if (buffer_pos_ < buffer_size_) {
+      current_char_ = buffer_[buffer_pos_];
+    } else {
+      Refresh();
+    }
+  }
+}
+
 template <typename CharacterClass>
 inline void Tokenizer::ConsumeOneOrMore(const char* error) {
   if (!CharacterClass::InClass(current_char_)) {
@@ -377,6 +603,7 @@ inline void Tokenizer::ConsumeOneOrMore(const char* error) {
 
 void Tokenizer::ConsumeString(char delimiter) {
   while (true) {
+    ConsumeRun<StringText>();
     switch (current_char_) {
       case '\0':
         AddError("Unexpected end of string.");
@@ -453,20 +680,20 @@ Tokenizer::TokenType Tokenizer::ConsumeNumber(bool started_with_zero,
     ConsumeZeroOrMore<OctalDigit>();
     if (LookingAt<Digit>()) {
       AddError("Numbers starting with leading zero must be in octal.");
-      ConsumeZeroOrMore<Digit>();
+      ConsumeRun<Digit>();
     }
 
   } else {
     // A decimal number.
     if (started_with_dot) {
       is_float = true;
-      ConsumeZeroOrMore<Digit>();
+      ConsumeRun<Digit>();
     } else {
-      ConsumeZeroOrMore<Digit>();
+      ConsumeRun<Digit>();
 
       if (TryConsume('.')) {
         is_float = true;
-        ConsumeZeroOrMore<Digit>();
+        ConsumeRun<Digit>();
       }
     }
 
@@ -500,6 +727,7 @@ void Tokenizer::ConsumeLineComment(std::string* content) {
 
   while (current_char_ != '\0' && current_char_ != '\n') {
     NextChar();
+    ConsumeRun<LineCommentText>();
   }
   TryConsume('\n');
 
@@ -516,13 +744,14 @@ void Tokenizer::ConsumeBlockComment(std::string* content) {
     while (current_char_ != '\0' && current_char_ != '*' &&
            current_char_ != '/' && current_char_ != '\n') {
       NextChar();
+      ConsumeRun<BlockCommentText>();
     }
 
     if (TryConsume('\n')) {
       if (content != NULL) StopRecording();
 
       // Consume leading whitespace and asterisk;
-      ConsumeZeroOrMore<WhitespaceNoNewline>();
+      ConsumeRun<WhitespaceNoNewline>();
       if (TryConsume('*')) {
         if (TryConsume('/')) {
           // End of comment.
@@ -579,14 +808,14 @@ Tokenizer::NextCommentStatus Tokenizer::TryConsumeCommentStart() {
 bool Tokenizer::TryConsumeWhitespace() {
   if (report_newlines_) {
     if (TryConsumeOne<WhitespaceNoNewline>()) {
-      ConsumeZeroOrMore<WhitespaceNoNewline>();
+      ConsumeRun<WhitespaceNoNewline>();
       current_.type = TYPE_WHITESPACE;
       return true;
     }
     return false;
   }
   if (TryConsumeOne<Whitespace>()) {
-    ConsumeZeroOrMore<Whitespace>();
+    ConsumeRun<Whitespace>();
     current_.type = TYPE_WHITESPACE;
     return report_whitespace_;
   }
@@ -651,7 +880,7 @@ bool Tokenizer::Next() {
       StartToken();
 
       if (TryConsumeOne<Letter>()) {
-        ConsumeZeroOrMore<Alphanumeric>();
+        ConsumeRun<Alphanumeric>();
         current_.type = TYPE_IDENTIFIER;
       } else if (TryConsume('0')) {
         current_.type = ConsumeNumber(true, false);
@@ -859,7 +1088,7 @@ bool Tokenizer::NextWithComments(std::string* prev_trailing_comments,
   } else {
     // A comment appearing on the same line must be attached to the previous
     // declaration.
-    ConsumeZeroOrMore<WhitespaceNoNewline>();
+    ConsumeRun<WhitespaceNoNewline>();
     switch (TryConsumeCommentStart()) {
       case LINE_COMMENT:
         trailing_comment_end_line = line_;
@@ -872,7 +1101,7 @@ bool Tokenizer::NextWithComments(std::string* prev_trailing_comments,
       case BLOCK_COMMENT:
         ConsumeBlockComment(collector.GetBufferForBlockComment());
         trailing_comment_end_line = line_;
-        ConsumeZeroOrMore<WhitespaceNoNewline>();
+        ConsumeRun<WhitespaceNoNewline>();
 
         // Don't allow comments on subsequent lines to be attached to a trailing
         // comment.
@@ -891,7 +1120,7 @@ bool Tokenizer::NextWithComments(std::string* prev_trailing_comments,
 
   // OK, we are now on the line *after* the previous token.
   while (true) {
-    ConsumeZeroOrMore<WhitespaceNoNewline>();
+    ConsumeRun<WhitespaceNoNewline>();
 
     switch (TryConsumeCommentStart()) {
       case LINE_COMMENT:
@@ -902,7 +1131,7 @@ bool Tokenizer::NextWithComments(std::string* prev_trailing_comments,
 
         // Consume the rest of the line so that we don't interpret it as a
         // blank line the next time around the loop.
-        ConsumeZeroOrMore<WhitespaceNoNewline>();
+        ConsumeRun<WhitespaceNoNewline>();
         TryConsume('\n');
         break;
       case SLASH_NOT_COMMENT:
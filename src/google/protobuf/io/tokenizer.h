@@ -399,6 +399,13 @@ class PROTOBUF_EXPORT Tokenizer {
   template <typename CharacterClass>
   inline void ConsumeZeroOrMore();
 
+  // Like ConsumeZeroOrMore(), but for the "run" classes in the .cc file,
+  // which can classify a whole block of the buffer at once.  Used for the
+  // long runs of whitespace, identifier, digit, string and comment characters
+  // that make up most of the input.
+  template <typename RunClass>
+  inline void ConsumeRun();
+
   // Consume one or more of the given character class or log the given
   // error message.
   // e.g. ConsumeOneOrMore<Digit>("Expected digits.");
@@ -14,6 +14,7 @@
 #include <limits.h>
 #include <math.h>
 
+#include <string>
 #include <vector>
 
 #include "google/protobuf/stubs/common.h"
@@ -567,6 +568,81 @@ TEST_2D(TokenizerTest, MultipleWhitespaceTokens, kMultiWhitespaceTokenCases,
   EXPECT_TRUE(error_collector.text_.empty());
 }
 
+// Runs of whitespace, identifier, digit, string and comment characters are
+// consumed a block at a time.  Make sure that long runs, including ones that
+// cross buffer boundaries, still produce exact positions.
+TEST_1D(TokenizerTest, LongRuns, kBlockSizes) {
+  std::string text;
+  std::vector<Tokenizer::Token> expected;
+  int line = 0;
+  int column = 0;
+  // Appends `s` to the input, tracking the position like the tokenizer does.
+  auto skip = [&](const std::string& s) {
+    text += s;
+    for (char c : s) {
+      if (c == '\n') {
+        ++line;
+        column = 0;
+      } else if (c == '\t') {
+        column += 8 - column % 8;
+      } else {
+        ++column;
+      }
+    }
+  };
+  auto add_token = [&](Tokenizer::TokenType type, const std::string& s) {
+    Tokenizer::Token token;
+    token.type = type;
+    token.text = s;
+    token.line = line;
+    token.column = column;
+    skip(s);
+    token.end_column = column;
+    expected.push_back(token);
+  };
+
+  std::string identifier = "_";
+  std::string digits;
+  for (int i = 0; i < 20; ++i) {
+    identifier += "aZ9_";
+    digits += "0123456789";
+  }
+  skip("  \t \v\f\r   ");
+  add_token(Tokenizer::TYPE_IDENTIFIER, identifier);
+  skip(std::string(40, ' ') + "\t\t\n\n" + std::string(37, ' '));
+  add_token(Tokenizer::TYPE_INTEGER, "1" + digits);
+  skip(" ");
+  add_token(Tokenizer::TYPE_FLOAT, "1" + digits + "." + digits + "e+" + digits);
+  skip("\n   ");
+  add_token(Tokenizer::TYPE_STRING,
+            "\"A string literal with 'quotes', \\\"escapes\\\", a\ttab and "
+            "UTF-8 (\xc3\xa9) that is longer than a vector.\"");
+  skip("  // A line comment that is also longer than a vector,\twith a tab.\n");
+  skip("/* A block comment that is longer than a vector, too,\n"
+       "\t * and that has a second line. */ ");
+  add_token(Tokenizer::TYPE_SYMBOL, "}");
+
+  TestInputStream input(text.data(), text.size(), kBlockSizes_case);
+  TestErrorCollector error_collector;
+  Tokenizer tokenizer(&input, &error_collector);
+
+  for (const Tokenizer::Token& token : expected) {
+    SCOPED_TRACE(testing::Message() << "Token: " << token.text);
+    ASSERT_TRUE(tokenizer.Next());
+    EXPECT_EQ(token.type, tokenizer.current().type);
+    EXPECT_EQ(token.text, tokenizer.current().text);
+    EXPECT_EQ(token.line, tokenizer.current().line);
+    EXPECT_EQ(token.column, tokenizer.current().column);
+    EXPECT_EQ(token.end_column, tokenizer.current().end_column);
+  }
+  EXPECT_FALSE(tokenizer.Next());
+  EXPECT_EQ(line, tokenizer.current().line);
+  EXPECT_EQ(column, tokenizer.current().column);
+
+  // There should be no errors.
+  EXPECT_TRUE(error_collector.text_.empty()) << error_collector.text_;
+}
+
 // This test causes gcc 3.3.5 (and earlier?) to give the cryptic error:
 //   "sorry, unimplemented: `method_call_expr' not supported by dump_expr"
 #if !defined(__GNUC__) || __GNUC__ > 3 || (__GNUC__ == 3 && __GNUC_MINOR__ > 3)
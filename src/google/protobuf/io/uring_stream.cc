@@ -0,0 +1,603 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/io/uring_stream.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#include <errno.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include "absl/log/absl_check.h"
+#include "absl/log/absl_log.h"
+#include "google/protobuf/io/io_win32.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+#ifdef _WIN32
+// DO NOT include <io.h>, instead create functions in io_win32.{h,cc} and import
+// them like we do below.
+using google::protobuf::io::win32::close;
+#endif
+
+namespace {
+
+// EINTR sucks.
+int close_no_eintr(int fd) {
+  int result;
+  do {
+    result = close(fd);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+// Returns whether reads and writes at explicit offsets land in order on
+// `fd`, and if so, stores the current offset in `offset`.
+bool GetSeekableOffset(int fd, bool for_writing, uint64_t* offset) {
+#ifndef _WIN32
+  struct stat info;
+  const off_t current = lseek(fd, 0, SEEK_CUR);
+  if (current < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+    return false;
+  }
+  // O_APPEND makes the kernel ignore the offsets of writes.
+  if (for_writing && (fcntl(fd, F_GETFL) & O_APPEND) != 0) return false;
+  *offset = static_cast<uint64_t>(current);
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Reads and writes on descriptors that aren't seekable use the file position.
+constexpr uint64_t kCurrentPosition = ~uint64_t{0};
+
+}  // namespace
+
+// A minimal io_uring, set up and driven through the raw system calls so that
+// liburing isn't needed. Every operation is submitted as soon as it is
+// queued, and the streams never have more operations in flight than the
+// ring has entries.
+class IoUring {
+ public:
+  // Returns nullptr if io_uring is unavailable.
+  static std::unique_ptr<IoUring> Create(unsigned entries);
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+  ~IoUring();
+
+  // Submits a read or write (`opcode` is IORING_OP_READ or IORING_OP_WRITE)
+  // of `buffer` at `offset`. Returns zero or an errno.
+  int Submit(uint8_t opcode, int fd, void* buffer, int size, uint64_t offset,
+             uint64_t user_data);
+
+  // Waits until an operation completes, and returns its `user_data` and
+  // result, which is a byte count or a negated errno. Returns zero or an
+  // errno.
+  int Wait(uint64_t* user_data, int32_t* result);
+
+ private:
+  IoUring() = default;
+
+#if defined(__linux__) && defined(IORING_FEAT_RW_CUR_POS) && \
+    defined(__NR_io_uring_setup)
+  int ring_fd_ = -1;
+  void* sq_ring_ = MAP_FAILED;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = MAP_FAILED;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+  size_t sqes_size_ = 0;
+
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+#endif
+};
+
+#if defined(__linux__) && defined(IORING_FEAT_RW_CUR_POS) && \
+    defined(__NR_io_uring_setup)
+
+std::unique_ptr<IoUring> IoUring::Create(unsigned entries) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  std::unique_ptr<IoUring> ring(new IoUring);
+  ring->ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries,
+                                            &params));
+  // IORING_FEAT_RW_CUR_POS arrived in Linux 5.6 together with
+  // IORING_OP_READ and IORING_OP_WRITE, which are used below.
+  if (ring->ring_fd_ < 0 || (params.features & IORING_FEAT_RW_CUR_POS) == 0) {
+    return nullptr;
+  }
+
+  ring->sq_ring_size_ =
+      params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  ring->sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  ring->sq_ring_ = mmap(nullptr, ring->sq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->ring_fd_,
+                        IORING_OFF_SQ_RING);
+  ring->cq_ring_ = mmap(nullptr, ring->cq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->ring_fd_,
+                        IORING_OFF_CQ_RING);
+  ring->sqes_ = static_cast<io_uring_sqe*>(
+      mmap(nullptr, ring->sqes_size_, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, ring->ring_fd_, IORING_OFF_SQES));
+  if (ring->sq_ring_ == MAP_FAILED || ring->cq_ring_ == MAP_FAILED ||
+      ring->sqes_ == MAP_FAILED) {
+    return nullptr;
+  }
+
+  char* sq = static_cast<char*>(ring->sq_ring_);
+  ring->sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  ring->sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  ring->sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  char* cq = static_cast<char*>(ring->cq_ring_);
+  ring->cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  ring->cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  ring->cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  ring->cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+  return ring;
+}
+
+IoUring::~IoUring() {
+  if (sqes_ != MAP_FAILED) munmap(sqes_, sqes_size_);
+  if (cq_ring_ != MAP_FAILED) munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_ != MAP_FAILED) munmap(sq_ring_, sq_ring_size_);
+  if (ring_fd_ >= 0) close_no_eintr(ring_fd_);
+}
+
+int IoUring::Submit(uint8_t opcode, int fd, void* buffer, int size,
+                    uint64_t offset, uint64_t user_data) {
+  // This is the only producer, so the tail can be read without ordering.
+  const unsigned tail = *sq_tail_;
+  const unsigned index = tail & sq_mask_;
+  io_uring_sqe* sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uintptr_t>(buffer);
+  sqe->len = static_cast<unsigned>(size);
+  sqe->off = offset;
+  sqe->user_data = user_data;
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+  int result;
+  do {
+    result = static_cast<int>(
+        syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0));
+  } while (result < 0 && errno == EINTR);
+  if (result < 0) return errno;
+  return result == 1 ? 0 : EAGAIN;
+}
+
+int IoUring::Wait(uint64_t* user_data, int32_t* result) {
+  while (true) {
+    const unsigned head = *cq_head_;
+    if (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+      *user_data = cqe.user_data;
+      *result = cqe.res;
+      __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+      return 0;
+    }
+    if (syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS,
+                nullptr, 0) < 0 &&
+        errno != EINTR) {
+      return errno;
+    }
+  }
+}
+
+constexpr uint8_t kReadOpcode = IORING_OP_READ;
+constexpr uint8_t kWriteOpcode = IORING_OP_WRITE;
+
+#else  // io_uring unavailable
+
+std::unique_ptr<IoUring> IoUring::Create(unsigned) { return nullptr; }
+IoUring::~IoUring() {}
+int IoUring::Submit(uint8_t, int, void*, int, uint64_t, uint64_t) {
+  return ENOSYS;
+}
+int IoUring::Wait(uint64_t*, int32_t*) { return ENOSYS; }
+
+constexpr uint8_t kReadOpcode = 0;
+constexpr uint8_t kWriteOpcode = 0;
+
+#endif  // io_uring available
+
+UringStreamOptions::UringStreamOptions()
+    : queue_depth(4), block_size(64 << 10) {}
+
+// ===================================================================
+
+UringInputStream::UringInputStream(int file_descriptor)
+    : UringInputStream(file_descriptor, UringStreamOptions()) {}
+
+UringInputStream::UringInputStream(int file_descriptor,
+                                   const UringStreamOptions& options)
+    : file_(file_descriptor), block_size_(options.block_size) {
+  ABSL_CHECK_GT(options.queue_depth, 0);
+  ABSL_CHECK_GT(options.block_size, 0);
+  ring_ = IoUring::Create(static_cast<unsigned>(options.queue_depth));
+  if (ring_ == nullptr) {
+    fallback_ = std::make_unique<FileInputStream>(file_, block_size_);
+    return;
+  }
+  seekable_ = GetSeekableOffset(file_, /*for_writing=*/false, &next_offset_);
+  buffers_.resize(options.queue_depth);
+  for (Buffer& buffer : buffers_) {
+    buffer.data = std::make_unique<char[]>(block_size_);
+  }
+}
+
+UringInputStream::~UringInputStream() {
+  if (close_on_delete_ && !is_closed_) {
+    if (!Close()) {
+      ABSL_LOG(ERROR) << "close() failed: " << strerror(GetErrno());
+    }
+  } else {
+    // The kernel may still be reading into the buffers.
+    Drain();
+  }
+}
+
+bool UringInputStream::Close() {
+  ABSL_CHECK(!is_closed_);
+
+  is_closed_ = true;
+  if (fallback_ != nullptr) return fallback_->Close();
+  Drain();
+  if (close_no_eintr(file_) != 0 && errno_ == 0) errno_ = errno;
+  return errno_ == 0;
+}
+
+int UringInputStream::GetErrno() const {
+  return fallback_ != nullptr ? fallback_->GetErrno() : errno_;
+}
+
+void UringInputStream::Pump() {
+  const int max_in_flight = seekable_ ? static_cast<int>(buffers_.size()) : 1;
+  while (!eof_ && errno_ == 0 &&
+         outstanding_ < static_cast<int>(buffers_.size()) &&
+         in_flight_ < max_in_flight) {
+    Buffer& buffer = buffers_[next_submit_];
+    buffer.offset = seekable_ ? next_offset_ : kCurrentPosition;
+    buffer.filled = 0;
+    buffer.done = false;
+    if (!Submit(next_submit_)) return;
+    if (seekable_) next_offset_ += block_size_;
+    next_submit_ = (next_submit_ + 1) % static_cast<int>(buffers_.size());
+    ++outstanding_;
+  }
+}
+
+bool UringInputStream::Submit(int index) {
+  Buffer& buffer = buffers_[index];
+  const int error = ring_->Submit(
+      kReadOpcode, file_, buffer.data.get() + buffer.filled,
+      block_size_ - buffer.filled,
+      seekable_ ? buffer.offset + buffer.filled : kCurrentPosition, index);
+  if (error != 0) {
+    errno_ = error;
+    return false;
+  }
+  ++in_flight_;
+  return true;
+}
+
+bool UringInputStream::WaitForCompletion() {
+  uint64_t index;
+  int32_t result;
+  const int error = ring_->Wait(&index, &result);
+  if (error != 0) {
+    errno_ = error;
+    return false;
+  }
+  --in_flight_;
+  Buffer& buffer = buffers_[index];
+  if (result == -EINTR || result == -EAGAIN) {
+    // Retried below.
+  } else if (result < 0) {
+    if (errno_ == 0) errno_ = -result;
+    buffer.done = true;
+    return true;
+  } else if (result == 0) {
+    eof_ = true;
+    buffer.done = true;
+    return true;
+  } else {
+    buffer.filled += result;
+    // Short reads from regular files are continued so that the blocks queued
+    // after this one stay in place. Other descriptors return what they have.
+    if (!seekable_ || buffer.filled == block_size_) {
+      buffer.done = true;
+      return true;
+    }
+  }
+  if (errno_ != 0) {
+    buffer.done = true;
+    return true;
+  }
+  return Submit(static_cast<int>(index));
+}
+
+void UringInputStream::Drain() {
+  while (in_flight_ > 0) {
+    if (!WaitForCompletion()) {
+      // The ring itself failed, so the buffers may still be written to.
+      // Leak them rather than risk the kernel writing to freed memory.
+      for (Buffer& buffer : buffers_) buffer.data.release();
+      in_flight_ = 0;
+    }
+  }
+}
+
+bool UringInputStream::Next(const void** data, int* size) {
+  if (fallback_ != nullptr) return fallback_->Next(data, size);
+  if (backup_ > 0) {
+    *data = buffers_[current_].data.get() + buffers_[current_].filled - backup_;
+    *size = backup_;
+    position_ += backup_;
+    backup_ = 0;
+    return true;
+  }
+  if (has_current_) {
+    // The current buffer is used up; reuse it for a later block.
+    has_current_ = false;
+    current_ = (current_ + 1) % static_cast<int>(buffers_.size());
+    --outstanding_;
+  }
+  Pump();
+  if (outstanding_ == 0) return false;
+  while (!buffers_[current_].done) {
+    if (!WaitForCompletion()) return false;
+    Pump();
+  }
+  if (errno_ != 0) return false;
+  Buffer& buffer = buffers_[current_];
+  if (buffer.filled == 0) return false;
+  has_current_ = true;
+  *data = buffer.data.get();
+  *size = buffer.filled;
+  position_ += buffer.filled;
+  return true;
+}
+
+void UringInputStream::BackUp(int count) {
+  if (fallback_ != nullptr) return fallback_->BackUp(count);
+  ABSL_CHECK(has_current_ && backup_ == 0)
+      << " BackUp() can only be called after Next().";
+  ABSL_CHECK_LE(count, buffers_[current_].filled)
+      << " Can't back up over more bytes than were returned by the last call"
+         " to Next().";
+  ABSL_CHECK_GE(count, 0) << " Parameter to BackUp() can't be negative.";
+  backup_ = count;
+  position_ -= count;
+}
+
+bool UringInputStream::Skip(int count) {
+  if (fallback_ != nullptr) return fallback_->Skip(count);
+  ABSL_CHECK_GE(count, 0);
+  const void* data;
+  int size;
+  while (count > 0) {
+    if (!Next(&data, &size)) return false;
+    if (size > count) {
+      BackUp(size - count);
+      return true;
+    }
+    count -= size;
+  }
+  return true;
+}
+
+int64_t UringInputStream::ByteCount() const {
+  return fallback_ != nullptr ? fallback_->ByteCount() : position_;
+}
+
+// ===================================================================
+
+UringOutputStream::UringOutputStream(int file_descriptor)
+    : UringOutputStream(file_descriptor, UringStreamOptions()) {}
+
+UringOutputStream::UringOutputStream(int file_descriptor,
+                                     const UringStreamOptions& options)
+    : file_(file_descriptor), block_size_(options.block_size) {
+  ABSL_CHECK_GT(options.queue_depth, 0);
+  ABSL_CHECK_GT(options.block_size, 0);
+  ring_ = IoUring::Create(static_cast<unsigned>(options.queue_depth));
+  if (ring_ == nullptr) {
+    fallback_ = std::make_unique<FileOutputStream>(file_, block_size_);
+    return;
+  }
+  seekable_ = GetSeekableOffset(file_, /*for_writing=*/true, &next_offset_);
+  buffers_.resize(options.queue_depth);
+  // Hand out buffers_[0] first.
+  for (int i = options.queue_depth - 1; i >= 0; --i) free_.push_back(i);
+}
+
+UringOutputStream::~UringOutputStream() {
+  if (close_on_delete_ && !is_closed_) {
+    if (!Close()) {
+      ABSL_LOG(ERROR) << "close() failed: " << strerror(GetErrno());
+    }
+  } else if (!is_closed_) {
+    Flush();
+  }
+}
+
+bool UringOutputStream::Close() {
+  ABSL_CHECK(!is_closed_);
+
+  is_closed_ = true;
+  if (fallback_ != nullptr) return fallback_->Close();
+  Flush();
+  if (close_no_eintr(file_) != 0 && errno_ == 0) errno_ = errno;
+  return errno_ == 0;
+}
+
+bool UringOutputStream::Flush() {
+  if (fallback_ != nullptr) return fallback_->Flush();
+  if (current_ >= 0) {
+    Enqueue(current_);
+    current_ = -1;
+  }
+  while (in_flight_ > 0) {
+    if (!WaitForCompletion()) {
+      // The ring itself failed, so the buffers may still be read from.
+      // Leak them rather than risk the kernel reading freed memory.
+      for (Buffer& buffer : buffers_) buffer.data.release();
+      in_flight_ = 0;
+    }
+  }
+#ifndef _WIN32
+  // Leave the file offset after the data, as write() would have.
+  if (seekable_ && errno_ == 0 &&
+      lseek(file_, static_cast<off_t>(next_offset_), SEEK_SET) < 0) {
+    errno_ = errno;
+  }
+#endif
+  return errno_ == 0;
+}
+
+int UringOutputStream::GetErrno() const {
+  return fallback_ != nullptr ? fallback_->GetErrno() : errno_;
+}
+
+void UringOutputStream::Enqueue(int index) {
+  Buffer& buffer = buffers_[index];
+  if (buffer.end == 0 || errno_ != 0) {
+    free_.push_back(index);
+    return;
+  }
+  buffer.offset = seekable_ ? next_offset_ : kCurrentPosition;
+  next_offset_ += buffer.end;
+  queued_.push_back(index);
+  SubmitQueued();
+}
+
+void UringOutputStream::SubmitQueued() {
+  const int max_in_flight = seekable_ ? static_cast<int>(buffers_.size()) : 1;
+  while (!queued_.empty() && in_flight_ < max_in_flight) {
+    const int index = queued_.front();
+    queued_.pop_front();
+    Buffer& buffer = buffers_[index];
+    const int error = errno_ != 0 ? errno_
+                                  : ring_->Submit(kWriteOpcode, file_,
+                                                  buffer.data.get() +
+                                                      buffer.begin,
+                                                  buffer.end - buffer.begin,
+                                                  buffer.offset, index);
+    if (error != 0) {
+      // Nothing more will be written.
+      errno_ = error;
+      free_.push_back(index);
+      continue;
+    }
+    ++in_flight_;
+  }
+}
+
+bool UringOutputStream::WaitForCompletion() {
+  uint64_t index;
+  int32_t result;
+  const int error = ring_->Wait(&index, &result);
+  if (error != 0) {
+    errno_ = error;
+    return false;
+  }
+  --in_flight_;
+  Buffer& buffer = buffers_[index];
+  if (result == -EINTR || result == -EAGAIN) {
+    queued_.push_front(static_cast<int>(index));
+  } else if (result <= 0) {
+    // A write of zero bytes would just be retried forever.
+    if (errno_ == 0) errno_ = result < 0 ? -result : EIO;
+    free_.push_back(static_cast<int>(index));
+  } else if (buffer.begin + result < buffer.end) {
+    // Write the rest before anything queued after it.
+    buffer.begin += result;
+    if (seekable_) buffer.offset += result;
+    queued_.push_front(static_cast<int>(index));
+  } else {
+    free_.push_back(static_cast<int>(index));
+  }
+  SubmitQueued();
+  return true;
+}
+
+bool UringOutputStream::Next(void** data, int* size) {
+  if (fallback_ != nullptr) return fallback_->Next(data, size);
+  if (current_ >= 0) {
+    Enqueue(current_);
+    current_ = -1;
+  }
+  while (free_.empty()) {
+    if (!WaitForCompletion()) return false;
+  }
+  if (errno_ != 0) return false;
+  current_ = free_.back();
+  free_.pop_back();
+  Buffer& buffer = buffers_[current_];
+  if (buffer.data == nullptr) {
+    buffer.data = std::make_unique<char[]>(block_size_);
+  }
+  buffer.begin = 0;
+  buffer.end = block_size_;
+  *data = buffer.data.get();
+  *size = block_size_;
+  position_ += block_size_;
+  return true;
+}
+
+void UringOutputStream::BackUp(int count) {
+  if (fallback_ != nullptr) return fallback_->BackUp(count);
+  ABSL_CHECK_GE(current_, 0) << " BackUp() can only be called after Next().";
+  ABSL_CHECK_LE(count, buffers_[current_].end)
+      << " Can't back up over more bytes than were returned by the last call"
+         " to Next().";
+  ABSL_CHECK_GE(count, 0) << " Parameter to BackUp() can't be negative.";
+  buffers_[current_].end -= count;
+  position_ -= count;
+}
+
+int64_t UringOutputStream::ByteCount() const {
+  return fallback_ != nullptr ? fallback_->ByteCount() : position_;
+}
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
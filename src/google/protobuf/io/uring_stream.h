@@ -0,0 +1,246 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file contains UringInputStream and UringOutputStream, which read and
+// write file descriptors asynchronously through Linux's io_uring interface.
+//
+// FileInputStream and FileOutputStream block in read() or write() for each
+// buffer. These streams instead keep several buffers queued with the kernel,
+// so that serializing into (or parsing from) one buffer overlaps the kernel
+// writing (or reading) the others.
+
+#ifndef GOOGLE_PROTOBUF_IO_URING_STREAM_H__
+#define GOOGLE_PROTOBUF_IO_URING_STREAM_H__
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+// Owns an io_uring instance. Defined in uring_stream.cc.
+class IoUring;
+
+// Options shared by UringInputStream and UringOutputStream.
+struct PROTOBUF_EXPORT UringStreamOptions {
+  UringStreamOptions();
+
+  // The number of buffers, and thus the maximum number of reads or writes
+  // queued with the kernel at a time. Defaults to 4.
+  int queue_depth;
+
+  // The size of each buffer. Defaults to 64k.
+  int block_size;
+};
+
+// A ZeroCopyInputStream which reads from a file descriptor through io_uring,
+// keeping up to UringStreamOptions::queue_depth reads ahead of the consumer.
+//
+// Regular files are read with explicit offsets, starting at the current
+// offset of the file descriptor, which is not advanced by the stream. Other
+// descriptors (pipes, sockets, ...) have only one read queued at a time,
+// since the kernel does not order concurrent reads from them.
+//
+// If io_uring is unavailable (it is Linux-only, and may be disabled by the
+// kernel configuration or a seccomp policy), the stream falls back to reading
+// synchronously like FileInputStream.
+class PROTOBUF_EXPORT UringInputStream final : public ZeroCopyInputStream {
+ public:
+  // Creates a stream that reads from the given Unix file descriptor.
+  explicit UringInputStream(int file_descriptor);
+  UringInputStream(int file_descriptor, const UringStreamOptions& options);
+  UringInputStream(const UringInputStream&) = delete;
+  UringInputStream& operator=(const UringInputStream&) = delete;
+  ~UringInputStream() override;
+
+  // Closes the underlying file descriptor, after waiting for any queued
+  // reads. Returns false if an error occurs during the process; use
+  // GetErrno() to examine the error. Even if an error occurs, the file
+  // descriptor is closed when this returns.
+  bool Close();
+
+  // By default, the file descriptor is not closed when the stream is
+  // destroyed. Call SetCloseOnDelete(true) to change that.
+  void SetCloseOnDelete(bool value) { close_on_delete_ = value; }
+
+  // If an I/O error has occurred on this file descriptor, this is the errno
+  // from that error. Otherwise, this is zero. Once an error occurs, the
+  // stream is broken and all subsequent operations will fail.
+  int GetErrno() const;
+
+  // Returns whether reads go through io_uring, as opposed to the synchronous
+  // fallback.
+  bool IsAsync() const { return ring_ != nullptr; }
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  struct Buffer {
+    std::unique_ptr<char[]> data;
+    // The file offset the buffer is read from.
+    uint64_t offset = 0;
+    // The number of bytes read so far, and whether the read has finished.
+    int filled = 0;
+    bool done = false;
+  };
+
+  // Queues reads into free buffers, as far as allowed.
+  void Pump();
+  // Queues a read of the rest of buffers_[index]. Returns false on error.
+  bool Submit(int index);
+  // Waits for one read and records its result. Returns false if the ring
+  // itself failed.
+  bool WaitForCompletion();
+  // Waits for all queued reads.
+  void Drain();
+
+  const int file_;
+  const int block_size_;
+  bool close_on_delete_ = false;
+  bool is_closed_ = false;
+  int errno_ = 0;
+
+  std::unique_ptr<IoUring> ring_;
+  // Whether reads use explicit offsets, so several can be in flight.
+  bool seekable_ = false;
+  int in_flight_ = 0;
+  // The offset of the next block to read, and whether a read has hit the
+  // end of the file.
+  uint64_t next_offset_ = 0;
+  bool eof_ = false;
+
+  // Buffers are filled and consumed in ring order. buffers_[current_] is the
+  // next to be consumed and buffers_[next_submit_] the next to be filled;
+  // `outstanding_` buffers between them are being filled or waiting to be
+  // consumed.
+  std::vector<Buffer> buffers_;
+  int current_ = 0;
+  int next_submit_ = 0;
+  int outstanding_ = 0;
+  // Whether buffers_[current_] was returned by Next(), and how many of its
+  // bytes were backed up.
+  bool has_current_ = false;
+  int backup_ = 0;
+  int64_t position_ = 0;
+
+  // Used instead of io_uring if it is unavailable.
+  std::unique_ptr<FileInputStream> fallback_;
+};
+
+// A ZeroCopyOutputStream which writes to a file descriptor through io_uring.
+// Each buffer is queued with the kernel as soon as the next one is requested,
+// and up to UringStreamOptions::queue_depth buffers may be waiting to be
+// written at a time.
+//
+// Regular files are written with explicit offsets, starting at the current
+// offset of the file descriptor, which is moved past the written data by
+// Flush() and Close(). Other descriptors (pipes, sockets, files opened with
+// O_APPEND, ...) have only one write in flight at a time, since the kernel
+// does not order concurrent writes to them.
+//
+// If io_uring is unavailable, the stream falls back to writing synchronously
+// like FileOutputStream.
+class PROTOBUF_EXPORT UringOutputStream final : public ZeroCopyOutputStream {
+ public:
+  // Creates a stream that writes to the given Unix file descriptor.
+  explicit UringOutputStream(int file_descriptor);
+  UringOutputStream(int file_descriptor, const UringStreamOptions& options);
+  UringOutputStream(const UringOutputStream&) = delete;
+  UringOutputStream& operator=(const UringOutputStream&) = delete;
+  ~UringOutputStream() override;
+
+  // Flushes any buffers and closes the underlying file descriptor. Returns
+  // false if an error occurs during the process; use GetErrno() to examine
+  // the error. Even if an error occurs, the file descriptor is closed when
+  // this returns.
+  bool Close();
+
+  // Queues any buffered data and waits until all of it has been written.
+  // Returns false if an error occurred, now or earlier.
+  bool Flush();
+
+  // By default, the file descriptor is not closed when the stream is
+  // destroyed. Call SetCloseOnDelete(true) to change that.
+  void SetCloseOnDelete(bool value) { close_on_delete_ = value; }
+
+  // If an I/O error has occurred on this file descriptor, this is the errno
+  // from that error. Otherwise, this is zero. Once an error occurs, the
+  // stream is broken and all subsequent operations will fail.
+  int GetErrno() const;
+
+  // Returns whether writes go through io_uring, as opposed to the
+  // synchronous fallback.
+  bool IsAsync() const { return ring_ != nullptr; }
+
+  // implements ZeroCopyOutputStream ---------------------------------
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  struct Buffer {
+    std::unique_ptr<char[]> data;
+    // The file offset the unwritten part is written to.
+    uint64_t offset = 0;
+    // The range of the buffer that has not been written yet.
+    int begin = 0;
+    int end = 0;
+  };
+
+  // Queues buffers_[index] to be written after all previously queued data.
+  void Enqueue(int index);
+  // Hands queued buffers to the kernel, as far as allowed.
+  void SubmitQueued();
+  // Waits for one write and records its result. Returns false if the ring
+  // itself failed.
+  bool WaitForCompletion();
+
+  const int file_;
+  const int block_size_;
+  bool close_on_delete_ = false;
+  bool is_closed_ = false;
+  int errno_ = 0;
+
+  std::unique_ptr<IoUring> ring_;
+  // Whether writes use explicit offsets, so several can be in flight.
+  bool seekable_ = false;
+  int in_flight_ = 0;
+  // The offset the next queued buffer is written to.
+  uint64_t next_offset_ = 0;
+
+  std::vector<Buffer> buffers_;
+  // Buffers that may be reused, and buffers waiting for a write slot.
+  std::vector<int> free_;
+  std::deque<int> queued_;
+  // The buffer last returned by Next(), or -1.
+  int current_ = -1;
+  int64_t position_ = 0;
+
+  // Used instead of io_uring if it is unavailable.
+  std::unique_ptr<FileOutputStream> fallback_;
+};
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_IO_URING_STREAM_H__
@@ -0,0 +1,236 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/io/uring_stream.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "google/protobuf/testing/file.h"
+#include <gtest/gtest.h>
+#include "absl/log/absl_check.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/testing/googletest.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace io {
+namespace {
+
+class UringStreamTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    filename_ = absl::StrCat(TestTempDir(), "/uring_stream_test_file");
+    options_.queue_depth = 3;
+    options_.block_size = 1000;
+  }
+  void TearDown() override {
+    File::DeleteRecursively(filename_, nullptr, nullptr);
+  }
+
+  int Open(int flags) {
+    const int fd = open(filename_.c_str(), flags, 0644);
+    ABSL_CHECK_GE(fd, 0);
+    return fd;
+  }
+
+  static std::string MakeContents(int size) {
+    std::string contents;
+    for (int i = 0; i < size; ++i) contents.push_back(static_cast<char>(i * 7));
+    return contents;
+  }
+
+  // Writes `contents` in pieces of varying sizes.
+  static void WriteAll(ZeroCopyOutputStream* output,
+                       absl::string_view contents) {
+    void* data;
+    int size;
+    int piece = 1;
+    while (!contents.empty()) {
+      ASSERT_TRUE(output->Next(&data, &size));
+      const int used =
+          std::min<int>({size, piece, static_cast<int>(contents.size())});
+      memcpy(data, contents.data(), used);
+      output->BackUp(size - used);
+      contents.remove_prefix(used);
+      piece = piece * 3 % 2017;
+    }
+  }
+
+  static std::string ReadAll(ZeroCopyInputStream* input) {
+    std::string result;
+    const void* data;
+    int size;
+    while (input->Next(&data, &size)) {
+      result.append(static_cast<const char*>(data), size);
+    }
+    return result;
+  }
+
+  std::string filename_;
+  UringStreamOptions options_;
+};
+
+TEST_F(UringStreamTest, WriteAndRead) {
+  const std::string contents = MakeContents(100000);
+  {
+    UringOutputStream output(Open(O_WRONLY | O_CREAT | O_TRUNC), options_);
+    output.SetCloseOnDelete(true);
+    WriteAll(&output, contents);
+    EXPECT_EQ(output.ByteCount(), contents.size());
+    EXPECT_TRUE(output.Close());
+  }
+  std::string written;
+  ASSERT_TRUE(File::GetContents(filename_, &written, true).ok());
+  EXPECT_EQ(written, contents);
+
+  UringInputStream input(Open(O_RDONLY), options_);
+  input.SetCloseOnDelete(true);
+  EXPECT_EQ(ReadAll(&input), contents);
+  EXPECT_EQ(input.ByteCount(), contents.size());
+  EXPECT_EQ(input.GetErrno(), 0);
+}
+
+TEST_F(UringStreamTest, DefaultOptions) {
+  const std::string contents = MakeContents(300000);
+  {
+    UringOutputStream output(Open(O_WRONLY | O_CREAT | O_TRUNC));
+    output.SetCloseOnDelete(true);
+    WriteAll(&output, contents);
+  }
+  UringInputStream input(Open(O_RDONLY));
+  input.SetCloseOnDelete(true);
+  EXPECT_EQ(ReadAll(&input), contents);
+}
+
+TEST_F(UringStreamTest, FileOffsets) {
+  const int fd = Open(O_RDWR | O_CREAT | O_TRUNC);
+  ASSERT_EQ(write(fd, "prefix", 6), 6);
+  const std::string contents = MakeContents(5000);
+  {
+    UringOutputStream output(fd, options_);
+    WriteAll(&output, contents);
+    EXPECT_TRUE(output.Flush());
+    // The descriptor is left after the written data.
+    EXPECT_EQ(lseek(fd, 0, SEEK_CUR), 6 + contents.size());
+    WriteAll(&output, "suffix");
+  }
+  EXPECT_EQ(lseek(fd, 0, SEEK_CUR), 12 + contents.size());
+
+  ASSERT_EQ(lseek(fd, 3, SEEK_SET), 3);
+  UringInputStream input(fd, options_);
+  input.SetCloseOnDelete(true);
+  EXPECT_EQ(ReadAll(&input), absl::StrCat("fix", contents, "suffix"));
+}
+
+TEST_F(UringStreamTest, Append) {
+  ASSERT_TRUE(File::SetContents(filename_, "head", true).ok());
+  const std::string contents = MakeContents(10000);
+  {
+    UringOutputStream output(Open(O_WRONLY | O_APPEND), options_);
+    output.SetCloseOnDelete(true);
+    WriteAll(&output, contents);
+  }
+  std::string written;
+  ASSERT_TRUE(File::GetContents(filename_, &written, true).ok());
+  EXPECT_EQ(written, absl::StrCat("head", contents));
+}
+
+TEST_F(UringStreamTest, Pipes) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  // Small enough to fit into the pipe's buffer.
+  const std::string contents = MakeContents(20000);
+  {
+    UringOutputStream output(fds[1], options_);
+    output.SetCloseOnDelete(true);
+    WriteAll(&output, contents);
+  }
+  UringInputStream input(fds[0], options_);
+  input.SetCloseOnDelete(true);
+  EXPECT_EQ(ReadAll(&input), contents);
+  EXPECT_EQ(input.ByteCount(), contents.size());
+}
+
+TEST_F(UringStreamTest, BackUpAndSkip) {
+  const std::string contents = MakeContents(10000);
+  ASSERT_TRUE(File::SetContents(filename_, contents, true).ok());
+  UringInputStream input(Open(O_RDONLY), options_);
+  input.SetCloseOnDelete(true);
+  const void* data;
+  int size;
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ(size, 1000);
+  input.BackUp(300);
+  EXPECT_EQ(input.ByteCount(), 700);
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ(absl::string_view(static_cast<const char*>(data), size),
+            absl::string_view(contents).substr(700, 300));
+  ASSERT_TRUE(input.Skip(4500));
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ(absl::string_view(static_cast<const char*>(data), size),
+            absl::string_view(contents).substr(5500, 500));
+  EXPECT_FALSE(input.Skip(10000));
+  EXPECT_EQ(input.ByteCount(), contents.size());
+}
+
+TEST_F(UringStreamTest, EmptyFile) {
+  ASSERT_TRUE(File::SetContents(filename_, "", true).ok());
+  UringInputStream input(Open(O_RDONLY), options_);
+  input.SetCloseOnDelete(true);
+  const void* data;
+  int size;
+  EXPECT_FALSE(input.Next(&data, &size));
+  EXPECT_FALSE(input.Next(&data, &size));
+  EXPECT_EQ(input.GetErrno(), 0);
+}
+
+TEST_F(UringStreamTest, WriteError) {
+  ASSERT_TRUE(File::SetContents(filename_, "", true).ok());
+  UringOutputStream output(Open(O_RDONLY), options_);
+  output.SetCloseOnDelete(true);
+  // The error is reported by a later call, once the write has completed.
+  void* data;
+  int size;
+  for (int i = 0; i < 10 && output.Next(&data, &size); ++i) {
+  }
+  EXPECT_FALSE(output.Next(&data, &size));
+  EXPECT_FALSE(output.Flush());
+  EXPECT_EQ(output.GetErrno(), EBADF);
+  EXPECT_FALSE(output.Close());
+}
+
+TEST_F(UringStreamTest, Messages) {
+  protobuf_unittest::TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  {
+    UringOutputStream output(Open(O_WRONLY | O_CREAT | O_TRUNC), options_);
+    output.SetCloseOnDelete(true);
+    ASSERT_TRUE(message.SerializeToZeroCopyStream(&output));
+  }
+  UringInputStream input(Open(O_RDONLY), options_);
+  input.SetCloseOnDelete(true);
+  protobuf_unittest::TestAllTypes parsed;
+  ASSERT_TRUE(parsed.ParseFromZeroCopyStream(&input));
+  TestUtil::ExpectAllFieldsSet(parsed);
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // !_WIN32
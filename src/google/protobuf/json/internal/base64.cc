@@ -0,0 +1,430 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/json/internal/base64.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/base/attributes.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define PROTOBUF_JSON_BASE64_X86 1
+#endif
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace json_internal {
+namespace {
+
+constexpr absl::string_view kStandardChars =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+constexpr absl::string_view kWebSafeChars =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// This table maps an unsigned `char` value, interpreted as an ASCII character,
+// to a corresponding value in the base64 alphabet (both traditional and
+// "web-safe" characters are included).
+//
+// If a character is not valid base64, it maps to -1; this is used by the bit
+// operations that assemble a base64-encoded word to determine if an error
+// occurred, by checking the sign bit.
+constexpr signed char kBase64Table[256] = {
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       62 /*+*/, -1,       62 /*-*/, -1,       63 /*/ */, 52 /*0*/,
+    53 /*1*/, 54 /*2*/, 55 /*3*/, 56 /*4*/, 57 /*5*/, 58 /*6*/,  59 /*7*/,
+    60 /*8*/, 61 /*9*/, -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       0 /*A*/,  1 /*B*/,  2 /*C*/,  3 /*D*/,   4 /*E*/,
+    5 /*F*/,  6 /*G*/,  07 /*H*/, 8 /*I*/,  9 /*J*/,  10 /*K*/,  11 /*L*/,
+    12 /*M*/, 13 /*N*/, 14 /*O*/, 15 /*P*/, 16 /*Q*/, 17 /*R*/,  18 /*S*/,
+    19 /*T*/, 20 /*U*/, 21 /*V*/, 22 /*W*/, 23 /*X*/, 24 /*Y*/,  25 /*Z*/,
+    -1,       -1,       -1,       -1,       63 /*_*/, -1,        26 /*a*/,
+    27 /*b*/, 28 /*c*/, 29 /*d*/, 30 /*e*/, 31 /*f*/, 32 /*g*/,  33 /*h*/,
+    34 /*i*/, 35 /*j*/, 36 /*k*/, 37 /*l*/, 38 /*m*/, 39 /*n*/,  40 /*o*/,
+    41 /*p*/, 42 /*q*/, 43 /*r*/, 44 /*s*/, 45 /*t*/, 46 /*u*/,  47 /*v*/,
+    48 /*w*/, 49 /*x*/, 50 /*y*/, 51 /*z*/, -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1,       -1,       -1,        -1,
+    -1,       -1,       -1,       -1};
+
+uint32_t Base64Lookup(char c) {
+  // Sign-extend return value so high bit will be set on any unexpected char.
+  return static_cast<uint32_t>(kBase64Table[static_cast<uint8_t>(c)]);
+}
+
+void EncodeScalar(absl::string_view chars, const char* ptr, const char* end,
+                  char* out) {
+  // Reads the `n`th character off of `ptr` while gracefully avoiding
+  // sign extension due to implicit conversions
+  auto read = [&](size_t n) {
+    return static_cast<size_t>(static_cast<uint8_t>(ptr[n]));
+  };
+
+  while (end - ptr >= 3) {
+    out[0] = chars[read(0) >> 2];
+    out[1] = chars[((read(0) & 0x3) << 4) | (read(1) >> 4)];
+    out[2] = chars[((read(1) & 0xf) << 2) | (read(2) >> 6)];
+    out[3] = chars[read(2) & 0x3f];
+    ptr += 3;
+    out += 4;
+  }
+
+  switch (end - ptr) {
+    case 2:
+      out[0] = chars[read(0) >> 2];
+      out[1] = chars[((read(0) & 0x3) << 4) | (read(1) >> 4)];
+      out[2] = chars[(read(1) & 0xf) << 2];
+      out[3] = '=';
+      break;
+    case 1:
+      out[0] = chars[read(0) >> 2];
+      out[1] = chars[((read(0) & 0x3) << 4)];
+      out[2] = '=';
+      out[3] = '=';
+      break;
+  }
+}
+
+absl::StatusOr<size_t> DecodeScalar(const char* ptr, const char* end,
+                                    char* out, char* out_begin) {
+  const char* end4 = ptr + ((end - ptr) & ~3);
+
+  for (; ptr < end4; ptr += 4, out += 3) {
+    auto val = Base64Lookup(ptr[0]) << 18 | Base64Lookup(ptr[1]) << 12 |
+               Base64Lookup(ptr[2]) << 6 | Base64Lookup(ptr[3]) << 0;
+
+    if (static_cast<int32_t>(val) < 0) {
+      // Junk chars or padding. Remove trailing padding, if any.
+      if (end - ptr == 4 && ptr[3] == '=') {
+        if (ptr[2] == '=') {
+          end -= 2;
+        } else {
+          end -= 1;
+        }
+      }
+      break;
+    }
+
+    out[0] = val >> 16;
+    out[1] = (val >> 8) & 0xff;
+    out[2] = val & 0xff;
+  }
+
+  if (ptr < end) {
+    uint32_t val = ~0u;
+    switch (end - ptr) {
+      case 2:
+        val = Base64Lookup(ptr[0]) << 18 | Base64Lookup(ptr[1]) << 12;
+        out[0] = val >> 16;
+        out += 1;
+        break;
+      case 3:
+        val = Base64Lookup(ptr[0]) << 18 | Base64Lookup(ptr[1]) << 12 |
+              Base64Lookup(ptr[2]) << 6;
+        out[0] = val >> 16;
+        out[1] = (val >> 8) & 0xff;
+        out += 2;
+        break;
+    }
+
+    if (static_cast<int32_t>(val) < 0) {
+      return absl::InvalidArgumentError("corrupt base64");
+    }
+  }
+
+  return static_cast<size_t>(out - out_begin);
+}
+
+#ifdef PROTOBUF_JSON_BASE64_X86
+
+// The vector kernels follow Muła and Lemire, "Faster Base64 Encoding and
+// Decoding using AVX2 Instructions" (2018). Each kernel advances `ptr` and
+// `out` over the blocks it converts and leaves the rest to the next narrower
+// kernel, ending with the scalar loops, which also handle padding and errors.
+
+// Maps 6-bit values to characters by adding a per-range offset: the ranges
+// A-Z, a-z, 0-9, and the last two characters, which differ between the
+// alphabets.
+__attribute__((target("ssse3"))) __m128i EncodeOffsetsSsse3(
+    Base64Alphabet alphabet) {
+  const char c62 = alphabet == Base64Alphabet::kStandard ? '+' : '-';
+  const char c63 = alphabet == Base64Alphabet::kStandard ? '/' : '_';
+  return _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                       '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                       '0' - 52, static_cast<char>(c62 - 62),
+                       static_cast<char>(c63 - 63), 'A', 0, 0);
+}
+
+__attribute__((target("ssse3"))) __m128i EncodeBlockSsse3(__m128i in,
+                                                          __m128i offsets) {
+  // Spread each group of 3 bytes over a 32-bit lane, then move each 6-bit
+  // value into a byte of its own.
+  in = _mm_shuffle_epi8(
+      in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+  __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  __m128i indices = _mm_or_si128(t1, t3);
+
+  // Reduce each value to an index into `offsets`: 13 for A-Z, 0 for a-z, 1
+  // for 0-9 and 11 and 12 for the last two.
+  __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+  range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+  return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range));
+}
+
+__attribute__((target("ssse3"))) void EncodeSsse3(Base64Alphabet alphabet,
+                                                  const char*& ptr,
+                                                  const char* end,
+                                                  char*& out) {
+  const __m128i offsets = EncodeOffsetsSsse3(alphabet);
+  // Each block reads 16 bytes but only converts the first 12.
+  while (end - ptr >= 16) {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                     EncodeBlockSsse3(in, offsets));
+    ptr += 12;
+    out += 16;
+  }
+}
+
+__attribute__((target("avx2"))) void EncodeAvx2(Base64Alphabet alphabet,
+                                                const char*& ptr,
+                                                const char* end, char*& out) {
+  const __m256i offsets =
+      _mm256_broadcastsi128_si256(EncodeOffsetsSsse3(alphabet));
+  const __m256i spread = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,  //
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  // Each block converts 24 bytes, 12 per lane, and reads up to 28.
+  while (end - ptr >= 28) {
+    __m256i in = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + 12)), 1);
+    in = _mm256_shuffle_epi8(in, spread);
+    __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    __m256i indices = _mm256_or_si256(t1, t3);
+
+    __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    range =
+        _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(out),
+        _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, range)));
+    ptr += 24;
+    out += 32;
+  }
+}
+
+// Decoding maps each character to its 6-bit value by range, and packs four
+// values into three bytes with multiply-adds. A block containing anything
+// other than base64 characters, including padding, is left to the scalar
+// loop, which knows how to report it.
+//
+// Each block stores a full vector at `out` but only advances it by 3/4 of the
+// block size. Since `out` never gets ahead of `ptr`, the extra bytes land on
+// input that has already been read, which keeps in-place decoding safe.
+
+__attribute__((target("ssse3"))) __m128i InRangeSsse3(__m128i v, char lo,
+                                                      char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                       _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), v));
+}
+
+__attribute__((target("ssse3"))) void DecodeSsse3(const char*& ptr,
+                                                  const char* end,
+                                                  char*& out) {
+  while (end - ptr >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+    __m128i upper = InRangeSsse3(v, 'A', 'Z');
+    __m128i lower = InRangeSsse3(v, 'a', 'z');
+    __m128i digit = InRangeSsse3(v, '0', '9');
+    __m128i c62 = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('+')),
+                               _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+    __m128i c63 = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')),
+                               _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower),
+                                 _mm_or_si128(digit, _mm_or_si128(c62, c63)));
+    if (_mm_movemask_epi8(valid) != 0xffff) return;
+
+    __m128i values = _mm_or_si128(
+        _mm_or_si128(
+            _mm_and_si128(upper, _mm_add_epi8(v, _mm_set1_epi8(-'A'))),
+            _mm_and_si128(lower, _mm_add_epi8(v, _mm_set1_epi8(26 - 'a')))),
+        _mm_or_si128(
+            _mm_and_si128(digit, _mm_add_epi8(v, _mm_set1_epi8(52 - '0'))),
+            _mm_or_si128(_mm_and_si128(c62, _mm_set1_epi8(62)),
+                         _mm_and_si128(c63, _mm_set1_epi8(63)))));
+    __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    __m128i words = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    __m128i bytes = _mm_shuffle_epi8(
+        words,
+        _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), bytes);
+    ptr += 16;
+    out += 12;
+  }
+}
+
+__attribute__((target("avx2"))) __m256i InRangeAvx2(__m256i v, char lo,
+                                                    char hi) {
+  return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+__attribute__((target("avx2"))) void DecodeAvx2(const char*& ptr,
+                                                const char* end, char*& out) {
+  while (end - ptr >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+    __m256i upper = InRangeAvx2(v, 'A', 'Z');
+    __m256i lower = InRangeAvx2(v, 'a', 'z');
+    __m256i digit = InRangeAvx2(v, '0', '9');
+    __m256i c62 = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('+')),
+                                  _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-')));
+    __m256i c63 = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')),
+                                  _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+    __m256i valid =
+        _mm256_or_si256(_mm256_or_si256(upper, lower),
+                        _mm256_or_si256(digit, _mm256_or_si256(c62, c63)));
+    if (static_cast<uint32_t>(_mm256_movemask_epi8(valid)) != 0xffffffff) {
+      return;
+    }
+
+    __m256i values = _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_and_si256(upper, _mm256_add_epi8(v, _mm256_set1_epi8(-'A'))),
+            _mm256_and_si256(lower,
+                             _mm256_add_epi8(v, _mm256_set1_epi8(26 - 'a')))),
+        _mm256_or_si256(
+            _mm256_and_si256(digit,
+                             _mm256_add_epi8(v, _mm256_set1_epi8(52 - '0'))),
+            _mm256_or_si256(_mm256_and_si256(c62, _mm256_set1_epi8(62)),
+                            _mm256_and_si256(c63, _mm256_set1_epi8(63)))));
+    __m256i pairs =
+        _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    __m256i words = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+    __m256i bytes = _mm256_shuffle_epi8(
+        words, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1,
+                                -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                -1, -1, -1, -1));
+    // Move the 12 bytes of the upper lane next to those of the lower one.
+    bytes = _mm256_permutevar8x32_epi32(
+        bytes, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), bytes);
+    ptr += 32;
+    out += 24;
+  }
+}
+
+Base64Kernel DetectBase64Kernel() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return Base64Kernel::kAvx2;
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    return Base64Kernel::kSsse3;
+  }
+  return Base64Kernel::kScalar;
+}
+
+#else  // PROTOBUF_JSON_BASE64_X86
+
+Base64Kernel DetectBase64Kernel() { return Base64Kernel::kScalar; }
+
+#endif  // PROTOBUF_JSON_BASE64_X86
+
+}  // namespace
+
+Base64Kernel BestBase64Kernel() {
+  static const Base64Kernel kernel = DetectBase64Kernel();
+  return kernel;
+}
+
+void EncodeBase64(Base64Kernel kernel, Base64Alphabet alphabet,
+                  absl::string_view data, char* out) {
+  const char* ptr = data.data();
+  const char* end = ptr + data.size();
+  if (kernel > BestBase64Kernel()) kernel = BestBase64Kernel();
+  switch (kernel) {
+#ifdef PROTOBUF_JSON_BASE64_X86
+    case Base64Kernel::kAvx2:
+      EncodeAvx2(alphabet, ptr, end, out);
+      ABSL_FALLTHROUGH_INTENDED;
+    case Base64Kernel::kSsse3:
+      EncodeSsse3(alphabet, ptr, end, out);
+      break;
+#endif  // PROTOBUF_JSON_BASE64_X86
+    default:
+      break;
+  }
+  EncodeScalar(alphabet == Base64Alphabet::kStandard ? kStandardChars
+                                                     : kWebSafeChars,
+               ptr, end, out);
+}
+
+absl::StatusOr<size_t> DecodeBase64(Base64Kernel kernel,
+                                    absl::string_view base64, char* out) {
+  const char* ptr = base64.data();
+  const char* end = ptr + base64.size();
+  char* out_begin = out;
+  if (kernel > BestBase64Kernel()) kernel = BestBase64Kernel();
+  switch (kernel) {
+#ifdef PROTOBUF_JSON_BASE64_X86
+    case Base64Kernel::kAvx2:
+      DecodeAvx2(ptr, end, out);
+      ABSL_FALLTHROUGH_INTENDED;
+    case Base64Kernel::kSsse3:
+      DecodeSsse3(ptr, end, out);
+      break;
+#endif  // PROTOBUF_JSON_BASE64_X86
+    default:
+      break;
+  }
+  return DecodeScalar(ptr, end, out, out_begin);
+}
+
+}  // namespace json_internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
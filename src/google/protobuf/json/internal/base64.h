@@ -0,0 +1,80 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines the base64 codecs used for `bytes` fields in JSON. They
+// convert 12 or 24 bytes per iteration using SSSE3 or AVX2 when the CPU
+// supports it, and fall back to converting one 3-byte group at a time
+// otherwise.
+
+#ifndef GOOGLE_PROTOBUF_JSON_INTERNAL_BASE64_H__
+#define GOOGLE_PROTOBUF_JSON_INTERNAL_BASE64_H__
+
+#include <cstddef>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace json_internal {
+
+// The codec kernels, ordered such that a CPU supporting one kernel also
+// supports all kernels before it.
+enum class Base64Kernel {
+  kScalar,
+  kSsse3,
+  kAvx2,
+};
+
+enum class Base64Alphabet {
+  // RFC 4648 section 4, using '+' and '/'.
+  kStandard,
+  // RFC 4648 section 5, using '-' and '_'.
+  kWebSafe,
+};
+
+// Returns the fastest kernel supported by the running CPU.
+PROTOBUF_EXPORT Base64Kernel BestBase64Kernel();
+
+// Returns the number of characters EncodeBase64() writes for `size` bytes.
+constexpr size_t Base64EncodedSize(size_t size) { return (size + 2) / 3 * 4; }
+
+// Encodes `data` as padded base64 into `out`, which must have room for
+// Base64EncodedSize(data.size()) characters.
+PROTOBUF_EXPORT void EncodeBase64(Base64Kernel kernel, Base64Alphabet alphabet,
+                                  absl::string_view data, char* out);
+
+// Decodes `base64` into `out`, which must have room for base64.size() bytes
+// and may point to base64.data() to decode in place. Returns the number of
+// bytes written.
+//
+// Characters of both alphabets are accepted, and trailing padding is
+// optional, as the ProtoJSON spec requires.
+PROTOBUF_EXPORT absl::StatusOr<size_t> DecodeBase64(Base64Kernel kernel,
+                                                    absl::string_view base64,
+                                                    char* out);
+
+inline void EncodeBase64(Base64Alphabet alphabet, absl::string_view data,
+                         char* out) {
+  EncodeBase64(BestBase64Kernel(), alphabet, data, out);
+}
+
+inline absl::StatusOr<size_t> DecodeBase64(absl::string_view base64,
+                                           char* out) {
+  return DecodeBase64(BestBase64Kernel(), base64, out);
+}
+
+}  // namespace json_internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_JSON_INTERNAL_BASE64_H__
@@ -0,0 +1,171 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/json/internal/base64.h"
+
+#include <cstddef>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/status/statusor.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_replace.h"
+#include "absl/strings/string_view.h"
+
+namespace google {
+namespace protobuf {
+namespace json_internal {
+namespace {
+
+class Base64Test : public testing::TestWithParam<Base64Kernel> {
+ protected:
+  void SetUp() override {
+    if (GetParam() > BestBase64Kernel()) {
+      GTEST_SKIP() << "kernel not supported by this CPU";
+    }
+  }
+
+  std::string Encode(absl::string_view data,
+                     Base64Alphabet alphabet = Base64Alphabet::kStandard) {
+    std::string out(Base64EncodedSize(data.size()), '\0');
+    EncodeBase64(GetParam(), alphabet, data, &out[0]);
+    return out;
+  }
+
+  absl::StatusOr<std::string> Decode(absl::string_view base64) {
+    std::string out(base64.size(), '\0');
+    absl::StatusOr<size_t> size = DecodeBase64(GetParam(), base64, &out[0]);
+    if (!size.ok()) return size.status();
+    out.resize(*size);
+    return out;
+  }
+};
+
+// Bytes that exercise every 6-bit value in every position.
+std::string TestData(size_t size) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<char>(i * 167 + (i >> 8) * 13);
+  }
+  return data;
+}
+
+TEST_P(Base64Test, Rfc4648Vectors) {
+  EXPECT_EQ(Encode(""), "");
+  EXPECT_EQ(Encode("f"), "Zg==");
+  EXPECT_EQ(Encode("fo"), "Zm8=");
+  EXPECT_EQ(Encode("foo"), "Zm9v");
+  EXPECT_EQ(Encode("foob"), "Zm9vYg==");
+  EXPECT_EQ(Encode("fooba"), "Zm9vYmE=");
+  EXPECT_EQ(Encode("foobar"), "Zm9vYmFy");
+
+  EXPECT_EQ(*Decode(""), "");
+  EXPECT_EQ(*Decode("Zg=="), "f");
+  EXPECT_EQ(*Decode("Zm8="), "fo");
+  EXPECT_EQ(*Decode("Zm9v"), "foo");
+  EXPECT_EQ(*Decode("Zm9vYg=="), "foob");
+  EXPECT_EQ(*Decode("Zm9vYmE="), "fooba");
+  EXPECT_EQ(*Decode("Zm9vYmFy"), "foobar");
+}
+
+TEST_P(Base64Test, RoundTrip) {
+  for (size_t size = 0; size <= 300; ++size) {
+    std::string data = TestData(size);
+    std::string standard = Encode(data, Base64Alphabet::kStandard);
+    EXPECT_EQ(standard, absl::Base64Escape(data)) << "size " << size;
+    std::string web_safe = Encode(data, Base64Alphabet::kWebSafe);
+    EXPECT_EQ(absl::StrReplaceAll(web_safe, {{"=", ""}}),
+              absl::WebSafeBase64Escape(data))
+        << "size " << size;
+
+    EXPECT_EQ(*Decode(standard), data) << "size " << size;
+    EXPECT_EQ(*Decode(web_safe), data) << "size " << size;
+    EXPECT_EQ(*Decode(absl::WebSafeBase64Escape(data)), data)
+        << "size " << size;
+  }
+}
+
+TEST_P(Base64Test, DecodeInPlace) {
+  std::string data = TestData(1000);
+  std::string buf = Encode(data);
+  absl::StatusOr<size_t> size = DecodeBase64(GetParam(), buf, &buf[0]);
+  ASSERT_TRUE(size.ok());
+  buf.resize(*size);
+  EXPECT_EQ(buf, data);
+}
+
+TEST_P(Base64Test, MixedAlphabets) {
+  EXPECT_EQ(*Decode("-_+/"), *Decode("+/-_"));
+  EXPECT_EQ(*Decode("-_+/"), *Decode("+/+/"));
+  EXPECT_EQ(*Decode(std::string(64, '-')), *Decode(std::string(64, '+')));
+}
+
+TEST_P(Base64Test, Padding) {
+  EXPECT_EQ(*Decode("AB"), *Decode("AB=="));
+  EXPECT_EQ(*Decode("ABC"), *Decode("ABC="));
+  EXPECT_FALSE(Decode("A").ok());
+  EXPECT_FALSE(Decode("A===").ok());
+  EXPECT_FALSE(Decode("AB=C").ok());
+  EXPECT_FALSE(Decode("AB==AAAA").ok());
+  EXPECT_FALSE(Decode("AAAA=").ok());
+}
+
+// Places every byte value at every position of inputs up to a few blocks
+// long, and checks that the result matches the scalar kernel's.
+TEST_P(Base64Test, EveryByteAtEveryPosition) {
+  for (size_t size = 1; size <= 100; ++size) {
+    std::string buf = Encode(TestData(size * 3 / 4));
+    buf.resize(size, 'A');
+    for (size_t pos = 0; pos < size; ++pos) {
+      for (int byte = 0; byte < 256; ++byte) {
+        std::string input = buf;
+        input[pos] = static_cast<char>(byte);
+        absl::StatusOr<std::string> decoded = Decode(input);
+
+        std::string expected(size, '\0');
+        absl::StatusOr<size_t> expected_size =
+            DecodeBase64(Base64Kernel::kScalar, input, &expected[0]);
+        ASSERT_EQ(decoded.ok(), expected_size.ok())
+            << "size " << size << " byte " << byte << " at " << pos;
+        if (decoded.ok()) {
+          expected.resize(*expected_size);
+          EXPECT_EQ(*decoded, expected)
+              << "size " << size << " byte " << byte << " at " << pos;
+        }
+      }
+    }
+  }
+}
+
+// The kernels must not read or write past the end of the buffers.
+TEST_P(Base64Test, StopsAtEndOfBuffer) {
+  std::string data = TestData(100);
+  for (size_t size = 0; size < 100; ++size) {
+    std::string encoded(Base64EncodedSize(size) + 1, '#');
+    EncodeBase64(GetParam(), Base64Alphabet::kStandard,
+                 absl::string_view(data).substr(0, size), &encoded[0]);
+    EXPECT_EQ(encoded.back(), '#');
+    encoded.pop_back();
+
+    std::string decoded(encoded.size() + 1, '#');
+    absl::StatusOr<size_t> decoded_size =
+        DecodeBase64(GetParam(), encoded, &decoded[0]);
+    ASSERT_TRUE(decoded_size.ok());
+    EXPECT_EQ(decoded.back(), '#');
+    EXPECT_EQ(decoded.substr(0, *decoded_size), data.substr(0, size));
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Kernels, Base64Test,
+                         testing::Values(Base64Kernel::kScalar,
+                                         Base64Kernel::kSsse3,
+                                         Base64Kernel::kAvx2));
+
+}  // namespace
+}  // namespace json_internal
+}  // namespace protobuf
+}  // namespace google
@@ -168,21 +168,9 @@ struct Proto2Descriptor {
 
   static absl::optional<Field> FieldByName(const Desc& d,
                                            absl::string_view name) {
-    if (const auto* field = d.FindFieldByCamelcaseName(name)) {
+    if (const auto* field = internal::JsonNameTable::For(d).FindField(name)) {
       return field;
     }
-
-    if (const auto* field = d.FindFieldByName(name)) {
-      return field;
-    }
-
-    for (int i = 0; i < d.field_count(); ++i) {
-      const auto* field = d.field(i);
-      if (field->has_json_name() && field->json_name() == name) {
-        return field;
-      }
-    }
-
     return absl::nullopt;
   }
 
@@ -209,6 +197,17 @@ struct Proto2Descriptor {
   static absl::string_view FieldJsonName(Field f) {
     return f->has_json_name() ? f->json_name() : f->camelcase_name();
   }
+
+  // Returns FieldName() and FieldJsonName() quoted and followed by a colon, or
+  // an empty string if they need escaping. Not valid for extensions.
+  static absl::string_view QuotedFieldName(Field f) {
+    return internal::JsonNameTable::For(*f->containing_type())
+        .QuotedName(f->index());
+  }
+  static absl::string_view QuotedFieldJsonName(Field f) {
+    return internal::JsonNameTable::For(*f->containing_type())
+        .QuotedJsonName(f->index());
+  }
   static absl::string_view FieldFullName(Field f) { return f->full_name(); }
 
   static absl::string_view FieldTypeName(Field f) {
@@ -376,6 +375,10 @@ struct Proto3Type {
   static absl::string_view FieldJsonName(Field f) {
     return f->proto().json_name();
   }
+
+  // type.proto fields have no precomputed keys.
+  static absl::string_view QuotedFieldName(Field f) { return {}; }
+  static absl::string_view QuotedFieldJsonName(Field f) { return {}; }
   static absl::string_view FieldFullName(Field f) { return f->proto().name(); }
 
   static absl::string_view FieldTypeName(Field f) {
@@ -30,6 +30,7 @@
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "utf8_validity.h"
+#include "google/protobuf/json/internal/scanner.h"
 #include "google/protobuf/stubs/status_macros.h"
 
 // Must be included last.
@@ -191,19 +192,22 @@ absl::StatusOr<uint16_t> JsonLexer::ParseU16HexCodepoint() {
 absl::Status JsonLexer::SkipToToken() {
   while (true) {
     RETURN_IF_ERROR(stream_.BufferAtLeast(1).status());
-    switch (stream_.PeekChar()) {
-      case '\n':
-        RETURN_IF_ERROR(Advance(1));
-        ++json_loc_.line;
-        json_loc_.col = 0;
-        break;
-      case '\r':
-      case '\t':
-      case ' ':
-        RETURN_IF_ERROR(Advance(1));
-        break;
-      default:
-        return absl::OkStatus();
+    absl::string_view unread = stream_.Unread();
+    size_t len = SpanWhitespace(unread);
+    bool found_token = len < unread.size();
+    absl::string_view whitespace = unread.substr(0, len);
+    size_t last_newline = whitespace.rfind('\n');
+    size_t newlines = 0;
+    if (last_newline != absl::string_view::npos) {
+      newlines = absl::c_count(whitespace, '\n');
+    }
+    RETURN_IF_ERROR(Advance(len));
+    if (newlines != 0) {
+      json_loc_.line += newlines;
+      json_loc_.col = len - last_newline - 1;
+    }
+    if (found_token) {
+      return absl::OkStatus();
     }
   }
 }
@@ -391,6 +395,15 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseUtf8() {
   std::string on_heap;
   LocationWith<Mark> mark = BeginMark();
   while (true) {
+    // Skip over the characters that need no special handling in bulk.
+    absl::string_view plain =
+        stream_.Unread().substr(0, SpanStringChars(stream_.Unread()));
+    if (!plain.empty()) {
+      if (!on_heap.empty()) {
+        on_heap.append(plain.data(), plain.size());
+      }
+      RETURN_IF_ERROR(Advance(plain.size()));
+    }
     RETURN_IF_ERROR(stream_.BufferAtLeast(1).status());
 
     char c = stream_.PeekChar();
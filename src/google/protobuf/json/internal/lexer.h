@@ -104,6 +104,17 @@ class JsonLexer {
     json_loc_.path = path_;
   }
 
+  // Starts lexing `stream` with `options`, as if newly constructed, but keeps
+  // the path and the buffer's capacity. No string or mark taken from the
+  // previous stream may still be alive.
+  void Reset(io::ZeroCopyInputStream* stream, const ParseOptions& options,
+             JsonLocation start = {}) {
+    stream_.Reset(stream);
+    options_ = options;
+    json_loc_ = start;
+    json_loc_.path = path_;
+  }
+
   const ParseOptions& options() const { return options_; }
 
   const MessagePath& path() const { return *path_; }
@@ -613,6 +613,47 @@ TEST(LexerTest, MixtureOfEscapesAndRawMultibyteCharacters) {
   });
 }
 
+// The strings and whitespace below are long enough to be scanned in several
+// vector-sized blocks, with each interesting character at a different offset
+// within a block.
+TEST(LexerTest, LongStrings) {
+  std::string plain(37, 'a');
+  std::string json = absl::StrCat("[\"", plain, "\\n", plain, "é", plain,
+                                  "\", \"", plain, plain, "\"]");
+  std::string expected = absl::StrCat(plain, "\n", plain, "é", plain);
+  Do(json, [&](io::ZeroCopyInputStream* stream) {
+    EXPECT_THAT(Value::Parse(stream),
+                IsOkAndHolds(ValueIs<Value::Array>(
+                    ElementsAre(ValueIs<std::string>(expected),
+                                ValueIs<std::string>(plain + plain)))));
+  });
+}
+
+TEST(LexerTest, LongWhitespace) {
+  std::string space(35, ' ');
+  std::string json = absl::StrCat(space, "{", space, "\"k\"\n\t\r\n", space,
+                                  ":", space, "\n", space, "1", space, "}",
+                                  space, "\n");
+  Do(json, [](io::ZeroCopyInputStream* stream) {
+    EXPECT_THAT(Value::Parse(stream),
+                IsOkAndHolds(ValueIs<Value::Object>(
+                    ElementsAre(Pair("k", ValueIs<double>(1))))));
+  });
+}
+
+TEST(LexerTest, ControlCharAfterLongPrefix) {
+  BadInner(absl::StrCat("\"", std::string(40, 'x'), "\n",
+                        std::string(40, 'x'), "\""));
+  BadInner(absl::StrCat("\"", std::string(40, 'x'), "\x01\""));
+}
+
+TEST(NonStandard, LongSingleQuoteString) {
+  std::string plain(37, 'a');
+  DoLegacy(absl::StrCat("'", plain, "\"", plain, "'"), [&](const Value& value) {
+    EXPECT_THAT(value, ValueIs<std::string>(absl::StrCat(plain, "\"", plain)));
+  });
+}
+
 TEST(LexerTest, SurrogateEscape) {
   absl::string_view json = R"json(
     [ "\ud83d\udc08\u200D\u2b1B\ud83d\uDdA4" ]
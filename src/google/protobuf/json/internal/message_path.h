@@ -26,6 +26,13 @@ class MessagePath {
       : components_(
             {Component{FieldDescriptor::TYPE_MESSAGE, message_root, "", -1}}) {}
 
+  // Clears the path back to a single root component for `message_root`.
+  void Reset(absl::string_view message_root) {
+    components_.clear();
+    components_.push_back(
+        Component{FieldDescriptor::TYPE_MESSAGE, message_root, "", -1});
+  }
+
   // Pushes a new field name, along with an optional type name if it is
   // a message or enum.
   //
@@ -31,12 +31,12 @@
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
-#include "absl/types/span.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/dynamic_message.h"
 #include "google/protobuf/io/zero_copy_sink.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/json/internal/base64.h"
 #include "google/protobuf/json/internal/descriptor_traits.h"
 #include "google/protobuf/json/internal/lexer.h"
 #include "google/protobuf/json/internal/parser_traits.h"
@@ -62,113 +62,6 @@ namespace {
 // combinations is used. The traits types that collect the per-instantiation
 // functionality can be found in json_util2_parser_traits-inl.h.
 
-// This table maps an unsigned `char` value, interpreted as an ASCII character,
-// to a corresponding value in the base64 alphabet (both traditional and
-// "web-safe" characters are included).
-//
-// If a character is not valid base64, it maps to -1; this is used by the bit
-// operations that assemble a base64-encoded word to determine if an error
-// occurred, by checking the sign bit.
-constexpr signed char kBase64Table[256] = {
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       62 /*+*/, -1,       62 /*-*/, -1,       63 /*/ */, 52 /*0*/,
-    53 /*1*/, 54 /*2*/, 55 /*3*/, 56 /*4*/, 57 /*5*/, 58 /*6*/,  59 /*7*/,
-    60 /*8*/, 61 /*9*/, -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       0 /*A*/,  1 /*B*/,  2 /*C*/,  3 /*D*/,   4 /*E*/,
-    5 /*F*/,  6 /*G*/,  07 /*H*/, 8 /*I*/,  9 /*J*/,  10 /*K*/,  11 /*L*/,
-    12 /*M*/, 13 /*N*/, 14 /*O*/, 15 /*P*/, 16 /*Q*/, 17 /*R*/,  18 /*S*/,
-    19 /*T*/, 20 /*U*/, 21 /*V*/, 22 /*W*/, 23 /*X*/, 24 /*Y*/,  25 /*Z*/,
-    -1,       -1,       -1,       -1,       63 /*_*/, -1,        26 /*a*/,
-    27 /*b*/, 28 /*c*/, 29 /*d*/, 30 /*e*/, 31 /*f*/, 32 /*g*/,  33 /*h*/,
-    34 /*i*/, 35 /*j*/, 36 /*k*/, 37 /*l*/, 38 /*m*/, 39 /*n*/,  40 /*o*/,
-    41 /*p*/, 42 /*q*/, 43 /*r*/, 44 /*s*/, 45 /*t*/, 46 /*u*/,  47 /*v*/,
-    48 /*w*/, 49 /*x*/, 50 /*y*/, 51 /*z*/, -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1,       -1,       -1,        -1,
-    -1,       -1,       -1,       -1};
-
-uint32_t Base64Lookup(char c) {
-  // Sign-extend return value so high bit will be set on any unexpected char.
-  return static_cast<uint32_t>(kBase64Table[static_cast<uint8_t>(c)]);
-}
-
-// Decodes `base64` in-place, shrinking the length as appropriate.
-absl::StatusOr<absl::Span<char>> DecodeBase64InPlace(absl::Span<char> base64) {
-  // We decode in place. This is safe because this is a new buffer (not
-  // aliasing the input) and because base64 decoding shrinks 4 bytes into 3.
-  char* out = base64.data();
-  const char* ptr = base64.data();
-  const char* end = ptr + base64.size();
-  const char* end4 = ptr + (base64.size() & ~3u);
-
-  for (; ptr < end4; ptr += 4, out += 3) {
-    auto val = Base64Lookup(ptr[0]) << 18 | Base64Lookup(ptr[1]) << 12 |
-               Base64Lookup(ptr[2]) << 6 | Base64Lookup(ptr[3]) << 0;
-
-    if (static_cast<int32_t>(val) < 0) {
-      // Junk chars or padding. Remove trailing padding, if any.
-      if (end - ptr == 4 && ptr[3] == '=') {
-        if (ptr[2] == '=') {
-          end -= 2;
-        } else {
-          end -= 1;
-        }
-      }
-      break;
-    }
-
-    out[0] = val >> 16;
-    out[1] = (val >> 8) & 0xff;
-    out[2] = val & 0xff;
-  }
-
-  if (ptr < end) {
-    uint32_t val = ~0u;
-    switch (end - ptr) {
-      case 2:
-        val = Base64Lookup(ptr[0]) << 18 | Base64Lookup(ptr[1]) << 12;
-        out[0] = val >> 16;
-        out += 1;
-        break;
-      case 3:
-        val = Base64Lookup(ptr[0]) << 18 | Base64Lookup(ptr[1]) << 12 |
-              Base64Lookup(ptr[2]) << 6;
-        out[0] = val >> 16;
-        out[1] = (val >> 8) & 0xff;
-        out += 2;
-        break;
-    }
-
-    if (static_cast<int32_t>(val) < 0) {
-      return absl::InvalidArgumentError("corrupt base64");
-    }
-  }
-
-  return absl::Span<char>(base64.data(),
-                          static_cast<size_t>(out - base64.data()));
-}
-
 template <typename T>
 absl::StatusOr<LocationWith<T>> ParseIntInner(JsonLexer& lex, double lo,
                                               double hi) {
@@ -310,12 +203,13 @@ absl::StatusOr<std::string> ParseStrOrBytes(JsonLexer& lex,
 
   if (Traits::FieldType(field) == FieldDescriptor::TYPE_BYTES) {
     std::string& b64 = str->value.ToString();
-    absl::StatusOr<absl::Span<char>> decoded =
-        DecodeBase64InPlace(absl::MakeSpan(&b64[0], b64.size()));
+    // Decoding in place is safe because base64 decoding shrinks 4 bytes into
+    // 3.
+    absl::StatusOr<size_t> decoded = DecodeBase64(b64, &b64[0]);
     if (!decoded.ok()) {
       return str->loc.Invalid(decoded.status().message());
     }
-    b64.resize(decoded->size());
+    b64.resize(*decoded);
   }
 
   return std::move(str->value.ToString());
@@ -1269,14 +1163,8 @@ absl::Status ParseMessage(JsonLexer& lex, const Desc<Traits>& desc,
         return ParseField<Traits>(lex, desc, name.value.ToString(), msg);
       });
 }
-}  // namespace
-
-absl::Status JsonStreamToMessage(io::ZeroCopyInputStream* input,
-                                 Message* message,
-                                 json_internal::ParseOptions options) {
-  MessagePath path(message->GetDescriptor()->full_name());
-  JsonLexer lex(input, options, &path);
 
+absl::Status ParseDocument(JsonLexer& lex, Message* message) {
   ParseProto2Descriptor::Msg msg(message);
   absl::Status s =
       ParseMessage<ParseProto2Descriptor>(lex, *message->GetDescriptor(), msg,
@@ -1292,6 +1180,23 @@ absl::Status JsonStreamToMessage(io::ZeroCopyInputStream* input,
   }
   return s;
 }
+}  // namespace
+
+absl::Status JsonStreamToMessage(io::ZeroCopyInputStream* input,
+                                 Message* message,
+                                 json_internal::ParseOptions options,
+                                 JsonLocation start) {
+  MessagePath path(message->GetDescriptor()->full_name());
+  JsonLexer lex(input, options, &path, start);
+  return ParseDocument(lex, message);
+}
+
+absl::Status JsonMessageParser::Parse(io::ZeroCopyInputStream* input,
+                                      Message* message, JsonLocation start) {
+  path_.Reset(message->GetDescriptor()->full_name());
+  lex_.Reset(input, options_, start);
+  return ParseDocument(lex_, message);
+}
 
 absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
                                 const std::string& type_url,
@@ -19,9 +19,37 @@ namespace protobuf {
 namespace json_internal {
 // Internal version of google::protobuf::util::JsonStreamToMessage; see json_util.h for
 // details.
+//
+// `start` is the location of the beginning of `input`, for use in error
+// messages when it is a part of some larger document.
 absl::Status JsonStreamToMessage(io::ZeroCopyInputStream* input,
                                  Message* message,
-                                 json_internal::ParseOptions options);
+                                 json_internal::ParseOptions options,
+                                 JsonLocation start = {});
+
+// Parses a sequence of JSON documents into messages, as JsonStreamToMessage()
+// does, but keeps one lexer and message path for all of them instead of
+// setting up new ones for each document.
+//
+// Not thread-safe; use one parser per thread.
+class JsonMessageParser {
+ public:
+  explicit JsonMessageParser(const json_internal::ParseOptions& options)
+      : options_(options), path_(""), lex_(nullptr, options, &path_) {}
+  JsonMessageParser(const JsonMessageParser&) = delete;
+  JsonMessageParser& operator=(const JsonMessageParser&) = delete;
+
+  // Merges the JSON document in `input` into `message`. `start` is as for
+  // JsonStreamToMessage().
+  absl::Status Parse(io::ZeroCopyInputStream* input, Message* message,
+                     JsonLocation start = {});
+
+ private:
+  json_internal::ParseOptions options_;
+  MessagePath path_;
+  JsonLexer lex_;
+};
+
 // Internal version of google::protobuf::util::JsonToBinaryStream; see json_util.h for
 // details.
 absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
@@ -0,0 +1,204 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/json/internal/scanner.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/numeric/bits.h"
+#include "absl/strings/string_view.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define PROTOBUF_JSON_SCANNER_X86 1
+#endif
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace json_internal {
+namespace {
+
+inline bool IsWhitespace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline bool IsPlainStringChar(char c) {
+  uint8_t uc = static_cast<uint8_t>(c);
+  return uc >= 0x20 && uc < 0x80 && c != '"' && c != '\'' && c != '\\';
+}
+
+template <bool (*pred)(char)>
+size_t SpanScalar(const char* ptr, const char* end) {
+  const char* begin = ptr;
+  while (ptr < end && pred(*ptr)) ++ptr;
+  return static_cast<size_t>(ptr - begin);
+}
+
+#ifdef PROTOBUF_JSON_SCANNER_X86
+
+// Each kernel computes a mask of the bytes that end the span, and stops at
+// the first block where it is non-zero. The final partial block is handled by
+// the scalar loop, so that no load crosses the end of `data`.
+
+__attribute__((target("sse2"))) size_t SpanWhitespaceSse2(const char* ptr,
+                                                          const char* end) {
+  const char* begin = ptr;
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i tab = _mm_set1_epi8('\t');
+  while (end - ptr >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+    __m128i ws = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, newline)),
+        _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, tab)));
+    uint32_t stop = ~static_cast<uint32_t>(_mm_movemask_epi8(ws)) & 0xffff;
+    if (stop != 0) {
+      return static_cast<size_t>(ptr - begin) + absl::countr_zero(stop);
+    }
+    ptr += 16;
+  }
+  return static_cast<size_t>(ptr - begin) + SpanScalar<IsWhitespace>(ptr, end);
+}
+
+__attribute__((target("sse2"))) size_t SpanStringCharsSse2(const char* ptr,
+                                                           const char* end) {
+  const char* begin = ptr;
+  const __m128i control = _mm_set1_epi8(0x20);
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i single_quote = _mm_set1_epi8('\'');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  while (end - ptr >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+    // Bytes below 0x20 and bytes of multi-byte UTF-8 sequences (which are
+    // negative as signed bytes) are both less than 0x20.
+    __m128i special = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                     _mm_cmpeq_epi8(v, single_quote)),
+        _mm_or_si128(_mm_cmpeq_epi8(v, backslash),
+                     _mm_cmpgt_epi8(control, v)));
+    uint32_t stop = static_cast<uint32_t>(_mm_movemask_epi8(special));
+    if (stop != 0) {
+      return static_cast<size_t>(ptr - begin) + absl::countr_zero(stop);
+    }
+    ptr += 16;
+  }
+  return static_cast<size_t>(ptr - begin) +
+         SpanScalar<IsPlainStringChar>(ptr, end);
+}
+
+__attribute__((target("avx2"))) size_t SpanWhitespaceAvx2(const char* ptr,
+                                                          const char* end) {
+  const char* begin = ptr;
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i newline = _mm256_set1_epi8('\n');
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  while (end - ptr >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+    __m256i ws = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+                        _mm256_cmpeq_epi8(v, newline)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, tab)));
+    uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(ws));
+    if (stop != 0) {
+      return static_cast<size_t>(ptr - begin) + absl::countr_zero(stop);
+    }
+    ptr += 32;
+  }
+  return static_cast<size_t>(ptr - begin) + SpanWhitespaceSse2(ptr, end);
+}
+
+__attribute__((target("avx2"))) size_t SpanStringCharsAvx2(const char* ptr,
+                                                           const char* end) {
+  const char* begin = ptr;
+  const __m256i control = _mm256_set1_epi8(0x20);
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i single_quote = _mm256_set1_epi8('\'');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  while (end - ptr >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+    __m256i special = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, quote),
+                        _mm256_cmpeq_epi8(v, single_quote)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, backslash),
+                        _mm256_cmpgt_epi8(control, v)));
+    uint32_t stop = static_cast<uint32_t>(_mm256_movemask_epi8(special));
+    if (stop != 0) {
+      return static_cast<size_t>(ptr - begin) + absl::countr_zero(stop);
+    }
+    ptr += 32;
+  }
+  return static_cast<size_t>(ptr - begin) + SpanStringCharsSse2(ptr, end);
+}
+
+JsonScanKernel DetectJsonScanKernel() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return JsonScanKernel::kAvx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return JsonScanKernel::kSse2;
+  }
+  return JsonScanKernel::kScalar;
+}
+
+#else  // PROTOBUF_JSON_SCANNER_X86
+
+JsonScanKernel DetectJsonScanKernel() { return JsonScanKernel::kScalar; }
+
+#endif  // PROTOBUF_JSON_SCANNER_X86
+
+}  // namespace
+
+JsonScanKernel BestJsonScanKernel() {
+  static const JsonScanKernel kernel = DetectJsonScanKernel();
+  return kernel;
+}
+
+size_t SpanWhitespace(JsonScanKernel kernel, absl::string_view data) {
+  const char* ptr = data.data();
+  const char* end = ptr + data.size();
+  if (kernel > BestJsonScanKernel()) kernel = BestJsonScanKernel();
+  switch (kernel) {
+#ifdef PROTOBUF_JSON_SCANNER_X86
+    case JsonScanKernel::kAvx2:
+      return SpanWhitespaceAvx2(ptr, end);
+    case JsonScanKernel::kSse2:
+      return SpanWhitespaceSse2(ptr, end);
+#endif  // PROTOBUF_JSON_SCANNER_X86
+    default:
+      return SpanScalar<IsWhitespace>(ptr, end);
+  }
+}
+
+size_t SpanStringChars(JsonScanKernel kernel, absl::string_view data) {
+  const char* ptr = data.data();
+  const char* end = ptr + data.size();
+  if (kernel > BestJsonScanKernel()) kernel = BestJsonScanKernel();
+  switch (kernel) {
+#ifdef PROTOBUF_JSON_SCANNER_X86
+    case JsonScanKernel::kAvx2:
+      return SpanStringCharsAvx2(ptr, end);
+    case JsonScanKernel::kSse2:
+      return SpanStringCharsSse2(ptr, end);
+#endif  // PROTOBUF_JSON_SCANNER_X86
+    default:
+      return SpanScalar<IsPlainStringChar>(ptr, end);
+  }
+}
+
+}  // namespace json_internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
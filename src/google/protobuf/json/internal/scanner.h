@@ -0,0 +1,66 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines the bulk scanning routines used by JsonLexer to skip over
+// the bytes that need no per-character handling: whitespace between tokens,
+// and runs of plain characters inside strings. They classify 16 or 32 bytes
+// per iteration using SSE2 or AVX2 when the CPU supports it, and fall back to
+// classifying one byte at a time otherwise.
+
+#ifndef GOOGLE_PROTOBUF_JSON_INTERNAL_SCANNER_H__
+#define GOOGLE_PROTOBUF_JSON_INTERNAL_SCANNER_H__
+
+#include <cstddef>
+
+#include "absl/strings/string_view.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace json_internal {
+
+// The scanning kernels, ordered such that a CPU supporting one kernel also
+// supports all kernels before it.
+enum class JsonScanKernel {
+  kScalar,
+  kSse2,
+  kAvx2,
+};
+
+// Returns the fastest kernel supported by the running CPU.
+PROTOBUF_EXPORT JsonScanKernel BestJsonScanKernel();
+
+// Returns the length of the longest prefix of `data` consisting of JSON
+// whitespace: spaces, tabs, carriage returns and newlines.
+PROTOBUF_EXPORT size_t SpanWhitespace(JsonScanKernel kernel,
+                                      absl::string_view data);
+
+// Returns the length of the longest prefix of `data` consisting of characters
+// that stand for themselves inside a string literal: printable ASCII other
+// than quotes and backslashes. The lexer handles everything else (escapes,
+// the closing quote, control characters and multi-byte UTF-8) one character
+// at a time.
+PROTOBUF_EXPORT size_t SpanStringChars(JsonScanKernel kernel,
+                                       absl::string_view data);
+
+inline size_t SpanWhitespace(absl::string_view data) {
+  return SpanWhitespace(BestJsonScanKernel(), data);
+}
+
+inline size_t SpanStringChars(absl::string_view data) {
+  return SpanStringChars(BestJsonScanKernel(), data);
+}
+
+}  // namespace json_internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_JSON_INTERNAL_SCANNER_H__
@@ -0,0 +1,101 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/json/internal/scanner.h"
+
+#include <cstddef>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace google {
+namespace protobuf {
+namespace json_internal {
+namespace {
+
+class ScannerTest : public testing::TestWithParam<JsonScanKernel> {
+ protected:
+  void SetUp() override {
+    if (GetParam() > BestJsonScanKernel()) {
+      GTEST_SKIP() << "kernel not supported by this CPU";
+    }
+  }
+};
+
+TEST_P(ScannerTest, Empty) {
+  EXPECT_EQ(SpanWhitespace(GetParam(), ""), 0u);
+  EXPECT_EQ(SpanStringChars(GetParam(), ""), 0u);
+}
+
+TEST_P(ScannerTest, Whitespace) {
+  EXPECT_EQ(SpanWhitespace(GetParam(), " \t\r\n{ "), 4u);
+  EXPECT_EQ(SpanWhitespace(GetParam(), "\"x\""), 0u);
+  // Vertical tabs and form feeds are not JSON whitespace.
+  EXPECT_EQ(SpanWhitespace(GetParam(), "  \v "), 2u);
+  EXPECT_EQ(SpanWhitespace(GetParam(), "  \f "), 2u);
+  const std::string all(100, ' ');
+  EXPECT_EQ(SpanWhitespace(GetParam(), all), all.size());
+}
+
+TEST_P(ScannerTest, StringChars) {
+  EXPECT_EQ(SpanStringChars(GetParam(), "abc\"def"), 3u);
+  EXPECT_EQ(SpanStringChars(GetParam(), "abc'def"), 3u);
+  EXPECT_EQ(SpanStringChars(GetParam(), "abc\\ndef"), 3u);
+  EXPECT_EQ(SpanStringChars(GetParam(), "abc\tdef"), 3u);
+  EXPECT_EQ(SpanStringChars(GetParam(), "abc\x7f\xc3\xa9"), 4u);
+  const std::string all(100, '~');
+  EXPECT_EQ(SpanStringChars(GetParam(), all), all.size());
+}
+
+// Places every byte value at every position of buffers up to a few blocks
+// long, and checks where each span stops.
+TEST_P(ScannerTest, EveryByteAtEveryPosition) {
+  for (size_t size = 1; size <= 100; ++size) {
+    for (size_t pos = 0; pos < size; ++pos) {
+      for (int byte = 0; byte < 256; ++byte) {
+        const char c = static_cast<char>(byte);
+        std::string buf(size, ' ');
+        buf[pos] = c;
+        const bool is_whitespace =
+            c == ' ' || c == '\t' || c == '\r' || c == '\n';
+        EXPECT_EQ(SpanWhitespace(GetParam(), buf), is_whitespace ? size : pos)
+            << "size " << size << " byte " << byte << " at " << pos;
+
+        buf.assign(size, 'a');
+        buf[pos] = c;
+        const bool is_plain = byte >= 0x20 && byte < 0x80 && c != '"' &&
+                              c != '\'' && c != '\\';
+        EXPECT_EQ(SpanStringChars(GetParam(), buf), is_plain ? size : pos)
+            << "size " << size << " byte " << byte << " at " << pos;
+      }
+    }
+  }
+}
+
+// The kernels must not read past the end of the view.
+TEST_P(ScannerTest, StopsAtEndOfView) {
+  const std::string whitespace = absl::StrCat(std::string(70, ' '), "x");
+  const std::string str = absl::StrCat(std::string(70, 'a'), "\"");
+  for (size_t size = 0; size < 70; ++size) {
+    absl::string_view view = absl::string_view(whitespace).substr(0, size);
+    EXPECT_EQ(SpanWhitespace(GetParam(), view), size);
+    view = absl::string_view(str).substr(0, size);
+    EXPECT_EQ(SpanStringChars(GetParam(), view), size);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Kernels, ScannerTest,
+                         testing::Values(JsonScanKernel::kScalar,
+                                         JsonScanKernel::kSse2,
+                                         JsonScanKernel::kAvx2));
+
+}  // namespace
+}  // namespace json_internal
+}  // namespace protobuf
+}  // namespace google
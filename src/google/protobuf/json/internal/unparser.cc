@@ -7,6 +7,7 @@
 
 #include "google/protobuf/json/internal/unparser.h"
 
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
 #include <complex>
@@ -18,7 +19,12 @@
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
+#include "absl/algorithm/container.h"
+#include "absl/base/casts.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
 #include "absl/status/status.h"
@@ -34,9 +40,12 @@
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/json/internal/descriptor_traits.h"
 #include "google/protobuf/json/internal/unparser_traits.h"
+#include "google/protobuf/json/internal/untyped_message.h"
 #include "google/protobuf/json/internal/writer.h"
 #include "google/protobuf/message.h"
 #include "google/protobuf/stubs/status_macros.h"
+#include "google/protobuf/wire_format_lite.h"
+#include "utf8_validity.h"
 
 // Must be included last.
 #include "google/protobuf/port_def.inc"
@@ -45,6 +54,8 @@ namespace google {
 namespace protobuf {
 namespace json_internal {
 namespace {
+using ::google::protobuf::internal::WireFormatLite;
+
 template <typename Traits>
 bool IsEmpty(const Msg<Traits>& msg, const Desc<Traits>& desc) {
   size_t count = Traits::FieldCount(desc);
@@ -274,21 +285,22 @@ absl::Status WriteRepeated(JsonWriter& writer, const Msg<Traits>& msg,
   return absl::OkStatus();
 }
 
-template <typename Traits>
-absl::Status WriteMapKey(JsonWriter& writer, const Msg<Traits>& entry,
-                         Field<Traits> field) {
+// Like WriteSingular(), writes the default key when `args` is empty.
+template <typename Traits, typename... Args>
+absl::Status WriteMapKey(JsonWriter& writer, Field<Traits> field,
+                         Args&&... args) {
   switch (Traits::FieldType(field)) {
     case FieldDescriptor::TYPE_SFIXED64:
     case FieldDescriptor::TYPE_SINT64:
     case FieldDescriptor::TYPE_INT64: {
-      auto x = Traits::GetInt64(field, entry);
+      auto x = Traits::GetInt64(field, std::forward<Args>(args)...);
       RETURN_IF_ERROR(x.status());
       writer.Write(MakeQuoted(*x));
       break;
     }
     case FieldDescriptor::TYPE_FIXED64:
     case FieldDescriptor::TYPE_UINT64: {
-      auto x = Traits::GetUInt64(field, entry);
+      auto x = Traits::GetUInt64(field, std::forward<Args>(args)...);
       RETURN_IF_ERROR(x.status());
       writer.Write(MakeQuoted(*x));
       break;
@@ -296,32 +308,33 @@ absl::Status WriteMapKey(JsonWriter& writer, const Msg<Traits>& entry,
     case FieldDescriptor::TYPE_SFIXED32:
     case FieldDescriptor::TYPE_SINT32:
     case FieldDescriptor::TYPE_INT32: {
-      auto x = Traits::GetInt32(field, entry);
+      auto x = Traits::GetInt32(field, std::forward<Args>(args)...);
       RETURN_IF_ERROR(x.status());
       writer.Write(MakeQuoted(*x));
       break;
     }
     case FieldDescriptor::TYPE_FIXED32:
     case FieldDescriptor::TYPE_UINT32: {
-      auto x = Traits::GetUInt32(field, entry);
+      auto x = Traits::GetUInt32(field, std::forward<Args>(args)...);
       RETURN_IF_ERROR(x.status());
       writer.Write(MakeQuoted(*x));
       break;
     }
     case FieldDescriptor::TYPE_BOOL: {
-      auto x = Traits::GetBool(field, entry);
+      auto x = Traits::GetBool(field, std::forward<Args>(args)...);
       RETURN_IF_ERROR(x.status());
       writer.Write(MakeQuoted(*x ? "true" : "false"));
       break;
     }
     case FieldDescriptor::TYPE_STRING: {
-      auto x = Traits::GetString(field, writer.ScratchBuf(), entry);
+      auto x = Traits::GetString(field, writer.ScratchBuf(),
+                                 std::forward<Args>(args)...);
       RETURN_IF_ERROR(x.status());
       writer.Write(MakeQuoted(*x));
       break;
     }
     case FieldDescriptor::TYPE_ENUM: {
-      auto x = Traits::GetEnumValue(field, entry);
+      auto x = Traits::GetEnumValue(field, std::forward<Args>(args)...);
       RETURN_IF_ERROR(x.status());
       WriteEnum<Traits>(writer, field, *x, IntegerEnumStyle::kQuoted);
       break;
@@ -349,6 +362,50 @@ absl::StatusOr<bool> IsEmptyValue(const Msg<Traits>& msg, Field<Traits> field) {
   return empty;
 }
 
+// Writes one entry of a map, unless its value is an empty
+// google.protobuf.Value. Serializers may omit the key or value of an entry when
+// it has its default value.
+template <typename Traits>
+absl::Status WriteMapEntry(JsonWriter& writer, const Msg<Traits>& entry,
+                           const Desc<Traits>& type, bool& first) {
+  Field<Traits> key_field = Traits::KeyField(type);
+  Field<Traits> value_field = Traits::ValueField(type);
+  bool has_key = Traits::GetSize(key_field, entry) > 0;
+  bool has_value = Traits::GetSize(value_field, entry) > 0;
+
+  bool is_empty = !has_value && ClassifyMessage(Traits::FieldTypeName(
+                                    value_field)) == MessageType::kValue;
+  if (has_value) {
+    auto is_empty_value = IsEmptyValue<Traits>(entry, value_field);
+    RETURN_IF_ERROR(is_empty_value.status());
+    is_empty = *is_empty_value;
+  }
+  if (is_empty) {
+    // Empty google.protobuf.Values are silently discarded.
+    return absl::OkStatus();
+  }
+
+  writer.WriteComma(first);
+  writer.NewLine();
+  RETURN_IF_ERROR(has_key ? WriteMapKey<Traits>(writer, key_field, entry)
+                          : WriteMapKey<Traits>(writer, key_field));
+  writer.Write(":");
+  writer.Whitespace(" ");
+  if (has_value) {
+    return WriteSingular<Traits>(writer, value_field, entry);
+  }
+  if (Traits::FieldType(value_field) != FieldDescriptor::TYPE_MESSAGE) {
+    return WriteSingular<Traits>(writer, value_field);
+  }
+  return Traits::WithFieldType(
+      value_field, [&](const Desc<Traits>& desc) -> absl::Status {
+        return Traits::WithDecodedMessage(
+            desc, "", [&](const Msg<Traits>& value) -> absl::Status {
+              return WriteMessage<Traits>(writer, value, desc);
+            });
+      });
+}
+
 template <typename Traits>
 absl::Status WriteMap(JsonWriter& writer, const Msg<Traits>& msg,
                       Field<Traits> field) {
@@ -361,23 +418,8 @@ absl::Status WriteMap(JsonWriter& writer, const Msg<Traits>& msg,
     absl::StatusOr<const Msg<Traits>*> entry =
         Traits::GetMessage(field, msg, i);
     RETURN_IF_ERROR(entry.status());
-    const Desc<Traits>& type = Traits::GetDesc(**entry);
-
-    auto is_empty = IsEmptyValue<Traits>(**entry, Traits::ValueField(type));
-    RETURN_IF_ERROR(is_empty.status());
-    if (*is_empty) {
-      // Empty google.protobuf.Values are silently discarded.
-      continue;
-    }
-
-    writer.WriteComma(first);
-    writer.NewLine();
-    RETURN_IF_ERROR(
-        WriteMapKey<Traits>(writer, **entry, Traits::KeyField(type)));
-    writer.Write(":");
-    writer.Whitespace(" ");
-    RETURN_IF_ERROR(
-        WriteSingular<Traits>(writer, Traits::ValueField(type), **entry));
+    RETURN_IF_ERROR(WriteMapEntry<Traits>(writer, **entry,
+                                          Traits::GetDesc(**entry), first));
   }
 
   writer.Pop();
@@ -389,25 +431,16 @@ absl::Status WriteMap(JsonWriter& writer, const Msg<Traits>& msg,
 }
 
 template <typename Traits>
-absl::Status WriteField(JsonWriter& writer, const Msg<Traits>& msg,
-                        Field<Traits> field, bool& first) {
-  if (!Traits::IsRepeated(field)) {  // Repeated case is handled in
-                                     // WriteRepeated.
-    auto is_empty = IsEmptyValue<Traits>(msg, field);
-    RETURN_IF_ERROR(is_empty.status());
-    if (*is_empty) {
-      // Empty google.protobuf.Values are silently discarded.
-      return absl::OkStatus();
-    }
-  }
-
-  writer.WriteComma(first);
-  writer.NewLine();
-
+void WriteFieldName(JsonWriter& writer, Field<Traits> field) {
   if (Traits::IsExtension(field)) {
     writer.Write(MakeQuoted("[", Traits::FieldFullName(field), "]"), ":");
   } else if (writer.options().preserve_proto_field_names) {
-    writer.Write(MakeQuoted(Traits::FieldName(field)), ":");
+    absl::string_view quoted = Traits::QuotedFieldName(field);
+    if (!quoted.empty()) {
+      writer.Write(quoted);
+    } else {
+      writer.Write(MakeQuoted(Traits::FieldName(field)), ":");
+    }
   } else {
     // The generator for type.proto and the internals of descriptor.cc disagree
     // on what the json name of a PascalCase field is supposed to be; type.proto
@@ -423,9 +456,32 @@ absl::Status WriteField(JsonWriter& writer, const Msg<Traits>& msg,
                               original_name.substr(1)),
                    ":");
     } else {
-      writer.Write(MakeQuoted(json_name), ":");
+      absl::string_view quoted = Traits::QuotedFieldJsonName(field);
+      if (!quoted.empty()) {
+        writer.Write(quoted);
+      } else {
+        writer.Write(MakeQuoted(json_name), ":");
+      }
+    }
+  }
+}
+
+template <typename Traits>
+absl::Status WriteField(JsonWriter& writer, const Msg<Traits>& msg,
+                        Field<Traits> field, bool& first) {
+  if (!Traits::IsRepeated(field)) {  // Repeated case is handled in
+                                     // WriteRepeated.
+    auto is_empty = IsEmptyValue<Traits>(msg, field);
+    RETURN_IF_ERROR(is_empty.status());
+    if (*is_empty) {
+      // Empty google.protobuf.Values are silently discarded.
+      return absl::OkStatus();
     }
   }
+
+  writer.WriteComma(first);
+  writer.NewLine();
+  WriteFieldName<Traits>(writer, field);
   writer.Whitespace(" ");
 
   if (Traits::IsMap(field)) {
@@ -824,6 +880,675 @@ absl::Status WriteMessage(JsonWriter& writer, const Msg<Traits>& msg,
     }
   }
 }
+
+// Converts wire-format data to JSON as it is read, for BinaryToJsonString() and
+// for BinaryToJsonStream() with WriterOptions::stream_in_wire_order.
+//
+// Parsing the whole input into an UntypedMessage before writing anything
+// needs memory proportional to the input, and delays the first byte of output
+// until the last byte of input has been read. Instead, this writes each field
+// as soon as it has been read, and only buffers values whose JSON form
+// depends on what follows them: map entries (the key may follow the value),
+// well-known types (e.g. an empty google.protobuf.Value is omitted along with
+// its key), and an Any whose value precedes its type URL.
+//
+// Protobuf serializers write fields in field number order, in which case the
+// output is the same as WriteMessage()'s. Otherwise, fields are written in the
+// order in which they appear on the wire, and a field that appears again
+// after other fields is an error, since it cannot be merged into what was
+// already written. When `ordered` is set, any field out of order is an error
+// instead, and sets unordered(), so that the caller can start over with
+// WriteMessage().
+class WireTranscoder {
+ public:
+  WireTranscoder(JsonWriter& writer, io::CodedInputStream& stream,
+                 bool ordered = false)
+      : writer_(writer), stream_(stream), ordered_(ordered) {}
+
+  // Writes a message of type `desc` read from the rest of the stream, up to
+  // its current limit.
+  absl::Status Transcode(const ResolverPool::Message& desc,
+                         bool is_top_level = false);
+
+  bool unordered() const { return unordered_; }
+
+ private:
+  using Traits = UnparseProto3Type;
+  using Field = ResolverPool::Field;
+
+  // Writes the fields of a message of type `desc` into the current JSON
+  // object, up to the stream's current limit or, for a group, the group's
+  // END_GROUP tag.
+  absl::Status TranscodeFields(const ResolverPool::Message& desc, bool& first,
+                               absl::optional<int32_t> group = absl::nullopt);
+
+  // Reads one value of `field` encoded with `wire_type`, and writes it after
+  // calling `prefix`, which writes the value's key or the comma before it.
+  // Values that are omitted from JSON do not call `prefix`.
+  absl::Status TranscodeValue(const Field& field, int wire_type,
+                              absl::FunctionRef<void()> prefix);
+
+  // Like TranscodeValue(), for a map entry.
+  absl::Status TranscodeMapEntry(const Field& field, int wire_type,
+                                 bool& first);
+
+  // Skips the rest of a field that is not written, accepting the same inputs
+  // as UntypedMessage.
+  absl::Status SkipField(int32_t number, int wire_type);
+
+  absl::Status TranscodeAny(const ResolverPool::Message& desc);
+
+  JsonWriter& writer_;
+  io::CodedInputStream& stream_;
+  bool ordered_;
+  bool unordered_ = false;
+  std::string buf_;
+};
+
+PROTOBUF_NOINLINE absl::Status MakeWireTypeError(const ResolverPool::Field& f,
+                                                 int wire_type) {
+  return absl::InvalidArgumentError(absl::StrFormat(
+      "field type %d (number %d) does not support wire type %d",
+      f.proto().kind(), f.proto().number(), wire_type));
+}
+
+PROTOBUF_NOINLINE absl::Status MakeWireEofError() {
+  return absl::InvalidArgumentError("unexpected EOF");
+}
+
+absl::Status WireTranscoder::Transcode(const ResolverPool::Message& desc,
+                                       bool is_top_level) {
+  switch (ClassifyMessage(Traits::TypeName(desc))) {
+    case MessageType::kNotWellKnown: {
+      writer_.Write("{");
+      writer_.Push();
+      bool first = true;
+      RETURN_IF_ERROR(TranscodeFields(desc, first));
+      writer_.Pop();
+      if (!first) {
+        writer_.NewLine();
+      }
+      writer_.Write("}");
+      return absl::OkStatus();
+    }
+    case MessageType::kAny:
+      return TranscodeAny(desc);
+    default: {
+      // The other well-known types are small enough to buffer.
+      auto msg = UntypedMessage::ParseFromStream(&desc, stream_);
+      RETURN_IF_ERROR(msg.status());
+      return WriteMessage<Traits>(writer_, *msg, desc, is_top_level);
+    }
+  }
+}
+
+absl::Status WireTranscoder::TranscodeFields(const ResolverPool::Message& desc,
+                                             bool& first,
+                                             absl::optional<int32_t> group) {
+  // The numbers of the fields written so far, which may not appear again.
+  // Fields normally arrive in increasing order, so a field numbered above
+  // `last` is known to be new without a search.
+  absl::InlinedVector<int32_t, 16> seen;
+  int32_t last = 0;
+  auto was_seen = [&](int32_t number) {
+    return number <= last && absl::c_linear_search(seen, number);
+  };
+  auto mark_seen = [&](int32_t number) {
+    seen.push_back(number);
+    last = std::max(last, number);
+  };
+
+  // The repeated field currently being read, if any. Its array (or object,
+  // for a map) is opened by its first element, so that a field whose only
+  // record is an empty packed run is omitted, like WriteFields() does.
+  const Field* open = nullptr;
+  bool open_is_map = false;
+  bool open_started = false;
+  bool open_first = true;
+  auto write_key = [&](const Field* field) {
+    writer_.WriteComma(first);
+    writer_.NewLine();
+    WriteFieldName<Traits>(writer_, field);
+    writer_.Whitespace(" ");
+  };
+  auto start = [&] {
+    if (open_started) return;
+    open_started = true;
+    write_key(open);
+    writer_.Write(open_is_map ? "{" : "[");
+    writer_.Push();
+  };
+  auto close = [&] {
+    if (open_started) {
+      writer_.Pop();
+      if (!open_first) {
+        writer_.NewLine();
+      }
+      writer_.Write(open_is_map ? "}" : "]");
+    }
+    open = nullptr;
+  };
+
+  // With always_print_fields_with_no_presence, absent fields without presence
+  // are written as defaults, in field number order among the others.
+  std::vector<const Field*> no_presence;
+  size_t next_no_presence = 0;
+  absl::optional<UntypedMessage> empty;
+  if (writer_.options().always_print_fields_with_no_presence) {
+    for (const Field& field : desc.FieldsByIndex()) {
+      if (Traits::IsRepeated(&field) || Traits::IsImplicitPresence(&field)) {
+        no_presence.push_back(&field);
+      }
+    }
+    absl::c_sort(no_presence, [](const Field* a, const Field* b) {
+      return a->proto().number() < b->proto().number();
+    });
+    io::CodedInputStream no_input(nullptr, 0);
+    auto msg = UntypedMessage::ParseFromStream(&desc, no_input);
+    RETURN_IF_ERROR(msg.status());
+    empty.emplace(*std::move(msg));
+  }
+  // Writes the absent fields without presence numbered below `number`.
+  auto write_absent = [&](int32_t number) -> absl::Status {
+    for (; next_no_presence < no_presence.size() &&
+           no_presence[next_no_presence]->proto().number() < number;
+         ++next_no_presence) {
+      const Field* field = no_presence[next_no_presence];
+      if (was_seen(field->proto().number())) continue;
+      mark_seen(field->proto().number());
+      RETURN_IF_ERROR(WriteField<Traits>(writer_, *empty, field, first));
+    }
+    return absl::OkStatus();
+  };
+
+  while (true) {
+    uint32_t tag = stream_.ReadTag();
+    if (tag == 0) {
+      break;
+    }
+    int32_t number = tag >> 3;
+    int wire_type = tag & 7;
+
+    if (wire_type == WireFormatLite::WIRETYPE_END_GROUP) {
+      if (!group.has_value()) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "attempted to close group %d before SGROUP tag", number));
+      }
+      if (number != *group) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("attempted to close group %d while inside group %d",
+                            number, *group));
+      }
+      break;
+    }
+
+    const Field* field = desc.FindField(number);
+    if (field == nullptr) {
+      // Unknown fields are dropped, without closing an open repeated field.
+      RETURN_IF_ERROR(SkipField(number, wire_type));
+      continue;
+    }
+
+    if (field != open) {
+      if (open != nullptr) {
+        close();
+      }
+      if (number <= last && ordered_) {
+        unordered_ = true;
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "field number %d is out of order", number));
+      }
+      if (was_seen(number)) {
+        // Fields without presence may have been written as defaults.
+        if (!Traits::IsRepeated(field) && no_presence.empty()) {
+          return absl::InvalidArgumentError(absl::StrCat(
+              "repeated entries for singular field number ", number));
+        }
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "field number %d cannot be merged with its earlier entries",
+            number));
+      }
+      RETURN_IF_ERROR(write_absent(number));
+      mark_seen(number);
+
+      if (Traits::IsRepeated(field)) {
+        open = field;
+        open_is_map = Traits::IsMap(field);
+        open_started = false;
+        open_first = true;
+      }
+    }
+
+    if (open != nullptr && open_is_map) {
+      start();
+      RETURN_IF_ERROR(TranscodeMapEntry(*field, wire_type, open_first));
+      continue;
+    }
+
+    auto write_comma = [&] {
+      writer_.WriteComma(open_first);
+      writer_.NewLine();
+    };
+    auto write_singular_key = [&] { write_key(field); };
+    absl::FunctionRef<void()> prefix =
+        open != nullptr ? absl::FunctionRef<void()>(write_comma)
+                        : absl::FunctionRef<void()>(write_singular_key);
+
+    auto natural_wire_type = WireFormatLite::WireTypeForFieldType(
+        static_cast<WireFormatLite::FieldType>(field->proto().kind()));
+    if (wire_type != WireFormatLite::WIRETYPE_LENGTH_DELIMITED ||
+        natural_wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED ||
+        natural_wire_type == WireFormatLite::WIRETYPE_START_GROUP) {
+      if (open != nullptr) start();
+      RETURN_IF_ERROR(TranscodeValue(*field, wire_type, prefix));
+      continue;
+    }
+
+    // A packed run of scalars.
+    if (!stream_.IncrementRecursionDepth()) {
+      return absl::InvalidArgumentError("allowed depth exceeded");
+    }
+    auto limit = stream_.ReadLengthAndPushLimit();
+    int count = 0;
+    for (; stream_.BytesUntilLimit() > 0; ++count) {
+      if (open == nullptr && count > 0) {
+        return absl::InvalidArgumentError(absl::StrCat(
+            "repeated entries for singular field number ", number));
+      }
+      if (open != nullptr) start();
+      RETURN_IF_ERROR(TranscodeValue(*field, natural_wire_type, prefix));
+    }
+    stream_.DecrementRecursionDepthAndPopLimit(limit);
+    if (open == nullptr && count == 0) {
+      // An empty run does not set a singular field, which may still appear
+      // later (or be written as a default).
+      seen.pop_back();
+    }
+  }
+
+  if (open != nullptr) {
+    close();
+  }
+  return write_absent(std::numeric_limits<int32_t>::max());
+}
+
+absl::Status WireTranscoder::TranscodeValue(const Field& field, int wire_type,
+                                            absl::FunctionRef<void()> prefix) {
+  using Kind = google::protobuf::Field::Kind;
+  Kind kind = field.proto().kind();
+  if (kind == Kind::Field_Kind_TYPE_MESSAGE ||
+      kind == Kind::Field_Kind_TYPE_GROUP) {
+    auto type = field.MessageType();
+    RETURN_IF_ERROR(type.status());
+
+    if (kind == Kind::Field_Kind_TYPE_GROUP &&
+        wire_type == WireFormatLite::WIRETYPE_START_GROUP) {
+      prefix();
+      writer_.Write("{");
+      writer_.Push();
+      bool first = true;
+      RETURN_IF_ERROR(TranscodeFields(**type, first, field.proto().number()));
+      writer_.Pop();
+      if (!first) {
+        writer_.NewLine();
+      }
+      writer_.Write("}");
+      return absl::OkStatus();
+    }
+    if (kind == Kind::Field_Kind_TYPE_GROUP ||
+        wire_type != WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      return MakeWireTypeError(field, wire_type);
+    }
+
+    if (!stream_.IncrementRecursionDepth()) {
+      return absl::InvalidArgumentError("allowed depth exceeded");
+    }
+    auto limit = stream_.ReadLengthAndPushLimit();
+    MessageType type_class = ClassifyMessage(Traits::TypeName(**type));
+    if (type_class == MessageType::kNotWellKnown ||
+        type_class == MessageType::kAny) {
+      prefix();
+      RETURN_IF_ERROR(Transcode(**type));
+    } else {
+      auto msg = UntypedMessage::ParseFromStream(*type, stream_);
+      RETURN_IF_ERROR(msg.status());
+      // Empty google.protobuf.Values are silently discarded.
+      if (type_class != MessageType::kValue ||
+          !IsEmpty<Traits>(*msg, **type)) {
+        prefix();
+        RETURN_IF_ERROR(WriteMessage<Traits>(writer_, *msg, **type));
+      }
+    }
+    stream_.DecrementRecursionDepthAndPopLimit(limit);
+    return absl::OkStatus();
+  }
+
+  WireFormatLite::WireType expected = WireFormatLite::WireTypeForFieldType(
+      static_cast<WireFormatLite::FieldType>(kind));
+  if (wire_type != expected) {
+    return MakeWireTypeError(field, wire_type);
+  }
+
+  switch (kind) {
+    case Kind::Field_Kind_TYPE_STRING:
+    case Kind::Field_Kind_TYPE_BYTES: {
+      uint32_t size;
+      if (!stream_.ReadVarint32(&size) ||
+          !stream_.ReadString(&buf_, static_cast<int>(size))) {
+        return MakeWireEofError();
+      }
+      if (kind == Kind::Field_Kind_TYPE_BYTES) {
+        prefix();
+        writer_.WriteBase64(buf_);
+        break;
+      }
+      if (field.parent().proto().syntax() == google::protobuf::SYNTAX_PROTO3 &&
+          !utf8_range::IsStructurallyValid(buf_)) {
+        return absl::InvalidArgumentError("proto3 strings must be UTF-8");
+      }
+      prefix();
+      writer_.Write(MakeQuoted(absl::string_view(buf_)));
+      break;
+    }
+    case Kind::Field_Kind_TYPE_BOOL: {
+      // Like UntypedMessage, only accept the canonical encodings.
+      char byte;
+      if (!stream_.ReadRaw(&byte, 1)) {
+        return MakeWireEofError();
+      }
+      if (byte != 0 && byte != 1) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("bad value for bool: \\x%02x", byte));
+      }
+      prefix();
+      writer_.Write(byte != 0 ? "true" : "false");
+      break;
+    }
+    case Kind::Field_Kind_TYPE_INT32:
+    case Kind::Field_Kind_TYPE_SINT32:
+    case Kind::Field_Kind_TYPE_UINT32:
+    case Kind::Field_Kind_TYPE_ENUM: {
+      uint32_t x;
+      if (!stream_.ReadVarint32(&x)) {
+        return MakeWireEofError();
+      }
+      prefix();
+      if (kind == Kind::Field_Kind_TYPE_UINT32) {
+        writer_.Write(x);
+      } else if (kind == Kind::Field_Kind_TYPE_ENUM) {
+        WriteEnum<Traits>(writer_, &field, static_cast<int32_t>(x));
+      } else if (kind == Kind::Field_Kind_TYPE_SINT32) {
+        writer_.Write(WireFormatLite::ZigZagDecode32(x));
+      } else {
+        writer_.Write(static_cast<int32_t>(x));
+      }
+      break;
+    }
+    case Kind::Field_Kind_TYPE_SFIXED32: {
+      uint32_t x;
+      if (!stream_.ReadLittleEndian32(&x)) {
+        return MakeWireEofError();
+      }
+      prefix();
+      writer_.Write(static_cast<int32_t>(x));
+      break;
+    }
+    case Kind::Field_Kind_TYPE_FIXED32: {
+      uint32_t x;
+      if (!stream_.ReadLittleEndian32(&x)) {
+        return MakeWireEofError();
+      }
+      prefix();
+      writer_.Write(x);
+      break;
+    }
+    case Kind::Field_Kind_TYPE_FLOAT: {
+      uint32_t x;
+      if (!stream_.ReadLittleEndian32(&x)) {
+        return MakeWireEofError();
+      }
+      prefix();
+      writer_.Write(absl::bit_cast<float>(x));
+      break;
+    }
+    case Kind::Field_Kind_TYPE_DOUBLE: {
+      uint64_t x;
+      if (!stream_.ReadLittleEndian64(&x)) {
+        return MakeWireEofError();
+      }
+      prefix();
+      writer_.Write(absl::bit_cast<double>(x));
+      break;
+    }
+    case Kind::Field_Kind_TYPE_INT64:
+    case Kind::Field_Kind_TYPE_SINT64:
+    case Kind::Field_Kind_TYPE_SFIXED64: {
+      uint64_t x;
+      bool ok = kind == Kind::Field_Kind_TYPE_SFIXED64
+                    ? stream_.ReadLittleEndian64(&x)
+                    : stream_.ReadVarint64(&x);
+      if (!ok) {
+        return MakeWireEofError();
+      }
+      int64_t value = kind == Kind::Field_Kind_TYPE_SINT64
+                          ? WireFormatLite::ZigZagDecode64(x)
+                          : static_cast<int64_t>(x);
+      prefix();
+      if (writer_.options().unquote_int64_if_possible &&
+          RoundTripsThroughDouble(value)) {
+        writer_.Write(value);
+      } else {
+        writer_.Write(MakeQuoted(value));
+      }
+      break;
+    }
+    case Kind::Field_Kind_TYPE_UINT64:
+    case Kind::Field_Kind_TYPE_FIXED64: {
+      uint64_t x;
+      bool ok = kind == Kind::Field_Kind_TYPE_FIXED64
+                    ? stream_.ReadLittleEndian64(&x)
+                    : stream_.ReadVarint64(&x);
+      if (!ok) {
+        return MakeWireEofError();
+      }
+      prefix();
+      if (writer_.options().unquote_int64_if_possible &&
+          RoundTripsThroughDouble(x)) {
+        writer_.Write(x);
+      } else {
+        writer_.Write(MakeQuoted(x));
+      }
+      break;
+    }
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("unsupported field type: ", kind));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status WireTranscoder::TranscodeMapEntry(const Field& field,
+                                               int wire_type, bool& first) {
+  if (wire_type != WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+    return MakeWireTypeError(field, wire_type);
+  }
+  auto type = field.MessageType();
+  RETURN_IF_ERROR(type.status());
+
+  if (!stream_.IncrementRecursionDepth()) {
+    return absl::InvalidArgumentError("allowed depth exceeded");
+  }
+  auto limit = stream_.ReadLengthAndPushLimit();
+  auto entry = UntypedMessage::ParseFromStream(*type, stream_);
+  RETURN_IF_ERROR(entry.status());
+  stream_.DecrementRecursionDepthAndPopLimit(limit);
+
+  return WriteMapEntry<Traits>(writer_, *entry, **type, first);
+}
+
+absl::Status WireTranscoder::SkipField(int32_t number, int wire_type) {
+  // The groups being skipped, innermost last.
+  std::vector<int32_t> groups;
+  while (true) {
+    switch (wire_type) {
+      case WireFormatLite::WIRETYPE_VARINT: {
+        uint64_t x;
+        if (!stream_.ReadVarint64(&x)) {
+          return MakeWireEofError();
+        }
+        break;
+      }
+      case WireFormatLite::WIRETYPE_FIXED64: {
+        uint64_t x;
+        if (!stream_.ReadLittleEndian64(&x)) {
+          return MakeWireEofError();
+        }
+        break;
+      }
+      case WireFormatLite::WIRETYPE_FIXED32: {
+        uint32_t x;
+        if (!stream_.ReadLittleEndian32(&x)) {
+          return MakeWireEofError();
+        }
+        break;
+      }
+      case WireFormatLite::WIRETYPE_LENGTH_DELIMITED: {
+        uint32_t x;
+        if (!stream_.ReadVarint32(&x)) {
+          return MakeWireEofError();
+        }
+        stream_.Skip(x);
+        break;
+      }
+      case WireFormatLite::WIRETYPE_START_GROUP:
+        groups.push_back(number);
+        break;
+      case WireFormatLite::WIRETYPE_END_GROUP:
+        if (groups.empty()) {
+          return absl::InvalidArgumentError(absl::StrFormat(
+              "attempted to close group %d before SGROUP tag", number));
+        }
+        if (number != groups.back()) {
+          return absl::InvalidArgumentError(absl::StrFormat(
+              "attempted to close group %d while inside group %d", number,
+              groups.back()));
+        }
+        groups.pop_back();
+        break;
+      default:
+        return absl::InvalidArgumentError(
+            absl::StrCat("unknown wire type: ", wire_type));
+    }
+    if (groups.empty()) {
+      return absl::OkStatus();
+    }
+
+    uint32_t tag = stream_.ReadTag();
+    if (tag == 0) {
+      // Like UntypedMessage, accept a group that is cut off by the end of the
+      // message.
+      return absl::OkStatus();
+    }
+    number = WireFormatLite::GetTagFieldNumber(tag);
+    wire_type = WireFormatLite::GetTagWireType(tag);
+  }
+}
+
+absl::Status WireTranscoder::TranscodeAny(const ResolverPool::Message& desc) {
+  // The type URL is needed before anything else can be written. If it is not
+  // the first field, buffer the whole Any.
+  constexpr uint8_t kTypeUrlTag =
+      WireFormatLite::MakeTag(1, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  const void* data;
+  int size;
+  if (!stream_.GetDirectBufferPointer(&data, &size) ||
+      *static_cast<const uint8_t*>(data) != kTypeUrlTag) {
+    auto msg = UntypedMessage::ParseFromStream(&desc, stream_);
+    RETURN_IF_ERROR(msg.status());
+    return WriteMessage<Traits>(writer_, *msg, desc);
+  }
+
+  std::string type_url;
+  uint32_t url_size;
+  stream_.Skip(1);
+  if (!stream_.ReadVarint32(&url_size) ||
+      !stream_.ReadString(&type_url, static_cast<int>(url_size))) {
+    return MakeWireEofError();
+  }
+  auto any_desc = desc.pool()->FindMessage(type_url);
+  RETURN_IF_ERROR(any_desc.status());
+
+  writer_.Write("{");
+  writer_.Push();
+  writer_.NewLine();
+  writer_.Write("\"@type\":");
+  writer_.Whitespace(" ");
+  writer_.Write(MakeQuoted(absl::string_view(type_url)));
+
+  bool first = false;
+  // Writes the value read from `stream`, up to its current limit.
+  auto write_value = [&](io::CodedInputStream& stream) -> absl::Status {
+    if (ClassifyMessage(Traits::TypeName(**any_desc)) ==
+        MessageType::kNotWellKnown) {
+      WireTranscoder value(writer_, stream, ordered_);
+      absl::Status s = value.TranscodeFields(**any_desc, first);
+      unordered_ |= value.unordered();
+      return s;
+    }
+    auto msg = UntypedMessage::ParseFromStream(*any_desc, stream);
+    RETURN_IF_ERROR(msg.status());
+    if (ClassifyMessage(Traits::TypeName(**any_desc)) == MessageType::kValue &&
+        IsEmpty<Traits>(*msg, **any_desc)) {
+      return absl::InvalidArgumentError(
+          "google.protobuf.Value in Any has no value");
+    }
+    writer_.WriteComma(first);
+    writer_.NewLine();
+    writer_.Write("\"value\":");
+    writer_.Whitespace(" ");
+    return WriteMessage<Traits>(writer_, *msg, **any_desc);
+  };
+
+  bool has_value = false;
+  while (uint32_t tag = stream_.ReadTag()) {
+    int32_t number = WireFormatLite::GetTagFieldNumber(tag);
+    int wire_type = WireFormatLite::GetTagWireType(tag);
+    if (number != 1 && number != 2) {
+      RETURN_IF_ERROR(SkipField(number, wire_type));
+      continue;
+    }
+    if (wire_type != WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      return MakeWireTypeError(*desc.FindField(number), wire_type);
+    }
+    if (number == 1 || has_value) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("repeated entries for singular field number ", number));
+    }
+    has_value = true;
+
+    if (!stream_.IncrementRecursionDepth()) {
+      return absl::InvalidArgumentError("allowed depth exceeded");
+    }
+    auto limit = stream_.ReadLengthAndPushLimit();
+    RETURN_IF_ERROR(write_value(stream_));
+    stream_.DecrementRecursionDepthAndPopLimit(limit);
+  }
+
+  if (!has_value) {
+    if (!writer_.options().allow_legacy_syntax) {
+      return absl::InvalidArgumentError("broken Any: missing value");
+    }
+    io::CodedInputStream no_input(nullptr, 0);
+    RETURN_IF_ERROR(write_value(no_input));
+  }
+
+  writer_.Pop();
+  if (!first) {
+    writer_.NewLine();
+  }
+  writer_.Write("}");
+  return absl::OkStatus();
+}
 }  // namespace
 
 absl::Status MessageToJsonString(const Message& message, std::string* output,
@@ -850,6 +1575,25 @@ absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
                                 io::ZeroCopyInputStream* binary_input,
                                 io::ZeroCopyOutputStream* json_output,
                                 json_internal::WriterOptions options) {
+  if (!options.stream_in_wire_order) {
+    // Fields that are out of order or split up can appear anywhere in the
+    // input, so nothing can be written before all of it has been read. Read it
+    // into memory and use the same ordered transcoding, with the same fallback,
+    // as BinaryToJsonString(), so that both produce the same output.
+    std::string input;
+    const void* data;
+    int len;
+    while (binary_input->Next(&data, &len)) {
+      input.append(static_cast<const char*>(data), static_cast<size_t>(len));
+    }
+    std::string output;
+    RETURN_IF_ERROR(
+        BinaryToJsonString(resolver, type_url, input, &output, options));
+    io::zc_sink_internal::ZeroCopyStreamByteSink(json_output)
+        .Append(output.data(), output.size());
+    return absl::OkStatus();
+  }
+
   // NOTE: Most of the contortions in this function are to allow for capture of
   // input and output of the parser in ABSL_DLOG mode. Destruction order is very
   // critical in this function, because io::ZeroCopy*Stream types usually only
@@ -881,14 +1625,10 @@ absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
 
   io::CodedInputStream stream(tee_input.has_value() ? &*tee_input
                                                     : binary_input);
-  auto msg = UntypedMessage::ParseFromStream(*desc, stream);
-  RETURN_IF_ERROR(msg.status());
-
   JsonWriter writer(tee_output.has_value() ? &*tee_output : json_output,
                     options);
-  absl::Status s = WriteMessage<UnparseProto3Type>(
-      writer, *msg, UnparseProto3Type::GetDesc(*msg),
-      /*is_top_level=*/true);
+  absl::Status s =
+      WireTranscoder(writer, stream).Transcode(**desc, /*is_top_level=*/true);
   if (PROTOBUF_DEBUG) ABSL_DLOG(INFO) << "json2/status: " << s;
   RETURN_IF_ERROR(s);
 
@@ -902,6 +1642,64 @@ absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
   writer.NewLine();
   return absl::OkStatus();
 }
+
+absl::Status BinaryToJsonString(google::protobuf::util::TypeResolver* resolver,
+                                const std::string& type_url,
+                                absl::string_view binary_input,
+                                std::string* json_output,
+                                json_internal::WriterOptions options) {
+  if (PROTOBUF_DEBUG) {
+    ABSL_DLOG(INFO) << "json2/input: " << absl::BytesToHexString(binary_input);
+  }
+  ResolverPool pool(resolver);
+  auto desc = pool.FindMessage(type_url);
+  RETURN_IF_ERROR(desc.status());
+
+  // Fields are almost always in field number order, so try transcoding
+  // directly first, and only parse the input into an UntypedMessage, which
+  // sorts and merges fields, if they turn out not to be.
+  const size_t initial_size = json_output->size();
+  absl::Status s;
+  bool unordered;
+  {
+    io::ArrayInputStream in(binary_input.data(),
+                            static_cast<int>(binary_input.size()));
+    io::CodedInputStream stream(&in);
+    io::StringOutputStream out(json_output);
+    JsonWriter writer(&out, options);
+    WireTranscoder transcoder(writer, stream, /*ordered=*/true);
+    s = transcoder.Transcode(**desc, /*is_top_level=*/true);
+    unordered = transcoder.unordered();
+    if (s.ok()) writer.NewLine();
+  }
+
+  if (unordered) {
+    json_output->resize(initial_size);
+    io::ArrayInputStream in(binary_input.data(),
+                            static_cast<int>(binary_input.size()));
+    io::CodedInputStream stream(&in);
+    auto msg = UntypedMessage::ParseFromStream(*desc, stream);
+    RETURN_IF_ERROR(msg.status());
+
+    io::StringOutputStream out(json_output);
+    JsonWriter writer(&out, options);
+    s = WriteMessage<UnparseProto3Type>(writer, *msg, **desc,
+                                        /*is_top_level=*/true);
+    if (s.ok()) writer.NewLine();
+  }
+  if (PROTOBUF_DEBUG) ABSL_DLOG(INFO) << "json2/status: " << s;
+  if (!s.ok()) {
+    json_output->resize(initial_size);
+    return s;
+  }
+
+  if (PROTOBUF_DEBUG) {
+    absl::string_view out = *json_output;
+    ABSL_DLOG(INFO) << "json2/output: "
+                    << absl::CHexEscape(out.substr(initial_size));
+  }
+  return absl::OkStatus();
+}
 }  // namespace json_internal
 }  // namespace protobuf
 }  // namespace google
@@ -29,6 +29,13 @@ absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
                                 io::ZeroCopyInputStream* binary_input,
                                 io::ZeroCopyOutputStream* json_output,
                                 json_internal::WriterOptions options);
+// Internal version of google::protobuf::util::BinaryToJsonString; see json_util.h for
+// details.
+absl::Status BinaryToJsonString(google::protobuf::util::TypeResolver* resolver,
+                                const std::string& type_url,
+                                absl::string_view binary_input,
+                                std::string* json_output,
+                                json_internal::WriterOptions options);
 }  // namespace json_internal
 }  // namespace protobuf
 }  // namespace google
@@ -7,6 +7,7 @@
 
 #include "google/protobuf/json/internal/writer.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <initializer_list>
 #include <limits>
@@ -14,6 +15,8 @@
 
 #include "absl/algorithm/container.h"
 #include "absl/log/absl_check.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/json/internal/base64.h"
 
 // Must be included last.
 #include "google/protobuf/port_def.inc"
@@ -38,48 +41,18 @@ bool JsonWriter::MaybeWriteSpecialFp(double val) {
 }
 
 void JsonWriter::WriteBase64(absl::string_view str) {
-  // This is the regular base64, not the "web-safe" version.
-  constexpr absl::string_view kBase64 =
-      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-  const char* ptr = str.data();
-  const char* end = ptr + str.size();
-
-  // Reads the `n`th character off of `ptr` while gracefully avoiding
-  // sign extension due to implicit conversions
-  auto read = [&](size_t n) {
-    return static_cast<size_t>(static_cast<uint8_t>(ptr[n]));
-  };
-
-  char buf[4];
-  absl::string_view view(buf, sizeof(buf));
+  // This is the regular base64, not the "web-safe" version. The input is
+  // encoded in chunks of a multiple of 3 bytes, so that only the last one
+  // needs padding.
+  constexpr size_t kChunk = 3 * 256;
+  char buf[Base64EncodedSize(kChunk)];
   Write("\"");
-
-  while (end - ptr >= 3) {
-    buf[0] = kBase64[read(0) >> 2];
-    buf[1] = kBase64[((read(0) & 0x3) << 4) | (read(1) >> 4)];
-    buf[2] = kBase64[((read(1) & 0xf) << 2) | (read(2) >> 6)];
-    buf[3] = kBase64[read(2) & 0x3f];
-    Write(view);
-    ptr += 3;
-  }
-
-  switch (end - ptr) {
-    case 2:
-      buf[0] = kBase64[read(0) >> 2];
-      buf[1] = kBase64[((read(0) & 0x3) << 4) | (read(1) >> 4)];
-      buf[2] = kBase64[(read(1) & 0xf) << 2];
-      buf[3] = '=';
-      Write(view);
-      break;
-    case 1:
-      buf[0] = kBase64[read(0) >> 2];
-      buf[1] = kBase64[((read(0) & 0x3) << 4)];
-      buf[2] = '=';
-      buf[3] = '=';
-      Write(view);
-      break;
+  while (!str.empty()) {
+    absl::string_view chunk = str.substr(0, kChunk);
+    EncodeBase64(Base64Alphabet::kStandard, chunk, buf);
+    Write(absl::string_view(buf, Base64EncodedSize(chunk.size())));
+    str.remove_prefix(chunk.size());
   }
-
   Write("\"");
 }
 
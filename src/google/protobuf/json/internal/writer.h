@@ -49,6 +49,9 @@ struct WriterOptions {
   // If set, int64 values that can be represented exactly as a double are
   // printed without quotes.
   bool unquote_int64_if_possible = false;
+  // Whether BinaryToJsonStream() writes fields in the order in which they are
+  // read, instead of reading all of the input first.
+  bool stream_in_wire_order = false;
   // The original parser used by json_util2 accepted a number of non-standard
   // options. Setting this flag enables them.
   //
@@ -105,17 +108,19 @@ class JsonWriter {
 
   void Write(char c) { sink_.Append(&c, 1); }
 
-  // The precision on this and the following function are completely made-up,
-  // in an attempt to match the behavior of the ESF parser.
+  // Floating-point values are written with the fewest digits that parse back
+  // to the same value.
   void Write(double val) {
     if (!MaybeWriteSpecialFp(val)) {
-      Write(io::SimpleDtoa(val));
+      char buf[io::kShortestToBufferSize];
+      Write(io::ShortestDtoa(val, buf));
     }
   }
 
   void Write(float val) {
     if (!MaybeWriteSpecialFp(val)) {
-      Write(io::SimpleFtoa(val));
+      char buf[io::kShortestToBufferSize];
+      Write(io::ShortestFtoa(val, buf));
     }
   }
 
@@ -135,6 +135,20 @@ class ZeroCopyBufferedStream {
   explicit ZeroCopyBufferedStream(io::ZeroCopyInputStream* stream)
       : stream_(stream) {}
 
+  // Starts reading from `stream`, discarding whatever is left of the previous
+  // one but keeping the buffer's capacity. Nothing may still be borrowing
+  // from the buffer.
+  void Reset(io::ZeroCopyInputStream* stream) {
+    ABSL_DCHECK_EQ(outstanding_buffer_borrows_, 0);
+    stream_ = stream;
+    last_chunk_ = absl::string_view();
+    buf_.clear();
+    using_buf_ = false;
+    cursor_ = 0;
+    buffer_start_ = 0;
+    eof_ = false;
+  }
+
   // Returns whether the stream is currently at eof.
   //
   // This function will buffer at least one character to verify whether it
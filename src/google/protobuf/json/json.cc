@@ -24,11 +24,9 @@ namespace google {
 namespace protobuf {
 namespace json {
 
-absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
-                                const std::string& type_url,
-                                io::ZeroCopyInputStream* binary_input,
-                                io::ZeroCopyOutputStream* json_output,
-                                const PrintOptions& options) {
+namespace {
+google::protobuf::json_internal::WriterOptions ToWriterOptions(
+    const PrintOptions& options) {
   google::protobuf::json_internal::WriterOptions opts;
   opts.add_whitespace = options.add_whitespace;
   opts.preserve_proto_field_names = options.preserve_proto_field_names;
@@ -36,12 +34,21 @@ absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
   opts.always_print_fields_with_no_presence =
       options.always_print_fields_with_no_presence;
   opts.unquote_int64_if_possible = options.unquote_int64_if_possible;
+  opts.stream_in_wire_order = options.stream_in_wire_order;
 
   // TODO: Drop this setting.
   opts.allow_legacy_syntax = true;
+  return opts;
+}
+}  // namespace
 
+absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
+                                const std::string& type_url,
+                                io::ZeroCopyInputStream* binary_input,
+                                io::ZeroCopyOutputStream* json_output,
+                                const PrintOptions& options) {
   return google::protobuf::json_internal::BinaryToJsonStream(
-      resolver, type_url, binary_input, json_output, opts);
+      resolver, type_url, binary_input, json_output, ToWriterOptions(options));
 }
 
 absl::Status BinaryToJsonString(google::protobuf::util::TypeResolver* resolver,
@@ -49,10 +56,8 @@ absl::Status BinaryToJsonString(google::protobuf::util::TypeResolver* resolver,
                                 const std::string& binary_input,
                                 std::string* json_output,
                                 const PrintOptions& options) {
-  io::ArrayInputStream input_stream(binary_input.data(), binary_input.size());
-  io::StringOutputStream output_stream(json_output);
-  return BinaryToJsonStream(resolver, type_url, &input_stream, &output_stream,
-                            options);
+  return google::protobuf::json_internal::BinaryToJsonString(
+      resolver, type_url, binary_input, json_output, ToWriterOptions(options));
 }
 
 absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
@@ -84,18 +89,8 @@ absl::Status JsonToBinaryString(google::protobuf::util::TypeResolver* resolver,
 
 absl::Status MessageToJsonString(const Message& message, std::string* output,
                                  const PrintOptions& options) {
-  google::protobuf::json_internal::WriterOptions opts;
-  opts.add_whitespace = options.add_whitespace;
-  opts.preserve_proto_field_names = options.preserve_proto_field_names;
-  opts.always_print_enums_as_ints = options.always_print_enums_as_ints;
-  opts.always_print_fields_with_no_presence =
-      options.always_print_fields_with_no_presence;
-  opts.unquote_int64_if_possible = options.unquote_int64_if_possible;
-
-  // TODO: Drop this setting.
-  opts.allow_legacy_syntax = true;
-
-  return google::protobuf::json_internal::MessageToJsonString(message, output, opts);
+  return google::protobuf::json_internal::MessageToJsonString(message, output,
+                                                    ToWriterOptions(options));
 }
 
 absl::Status JsonStringToMessage(absl::string_view input, Message* message,
@@ -52,6 +52,10 @@ struct PrintOptions {
   // If set, int64 values that can be represented exactly as a double are
   // printed without quotes.
   bool unquote_int64_if_possible = false;
+  // If set, BinaryToJsonStream() writes each field as soon as it has been read
+  // instead of reading all of the input first. See BinaryToJsonStream() for
+  // the restrictions this puts on the input. Ignored by other functions.
+  bool stream_in_wire_order = false;
 };
 
 // Converts from protobuf message to JSON and appends it to |output|. This is a
@@ -105,6 +109,17 @@ inline absl::Status JsonStreamToMessage(io::ZeroCopyInputStream* input,
 //      information returned by TypeResolver.
 // Note that unknown fields will be discarded silently.
 //
+// By default, the output is the same as BinaryToJsonString()'s, and nothing
+// is written to |json_output| before all of |binary_input| has been read.
+//
+// With |options.stream_in_wire_order|, the input is instead transcoded as it is
+// read: memory use no longer grows with the size of the input, but fields are
+// written in the order in which they appear on the wire, and output may already
+// have been written to |json_output| when an error is returned. A repeated or
+// message field whose entries are interleaved with other fields (as happens
+// when concatenating two serialized messages) cannot be converted this way and
+// results in an error.
+//
 // Please note that non-OK statuses are not a stable output of this API and
 // subject to change without notice.
 PROTOBUF_EXPORT absl::Status BinaryToJsonStream(
@@ -0,0 +1,297 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/json/json_lines.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/json/internal/lexer.h"
+#include "google/protobuf/json/internal/parser.h"
+#include "google/protobuf/json/json.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/stubs/status_macros.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace json {
+namespace {
+json_internal::ParseOptions ToInternalOptions(const ParseOptions& options) {
+  json_internal::ParseOptions opts;
+  opts.ignore_unknown_fields = options.ignore_unknown_fields;
+  opts.case_insensitive_enum_parsing = options.case_insensitive_enum_parsing;
+
+  // Matches JsonStringToMessage().
+  opts.allow_legacy_syntax = true;
+  return opts;
+}
+
+bool IsBlank(absl::string_view line) {
+  return line.find_first_not_of(" \t\r") == absl::string_view::npos;
+}
+
+// Calls `fn(begin, end)` on up to `num_threads` contiguous ranges that
+// together cover [0, n). All but the first range run on threads of their own.
+void ParallelFor(size_t n, int num_threads,
+                 absl::FunctionRef<void(size_t, size_t)> fn) {
+  size_t shards = std::min(n, static_cast<size_t>(std::max(num_threads, 1)));
+  if (shards <= 1) {
+    fn(0, n);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  threads.reserve(shards - 1);
+  for (size_t i = 1; i < shards; ++i) {
+    threads.emplace_back([&fn, i, n, shards] {
+      fn(n * i / shards, n * (i + 1) / shards);
+    });
+  }
+  fn(0, n / shards);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+}  // namespace
+
+JsonLinesReader::JsonLinesReader(io::ZeroCopyInputStream* input,
+                                 const ParseOptions& options)
+    : input_(input),
+      options_(options),
+      parser_(std::make_unique<json_internal::JsonMessageParser>(
+          ToInternalOptions(options))) {}
+
+JsonLinesReader::~JsonLinesReader() {
+  // Leave the stream positioned just past the last line we consumed.
+  if (!chunk_.empty()) {
+    input_->BackUp(static_cast<int>(chunk_.size()));
+  }
+}
+
+bool JsonLinesReader::NextLine(absl::string_view* line) {
+  if (clear_carry_) {
+    carry_.clear();
+    clear_carry_ = false;
+  }
+
+  while (true) {
+    size_t newline = chunk_.find('\n');
+    if (newline != absl::string_view::npos) {
+      if (carry_.empty()) {
+        *line = chunk_.substr(0, newline);
+      } else {
+        carry_.append(chunk_.data(), newline);
+        *line = carry_;
+        clear_carry_ = true;
+      }
+      chunk_.remove_prefix(newline + 1);
+      ++line_count_;
+      offset_ += static_cast<int64_t>(line->size()) + 1;
+      return true;
+    }
+
+    carry_.append(chunk_.data(), chunk_.size());
+    chunk_ = absl::string_view();
+
+    const void* data;
+    int size;
+    if (!input_->Next(&data, &size)) {
+      // The last line need not end in a newline.
+      if (carry_.empty()) {
+        return false;
+      }
+      *line = carry_;
+      clear_carry_ = true;
+      ++line_count_;
+      offset_ += static_cast<int64_t>(line->size());
+      return true;
+    }
+    chunk_ = absl::string_view(static_cast<const char*>(data),
+                               static_cast<size_t>(size));
+  }
+}
+
+absl::Status JsonLinesReader::ParseLine(
+    json_internal::JsonMessageParser& parser, absl::string_view line,
+    int64_t line_number, int64_t offset, Message* message) {
+  json_internal::JsonLocation start;
+  start.offset = static_cast<size_t>(offset);
+  start.line = static_cast<size_t>(line_number);
+
+  io::ArrayInputStream input(line.data(), static_cast<int>(line.size()));
+  return parser.Parse(&input, message, start);
+}
+
+absl::StatusOr<bool> JsonLinesReader::Read(Message* message) {
+  absl::string_view line;
+  int64_t line_number;
+  int64_t offset;
+  do {
+    line_number = line_count_;
+    offset = offset_;
+    if (!NextLine(&line)) {
+      return false;
+    }
+  } while (IsBlank(line));
+
+  message->Clear();
+  RETURN_IF_ERROR(ParseLine(*parser_, line, line_number, offset, message));
+  return true;
+}
+
+absl::Status JsonLinesReader::ReadAll(
+    const Message& prototype, Arena* arena, int num_threads,
+    absl::FunctionRef<absl::Status(Message&)> callback, size_t batch_bytes) {
+  struct Line {
+    size_t start;
+    size_t size;
+    int64_t number;
+    int64_t offset;
+  };
+  std::vector<Line> lines;
+  std::vector<absl::Status> statuses;
+  std::vector<std::unique_ptr<Message>> owned;
+  std::vector<Message*> messages;
+
+  bool more = true;
+  while (more) {
+    // Lines are copied into `batch_`, since the stream's buffers do not
+    // outlive the next call to NextLine().
+    batch_.clear();
+    lines.clear();
+    while (batch_.size() < batch_bytes) {
+      int64_t number = line_count_;
+      int64_t offset = offset_;
+      absl::string_view line;
+      if (!NextLine(&line)) {
+        more = false;
+        break;
+      }
+      if (IsBlank(line)) continue;
+      lines.push_back({batch_.size(), line.size(), number, offset});
+      batch_.append(line.data(), line.size());
+    }
+
+    while (messages.size() < lines.size()) {
+      Message* message = prototype.New(arena);
+      if (arena == nullptr) {
+        owned.emplace_back(message);
+      }
+      messages.push_back(message);
+    }
+
+    statuses.assign(lines.size(), absl::OkStatus());
+    ParallelFor(lines.size(), num_threads, [&](size_t begin, size_t end) {
+      // Each range after the first runs on a thread of its own, so it needs
+      // a parser of its own; that setup is paid once per range, not per line.
+      std::unique_ptr<json_internal::JsonMessageParser> local;
+      json_internal::JsonMessageParser* parser = parser_.get();
+      if (begin != 0) {
+        local = std::make_unique<json_internal::JsonMessageParser>(
+            ToInternalOptions(options_));
+        parser = local.get();
+      }
+      for (size_t i = begin; i < end; ++i) {
+        const Line& line = lines[i];
+        messages[i]->Clear();
+        statuses[i] = ParseLine(
+            *parser, absl::string_view(batch_).substr(line.start, line.size),
+            line.number, line.offset, messages[i]);
+        if (!statuses[i].ok()) break;
+      }
+    });
+
+    // A range stops at its first error, leaving later messages in it
+    // unparsed; this loop returns before reaching them.
+    for (size_t i = 0; i < lines.size(); ++i) {
+      RETURN_IF_ERROR(statuses[i]);
+      RETURN_IF_ERROR(callback(*messages[i]));
+    }
+  }
+  return absl::OkStatus();
+}
+
+JsonLinesWriter::JsonLinesWriter(io::ZeroCopyOutputStream* output,
+                                 const PrintOptions& options)
+    : sink_(output), options_(options) {
+  options_.add_whitespace = false;
+}
+
+absl::Status JsonLinesWriter::Emit(absl::string_view lines) {
+  sink_.Append(lines.data(), lines.size());
+  if (sink_.failed()) {
+    return absl::InternalError("failed to write to the output stream");
+  }
+  return absl::OkStatus();
+}
+
+absl::Status JsonLinesWriter::Write(const Message& message) {
+  buffer_.clear();
+  RETURN_IF_ERROR(MessageToJsonString(message, &buffer_, options_));
+  buffer_.push_back('\n');
+  return Emit(buffer_);
+}
+
+absl::Status JsonLinesWriter::WriteAll(
+    absl::Span<const Message* const> messages, int num_threads) {
+  if (num_threads <= 1 || messages.size() <= 1) {
+    for (const Message* message : messages) {
+      RETURN_IF_ERROR(Write(*message));
+    }
+    return absl::OkStatus();
+  }
+
+  size_t shards = std::min(messages.size(), static_cast<size_t>(num_threads));
+  thread_buffers_.resize(shards);
+  std::vector<absl::Status> statuses(shards);
+  ParallelFor(shards, num_threads, [&](size_t begin, size_t end) {
+    for (size_t shard = begin; shard < end; ++shard) {
+      std::string& out = thread_buffers_[shard];
+      out.clear();
+      size_t first = messages.size() * shard / shards;
+      size_t last = messages.size() * (shard + 1) / shards;
+      for (size_t i = first; i < last; ++i) {
+        size_t size = out.size();
+        statuses[shard] = MessageToJsonString(*messages[i], &out, options_);
+        if (!statuses[shard].ok()) {
+          // Drop the partial line, but keep the records before it.
+          out.resize(size);
+          break;
+        }
+        out.push_back('\n');
+      }
+    }
+  });
+
+  for (size_t shard = 0; shard < shards; ++shard) {
+    RETURN_IF_ERROR(Emit(thread_buffers_[shard]));
+    RETURN_IF_ERROR(statuses[shard]);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace json
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
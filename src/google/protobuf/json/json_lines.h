@@ -0,0 +1,156 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Readers and writers for newline-delimited JSON ("JSON lines" or NDJSON),
+// where each line of a stream holds one message in proto3 JSON format.
+#ifndef GOOGLE_PROTOBUF_JSON_JSON_LINES_H__
+#define GOOGLE_PROTOBUF_JSON_JSON_LINES_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/io/zero_copy_sink.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/json/json.h"
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace json_internal {
+class JsonMessageParser;
+}  // namespace json_internal
+
+namespace json {
+
+// Parses a stream of JSON lines, one message per line. Lines that are empty or
+// contain only whitespace are skipped. Errors report the line number within
+// the whole stream.
+//
+// Parsing many records through one reader avoids the per-call setup of
+// JsonStringToMessage(): one lexer and error path are kept for all records,
+// lines are parsed directly out of the stream's buffers when they do not
+// straddle two of them, and the scratch buffers and messages used by
+// ReadAll() are recycled from one batch to the next.
+//
+// Example:
+//   io::FileInputStream input(fd);
+//   JsonLinesReader reader(&input);
+//   MyMessage record;
+//   while (true) {
+//     absl::StatusOr<bool> read = reader.Read(&record);
+//     if (!read.ok()) return read.status();
+//     if (!*read) break;
+//     Process(record);
+//   }
+class PROTOBUF_EXPORT JsonLinesReader {
+ public:
+  explicit JsonLinesReader(io::ZeroCopyInputStream* input,
+                           const ParseOptions& options = ParseOptions());
+  JsonLinesReader(const JsonLinesReader&) = delete;
+  JsonLinesReader& operator=(const JsonLinesReader&) = delete;
+  ~JsonLinesReader();
+
+  // Clears `message` and parses the next record into it, which may be
+  // allocated on an arena. Returns false once the input is exhausted.
+  absl::StatusOr<bool> Read(Message* message);
+
+  // Parses all remaining records and calls `callback` with each of them, in
+  // input order. Records are parsed in batches of about `batch_bytes` into
+  // messages created from `prototype` on `arena` (or on the heap if it is
+  // null); those messages are reused for the next batch, so `callback` must
+  // not hold on to them.
+  //
+  // If `num_threads` is greater than one, the lines of each batch are split
+  // into that many contiguous ranges, which are parsed concurrently. The
+  // callback is always called from the calling thread.
+  //
+  // Stops at the first error, whether from parsing or from `callback`.
+  absl::Status ReadAll(const Message& prototype, Arena* arena, int num_threads,
+                       absl::FunctionRef<absl::Status(Message&)> callback,
+                       size_t batch_bytes = 1 << 20);
+
+  // The number of lines consumed so far, including skipped ones.
+  int64_t line_count() const { return line_count_; }
+
+ private:
+  // Returns the next line, without its terminating newline, in `line`; the
+  // view is valid until the next call. Returns false at the end of input.
+  bool NextLine(absl::string_view* line);
+
+  static absl::Status ParseLine(json_internal::JsonMessageParser& parser,
+                                absl::string_view line, int64_t line_number,
+                                int64_t offset, Message* message);
+
+  io::ZeroCopyInputStream* input_;
+  ParseOptions options_;
+  // Used by Read(), and by the calling thread in ReadAll().
+  std::unique_ptr<json_internal::JsonMessageParser> parser_;
+
+  // The unread part of the buffer last returned by `input_`.
+  absl::string_view chunk_;
+  // Holds the start of a line that continues past the end of a chunk.
+  std::string carry_;
+  bool clear_carry_ = false;
+
+  int64_t line_count_ = 0;
+  int64_t offset_ = 0;
+
+  // Scratch space for ReadAll().
+  std::string batch_;
+};
+
+// Writes messages as JSON lines. PrintOptions::add_whitespace is ignored,
+// since each record must fit on a single line.
+//
+// Each record is rendered into a reusable buffer before being copied to the
+// stream, so a record that fails to print leaves no partial line behind. As
+// with other users of ZeroCopyOutputStream, unused space in the stream's last
+// buffer is only given back when the writer is destroyed.
+class PROTOBUF_EXPORT JsonLinesWriter {
+ public:
+  explicit JsonLinesWriter(io::ZeroCopyOutputStream* output,
+                           const PrintOptions& options = PrintOptions());
+  JsonLinesWriter(const JsonLinesWriter&) = delete;
+  JsonLinesWriter& operator=(const JsonLinesWriter&) = delete;
+
+  // Writes `message` followed by a newline.
+  absl::Status Write(const Message& message);
+
+  // Writes each of `messages` on its own line, in order. If `num_threads` is
+  // greater than one, the messages are printed concurrently and then written
+  // out from the calling thread.
+  absl::Status WriteAll(absl::Span<const Message* const> messages,
+                        int num_threads = 1);
+
+ private:
+  absl::Status Emit(absl::string_view lines);
+
+  io::zc_sink_internal::ZeroCopyStreamByteSink sink_;
+  PrintOptions options_;
+  std::string buffer_;
+  std::vector<std::string> thread_buffers_;
+};
+
+}  // namespace json
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_JSON_JSON_LINES_H__
@@ -0,0 +1,192 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/json/json_lines.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/io/test_zero_copy_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/util/json_format_proto3.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace json {
+namespace {
+using ::proto3::TestMessage;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+std::vector<int32_t> ReadInt32Values(io::ZeroCopyInputStream* input) {
+  JsonLinesReader reader(input);
+  std::vector<int32_t> values;
+  TestMessage message;
+  while (true) {
+    absl::StatusOr<bool> read = reader.Read(&message);
+    EXPECT_TRUE(read.ok()) << read.status();
+    if (!read.ok() || !*read) break;
+    values.push_back(message.int32_value());
+  }
+  return values;
+}
+
+TEST(JsonLinesTest, ReadsLinesSplitAcrossBuffers) {
+  io::internal::TestZeroCopyInputStream input({
+      "{\"int32Value\": 1}\n{\"int3",
+      "2Value\"",
+      ": 2}\r\n\n   \n{\"int32Value\": 3}\n{",
+      "\"int32Value\": 4}",
+  });
+  EXPECT_THAT(ReadInt32Values(&input), ElementsAre(1, 2, 3, 4));
+}
+
+TEST(JsonLinesTest, ClearsMessageBetweenRecords) {
+  std::string input = "{\"int32Value\": 1, \"stringValue\": \"x\"}\n{}\n";
+  io::ArrayInputStream stream(input.data(), static_cast<int>(input.size()));
+  JsonLinesReader reader(&stream);
+  TestMessage message;
+
+  ASSERT_TRUE(*reader.Read(&message));
+  EXPECT_EQ(message.string_value(), "x");
+  ASSERT_TRUE(*reader.Read(&message));
+  EXPECT_EQ(message.string_value(), "");
+  EXPECT_EQ(message.int32_value(), 0);
+  EXPECT_FALSE(*reader.Read(&message));
+  EXPECT_EQ(reader.line_count(), 2);
+}
+
+TEST(JsonLinesTest, ReportsLineOfError) {
+  std::string input = "{\"int32Value\": 1}\n\n{\"int32Value\": true}\n";
+  io::ArrayInputStream stream(input.data(), static_cast<int>(input.size()));
+  JsonLinesReader reader(&stream);
+  TestMessage message;
+
+  ASSERT_TRUE(*reader.Read(&message));
+  absl::StatusOr<bool> read = reader.Read(&message);
+  EXPECT_EQ(read.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(read.status().message(), HasSubstr(" 3:"));
+}
+
+TEST(JsonLinesTest, RecoversAfterErrors) {
+  // Each bad line fails inside a nested object. The nesting depth and error
+  // path left behind by one record must not carry over to the next.
+  std::string input;
+  for (int i = 0; i < 200; ++i) {
+    absl::StrAppend(&input, "{\"messageValue\": {\"value\": true}}\n");
+  }
+  absl::StrAppend(&input, "{\"messageValue\": {\"value\": 5}}\n");
+  absl::StrAppend(&input, "{\"int32Value\": true}\n");
+  io::ArrayInputStream stream(input.data(), static_cast<int>(input.size()));
+  JsonLinesReader reader(&stream);
+  TestMessage message;
+
+  for (int i = 0; i < 200; ++i) {
+    absl::StatusOr<bool> read = reader.Read(&message);
+    ASSERT_EQ(read.status().code(), absl::StatusCode::kInvalidArgument);
+    EXPECT_THAT(read.status().message(), HasSubstr("messageValue"));
+  }
+  absl::StatusOr<bool> read = reader.Read(&message);
+  ASSERT_TRUE(read.ok()) << read.status();
+  EXPECT_EQ(message.message_value().value(), 5);
+
+  read = reader.Read(&message);
+  EXPECT_EQ(read.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(read.status().message(), HasSubstr(" 202:"));
+  EXPECT_THAT(read.status().message(), Not(HasSubstr("messageValue")));
+}
+
+TEST(JsonLinesTest, ReadsIntoArenaMessage) {
+  std::string input = "{\"int32Value\": 7}\n";
+  io::ArrayInputStream stream(input.data(), static_cast<int>(input.size()));
+  JsonLinesReader reader(&stream);
+  Arena arena;
+  auto* message = Arena::Create<TestMessage>(&arena);
+
+  ASSERT_TRUE(*reader.Read(message));
+  EXPECT_EQ(message->int32_value(), 7);
+}
+
+class JsonLinesThreadsTest : public testing::TestWithParam<int> {};
+
+TEST_P(JsonLinesThreadsTest, RoundTrip) {
+  std::vector<TestMessage> messages(1000);
+  std::vector<const Message*> pointers;
+  for (int i = 0; i < static_cast<int>(messages.size()); ++i) {
+    messages[i].set_int32_value(i);
+    messages[i].set_string_value(absl::StrCat("line\n", i));
+    messages[i].add_repeated_double_value(i / 3.0);
+    pointers.push_back(&messages[i]);
+  }
+
+  std::string output;
+  {
+    io::StringOutputStream stream(&output);
+    PrintOptions options;
+    options.add_whitespace = true;
+    JsonLinesWriter writer(&stream, options);
+    ASSERT_TRUE(writer.WriteAll(pointers, GetParam()).ok());
+  }
+  EXPECT_EQ(std::count(output.begin(), output.end(), '\n'),
+            static_cast<std::ptrdiff_t>(messages.size()));
+
+  io::ArrayInputStream stream(output.data(), static_cast<int>(output.size()),
+                              /*block_size=*/100);
+  JsonLinesReader reader(&stream);
+  Arena arena;
+  size_t count = 0;
+  absl::Status status = reader.ReadAll(
+      TestMessage::default_instance(), &arena, GetParam(),
+      [&](Message& message) {
+        const auto& parsed = static_cast<const TestMessage&>(message);
+        EXPECT_EQ(parsed.SerializeAsString(),
+                  messages[count].SerializeAsString());
+        ++count;
+        return absl::OkStatus();
+      },
+      /*batch_bytes=*/4096);
+  EXPECT_TRUE(status.ok()) << status;
+  EXPECT_EQ(count, messages.size());
+}
+
+TEST_P(JsonLinesThreadsTest, ReadAllStopsAtFirstError) {
+  std::string input;
+  for (int i = 0; i < 100; ++i) {
+    absl::StrAppend(&input, "{\"int32Value\": ", i == 42 ? "\"x\"" : "1",
+                    "}\n");
+  }
+  io::ArrayInputStream stream(input.data(), static_cast<int>(input.size()));
+  JsonLinesReader reader(&stream);
+  int count = 0;
+  absl::Status status = reader.ReadAll(TestMessage::default_instance(),
+                                       /*arena=*/nullptr, GetParam(),
+                                       [&](Message&) {
+                                         ++count;
+                                         return absl::OkStatus();
+                                       });
+  EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(status.message(), HasSubstr(" 43:"));
+  EXPECT_EQ(count, 42);
+}
+
+INSTANTIATE_TEST_SUITE_P(JsonLinesThreadsTest, JsonLinesThreadsTest,
+                         testing::Values(1, 4));
+
+}  // namespace
+}  // namespace json
+}  // namespace protobuf
+}  // namespace google
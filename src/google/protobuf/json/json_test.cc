@@ -444,7 +444,7 @@ TEST_P(JsonTest, FloatPrecision) {
   v.mutable_list_value()->add_values()->set_number_value(0.8799999952316284);
 
   EXPECT_THAT(ToJson(v),
-              IsOkAndHolds("[0.99000000953674316,0.87999999523162842]"));
+              IsOkAndHolds("[0.9900000095367432,0.8799999952316284]"));
 }
 
 TEST_P(JsonTest, FloatMinMaxValue) {
@@ -1274,6 +1274,81 @@ TEST_P(JsonTest, FieldOrder) {
       out, R"({"boolValue":true,"int64Value":"3","repeatedInt32Value":[2,2]})");
 }
 
+TEST_P(JsonTest, FieldOrderStream) {
+  // $ protoscope -s <<< "3: 3 22: 2 1: 1 22: 2"
+  std::string in("\x18\x03\xb0\x01\x02\x08\x01\xb0\x01\x02");
+  io::ArrayInputStream in_stream(in.data(), in.size());
+  std::string out;
+  io::StringOutputStream out_stream(&out);
+  ASSERT_OK(BinaryToJsonStream(resolver_.get(),
+                               "type.googleapis.com/proto3.TestMessage",
+                               &in_stream, &out_stream));
+  EXPECT_EQ(
+      out, R"({"boolValue":true,"int64Value":"3","repeatedInt32Value":[2,2]})");
+}
+
+TEST_P(JsonTest, FieldOrderStreamInterleaved) {
+  // $ protoscope -s <<< "31: {1: 5} 22: 2 1: 1 22: 3 31: {1: 6} 22: 4"
+  std::string in(
+      "\xfa\x01\x02\x08\x05\xb0\x01\x02\x08\x01\xb0\x01\x03"
+      "\xfa\x01\x02\x08\x06\xb0\x01\x04");
+  io::ArrayInputStream in_stream(in.data(), in.size());
+  std::string out;
+  {
+    io::StringOutputStream out_stream(&out);
+    ASSERT_OK(BinaryToJsonStream(resolver_.get(),
+                                 "type.googleapis.com/proto3.TestMessage",
+                                 &in_stream, &out_stream));
+  }
+  EXPECT_EQ(out,
+            R"({"boolValue":true,"repeatedInt32Value":[2,3,4],)"
+            R"("repeatedMessageValue":[{"value":5},{"value":6}]})");
+
+  std::string string_out;
+  ASSERT_OK(BinaryToJsonString(resolver_.get(),
+                               "type.googleapis.com/proto3.TestMessage", in,
+                               &string_out));
+  EXPECT_EQ(out, string_out);
+}
+
+TEST_P(JsonTest, FieldOrderStreamInWireOrder) {
+  // $ protoscope -s <<< "3: 3 22: 2 22: 2 1: 1"
+  std::string in("\x18\x03\xb0\x01\x02\xb0\x01\x02\x08\x01");
+  io::ArrayInputStream in_stream(in.data(), in.size());
+  std::string out;
+  io::StringOutputStream out_stream(&out);
+  PrintOptions options;
+  options.stream_in_wire_order = true;
+  ASSERT_OK(BinaryToJsonStream(resolver_.get(),
+                               "type.googleapis.com/proto3.TestMessage",
+                               &in_stream, &out_stream, options));
+  EXPECT_EQ(
+      out, R"({"int64Value":"3","repeatedInt32Value":[2,2],"boolValue":true})");
+}
+
+TEST_P(JsonTest, FieldOrderStreamInWireOrderSplitRepeated) {
+  // $ protoscope -s <<< "3: 3 22: 2 1: 1 22: 2"
+  std::string in("\x18\x03\xb0\x01\x02\x08\x01\xb0\x01\x02");
+  io::ArrayInputStream in_stream(in.data(), in.size());
+  std::string out;
+  io::StringOutputStream out_stream(&out);
+  PrintOptions options;
+  options.stream_in_wire_order = true;
+  EXPECT_THAT(BinaryToJsonStream(resolver_.get(),
+                                 "type.googleapis.com/proto3.TestMessage",
+                                 &in_stream, &out_stream, options),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_P(JsonTest, MapEntryMissingKeyOrValue) {
+  // $ protoscope -s <<< "6: {2: 5} 2: {1: 7}"
+  std::string out;
+  ASSERT_OK(BinaryToJsonString(resolver_.get(),
+                               "type.googleapis.com/proto3.TestMap",
+                               "\x32\x02\x10\x05\x12\x02\x08\x07", &out));
+  EXPECT_EQ(out, R"({"int32Map":{"7":0},"stringMap":{"":5}})");
+}
+
 TEST_P(JsonTest, UnknownGroupField) {
   // $ protoscope -s <<< "999: !{1: 99}"
   std::string out;
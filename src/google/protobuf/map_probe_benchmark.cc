@@ -61,8 +61,7 @@ struct MapBenchmarkPeer {
            static_cast<double>(map.size());
   }
 };
-}  // namespace protobuf
-}  // namespace google::internal
+}  // namespace google::protobuf::internal
 
 namespace {
 
@@ -226,8 +226,10 @@ class DescriptorPoolExtensionFinder;
 class ExtensionSet;
 class LazyField;
 class RepeatedPtrFieldBase;
+class ReverseSerializer;
 class TcParser;
 struct TcParseTableBase;
+class TcSerializer;
 class WireFormatLite;
 class WeakFieldMap;
 class RustMapHelper;
@@ -945,9 +947,11 @@ class PROTOBUF_EXPORT MessageLite {
   friend class internal::DescriptorPoolExtensionFinder;
   friend class internal::ExtensionSet;
   friend class internal::LazyField;
+  friend class internal::ReverseSerializer;
   friend class internal::SwapFieldHelper;
   friend class internal::TcParser;
   friend struct internal::TcParseTableBase;
+  friend class internal::TcSerializer;
   friend class internal::UntypedMapBase;
   friend class internal::WeakFieldMap;
   friend class internal::WireFormatLite;
@@ -0,0 +1,387 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/packed_varint.h"
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "absl/numeric/bits.h"
+#include "google/protobuf/parse_context.h"
+#include "google/protobuf/wire_format_lite.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define PROTOBUF_PACKED_VARINT_X86 1
+#endif
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+namespace {
+
+template <typename T, bool zigzag>
+inline PROTOBUF_ALWAYS_INLINE T ConvertVarint(uint64_t varint) {
+  if (!zigzag) return static_cast<T>(varint);
+  if (sizeof(T) == 8) {
+    return static_cast<T>(WireFormatLite::ZigZagDecode64(varint));
+  }
+  return static_cast<T>(
+      WireFormatLite::ZigZagDecode32(static_cast<uint32_t>(varint)));
+}
+
+int CountVarintEndsScalar(const char* ptr, const char* end) {
+  int n = 0;
+  for (; ptr < end; ++ptr) n += static_cast<int8_t>(*ptr) >= 0;
+  return n;
+}
+
+template <typename T, bool zigzag>
+const char* DecodeScalar(const char* ptr, const char* end, T* out,
+                         int* count) {
+  int n = 0;
+  while (ptr < end) {
+    uint64_t varint;
+    ptr = VarintParse(ptr, &varint);
+    if (ptr == nullptr) break;
+    out[n++] = ConvertVarint<T, zigzag>(varint);
+  }
+  *count += n;
+  return ptr;
+}
+
+#ifdef PROTOBUF_PACKED_VARINT_X86
+
+// Returns the value of the varint in the low `len` (1 to 8) bytes of `bytes`,
+// which were loaded in little-endian order.
+inline PROTOBUF_ALWAYS_INLINE uint64_t CompactVarint(uint64_t bytes, int len) {
+  uint64_t x = bytes & (~uint64_t{0} >> (64 - 8 * len)) & 0x7f7f7f7f7f7f7f7f;
+  // Squeeze out the continuation bits: 7-bit groups become 14-bit groups in
+  // 16-bit lanes, then 28-bit groups in 32-bit lanes, then a 56-bit value.
+  x = (x & 0x007f007f007f007f) | ((x & 0x7f007f007f007f00) >> 1);
+  x = (x & 0x00003fff00003fff) | ((x & 0x3fff00003fff0000) >> 2);
+  x = (x & 0x000000000fffffff) | ((x & 0x0fffffff00000000) >> 4);
+  return x;
+}
+
+// Decodes the varints that end among the `width` bytes at `p`, where bit i of
+// `continuation` is the continuation bit of p[i]. Stops before a malformed
+// varint. Reads up to p[width + 6] and returns the number of bytes consumed.
+template <typename T, bool zigzag>
+inline PROTOBUF_ALWAYS_INLINE int DecodeMasked(const char* p,
+                                               uint64_t continuation,
+                                               int width, T*& out) {
+  uint64_t ends = ~continuation & (~uint64_t{0} >> (64 - width));
+  int start = 0;
+  while (ends != 0) {
+    const int stop = absl::countr_zero(ends);
+    const int len = stop + 1 - start;
+    uint64_t bytes;
+    std::memcpy(&bytes, p + start, sizeof(bytes));
+    uint64_t value;
+    if (PROTOBUF_PREDICT_TRUE(len <= 8)) {
+      value = CompactVarint(bytes, len);
+    } else {
+      if (len > 10) break;
+      // Like VarintParse, drop the bits of a tenth byte that overflow.
+      value = CompactVarint(bytes, 8) |
+              (static_cast<uint64_t>(p[start + 8] & 0x7f) << 56) |
+              (len == 10 ? static_cast<uint64_t>(p[start + 9]) << 63 : 0);
+    }
+    *out++ = ConvertVarint<T, zigzag>(value);
+    start = stop + 1;
+    ends &= ends - 1;
+  }
+  return start;
+}
+
+// Decodes the varint at `p`, which DecodeMasked could not decode.
+template <typename T, bool zigzag>
+inline const char* DecodeOne(const char* p, T*& out) {
+  uint64_t varint;
+  p = VarintParse(p, &varint);
+  if (p != nullptr) *out++ = ConvertVarint<T, zigzag>(varint);
+  return p;
+}
+
+// Stores the 16 single-byte varints in `v`. All bytes are below 0x80, so both
+// the raw and the ZigZag decoded values can be sign extended.
+template <typename T, bool zigzag>
+__attribute__((target("sse4.1"))) inline void StoreBytesSse41(__m128i v,
+                                                              T* out) {
+  if (zigzag) {
+    // (v >> 1) ^ -(v & 1), bytewise.
+    const __m128i sign = _mm_sub_epi8(_mm_setzero_si128(),
+                                      _mm_and_si128(v, _mm_set1_epi8(1)));
+    v = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(v, 1), _mm_set1_epi8(0x7f)),
+                      sign);
+  }
+  auto* dst = reinterpret_cast<__m128i*>(out);
+  if (sizeof(T) == 4) {
+    _mm_storeu_si128(dst + 0, _mm_cvtepi8_epi32(v));
+    _mm_storeu_si128(dst + 1, _mm_cvtepi8_epi32(_mm_srli_si128(v, 4)));
+    _mm_storeu_si128(dst + 2, _mm_cvtepi8_epi32(_mm_srli_si128(v, 8)));
+    _mm_storeu_si128(dst + 3, _mm_cvtepi8_epi32(_mm_srli_si128(v, 12)));
+  } else {
+    _mm_storeu_si128(dst + 0, _mm_cvtepi8_epi64(v));
+    _mm_storeu_si128(dst + 1, _mm_cvtepi8_epi64(_mm_srli_si128(v, 2)));
+    _mm_storeu_si128(dst + 2, _mm_cvtepi8_epi64(_mm_srli_si128(v, 4)));
+    _mm_storeu_si128(dst + 3, _mm_cvtepi8_epi64(_mm_srli_si128(v, 6)));
+    _mm_storeu_si128(dst + 4, _mm_cvtepi8_epi64(_mm_srli_si128(v, 8)));
+    _mm_storeu_si128(dst + 5, _mm_cvtepi8_epi64(_mm_srli_si128(v, 10)));
+    _mm_storeu_si128(dst + 6, _mm_cvtepi8_epi64(_mm_srli_si128(v, 12)));
+    _mm_storeu_si128(dst + 7, _mm_cvtepi8_epi64(_mm_srli_si128(v, 14)));
+  }
+}
+
+// Describes how to decode the leading one and two byte varints among 8 bytes
+// with a given set of continuation bits: `shuffle` moves the bytes of each
+// varint into its own 16-bit lane.
+struct ShortVarints {
+  alignas(16) int8_t shuffle[16];
+  uint8_t count;
+  uint8_t consumed;
+};
+
+struct ShortVarintTable {
+  ShortVarintTable() {
+    for (int mask = 0; mask < 256; ++mask) {
+      ShortVarints& e = entries[mask];
+      std::memset(e.shuffle, -1, sizeof(e.shuffle));
+      int pos = 0;
+      int n = 0;
+      while (pos < 8) {
+        const int len = (mask >> pos & 1) == 0 ? 1 : 2;
+        if (pos + len > 8 || (len == 2 && (mask >> (pos + 1) & 1) != 0)) break;
+        e.shuffle[2 * n] = static_cast<int8_t>(pos);
+        if (len == 2) e.shuffle[2 * n + 1] = static_cast<int8_t>(pos + 1);
+        pos += len;
+        ++n;
+      }
+      e.count = static_cast<uint8_t>(n);
+      e.consumed = static_cast<uint8_t>(pos);
+    }
+  }
+
+  ShortVarints entries[256];
+};
+
+const ShortVarints& GetShortVarints(uint32_t continuation) {
+  static const ShortVarintTable table;
+  return table.entries[continuation & 0xff];
+}
+
+// Stores the leading one and two byte varints of `v` as described by `e`.
+// Always writes 8 elements.
+template <typename T, bool zigzag>
+__attribute__((target("sse4.1"))) inline void StoreShortSse41(
+    __m128i v, const ShortVarints& e, T* out) {
+  v = _mm_shuffle_epi8(
+      v, _mm_load_si128(reinterpret_cast<const __m128i*>(e.shuffle)));
+  v = _mm_or_si128(_mm_and_si128(v, _mm_set1_epi16(0x007f)),
+                   _mm_srli_epi16(_mm_and_si128(v, _mm_set1_epi16(0x7f00)), 1));
+  if (zigzag) {
+    const __m128i sign = _mm_sub_epi16(_mm_setzero_si128(),
+                                       _mm_and_si128(v, _mm_set1_epi16(1)));
+    v = _mm_xor_si128(_mm_srli_epi16(v, 1), sign);
+  }
+  auto* dst = reinterpret_cast<__m128i*>(out);
+  // Values are below 1 << 14, so both the raw and the ZigZag decoded values
+  // can be sign extended.
+  if (sizeof(T) == 4) {
+    _mm_storeu_si128(dst + 0, _mm_cvtepi16_epi32(v));
+    _mm_storeu_si128(dst + 1, _mm_cvtepi16_epi32(_mm_srli_si128(v, 8)));
+  } else {
+    _mm_storeu_si128(dst + 0, _mm_cvtepi16_epi64(v));
+    _mm_storeu_si128(dst + 1, _mm_cvtepi16_epi64(_mm_srli_si128(v, 4)));
+    _mm_storeu_si128(dst + 2, _mm_cvtepi16_epi64(_mm_srli_si128(v, 8)));
+    _mm_storeu_si128(dst + 3, _mm_cvtepi16_epi64(_mm_srli_si128(v, 12)));
+  }
+}
+
+// Decodes the leading one and two byte varints among the 16 bytes `v` at
+// `ptr`, looking at 8 bytes at a time. Returns false if the first varint is
+// longer than two bytes.
+template <typename T, bool zigzag>
+__attribute__((target("sse4.1"))) inline bool DecodeShortSse41(
+    __m128i v, uint32_t continuation, const char*& ptr, T*& out) {
+  if ((continuation & 3) == 3) return false;
+  const ShortVarints& lo = GetShortVarints(continuation);
+  StoreShortSse41<T, zigzag>(v, lo, out);
+  out += lo.count;
+  if (lo.consumed < 8) {
+    ptr += lo.consumed;
+    return true;
+  }
+  // The second half can be looked up without waiting for the first one.
+  const ShortVarints& hi = GetShortVarints(continuation >> 8);
+  StoreShortSse41<T, zigzag>(_mm_srli_si128(v, 8), hi, out);
+  out += hi.count;
+  ptr += 8 + hi.consumed;
+  return true;
+}
+
+__attribute__((target("sse4.1,popcnt"))) int CountVarintEndsSse41(
+    const char* ptr, const char* end) {
+  int n = 0;
+  for (; end - ptr >= 16; ptr += 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+    n += 16 - __builtin_popcount(_mm_movemask_epi8(v));
+  }
+  return n + CountVarintEndsScalar(ptr, end);
+}
+
+template <typename T, bool zigzag>
+__attribute__((target("sse4.1"))) const char* DecodeSse41(const char* ptr,
+                                                          const char* end,
+                                                          T* out, int* count) {
+  T* const begin = out;
+  while (end - ptr >= 16 + 8) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+    const uint32_t continuation = _mm_movemask_epi8(v);
+    if (continuation == 0) {
+      StoreBytesSse41<T, zigzag>(v, out);
+      out += 16;
+      ptr += 16;
+      continue;
+    }
+    if (DecodeShortSse41<T, zigzag>(v, continuation, ptr, out)) continue;
+    const int consumed = DecodeMasked<T, zigzag>(ptr, continuation, 16, out);
+    ptr = consumed != 0 ? ptr + consumed : DecodeOne<T, zigzag>(ptr, out);
+    if (ptr == nullptr) break;
+  }
+  *count += static_cast<int>(out - begin);
+  if (ptr == nullptr) return nullptr;
+  return DecodeScalar<T, zigzag>(ptr, end, out, count);
+}
+
+__attribute__((target("avx2,popcnt"))) int CountVarintEndsAvx2(
+    const char* ptr, const char* end) {
+  int n = 0;
+  for (; end - ptr >= 32; ptr += 32) {
+    const __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+    n += 32 - __builtin_popcount(
+                  static_cast<uint32_t>(_mm256_movemask_epi8(v)));
+  }
+  return n + CountVarintEndsScalar(ptr, end);
+}
+
+template <typename T, bool zigzag>
+__attribute__((target("avx2"))) const char* DecodeAvx2(const char* ptr,
+                                                       const char* end, T* out,
+                                                       int* count) {
+  T* const begin = out;
+  while (end - ptr >= 32 + 8) {
+    const __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+    const uint32_t continuation = _mm256_movemask_epi8(v);
+    if (continuation == 0) {
+      StoreBytesSse41<T, zigzag>(_mm256_castsi256_si128(v), out);
+      StoreBytesSse41<T, zigzag>(_mm256_extracti128_si256(v, 1), out + 16);
+      out += 32;
+      ptr += 32;
+      continue;
+    }
+    if (DecodeShortSse41<T, zigzag>(_mm256_castsi256_si128(v), continuation,
+                                    ptr, out)) {
+      continue;
+    }
+    const int consumed = DecodeMasked<T, zigzag>(ptr, continuation, 32, out);
+    ptr = consumed != 0 ? ptr + consumed : DecodeOne<T, zigzag>(ptr, out);
+    if (ptr == nullptr) break;
+  }
+  *count += static_cast<int>(out - begin);
+  if (ptr == nullptr) return nullptr;
+  return DecodeScalar<T, zigzag>(ptr, end, out, count);
+}
+
+PackedVarintKernel DetectPackedVarintKernel() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+    return PackedVarintKernel::kAvx2;
+  }
+  if (__builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt")) {
+    return PackedVarintKernel::kSse41;
+  }
+  return PackedVarintKernel::kScalar;
+}
+
+#else  // PROTOBUF_PACKED_VARINT_X86
+
+PackedVarintKernel DetectPackedVarintKernel() {
+  return PackedVarintKernel::kScalar;
+}
+
+#endif  // PROTOBUF_PACKED_VARINT_X86
+
+}  // namespace
+
+PackedVarintKernel BestPackedVarintKernel() {
+  static const PackedVarintKernel kernel = DetectPackedVarintKernel();
+  return kernel;
+}
+
+int CountVarintEnds(const char* ptr, const char* end) {
+#ifdef PROTOBUF_PACKED_VARINT_X86
+  switch (BestPackedVarintKernel()) {
+    case PackedVarintKernel::kAvx2:
+      return CountVarintEndsAvx2(ptr, end);
+    case PackedVarintKernel::kSse41:
+      return CountVarintEndsSse41(ptr, end);
+    case PackedVarintKernel::kScalar:
+      break;
+  }
+#endif  // PROTOBUF_PACKED_VARINT_X86
+  return CountVarintEndsScalar(ptr, end);
+}
+
+template <typename T, bool zigzag>
+const char* DecodePackedVarints(PackedVarintKernel kernel, const char* ptr,
+                                const char* end, T* out, int* count) {
+  static_assert(std::is_same<T, uint32_t>::value ||
+                    std::is_same<T, uint64_t>::value,
+                "");
+#ifdef PROTOBUF_PACKED_VARINT_X86
+  if (kernel > BestPackedVarintKernel()) kernel = BestPackedVarintKernel();
+  switch (kernel) {
+    case PackedVarintKernel::kAvx2:
+      return DecodeAvx2<T, zigzag>(ptr, end, out, count);
+    case PackedVarintKernel::kSse41:
+      return DecodeSse41<T, zigzag>(ptr, end, out, count);
+    case PackedVarintKernel::kScalar:
+      break;
+  }
+#else
+  (void)kernel;
+#endif  // PROTOBUF_PACKED_VARINT_X86
+  return DecodeScalar<T, zigzag>(ptr, end, out, count);
+}
+
+template PROTOBUF_EXPORT_TEMPLATE_DEFINE const char*
+DecodePackedVarints<uint32_t, false>(PackedVarintKernel, const char*,
+                                     const char*, uint32_t*, int*);
+template PROTOBUF_EXPORT_TEMPLATE_DEFINE const char*
+DecodePackedVarints<uint32_t, true>(PackedVarintKernel, const char*,
+                                    const char*, uint32_t*, int*);
+template PROTOBUF_EXPORT_TEMPLATE_DEFINE const char*
+DecodePackedVarints<uint64_t, false>(PackedVarintKernel, const char*,
+                                     const char*, uint64_t*, int*);
+template PROTOBUF_EXPORT_TEMPLATE_DEFINE const char*
+DecodePackedVarints<uint64_t, true>(PackedVarintKernel, const char*,
+                                    const char*, uint64_t*, int*);
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
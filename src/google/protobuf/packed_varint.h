@@ -0,0 +1,81 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines bulk decoders for the payload of packed varint fields.
+// They decode many varints per iteration using SSE4.1 or AVX2 when the CPU
+// supports it, and fall back to decoding one varint at a time otherwise.
+
+#ifndef GOOGLE_PROTOBUF_PACKED_VARINT_H__
+#define GOOGLE_PROTOBUF_PACKED_VARINT_H__
+
+#include <cstdint>
+
+#include "google/protobuf/port.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+// The decoding kernels, ordered such that a CPU supporting one kernel also
+// supports all kernels before it.
+enum class PackedVarintKernel {
+  kScalar,
+  kSse41,
+  kAvx2,
+};
+
+// Returns the fastest kernel supported by the running CPU.
+PROTOBUF_EXPORT PackedVarintKernel BestPackedVarintKernel();
+
+// Returns the number of varints that end in [ptr, end), i.e. the number of
+// bytes without a continuation bit. One more varint may start in the range and
+// end after it.
+PROTOBUF_EXPORT int CountVarintEnds(const char* ptr, const char* end);
+
+// The decoders may write this many elements past the last decoded value.
+constexpr int kPackedVarintOutputSlop = 8;
+
+// Decodes the varints starting in [ptr, end) into `out`, which must have room
+// for CountVarintEnds(ptr, end) + 1 + kPackedVarintOutputSlop elements. Like
+// ReadPackedVarintArray, the last varint may extend up to 10 bytes past `end`.
+// T is uint32_t or uint64_t; 64-bit varints are truncated to T, and ZigZag
+// decoded if `zigzag` is true.
+//
+// Adds the number of decoded values to `*count` and returns the position after
+// the last varint, or nullptr if a varint is malformed. `kernel` is clamped to
+// BestPackedVarintKernel().
+template <typename T, bool zigzag>
+const char* DecodePackedVarints(PackedVarintKernel kernel, const char* ptr,
+                                const char* end, T* out, int* count);
+
+#define PROTOBUF_DECLARE_DECODE_PACKED_VARINTS(T, zigzag)                     \
+  extern template PROTOBUF_EXPORT_TEMPLATE_DECLARE const char*                \
+  DecodePackedVarints<T, zigzag>(PackedVarintKernel kernel, const char* ptr, \
+                                 const char* end, T* out, int* count)
+PROTOBUF_DECLARE_DECODE_PACKED_VARINTS(uint32_t, false);
+PROTOBUF_DECLARE_DECODE_PACKED_VARINTS(uint32_t, true);
+PROTOBUF_DECLARE_DECODE_PACKED_VARINTS(uint64_t, false);
+PROTOBUF_DECLARE_DECODE_PACKED_VARINTS(uint64_t, true);
+#undef PROTOBUF_DECLARE_DECODE_PACKED_VARINTS
+
+template <typename T, bool zigzag>
+inline const char* DecodePackedVarints(const char* ptr, const char* end,
+                                       T* out, int* count) {
+  return DecodePackedVarints<T, zigzag>(BestPackedVarintKernel(), ptr, end,
+                                        out, count);
+}
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_PACKED_VARINT_H__
@@ -0,0 +1,166 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/packed_varint.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/wire_format_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+using testing::ElementsAreArray;
+using testing::TestWithParam;
+using testing::Values;
+
+namespace google {
+namespace protobuf {
+namespace internal {
+namespace {
+
+// Returns `n` values whose varint encodings are `len` bytes long, or of
+// random length if `len` is 0.
+std::vector<uint64_t> ValuesOfLength(int len, int n) {
+  std::mt19937_64 rng(len);
+  std::vector<uint64_t> values;
+  for (int i = 0; i < n; ++i) {
+    const int l = len != 0 ? len : 1 + static_cast<int>(rng() % 10);
+    const uint64_t max = l >= 10 ? ~uint64_t{0} : (uint64_t{1} << (7 * l)) - 1;
+    const uint64_t min = l == 1 ? 0 : (uint64_t{1} << (7 * (l - 1)));
+    values.push_back(min + rng() % (max - min + 1));
+  }
+  return values;
+}
+
+std::string Encode(const std::vector<uint64_t>& values) {
+  std::string out;
+  for (uint64_t v : values) {
+    while (v >= 0x80) {
+      out.push_back(static_cast<char>(v | 0x80));
+      v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+  }
+  return out;
+}
+
+template <typename T, bool zigzag>
+std::vector<T> Expected(const std::vector<uint64_t>& values) {
+  std::vector<T> out;
+  for (uint64_t v : values) {
+    if (!zigzag) {
+      out.push_back(static_cast<T>(v));
+    } else if (sizeof(T) == 8) {
+      out.push_back(static_cast<T>(WireFormatLite::ZigZagDecode64(v)));
+    } else {
+      out.push_back(static_cast<T>(
+          WireFormatLite::ZigZagDecode32(static_cast<uint32_t>(v))));
+    }
+  }
+  return out;
+}
+
+template <typename T, bool zigzag>
+std::vector<T> Decode(PackedVarintKernel kernel, const std::string& bytes) {
+  // Leave room for the slop a packed field may read past its end.
+  std::string buffer = bytes + std::string(16, '\0');
+  const char* end = buffer.data() + bytes.size();
+  std::vector<T> out(CountVarintEnds(buffer.data(), end) + 1 +
+                     kPackedVarintOutputSlop);
+  int count = 0;
+  const char* ptr = DecodePackedVarints<T, zigzag>(kernel, buffer.data(), end,
+                                                   out.data(), &count);
+  EXPECT_EQ(ptr, end);
+  out.resize(count);
+  return out;
+}
+
+class PackedVarintTest
+    : public TestWithParam<std::tuple<PackedVarintKernel, int>> {
+ protected:
+  PackedVarintKernel kernel() const { return std::get<0>(GetParam()); }
+  int length() const { return std::get<1>(GetParam()); }
+};
+
+TEST_P(PackedVarintTest, DecodesAllTypes) {
+  for (int n : {0, 1, 7, 16, 33, 100, 1000}) {
+    const std::vector<uint64_t> values = ValuesOfLength(length(), n);
+    const std::string bytes = Encode(values);
+    EXPECT_EQ(CountVarintEnds(bytes.data(), bytes.data() + bytes.size()), n);
+    EXPECT_THAT((Decode<uint32_t, false>(kernel(), bytes)),
+                ElementsAreArray(Expected<uint32_t, false>(values)));
+    EXPECT_THAT((Decode<uint32_t, true>(kernel(), bytes)),
+                ElementsAreArray(Expected<uint32_t, true>(values)));
+    EXPECT_THAT((Decode<uint64_t, false>(kernel(), bytes)),
+                ElementsAreArray(Expected<uint64_t, false>(values)));
+    EXPECT_THAT((Decode<uint64_t, true>(kernel(), bytes)),
+                ElementsAreArray(Expected<uint64_t, true>(values)));
+  }
+}
+
+TEST_P(PackedVarintTest, RejectsOverlongVarint) {
+  std::string bytes = Encode(ValuesOfLength(length(), 50));
+  bytes += std::string(11, '\x80');
+  bytes += Encode(ValuesOfLength(length(), 50));
+  std::string buffer = bytes + std::string(16, '\0');
+  std::vector<uint64_t> out(
+      CountVarintEnds(buffer.data(), buffer.data() + bytes.size()) + 1 +
+      kPackedVarintOutputSlop);
+  int count = 0;
+  EXPECT_EQ(
+      (DecodePackedVarints<uint64_t, false>(
+          kernel(), buffer.data(), buffer.data() + bytes.size(), out.data(),
+          &count)),
+      nullptr);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    AllKernels, PackedVarintTest,
+    testing::Combine(Values(PackedVarintKernel::kScalar,
+                            PackedVarintKernel::kSse41,
+                            PackedVarintKernel::kAvx2),
+                     Values(0, 1, 2, 3, 5, 8, 9, 10)));
+
+TEST(PackedVarintParseTest, ParsesAcrossBufferBoundaries) {
+  protobuf_unittest::TestPackedTypes message;
+  for (uint64_t v : ValuesOfLength(0, 5000)) {
+    message.add_packed_int32(static_cast<int32_t>(v));
+    message.add_packed_int64(static_cast<int64_t>(v));
+    message.add_packed_uint32(static_cast<uint32_t>(v));
+    message.add_packed_uint64(v);
+    message.add_packed_sint32(static_cast<int32_t>(v));
+    message.add_packed_sint64(static_cast<int64_t>(v));
+    message.add_packed_bool(v & 1);
+  }
+  const std::string bytes = message.SerializeAsString();
+
+  for (int block_size : {1, 7, 64, 1000, -1}) {
+    SCOPED_TRACE(block_size);
+    io::ArrayInputStream input(bytes.data(), static_cast<int>(bytes.size()),
+                               block_size);
+    protobuf_unittest::TestPackedTypes parsed;
+    ASSERT_TRUE(parsed.ParseFromZeroCopyStream(&input));
+    EXPECT_EQ(parsed.SerializeAsString(), bytes);
+  }
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
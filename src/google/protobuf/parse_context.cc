@@ -425,19 +425,8 @@ const char* InlineGreedyStringParser(std::string* s, const char* ptr,
 
 template <typename T, bool sign>
 const char* VarintParser(void* object, const char* ptr, ParseContext* ctx) {
-  return ctx->ReadPackedVarint(ptr, [object](uint64_t varint) {
-    T val;
-    if (sign) {
-      if (sizeof(T) == 8) {
-        val = WireFormatLite::ZigZagDecode64(varint);
-      } else {
-        val = WireFormatLite::ZigZagDecode32(varint);
-      }
-    } else {
-      val = varint;
-    }
-    static_cast<RepeatedField<T>*>(object)->Add(val);
-  });
+  return ctx->ReadPackedVarintBulk<sign>(
+      ptr, static_cast<RepeatedField<T>*>(object));
 }
 
 const char* PackedInt32Parser(void* object, const char* ptr,
@@ -470,7 +459,9 @@ const char* PackedEnumParser(void* object, const char* ptr, ParseContext* ctx) {
 }
 
 const char* PackedBoolParser(void* object, const char* ptr, ParseContext* ctx) {
-  return VarintParser<bool, false>(object, ptr, ctx);
+  return ctx->ReadPackedVarint(ptr, [object](uint64_t varint) {
+    static_cast<RepeatedField<bool>*>(object)->Add(varint != 0);
+  });
 }
 
 template <typename T>
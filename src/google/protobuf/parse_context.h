@@ -28,6 +28,7 @@
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/metadata_lite.h"
+#include "google/protobuf/packed_varint.h"
 #include "google/protobuf/port.h"
 #include "google/protobuf/repeated_field.h"
 #include "google/protobuf/wire_format_lite.h"
@@ -228,6 +229,12 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
   template <typename Add, typename SizeCb>
   PROTOBUF_NODISCARD const char* ReadPackedVarint(const char* ptr, Add add,
                                                   SizeCb size_callback);
+  // Like ReadPackedVarint, but decodes many varints at a time straight into
+  // `out`. T must be a 32 or 64-bit integer type. Values are truncated to T,
+  // after ZigZag decoding if `zigzag` is true.
+  template <bool zigzag, typename T>
+  PROTOBUF_NODISCARD const char* ReadPackedVarintBulk(const char* ptr,
+                                                      RepeatedField<T>* out);
 
   uint32_t LastTag() const { return last_tag_minus_1_ + 1; }
   bool ConsumeEndGroup(uint32_t start_tag) {
@@ -380,6 +387,13 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
     overall_limit_ += count;
   }
 
+  // Reads the `size` byte payload of a packed varint field, passing each
+  // contiguous piece of it to `read_array(ptr, end)`, which must behave like
+  // ReadPackedVarintArray.
+  template <typename ReadArray>
+  const char* ReadPackedVarintPayload(const char* ptr, int size,
+                                      ReadArray read_array);
+
   template <typename A>
   const char* AppendSize(const char* ptr, int size, const A& append) {
     int chunk_size = static_cast<int>(buffer_end_ + kSlopBytes - ptr);
@@ -1208,16 +1222,37 @@ const char* ReadPackedVarintArray(const char* ptr, const char* end, Add add) {
   return ptr;
 }
 
-template <typename Add, typename SizeCb>
-const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr, Add add,
-                                                 SizeCb size_callback) {
-  int size = ReadSize(&ptr);
-  size_callback(size);
+// Decodes the varints in [ptr, end) into `out`, reserving space for all of
+// them up front.
+template <bool zigzag, typename T>
+const char* ReadPackedVarintArrayBulk(const char* ptr, const char* end,
+                                      RepeatedField<T>* out) {
+  static_assert(std::is_integral<T>::value &&
+                    (sizeof(T) == sizeof(uint32_t) ||
+                     sizeof(T) == sizeof(uint64_t)),
+                "");
+  using Unsigned = std::conditional_t<sizeof(T) == sizeof(uint64_t), uint64_t,
+                                      uint32_t>;
+  if (ptr >= end) return ptr;
+  const int old_size = out->size();
+  const int max_count =
+      CountVarintEnds(ptr, end) + 1 + kPackedVarintOutputSlop;
+  out->Reserve(old_size + max_count);
+  int count = 0;
+  auto* dst = reinterpret_cast<Unsigned*>(out->AddNAlreadyReserved(max_count));
+  ptr = DecodePackedVarints<Unsigned, zigzag>(ptr, end, dst, &count);
+  out->Truncate(old_size + count);
+  return ptr;
+}
 
+template <typename ReadArray>
+const char* EpsCopyInputStream::ReadPackedVarintPayload(const char* ptr,
+                                                        int size,
+                                                        ReadArray read_array) {
   GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
   int chunk_size = static_cast<int>(buffer_end_ - ptr);
   while (size > chunk_size) {
-    ptr = ReadPackedVarintArray(ptr, buffer_end_, add);
+    ptr = read_array(ptr, buffer_end_);
     if (ptr == nullptr) return nullptr;
     int overrun = static_cast<int>(ptr - buffer_end_);
     ABSL_DCHECK(overrun >= 0 && overrun <= kSlopBytes);
@@ -1229,7 +1264,7 @@ const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr, Add add,
       std::memcpy(buf, buffer_end_, kSlopBytes);
       ABSL_CHECK_LE(size - chunk_size, kSlopBytes);
       auto end = buf + (size - chunk_size);
-      auto res = ReadPackedVarintArray(buf + overrun, end, add);
+      auto res = read_array(buf + overrun, end);
       if (res == nullptr || res != end) return nullptr;
       return buffer_end_ + (res - buf);
     }
@@ -1243,10 +1278,31 @@ const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr, Add add,
     chunk_size = static_cast<int>(buffer_end_ - ptr);
   }
   auto end = ptr + size;
-  ptr = ReadPackedVarintArray(ptr, end, add);
+  ptr = read_array(ptr, end);
   return end == ptr ? ptr : nullptr;
 }
 
+template <typename Add, typename SizeCb>
+const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr, Add add,
+                                                 SizeCb size_callback) {
+  int size = ReadSize(&ptr);
+  size_callback(size);
+  return ReadPackedVarintPayload(ptr, size, [&](const char* p, const char* e) {
+    return ReadPackedVarintArray(p, e, add);
+  });
+}
+
+template <bool zigzag, typename T>
+const char* EpsCopyInputStream::ReadPackedVarintBulk(const char* ptr,
+                                                     RepeatedField<T>* out) {
+  int size = ReadSize(&ptr);
+  return ReadPackedVarintPayload(ptr, size,
+                                 [out](const char* p, const char* e) {
+                                   return ReadPackedVarintArrayBulk<zigzag>(
+                                       p, e, out);
+                                 });
+}
+
 // Helper for verification of utf8
 PROTOBUF_EXPORT
 bool VerifyUTF8(absl::string_view s, const char* field_name);
@@ -0,0 +1,208 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/push_parser.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/message_lite.h"
+#include "google/protobuf/wire_format_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+absl::string_view Slice(absl::string_view chunk, size_t pos, size_t n) {
+  return chunk.substr(pos, n);
+}
+absl::Cord Slice(const absl::Cord& chunk, size_t pos, size_t n) {
+  return chunk.Subcord(pos, n);
+}
+
+bool MergePartial(absl::string_view data, MessageLite* message) {
+  return message->ParseFrom<MessageLite::kMergePartial>(data);
+}
+bool MergePartial(const absl::Cord& data, MessageLite* message) {
+  return message->MergePartialFromCord(data);
+}
+
+}  // namespace
+
+PushParser::PushParser(MessageLite* message) : message_(message) {}
+
+PushParser::~PushParser() = default;
+
+bool PushParser::Push(absl::string_view chunk) { return PushImpl(chunk); }
+
+bool PushParser::Push(const absl::Cord& chunk) { return PushImpl(chunk); }
+
+template <typename Chunk>
+bool PushParser::PushImpl(const Chunk& chunk) {
+  if (failed_) return false;
+  size_t first, last;
+  if (!Scan(chunk, &first, &last)) return Fail();
+  byte_count_ += chunk.size();
+  if (last == 0) {
+    // Still inside the same field.
+    pending_.Append(chunk);
+    return true;
+  }
+  size_t begin = 0;
+  if (!pending_.empty()) {
+    // The first field completed by this chunk began in an earlier one.
+    pending_.Append(Slice(chunk, 0, first));
+    if (!MergePartial(pending_, message_)) return Fail();
+    pending_.Clear();
+    begin = first;
+  }
+  if (last > begin && !MergePartial(Slice(chunk, begin, last - begin),
+                                    message_)) {
+    return Fail();
+  }
+  pending_.Append(Slice(chunk, last, chunk.size() - last));
+  return true;
+}
+
+bool PushParser::Finish() {
+  return FinishPartial() && message_->IsInitializedWithErrors();
+}
+
+bool PushParser::FinishPartial() {
+  if (failed_) return false;
+  if (state_ != State::kTag || varint_shift_ != 0 || !groups_.empty()) {
+    // The input ended in the middle of a field.
+    return Fail();
+  }
+  return true;
+}
+
+bool PushParser::Scan(absl::string_view data, size_t* first, size_t* last) {
+  *first = *last = 0;
+  const char* const begin = data.data();
+  const char* const end = begin + data.size();
+  const char* ptr = begin;
+  while (ptr < end) {
+    bool field_done = false;
+    if (state_ == State::kSkip) {
+      const size_t n =
+          static_cast<size_t>(std::min<uint64_t>(skip_, end - ptr));
+      ptr += n;
+      skip_ -= n;
+      if (skip_ != 0) break;
+      state_ = State::kTag;
+      field_done = true;
+    } else {
+      const uint8_t byte = static_cast<uint8_t>(*ptr++);
+      // The tenth byte of a varint can only hold the top bit of 64.
+      if (varint_shift_ == 63 && byte > 1) return false;
+      varint_ |= static_cast<uint64_t>(byte & 0x7f) << varint_shift_;
+      if (byte & 0x80) {
+        varint_shift_ += 7;
+        continue;
+      }
+      const uint64_t value = varint_;
+      varint_ = 0;
+      varint_shift_ = 0;
+      if (!OnVarint(value, &field_done)) return false;
+    }
+    if (field_done && groups_.empty()) {
+      const size_t offset = static_cast<size_t>(ptr - begin);
+      if (*first == 0) *first = offset;
+      *last = offset;
+    }
+  }
+  return true;
+}
+
+bool PushParser::Scan(const absl::Cord& data, size_t* first, size_t* last) {
+  *first = *last = 0;
+  size_t offset = 0;
+  for (absl::string_view piece : data.Chunks()) {
+    size_t piece_first, piece_last;
+    if (!Scan(piece, &piece_first, &piece_last)) return false;
+    if (piece_last != 0) {
+      if (*first == 0) *first = offset + piece_first;
+      *last = offset + piece_last;
+    }
+    offset += piece.size();
+  }
+  return true;
+}
+
+bool PushParser::OnVarint(uint64_t value, bool* field_done) {
+  using internal::WireFormatLite;
+  switch (state_) {
+    case State::kTag: {
+      if (value > UINT32_MAX) return false;
+      const uint32_t tag = static_cast<uint32_t>(value);
+      const uint32_t number = WireFormatLite::GetTagFieldNumber(tag);
+      if (number == 0) return false;
+      switch (WireFormatLite::GetTagWireType(tag)) {
+        case WireFormatLite::WIRETYPE_VARINT:
+          state_ = State::kVarint;
+          return true;
+        case WireFormatLite::WIRETYPE_FIXED64:
+          state_ = State::kSkip;
+          skip_ = 8;
+          return true;
+        case WireFormatLite::WIRETYPE_FIXED32:
+          state_ = State::kSkip;
+          skip_ = 4;
+          return true;
+        case WireFormatLite::WIRETYPE_LENGTH_DELIMITED:
+          state_ = State::kLength;
+          return true;
+        case WireFormatLite::WIRETYPE_START_GROUP:
+          // Parsing the group would exceed the recursion limit anyway.
+          if (groups_.size() >= static_cast<size_t>(
+                                    io::CodedInputStream::
+                                        GetDefaultRecursionLimit())) {
+            return false;
+          }
+          groups_.push_back(number);
+          return true;
+        case WireFormatLite::WIRETYPE_END_GROUP:
+          if (groups_.empty() || groups_.back() != number) return false;
+          groups_.pop_back();
+          *field_done = true;
+          return true;
+      }
+      return false;
+    }
+    case State::kVarint:
+      state_ = State::kTag;
+      *field_done = true;
+      return true;
+    case State::kLength:
+      if (value > INT_MAX) return false;
+      if (value == 0) {
+        state_ = State::kTag;
+        *field_done = true;
+      } else {
+        state_ = State::kSkip;
+        skip_ = value;
+      }
+      return true;
+    case State::kSkip:
+      break;
+  }
+  return false;
+}
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,118 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines PushParser, which parses a message from chunks of input
+// pushed by the caller as they arrive, instead of pulling them from a
+// ZeroCopyInputStream that must be able to produce the whole message.
+
+#ifndef GOOGLE_PROTOBUF_PUSH_PARSER_H__
+#define GOOGLE_PROTOBUF_PUSH_PARSER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/message_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+// Parses a message in the binary wire format from a sequence of chunks, e.g.
+// as they are received from the network:
+//
+//   PushParser parser(&message);
+//   while (ReceiveChunk(&chunk)) {
+//     if (!parser.Push(chunk)) return Error();
+//   }
+//   if (!parser.Finish()) return Error();
+//
+// Each top-level field is parsed as soon as its last byte has been pushed, so
+// parsing overlaps with receiving the rest of the message. Fields that lie
+// entirely within a chunk are parsed directly from it. When input runs out in
+// the middle of a field, the parser suspends and retains only the bytes of
+// that field, and resumes when the next chunk completes it. Chunks pushed as
+// absl::Cord are retained by reference rather than copied.
+//
+// The input is merged into the message, as with MergeFromString(): pushing a
+// message in any number of chunks gives the same result as merging it in one
+// piece.
+class PROTOBUF_EXPORT PushParser {
+ public:
+  // Does not take ownership of `message`, which must outlive the parser.
+  explicit PushParser(MessageLite* message);
+  PushParser(const PushParser&) = delete;
+  PushParser& operator=(const PushParser&) = delete;
+  ~PushParser();
+
+  // Parses the fields completed by the next chunk of input. Returns false if
+  // the input is malformed, in which case the message is left in an
+  // unspecified state and all further calls fail.
+  bool Push(absl::string_view chunk);
+  bool Push(const absl::Cord& chunk);
+
+  // Ends the input. Returns false if the input was malformed, ended in the
+  // middle of a field, or is missing required fields.
+  bool Finish();
+  // Like Finish(), but accepts messages that are missing required fields.
+  bool FinishPartial();
+
+  // The total number of bytes pushed.
+  int64_t ByteCount() const { return byte_count_; }
+  // The number of bytes retained for the field currently being received.
+  size_t BufferedBytes() const { return pending_.size(); }
+
+ private:
+  enum class State : uint8_t {
+    kTag,     // At the start of a tag, or inside one.
+    kVarint,  // Inside a varint field value.
+    kLength,  // Inside the length of a length-delimited field.
+    kSkip,    // Inside a fixed-size or length-delimited field value.
+  };
+
+  // Advances the scanner over `data`. Sets `*first` and `*last` to the
+  // offsets just past the first and last top-level fields completed in
+  // `data`, or to 0 if none is. Returns false on malformed input.
+  bool Scan(absl::string_view data, size_t* first, size_t* last);
+  bool Scan(const absl::Cord& data, size_t* first, size_t* last);
+  // Handles a complete varint in the current state. Sets `*field_done` if it
+  // ends a field.
+  bool OnVarint(uint64_t value, bool* field_done);
+
+  template <typename Chunk>
+  bool PushImpl(const Chunk& chunk);
+
+  bool Fail() {
+    failed_ = true;
+    return false;
+  }
+
+  MessageLite* const message_;
+  // The bytes received so far of the top-level field being received.
+  absl::Cord pending_;
+  int64_t byte_count_ = 0;
+  State state_ = State::kTag;
+  bool failed_ = false;
+  // The varint being decoded in kTag, kVarint and kLength.
+  uint64_t varint_ = 0;
+  int varint_shift_ = 0;
+  // The bytes left to skip in kSkip.
+  uint64_t skip_ = 0;
+  // The field numbers of the groups the scanner is inside of, innermost last.
+  std::vector<uint32_t> groups_;
+};
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_PUSH_PARSER_H__
@@ -0,0 +1,180 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/push_parser.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+using ::protobuf_unittest::TestRequired;
+
+// Pushes `data` in chunks of `chunk_size` bytes, each copied into a temporary
+// so that the parser cannot keep pointers into it.
+bool PushInChunks(absl::string_view data, size_t chunk_size,
+                  PushParser* parser) {
+  for (size_t i = 0; i < data.size(); i += chunk_size) {
+    const std::string chunk(data.substr(i, chunk_size));
+    if (!parser->Push(chunk)) return false;
+  }
+  return true;
+}
+
+TEST(PushParserTest, ParsesInChunksOfAnySize) {
+  TestAllTypes expected;
+  TestUtil::SetAllFields(&expected);
+  const std::string data = expected.SerializeAsString();
+
+  for (size_t chunk_size = 1; chunk_size <= data.size(); ++chunk_size) {
+    SCOPED_TRACE(chunk_size);
+    TestAllTypes message;
+    PushParser parser(&message);
+    ASSERT_TRUE(PushInChunks(data, chunk_size, &parser));
+    ASSERT_TRUE(parser.Finish());
+    EXPECT_EQ(parser.ByteCount(), static_cast<int64_t>(data.size()));
+    EXPECT_EQ(parser.BufferedBytes(), 0);
+    EXPECT_EQ(message.SerializeAsString(), data);
+  }
+}
+
+TEST(PushParserTest, ParsesCordChunks) {
+  TestAllTypes expected;
+  TestUtil::SetAllFields(&expected);
+  const std::string data = expected.SerializeAsString();
+
+  for (size_t chunk_size : {1, 5, 64, 1000}) {
+    SCOPED_TRACE(chunk_size);
+    TestAllTypes message;
+    PushParser parser(&message);
+    for (size_t i = 0; i < data.size(); i += chunk_size) {
+      // Build multi-piece cords so that fields also span pieces.
+      absl::Cord chunk;
+      for (char c : absl::string_view(data).substr(i, chunk_size)) {
+        chunk.Append(absl::Cord(std::string(1, c)));
+      }
+      ASSERT_TRUE(parser.Push(chunk));
+    }
+    ASSERT_TRUE(parser.Finish());
+    EXPECT_EQ(message.SerializeAsString(), data);
+  }
+}
+
+TEST(PushParserTest, MergesIntoMessage) {
+  TestAllTypes message;
+  message.set_optional_int32(1);
+  message.add_repeated_int32(2);
+  TestAllTypes input;
+  input.set_optional_int64(3);
+  input.add_repeated_int32(4);
+
+  PushParser parser(&message);
+  ASSERT_TRUE(PushInChunks(input.SerializeAsString(), 1, &parser));
+  ASSERT_TRUE(parser.Finish());
+  EXPECT_EQ(message.optional_int32(), 1);
+  EXPECT_EQ(message.optional_int64(), 3);
+  ASSERT_EQ(message.repeated_int32_size(), 2);
+  EXPECT_EQ(message.repeated_int32(1), 4);
+}
+
+TEST(PushParserTest, BuffersOnlyTheIncompleteField) {
+  TestAllTypes input;
+  input.set_optional_int32(1);
+  input.set_optional_bytes(std::string(1000, 'x'));
+  const std::string data = input.SerializeAsString();
+
+  TestAllTypes message;
+  PushParser parser(&message);
+  // The tag, length and first 100 bytes of optional_bytes.
+  ASSERT_TRUE(parser.Push(absl::string_view(data).substr(0, 105)));
+  EXPECT_EQ(message.optional_int32(), 1);
+  EXPECT_FALSE(message.has_optional_bytes());
+  EXPECT_EQ(parser.BufferedBytes(), 103);
+
+  ASSERT_TRUE(parser.Push(absl::string_view(data).substr(105)));
+  EXPECT_EQ(parser.BufferedBytes(), 0);
+  EXPECT_EQ(message.optional_bytes(), input.optional_bytes());
+  EXPECT_TRUE(parser.Finish());
+}
+
+TEST(PushParserTest, FailsOnTruncatedInput) {
+  TestAllTypes input;
+  input.mutable_optionalgroup()->set_a(117);
+  const std::string data = input.SerializeAsString();
+
+  // Cut the input inside optionalgroup, after the tag of `a`.
+  TestAllTypes message;
+  PushParser parser(&message);
+  ASSERT_TRUE(parser.Push(absl::string_view(data).substr(0, 4)));
+  EXPECT_EQ(parser.BufferedBytes(), 4);
+  EXPECT_FALSE(parser.Finish());
+  EXPECT_FALSE(parser.Push(absl::string_view(data).substr(4)));
+}
+
+TEST(PushParserTest, FailsOnMalformedInput) {
+  TestAllTypes message;
+  {
+    // Field number 0.
+    PushParser parser(&message);
+    EXPECT_FALSE(parser.Push(absl::string_view("\x00\x01", 2)));
+  }
+  {
+    // Invalid wire type.
+    PushParser parser(&message);
+    EXPECT_FALSE(parser.Push("\x0f"));
+  }
+  {
+    // Mismatched end group.
+    PushParser parser(&message);
+    EXPECT_TRUE(parser.Push("\x83\x01"));
+    EXPECT_FALSE(parser.Push("\x8c\x01"));
+  }
+  {
+    // Overlong varint.
+    PushParser parser(&message);
+    EXPECT_TRUE(parser.Push("\x08\xff\xff\xff\xff\xff"));
+    EXPECT_FALSE(parser.Push("\xff\xff\xff\xff\x7f"));
+  }
+}
+
+TEST(PushParserTest, ChecksRequiredFields) {
+  TestRequired message;
+  message.set_a(1);
+  const std::string data = message.SerializePartialAsString();
+  {
+    TestRequired parsed;
+    PushParser parser(&parsed);
+    ASSERT_TRUE(PushInChunks(data, 1, &parser));
+    EXPECT_FALSE(parser.Finish());
+  }
+  {
+    TestRequired parsed;
+    PushParser parser(&parsed);
+    ASSERT_TRUE(PushInChunks(data, 1, &parser));
+    EXPECT_TRUE(parser.FinishPartial());
+    EXPECT_EQ(parsed.a(), 1);
+  }
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
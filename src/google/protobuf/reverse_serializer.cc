@@ -0,0 +1,398 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/reverse_serializer.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "absl/container/inlined_vector.h"
+#include "absl/log/absl_check.h"
+#include "absl/log/absl_log.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/internal/resize_uninitialized.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/arenastring.h"
+#include "google/protobuf/generated_message_tcserializer.h"
+#include "google/protobuf/generated_message_tctable_decl.h"
+#include "google/protobuf/generated_message_tctable_impl.h"
+#include "google/protobuf/generated_message_util.h"
+#include "google/protobuf/inlined_string_field.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/message_lite.h"
+#include "google/protobuf/repeated_field.h"
+#include "google/protobuf/repeated_ptr_field.h"
+#include "google/protobuf/wire_format_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+void ReverseEncoder::WriteRaw(absl::string_view data) {
+  if (!data.empty()) memcpy(Prepend(data.size()), data.data(), data.size());
+}
+
+void ReverseEncoder::WriteCord(const absl::Cord& data) {
+  uint8_t* ptr = Prepend(data.size());
+  for (absl::string_view chunk : data.Chunks()) {
+    memcpy(ptr, chunk.data(), chunk.size());
+    ptr += chunk.size();
+  }
+}
+
+void ReverseEncoder::Finish(std::string* output) {
+  buffer_.erase(0, static_cast<size_t>(ptr_ - begin_));
+  output->swap(buffer_);
+  begin_ = ptr_ = end_ = nullptr;
+}
+
+void ReverseEncoder::Grow(size_t size) {
+  const size_t used = ByteCount();
+  const size_t capacity =
+      std::max({buffer_.size() * 2, used + size, size_t{256}});
+  std::string buffer;
+  absl::strings_internal::STLStringResizeUninitialized(&buffer, capacity);
+  uint8_t* begin = reinterpret_cast<uint8_t*>(&buffer[0]);
+  if (used != 0) memcpy(begin + capacity - used, ptr_, used);
+  buffer_.swap(buffer);
+  begin_ = begin;
+  end_ = begin + capacity;
+  ptr_ = end_ - used;
+}
+
+namespace {
+
+namespace fl = field_layout;
+using FieldEntry = TcParseTableBase::FieldEntry;
+
+template <typename T>
+const T& RefAt(const void* x, size_t offset) {
+  return *reinterpret_cast<const T*>(static_cast<const char*>(x) + offset);
+}
+
+void WriteFixed(uint32_t value, ReverseEncoder* out) {
+  out->WriteLittleEndian32(value);
+}
+void WriteFixed(uint64_t value, ReverseEncoder* out) {
+  out->WriteLittleEndian64(value);
+}
+
+constexpr WireFormatLite::WireType FixedWireType(uint32_t) {
+  return WireFormatLite::WIRETYPE_FIXED32;
+}
+constexpr WireFormatLite::WireType FixedWireType(uint64_t) {
+  return WireFormatLite::WIRETYPE_FIXED64;
+}
+
+}  // namespace
+
+// Walks messages through their TcParseTable, which MessageLite befriends.
+class ReverseSerializer {
+ public:
+  static void Serialize(const MessageLite& msg, ReverseEncoder* out);
+
+ private:
+  static bool CanSerialize(const MessageLite& msg,
+                           const TcParseTableBase* table);
+  static void SerializeForward(const MessageLite& msg, ReverseEncoder* out);
+
+  static void WriteField(const MessageLite& msg, const FieldEntry& entry,
+                         uint32_t number, ReverseEncoder* out);
+  template <typename T>
+  static void WriteVarints(const MessageLite& msg, const FieldEntry& entry,
+                           uint32_t number, ReverseEncoder* out);
+  template <typename T>
+  static void WriteFixeds(const MessageLite& msg, const FieldEntry& entry,
+                          uint32_t number, ReverseEncoder* out);
+  static void WriteStrings(const MessageLite& msg, const FieldEntry& entry,
+                           uint32_t number, ReverseEncoder* out);
+  static void WriteMessages(const MessageLite& msg, const FieldEntry& entry,
+                            uint32_t number, ReverseEncoder* out);
+  static void WriteMessage(const MessageLite& msg, uint32_t number,
+                           bool is_group, ReverseEncoder* out);
+
+};
+
+void ReverseSerializer::Serialize(const MessageLite& msg,
+                                  ReverseEncoder* out) {
+  const TcParseTableBase* table = msg.GetTcParseTable();
+  if (!CanSerialize(msg, table)) {
+    SerializeForward(msg, out);
+    return;
+  }
+  // Unknown fields come last in the output, so they are written first.
+  if (msg._internal_metadata_.have_unknown_fields()) {
+    out->WriteRaw(msg._internal_metadata_.unknown_fields<std::string>(
+        &GetEmptyString));
+  }
+  absl::InlinedVector<uint32_t, 32> numbers;
+  numbers.reserve(table->num_field_entries);
+  TcSerializer::ForEachField(table, [&](const FieldEntry&, uint32_t number) {
+    numbers.push_back(number);
+  });
+  const FieldEntry* entries = table->field_entries_begin();
+  for (size_t i = numbers.size(); i-- > 0;) {
+    WriteField(msg, entries[i], numbers[i], out);
+  }
+}
+
+bool ReverseSerializer::CanSerialize(const MessageLite& msg,
+                                     const TcParseTableBase* table) {
+  // Tables with other fallbacks belong to messages that are not generated
+  // code, or whose layout is only known to reflection.
+  if (table->fallback != &TcParser::GenericFallback &&
+      table->fallback != &TcParser::GenericFallbackLite) {
+    return false;
+  }
+  // Extensions are interleaved with fields by number.
+  if (table->extension_offset != 0) return false;
+  // Unknown fields of full messages are an UnknownFieldSet, which is not
+  // available to the lite runtime.
+  if (!msg.GetClassData()->is_lite &&
+      msg._internal_metadata_.have_unknown_fields()) {
+    return false;
+  }
+  for (const FieldEntry& entry : table->field_entries()) {
+    if (!TcSerializer::IsSupported(entry.type_card)) return false;
+  }
+  return true;
+}
+
+void ReverseSerializer::SerializeForward(const MessageLite& msg,
+                                         ReverseEncoder* out) {
+  const size_t size = msg.ByteSizeLong();
+  if (size > INT_MAX) {
+    out->SetHadError();
+    return;
+  }
+  uint8_t* target = out->Prepend(size);
+  io::EpsCopyOutputStream stream(
+      target, static_cast<int>(size),
+      io::CodedOutputStream::IsDefaultSerializationDeterministic());
+  uint8_t* end = msg._InternalSerialize(target, &stream);
+  ABSL_DCHECK(end == target + size);
+}
+
+void ReverseSerializer::WriteField(const MessageLite& msg,
+                                   const FieldEntry& entry, uint32_t number,
+                                   ReverseEncoder* out) {
+  const uint16_t type_card = entry.type_card;
+  if ((type_card & fl::kFcMask) != fl::kFcRepeated &&
+      !TcSerializer::HasField(msg, entry, number)) {
+    return;
+  }
+  const uint16_t rep = type_card & fl::kRepMask;
+  switch (type_card & fl::kFkMask) {
+    case fl::kFkVarint:
+    case fl::kFkPackedVarint:
+      switch (rep) {
+        case fl::kRep8Bits:
+          return WriteVarints<bool>(msg, entry, number, out);
+        case fl::kRep32Bits:
+          return WriteVarints<uint32_t>(msg, entry, number, out);
+        default:
+          return WriteVarints<uint64_t>(msg, entry, number, out);
+      }
+    case fl::kFkFixed:
+    case fl::kFkPackedFixed:
+      if (rep == fl::kRep32Bits) {
+        return WriteFixeds<uint32_t>(msg, entry, number, out);
+      }
+      return WriteFixeds<uint64_t>(msg, entry, number, out);
+    case fl::kFkString:
+      return WriteStrings(msg, entry, number, out);
+    case fl::kFkMessage:
+      return WriteMessages(msg, entry, number, out);
+  }
+}
+
+template <typename T>
+void ReverseSerializer::WriteVarints(const MessageLite& msg,
+                                     const FieldEntry& entry, uint32_t number,
+                                     ReverseEncoder* out) {
+  const uint16_t type_card = entry.type_card;
+  const uint16_t card = type_card & fl::kFcMask;
+  if (card != fl::kFcRepeated) {
+    const T value = RefAt<T>(&msg, entry.offset);
+    if (card == fl::kFcSingular && value == 0) return;
+    out->WriteVarint64(TcSerializer::ToVarint(value, type_card));
+    out->WriteTag(
+        WireFormatLite::MakeTag(number, WireFormatLite::WIRETYPE_VARINT));
+    return;
+  }
+  const auto& field = RefAt<RepeatedField<T>>(&msg, entry.offset);
+  if (field.empty()) return;
+  if ((type_card & fl::kFkMask) == fl::kFkPackedVarint) {
+    const size_t start = out->ByteCount();
+    for (int i = field.size(); i-- > 0;) {
+      out->WriteVarint64(TcSerializer::ToVarint(field.Get(i), type_card));
+    }
+    out->WriteVarint32(static_cast<uint32_t>(out->ByteCount() - start));
+    out->WriteTag(WireFormatLite::MakeTag(
+        number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+    return;
+  }
+  const uint32_t tag =
+      WireFormatLite::MakeTag(number, WireFormatLite::WIRETYPE_VARINT);
+  for (int i = field.size(); i-- > 0;) {
+    out->WriteVarint64(TcSerializer::ToVarint(field.Get(i), type_card));
+    out->WriteTag(tag);
+  }
+}
+
+template <typename T>
+void ReverseSerializer::WriteFixeds(const MessageLite& msg,
+                                    const FieldEntry& entry, uint32_t number,
+                                    ReverseEncoder* out) {
+  const uint16_t card = entry.type_card & fl::kFcMask;
+  if (card != fl::kFcRepeated) {
+    // Floating point values are compared bitwise, so that -0.0 is written.
+    const T value = RefAt<T>(&msg, entry.offset);
+    if (card == fl::kFcSingular && value == 0) return;
+    WriteFixed(value, out);
+    out->WriteTag(WireFormatLite::MakeTag(number, FixedWireType(T{})));
+    return;
+  }
+  const auto& field = RefAt<RepeatedField<T>>(&msg, entry.offset);
+  if (field.empty()) return;
+  if ((entry.type_card & fl::kFkMask) == fl::kFkPackedFixed) {
+    const size_t size = field.size() * sizeof(T);
+#ifdef ABSL_IS_LITTLE_ENDIAN
+    memcpy(out->Prepend(size), field.data(), size);
+#else
+    for (int i = field.size(); i-- > 0;) WriteFixed(field.Get(i), out);
+#endif
+    out->WriteVarint32(static_cast<uint32_t>(size));
+    out->WriteTag(WireFormatLite::MakeTag(
+        number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+    return;
+  }
+  const uint32_t tag = WireFormatLite::MakeTag(number, FixedWireType(T{}));
+  for (int i = field.size(); i-- > 0;) {
+    WriteFixed(field.Get(i), out);
+    out->WriteTag(tag);
+  }
+}
+
+void ReverseSerializer::WriteStrings(const MessageLite& msg,
+                                     const FieldEntry& entry, uint32_t number,
+                                     ReverseEncoder* out) {
+  const uint16_t card = entry.type_card & fl::kFcMask;
+  const uint16_t rep = entry.type_card & fl::kRepMask;
+  const uint32_t tag = WireFormatLite::MakeTag(
+      number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  if (card == fl::kFcRepeated) {
+    if (rep == fl::kRepCord) {
+      const auto& field = RefAt<RepeatedField<absl::Cord>>(&msg, entry.offset);
+      for (int i = field.size(); i-- > 0;) {
+        out->WriteCord(field.Get(i));
+        out->WriteVarint32(static_cast<uint32_t>(field.Get(i).size()));
+        out->WriteTag(tag);
+      }
+    } else {
+      const auto& field =
+          RefAt<RepeatedPtrField<std::string>>(&msg, entry.offset);
+      for (int i = field.size(); i-- > 0;) {
+        out->WriteRaw(field.Get(i));
+        out->WriteVarint32(static_cast<uint32_t>(field.Get(i).size()));
+        out->WriteTag(tag);
+      }
+    }
+    return;
+  }
+  size_t size;
+  if (rep == fl::kRepCord) {
+    const absl::Cord& value = card == fl::kFcOneof
+                                  ? *RefAt<absl::Cord*>(&msg, entry.offset)
+                                  : RefAt<absl::Cord>(&msg, entry.offset);
+    size = value.size();
+    if (card == fl::kFcSingular && size == 0) return;
+    out->WriteCord(value);
+  } else {
+    const std::string& value =
+        rep == fl::kRepIString
+            ? RefAt<InlinedStringField>(&msg, entry.offset).Get()
+            : RefAt<ArenaStringPtr>(&msg, entry.offset).Get();
+    size = value.size();
+    if (card == fl::kFcSingular && size == 0) return;
+    out->WriteRaw(value);
+  }
+  out->WriteVarint32(static_cast<uint32_t>(size));
+  out->WriteTag(tag);
+}
+
+void ReverseSerializer::WriteMessages(const MessageLite& msg,
+                                      const FieldEntry& entry, uint32_t number,
+                                      ReverseEncoder* out) {
+  const bool is_group = (entry.type_card & fl::kRepMask) == fl::kRepGroup;
+  if ((entry.type_card & fl::kFcMask) == fl::kFcRepeated) {
+    const auto& field =
+        RefAt<RepeatedPtrField<MessageLite>>(&msg, entry.offset);
+    for (int i = field.size(); i-- > 0;) {
+      WriteMessage(field.Get(i), number, is_group, out);
+    }
+    return;
+  }
+  const MessageLite* value = RefAt<const MessageLite*>(&msg, entry.offset);
+  if (value == nullptr) return;
+  WriteMessage(*value, number, is_group, out);
+}
+
+void ReverseSerializer::WriteMessage(const MessageLite& msg, uint32_t number,
+                                     bool is_group, ReverseEncoder* out) {
+  if (is_group) {
+    out->WriteTag(
+        WireFormatLite::MakeTag(number, WireFormatLite::WIRETYPE_END_GROUP));
+    Serialize(msg, out);
+    out->WriteTag(
+        WireFormatLite::MakeTag(number, WireFormatLite::WIRETYPE_START_GROUP));
+    return;
+  }
+  const size_t start = out->ByteCount();
+  Serialize(msg, out);
+  const size_t size = out->ByteCount() - start;
+  if (size > INT_MAX) out->SetHadError();
+  out->WriteVarint32(static_cast<uint32_t>(size));
+  out->WriteTag(WireFormatLite::MakeTag(
+      number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+}
+
+}  // namespace internal
+
+bool SerializeReversedToString(const MessageLite& message,
+                               std::string* output) {
+  ABSL_DCHECK(message.IsInitialized())
+      << "Can't serialize message of type \"" << message.GetTypeName()
+      << "\" because it is missing required fields: "
+      << message.InitializationErrorString();
+  return SerializePartialReversedToString(message, output);
+}
+
+bool SerializePartialReversedToString(const MessageLite& message,
+                                      std::string* output) {
+  internal::ReverseEncoder encoder;
+  internal::ReverseSerializer::Serialize(message, &encoder);
+  if (encoder.HadError() || encoder.ByteCount() > INT_MAX) {
+    ABSL_LOG(ERROR) << message.GetTypeName()
+                    << " exceeded maximum protobuf size of 2GB";
+    return false;
+  }
+  encoder.Finish(output);
+  return true;
+}
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
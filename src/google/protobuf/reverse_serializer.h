@@ -0,0 +1,117 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines an opt-in serializer that encodes a message in a single
+// pass, writing the output back to front.
+
+#ifndef GOOGLE_PROTOBUF_REVERSE_SERIALIZER_H__
+#define GOOGLE_PROTOBUF_REVERSE_SERIALIZER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/message_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+// Serializes `message` into `output`, replacing its contents. The output is
+// the same as that of MessageLite::SerializeToString().
+//
+// SerializeToString() makes two passes over the message: ByteSizeLong()
+// computes and caches the size of every submessage, so that the length
+// prefixes can be written before the submessages themselves. These functions
+// instead write the fields in reverse order from the end of the buffer, so
+// the length of each submessage is known by the time its prefix is written,
+// and the message is serialized in a single pass without touching the cached
+// sizes. This is typically faster for deeply nested messages.
+//
+// Messages whose layout the reverse serializer does not support (e.g. those
+// with extensions, maps or split fields) are serialized with the regular
+// serializer and copied in as a whole.
+PROTOBUF_EXPORT bool SerializeReversedToString(const MessageLite& message,
+                                               std::string* output);
+// Like SerializeReversedToString(), but allows missing required fields.
+PROTOBUF_EXPORT bool SerializePartialReversedToString(
+    const MessageLite& message, std::string* output);
+
+namespace internal {
+
+// A buffer that is written back to front. Each write prepends its bytes to
+// those written before it.
+class PROTOBUF_EXPORT ReverseEncoder {
+ public:
+  ReverseEncoder() = default;
+  ReverseEncoder(const ReverseEncoder&) = delete;
+  ReverseEncoder& operator=(const ReverseEncoder&) = delete;
+
+  // The number of bytes written so far. The difference between two calls is
+  // the size of what was written in between.
+  size_t ByteCount() const { return static_cast<size_t>(end_ - ptr_); }
+
+  // Reserves `size` bytes in front of the bytes written so far and returns a
+  // pointer to them. The caller must fill them in.
+  uint8_t* Prepend(size_t size) {
+    if (PROTOBUF_PREDICT_FALSE(static_cast<size_t>(ptr_ - begin_) < size)) {
+      Grow(size);
+    }
+    ptr_ -= size;
+    return ptr_;
+  }
+
+  void WriteTag(uint32_t tag) { WriteVarint32(tag); }
+  void WriteVarint32(uint32_t value) {
+    io::CodedOutputStream::WriteVarint32ToArray(
+        value, Prepend(io::CodedOutputStream::VarintSize32(value)));
+  }
+  void WriteVarint64(uint64_t value) {
+    io::CodedOutputStream::WriteVarint64ToArray(
+        value, Prepend(io::CodedOutputStream::VarintSize64(value)));
+  }
+  void WriteLittleEndian32(uint32_t value) {
+    io::CodedOutputStream::WriteLittleEndian32ToArray(value, Prepend(4));
+  }
+  void WriteLittleEndian64(uint64_t value) {
+    io::CodedOutputStream::WriteLittleEndian64ToArray(value, Prepend(8));
+  }
+  void WriteRaw(absl::string_view data);
+  void WriteCord(const absl::Cord& data);
+
+  // Marks the output as unusable, e.g. because it would be too large.
+  void SetHadError() { had_error_ = true; }
+  bool HadError() const { return had_error_; }
+
+  // Moves the bytes written into `output`, replacing its contents. The
+  // encoder must not be used afterwards.
+  void Finish(std::string* output);
+
+ private:
+  // Reallocates the buffer so that at least `size` bytes are free in front.
+  void Grow(size_t size);
+
+  std::string buffer_;
+  // The bytes written so far are [ptr_, end_), at the back of buffer_.
+  uint8_t* begin_ = nullptr;
+  uint8_t* ptr_ = nullptr;
+  uint8_t* end_ = nullptr;
+  bool had_error_ = false;
+};
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_REVERSE_SERIALIZER_H__
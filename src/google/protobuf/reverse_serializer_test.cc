@@ -0,0 +1,174 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/reverse_serializer.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/strings/cord.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/unittest_lite.pb.h"
+#include "google/protobuf/unittest_proto3.pb.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+using ::protobuf_unittest::MessageCreatorMemcpy;
+using ::protobuf_unittest::NestedTestAllTypes;
+using ::protobuf_unittest::TestAllExtensions;
+using ::protobuf_unittest::TestAllTypes;
+using ::protobuf_unittest::TestChildExtension;
+using ::protobuf_unittest::TestOneof2;
+using ::protobuf_unittest::TestPackedTypes;
+using ::protobuf_unittest::TestRequired;
+using ::protobuf_unittest::TestUnpackedTypes;
+
+// Checks that the reverse serializer produces the same bytes as the regular
+// one.
+void ExpectSameBytes(const MessageLite& message) {
+  std::string reversed = "garbage";
+  ASSERT_TRUE(SerializePartialReversedToString(message, &reversed));
+  EXPECT_EQ(reversed, message.SerializePartialAsString());
+}
+
+TEST(ReverseSerializerTest, AllTypes) {
+  TestAllTypes message;
+  ExpectSameBytes(message);
+  TestUtil::SetAllFields(&message);
+  ExpectSameBytes(message);
+}
+
+TEST(ReverseSerializerTest, NegativeValues) {
+  TestAllTypes message;
+  message.set_optional_int32(-1);
+  message.set_optional_sint32(-2);
+  message.set_optional_sint64(-3);
+  message.set_optional_double(-0.0);
+  message.set_optional_nested_enum(TestAllTypes::NEG);
+  message.add_repeated_int32(-4);
+  message.add_repeated_nested_enum(TestAllTypes::NEG);
+  ExpectSameBytes(message);
+}
+
+TEST(ReverseSerializerTest, PackedAndUnpacked) {
+  TestPackedTypes packed;
+  TestUtil::SetPackedFields(&packed);
+  ExpectSameBytes(packed);
+  TestUnpackedTypes unpacked;
+  TestUtil::SetUnpackedFields(&unpacked);
+  ExpectSameBytes(unpacked);
+}
+
+TEST(ReverseSerializerTest, Oneofs) {
+  TestOneof2 message;
+  message.set_foo_string("foo");
+  message.set_bar_string("bar");
+  message.set_baz_int(1);
+  ExpectSameBytes(message);
+  message.mutable_foo_message()->set_moo_int(2);
+  message.mutable_foogroup()->set_a(3);
+  ExpectSameBytes(message);
+}
+
+TEST(ReverseSerializerTest, DeeplyNested) {
+  NestedTestAllTypes message;
+  NestedTestAllTypes* child = &message;
+  for (int i = 0; i < 50; ++i) {
+    child->mutable_payload()->set_optional_string(std::string(i * 10, 'x'));
+    child->add_repeated_child()->mutable_payload()->add_repeated_int64(i);
+    child = child->mutable_child();
+  }
+  TestUtil::SetAllFields(child->mutable_payload());
+  ExpectSameBytes(message);
+}
+
+TEST(ReverseSerializerTest, ImplicitPresence) {
+  proto3_unittest::TestAllTypes message;
+  ExpectSameBytes(message);
+  message.set_optional_int32(1);
+  message.set_optional_float(-0.0f);
+  message.set_optional_string("abc");
+  message.set_optional_nested_enum(proto3_unittest::TestAllTypes::BAZ);
+  message.mutable_optional_nested_message()->set_bb(2);
+  message.add_repeated_int32(-3);
+  message.add_repeated_nested_message()->set_bb(0);
+  ExpectSameBytes(message);
+}
+
+TEST(ReverseSerializerTest, UnknownFields) {
+  TestAllTypes source;
+  TestUtil::SetAllFields(&source);
+  const std::string data = source.SerializeAsString();
+
+  // Parsing into a message that knows none of the fields keeps them all as
+  // unknown fields.
+  protobuf_unittest::TestEmptyMessage empty;
+  ASSERT_TRUE(empty.ParseFromString(data));
+  ExpectSameBytes(empty);
+
+  unittest::TestEmptyMessageLite empty_lite;
+  ASSERT_TRUE(empty_lite.ParseFromString(data));
+  ExpectSameBytes(empty_lite);
+
+  unittest::TestAllTypesLite lite;
+  lite.set_optional_int32(1);
+  lite.add_repeated_string("a");
+  lite.mutable_optional_nested_message()->set_bb(2);
+  ASSERT_TRUE(lite.MergeFromString(empty_lite.SerializeAsString()));
+  ExpectSameBytes(lite);
+}
+
+TEST(ReverseSerializerTest, FallsBackForUnsupportedMessages) {
+  TestAllExtensions extensions;
+  TestUtil::SetAllExtensions(&extensions);
+  ExpectSameBytes(extensions);
+
+  TestChildExtension child;
+  child.set_a("a");
+  TestUtil::SetAllExtensions(child.mutable_optional_extension());
+  child.set_b("b");
+  ExpectSameBytes(child);
+
+  MessageCreatorMemcpy with_map;
+  with_map.set_s("abc");
+  (*with_map.mutable_m2())[1] = 2;
+  with_map.mutable_m()->add_i(3);
+  ExpectSameBytes(with_map);
+}
+
+TEST(ReverseSerializerTest, ChecksRequiredFields) {
+  TestRequired message;
+  message.set_a(1);
+  std::string output;
+  EXPECT_TRUE(SerializePartialReversedToString(message, &output));
+  EXPECT_EQ(output, message.SerializePartialAsString());
+  message.set_b(2);
+  message.set_c(3);
+  EXPECT_TRUE(SerializeReversedToString(message, &output));
+  EXPECT_EQ(output, message.SerializeAsString());
+}
+
+TEST(ReverseSerializerTest, DoesNotUpdateCachedSizes) {
+  NestedTestAllTypes message;
+  message.mutable_child()->mutable_payload()->set_optional_int32(1);
+  std::string output;
+  ASSERT_TRUE(SerializeReversedToString(message, &output));
+  EXPECT_EQ(message.child().GetCachedSize(), 0);
+  EXPECT_EQ(output, message.SerializeAsString());
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
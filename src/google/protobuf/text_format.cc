@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "absl/container/btree_set.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/absl_check.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/cord.h"
@@ -37,6 +38,7 @@
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/any.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/descriptor.pb.h"
 #include "google/protobuf/dynamic_message.h"
@@ -413,6 +415,29 @@ class TextFormat::Parser::ParserImpl {
     }
   }
 
+  // Like Parse(), but hands each element of the repeated message field
+  // `field` of `output` to `callback` as soon as it has been parsed instead of
+  // adding it to `output`. Elements are created on `arena`, which is Reset()
+  // after each of them, or else one heap-allocated element is Clear()ed and
+  // reused.
+  bool ParseStreaming(Message* output, const FieldDescriptor* field,
+                      Arena* arena,
+                      absl::FunctionRef<bool(Message&)> callback) {
+    MessageFactory* factory =
+        finder_ ? finder_->FindExtensionFactory(field) : nullptr;
+    if (factory == nullptr) {
+      factory = output->GetReflection()->GetMessageFactory();
+    }
+    stream_root_ = output;
+    stream_field_ = field;
+    stream_prototype_ = factory->GetPrototype(field->message_type());
+    stream_arena_ = arena;
+    stream_callback_ = &callback;
+    bool result = Parse(output);
+    stream_callback_ = nullptr;
+    return result;
+  }
+
   bool ParseField(const FieldDescriptor* field, Message* output) {
     bool suc;
     if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
@@ -737,7 +762,7 @@ class TextFormat::Parser::ParserImpl {
 
     // If a parse info tree exists, add the location for the parsed
     // field.
-    if (parse_info_tree_ != nullptr) {
+    if (parse_info_tree_ != nullptr && !IsStreamed(message, field)) {
       int end_line = tokenizer_.previous().line;
       int end_column = tokenizer_.previous().end_column;
 
@@ -792,6 +817,11 @@ class TextFormat::Parser::ParserImpl {
                        initial_recursion_limit_, "."));
       return false;
     }
+    if (IsStreamed(message, field)) {
+      DO(ConsumeStreamedMessage());
+      ++recursion_limit_;
+      return true;
+    }
     // If the parse information tree is not nullptr, create a nested one
     // for the nested message.
     ParseInfoTree* parent = parse_info_tree_;
@@ -818,6 +848,52 @@ class TextFormat::Parser::ParserImpl {
     return true;
   }
 
+  // Returns true if elements of `field` in `message` go to the callback given
+  // to ParseStreaming().
+  bool IsStreamed(const Message* message, const FieldDescriptor* field) const {
+    return field == stream_field_ && message == stream_root_;
+  }
+
+  // Parses one element of the streamed field, including its delimiters, and
+  // passes it to the callback. Locations within it are not recorded, since the
+  // parse info tree would otherwise grow with the input.
+  bool ConsumeStreamedMessage() {
+    int start_line = tokenizer_.current().line;
+    int start_column = tokenizer_.current().column;
+    std::string delimiter;
+    DO(ConsumeMessageDelimiter(&delimiter));
+
+    if (stream_element_ == nullptr) {
+      stream_element_ = stream_prototype_->New(stream_arena_);
+      if (stream_arena_ == nullptr) {
+        stream_owned_element_.reset(stream_element_);
+      }
+    }
+    ParseInfoTree* parent = parse_info_tree_;
+    parse_info_tree_ = nullptr;
+    bool consumed = ConsumeMessage(stream_element_, delimiter);
+    parse_info_tree_ = parent;
+    DO(consumed);
+
+    if (!allow_partial_ && !stream_element_->IsInitialized()) {
+      std::vector<std::string> missing_fields;
+      stream_element_->FindInitializationErrors(&missing_fields);
+      ReportError(start_line, start_column,
+                  absl::StrCat("Message missing required fields: ",
+                               absl::StrJoin(missing_fields, ", ")));
+      return false;
+    }
+    DO((*stream_callback_)(*stream_element_));
+
+    if (stream_arena_ != nullptr) {
+      stream_element_ = nullptr;
+      stream_arena_->Reset();
+    } else {
+      stream_element_->Clear();
+    }
+    return true;
+  }
+
   // Skips the whole body of a message including the beginning delimiter and
   // the ending delimiter.
   bool SkipFieldMessage() {
@@ -1446,12 +1522,20 @@ class TextFormat::Parser::ParserImpl {
   bool had_errors_;
   UnsetFieldsMetadata* no_op_fields_{};
 
+  // State for ParseStreaming().
+  const Message* stream_root_ = nullptr;
+  const FieldDescriptor* stream_field_ = nullptr;
+  const Message* stream_prototype_ = nullptr;
+  Arena* stream_arena_ = nullptr;
+  const absl::FunctionRef<bool(Message&)>* stream_callback_ = nullptr;
+  Message* stream_element_ = nullptr;
+  std::unique_ptr<Message> stream_owned_element_;
 };
 
 // ===========================================================================
 // Internal class for writing text to the io::ZeroCopyOutputStream. Adapted
 // from the Printer found in //third_party/protobuf/io/printer.h
-class TextFormat::Printer::TextGenerator
+class TextFormat::Printer::TextGenerator final
     : public TextFormat::BaseTextGenerator {
  public:
   explicit TextGenerator(io::ZeroCopyOutputStream* output,
@@ -1509,21 +1593,20 @@ class TextFormat::Printer::TextGenerator
   // Print text to the output stream.
   void Print(const char* text, size_t size) override {
     if (indent_level_ > 0) {
-      size_t pos = 0;  // The number of bytes we've written so far.
-      for (size_t i = 0; i < size; i++) {
-        if (text[i] == '\n') {
-          // Saw newline.  If there is more text, we may need to insert an
-          // indent here.  So, write what we have so far, including the '\n'.
-          Write(text + pos, i - pos + 1);
-          pos = i + 1;
-
-          // Setting this true will cause the next Write() to insert an indent
-          // first.
-          at_start_of_line_ = true;
-        }
+      const char* end = text + size;
+      while (const char* newline = static_cast<const char*>(
+                 memchr(text, '\n', static_cast<size_t>(end - text)))) {
+        // Saw newline.  If there is more text, we may need to insert an
+        // indent here.  So, write what we have so far, including the '\n'.
+        Write(text, static_cast<size_t>(newline - text) + 1);
+        text = newline + 1;
+
+        // Setting this true will cause the next Write() to insert an indent
+        // first.
+        at_start_of_line_ = true;
       }
       // Write the rest.
-      Write(text + pos, size - pos);
+      Write(text, static_cast<size_t>(end - text));
     } else {
       Write(text, size);
       if (size > 0 && text[size - 1] == '\n') {
@@ -1532,6 +1615,16 @@ class TextFormat::Printer::TextGenerator
     }
   }
 
+  // Prints `text`, which must not contain a newline.  Unlike Print(), this
+  // is not virtual and does not scan the text.
+  void Append(absl::string_view text) { Write(text.data(), text.size()); }
+
+  // Ends the current line; the next write starts with the indent.
+  void EndLine() {
+    Write("\n", 1);
+    at_start_of_line_ = true;
+  }
+
   // True if any write to the underlying stream failed.  (We don't just
   // crash in this case because this is an I/O failure, not a programming
   // error.)
@@ -1832,6 +1925,41 @@ bool TextFormat::Parser::Parse(io::ZeroCopyInputStream* input,
   return MergeUsingImpl(input, output, &parser);
 }
 
+bool TextFormat::Parser::ParseStreaming(
+    io::ZeroCopyInputStream* input, Message* output,
+    const FieldDescriptor* field, absl::FunctionRef<bool(Message&)> callback,
+    Arena* arena) {
+  ABSL_CHECK(field->is_repeated() &&
+             field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE &&
+             field->containing_type() == output->GetDescriptor())
+      << field->full_name() << " is not a repeated message field of "
+      << output->GetDescriptor()->full_name() << ".";
+  ABSL_DCHECK(arena == nullptr || output->GetArena() != arena)
+      << "The streaming arena is reset after each element.";
+  output->Clear();
+
+  ParserImpl::SingularOverwritePolicy overwrites_policy =
+      allow_singular_overwrites_ ? ParserImpl::ALLOW_SINGULAR_OVERWRITES
+                                 : ParserImpl::FORBID_SINGULAR_OVERWRITES;
+
+  ParserImpl parser(output->GetDescriptor(), input, error_collector_, finder_,
+                    parse_info_tree_, overwrites_policy,
+                    allow_case_insensitive_field_, allow_unknown_field_,
+                    allow_unknown_extension_, allow_unknown_enum_,
+                    allow_field_number_, allow_relaxed_whitespace_,
+                    allow_partial_, recursion_limit_, no_op_fields_);
+  if (!parser.ParseStreaming(output, field, arena, callback)) return false;
+  if (!allow_partial_ && !output->IsInitialized()) {
+    std::vector<std::string> missing_fields;
+    output->FindInitializationErrors(&missing_fields);
+    parser.ReportError(-1, 0,
+                       absl::StrCat("Message missing required fields: ",
+                                    absl::StrJoin(missing_fields, ", ")));
+    return false;
+  }
+  return true;
+}
+
 bool TextFormat::Parser::ParseFromString(absl::string_view input,
                                          Message* output) {
   DO(CheckParseInputSize(input, error_collector_));
@@ -2032,11 +2160,13 @@ void TextFormat::FastFieldValuePrinter::PrintUInt64(
 }
 void TextFormat::FastFieldValuePrinter::PrintFloat(
     float val, BaseTextGenerator* generator) const {
-  generator->PrintString(!std::isnan(val) ? io::SimpleFtoa(val) : "nan");
+  char buffer[io::kShortestToBufferSize];
+  generator->PrintString(io::ShortestFtoa(val, buffer));
 }
 void TextFormat::FastFieldValuePrinter::PrintDouble(
     double val, BaseTextGenerator* generator) const {
-  generator->PrintString(!std::isnan(val) ? io::SimpleDtoa(val) : "nan");
+  char buffer[io::kShortestToBufferSize];
+  generator->PrintString(io::ShortestDtoa(val, buffer));
 }
 void TextFormat::FastFieldValuePrinter::PrintEnum(
     int32_t /*val*/, const std::string& name,
@@ -2200,6 +2330,8 @@ TextFormat::Printer::Printer()
       print_message_fields_in_index_order_(false),
       expand_any_(false),
       truncate_string_field_longer_than_(0LL),
+      builtin_field_value_printer_(false),
+      utf8_string_escaping_(false),
       finder_(nullptr) {
   SetUseUtf8StringEscaping(false);
 }
@@ -2207,16 +2339,20 @@ TextFormat::Printer::Printer()
 void TextFormat::Printer::SetUseUtf8StringEscaping(bool as_utf8) {
   SetDefaultFieldValuePrinter(as_utf8 ? new FastFieldValuePrinterUtf8Escaping()
                                       : new DebugStringFieldValuePrinter());
+  builtin_field_value_printer_ = true;
+  utf8_string_escaping_ = as_utf8;
 }
 
 void TextFormat::Printer::SetDefaultFieldValuePrinter(
     const FieldValuePrinter* printer) {
   default_field_value_printer_.reset(new FieldValuePrinterWrapper(printer));
+  builtin_field_value_printer_ = false;
 }
 
 void TextFormat::Printer::SetDefaultFieldValuePrinter(
     const FastFieldValuePrinter* printer) {
   default_field_value_printer_.reset(printer);
+  builtin_field_value_printer_ = false;
 }
 
 bool TextFormat::Printer::RegisterFieldValuePrinter(
@@ -2294,8 +2430,11 @@ bool TextFormat::Printer::Print(const Message& message,
                                 internal::FieldReporterLevel reporter) const {
   TextGenerator generator(output, insert_silent_marker_, initial_indent_level_);
 
-
-  Print(message, &generator);
+  if (CanPrintFast()) {
+    PrintFast(message, &generator);
+  } else {
+    Print(message, &generator);
+  }
 
   // Output false if the generator failed internally.
   return !generator.failed();
@@ -2827,6 +2966,242 @@ void TextFormat::Printer::PrintFieldValue(const Message& message,
   }
 }
 
+namespace {
+// Returns true if absl::CEscape() would return `val` unchanged.
+bool IsCEscaped(absl::string_view val) {
+  for (char c : val) {
+    unsigned char uc = static_cast<unsigned char>(c);
+    if (uc >= 0x80 || DefinitelyNeedsEscape(uc)) return false;
+  }
+  return true;
+}
+}  // namespace
+
+void TextFormat::Printer::PrintFast(const Message& message,
+                                    TextGenerator* generator) const {
+  const Reflection* reflection = message.GetReflection();
+  const Descriptor* descriptor = message.GetDescriptor();
+  if (reflection == nullptr ||
+      (expand_any_ && descriptor->full_name() == internal::kAnyFullTypeName)) {
+    Print(message, generator);
+    return;
+  }
+
+  std::vector<const FieldDescriptor*> fields;
+  if (descriptor->options().map_entry()) {
+    fields.push_back(descriptor->field(0));
+    fields.push_back(descriptor->field(1));
+  } else {
+    reflection->ListFields(message, &fields);
+  }
+
+  if (print_message_fields_in_index_order_) {
+    std::sort(fields.begin(), fields.end(), FieldIndexSorter());
+  }
+  for (const FieldDescriptor* field : fields) {
+    PrintFieldFast(message, reflection, field, generator);
+  }
+  if (!hide_unknown_fields_) {
+    PrintUnknownFields(reflection->GetUnknownFields(message), generator,
+                       kUnknownFieldRecursionLimit);
+  }
+}
+
+void TextFormat::Printer::PrintFieldFast(const Message& message,
+                                         const Reflection* reflection,
+                                         const FieldDescriptor* field,
+                                         TextGenerator* generator) const {
+  // Matches FastFieldValuePrinter::PrintFieldName().
+  auto print_name = [&] {
+    if (use_field_number_) {
+      generator->Append(absl::AlphaNum(field->number()).Piece());
+    } else if (field->is_extension()) {
+      generator->Append("[");
+      generator->Append(field->PrintableNameForExtension());
+      generator->Append("]");
+    } else if (internal::cpp::IsGroupLike(*field)) {
+      generator->Append(field->message_type()->name());
+    } else {
+      generator->Append(field->name());
+    }
+  };
+  auto end_field = [&](absl::string_view text) {
+    generator->Append(text);
+    if (single_line_mode_) {
+      generator->Append(" ");
+    } else {
+      generator->EndLine();
+    }
+  };
+
+  if (use_short_repeated_primitives_ && field->is_repeated() &&
+      field->cpp_type() != FieldDescriptor::CPPTYPE_STRING &&
+      field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) {
+    int size = reflection->FieldSize(message, field);
+    print_name();
+    generator->PrintMaybeWithMarker(MarkerToken(), ": ", "[");
+    for (int i = 0; i < size; i++) {
+      if (i > 0) generator->Append(", ");
+      PrintFieldValueFast(message, reflection, field, i, generator);
+    }
+    end_field("]");
+    return;
+  }
+
+  int count = 0;
+  if (field->is_repeated()) {
+    count = reflection->FieldSize(message, field);
+  } else if (reflection->HasField(message, field) ||
+             field->containing_type()->options().map_entry()) {
+    count = 1;
+  }
+
+  std::vector<const Message*> sorted_map_field;
+  bool need_release = false;
+  bool is_map = field->is_map();
+  if (is_map) {
+    need_release = internal::MapFieldPrinterHelper::SortMap(
+        message, reflection, field, &sorted_map_field);
+  }
+
+  for (int j = 0; j < count; ++j) {
+    print_name();
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      const Message& sub_message =
+          field->is_repeated()
+              ? (is_map ? *sorted_map_field[j]
+                        : reflection->GetRepeatedMessage(message, field, j))
+              : reflection->GetMessage(message, field);
+      // Matches DebugStringFieldValuePrinter::PrintMessageStart().
+      generator->PrintMaybeWithMarker(MarkerToken(), " ",
+                                      single_line_mode_ ? "{ " : "{\n");
+      generator->Indent();
+      PrintFast(sub_message, generator);
+      generator->Outdent();
+      end_field("}");
+    } else {
+      generator->PrintMaybeWithMarker(MarkerToken(), ": ");
+      PrintFieldValueFast(message, reflection, field,
+                          field->is_repeated() ? j : -1, generator);
+      end_field("");
+    }
+  }
+
+  if (need_release) {
+    for (const Message* message_to_delete : sorted_map_field) {
+      delete message_to_delete;
+    }
+  }
+}
+
+void TextFormat::Printer::PrintFieldValueFast(const Message& message,
+                                              const Reflection* reflection,
+                                              const FieldDescriptor* field,
+                                              int index,
+                                              TextGenerator* generator) const {
+  switch (field->cpp_type()) {
+#define OUTPUT_FIELD(CPPTYPE, METHOD)                                   \
+  case FieldDescriptor::CPPTYPE_##CPPTYPE:                              \
+    generator->Append(                                                  \
+        absl::AlphaNum(                                                 \
+            field->is_repeated()                                        \
+                ? reflection->GetRepeated##METHOD(message, field, index) \
+                : reflection->Get##METHOD(message, field))              \
+            .Piece());                                                  \
+    break
+
+    OUTPUT_FIELD(INT32, Int32);
+    OUTPUT_FIELD(INT64, Int64);
+    OUTPUT_FIELD(UINT32, UInt32);
+    OUTPUT_FIELD(UINT64, UInt64);
+#undef OUTPUT_FIELD
+
+    case FieldDescriptor::CPPTYPE_FLOAT: {
+      char buffer[io::kShortestToBufferSize];
+      generator->Append(io::ShortestFtoa(
+          field->is_repeated()
+              ? reflection->GetRepeatedFloat(message, field, index)
+              : reflection->GetFloat(message, field),
+          buffer));
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_DOUBLE: {
+      char buffer[io::kShortestToBufferSize];
+      generator->Append(io::ShortestDtoa(
+          field->is_repeated()
+              ? reflection->GetRepeatedDouble(message, field, index)
+              : reflection->GetDouble(message, field),
+          buffer));
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_BOOL: {
+      bool value = field->is_repeated()
+                       ? reflection->GetRepeatedBool(message, field, index)
+                       : reflection->GetBool(message, field);
+      generator->Append(value ? "true" : "false");
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_STRING: {
+      std::string scratch;
+      absl::string_view value =
+          field->is_repeated()
+              ? reflection->GetRepeatedStringReference(message, field, index,
+                                                       &scratch)
+              : reflection->GetStringReference(message, field, &scratch);
+      std::string truncated_value;
+      if (truncate_string_field_longer_than_ > 0 &&
+          static_cast<size_t>(truncate_string_field_longer_than_) <
+              value.size()) {
+        truncated_value =
+            absl::StrCat(value.substr(0, truncate_string_field_longer_than_),
+                         "...<truncated>...");
+        value = truncated_value;
+      }
+      if (utf8_string_escaping_ &&
+          field->type() == FieldDescriptor::TYPE_STRING) {
+        if (SkipPassthroughBytes(value) != value.size()) {
+          HardenedPrintString(value, generator);
+          break;
+        }
+      } else if (!IsCEscaped(value)) {
+        generator->Append("\"");
+        generator->Append(absl::CEscape(value));
+        generator->Append("\"");
+        break;
+      }
+      generator->Append("\"");
+      generator->Append(value);
+      generator->Append("\"");
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_ENUM: {
+      int enum_value =
+          field->is_repeated()
+              ? reflection->GetRepeatedEnumValue(message, field, index)
+              : reflection->GetEnumValue(message, field);
+      const EnumValueDescriptor* enum_desc =
+          field->enum_type()->FindValueByNumber(enum_value);
+      if (enum_desc != nullptr) {
+        generator->Append(internal::NameOfEnumAsString(enum_desc));
+      } else {
+        generator->Append(absl::AlphaNum(enum_value).Piece());
+      }
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      PrintFast(field->is_repeated()
+                    ? reflection->GetRepeatedMessage(message, field, index)
+                    : reflection->GetMessage(message, field),
+                generator);
+      break;
+  }
+}
+
 /* static */ bool TextFormat::Print(const Message& message,
                                     io::ZeroCopyOutputStream* output) {
   return Printer().Print(message, output);
@@ -22,6 +22,7 @@
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/functional/function_ref.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/descriptor.h"
@@ -529,6 +530,27 @@ class PROTOBUF_EXPORT TextFormat {
                              BaseTextGenerator* generator,
                              bool insert_value_separator) const;
 
+    // True if every field is printed by one of the built-in field value
+    // printers and no option needs the general path, so that PrintFast() can
+    // be used instead of Print().
+    bool CanPrintFast() const {
+      return builtin_field_value_printer_ && custom_printers_.empty() &&
+             custom_message_printers_.empty() && !redact_debug_string_;
+    }
+
+    // Like Print(), PrintField() and PrintFieldValue(), but format field names
+    // and scalar values straight into the TextGenerator instead of going
+    // through virtual FastFieldValuePrinter and BaseTextGenerator calls.
+    // Only valid if CanPrintFast() is true.
+    void PrintFast(const Message& message, TextGenerator* generator) const;
+    void PrintFieldFast(const Message& message, const Reflection* reflection,
+                        const FieldDescriptor* field,
+                        TextGenerator* generator) const;
+    void PrintFieldValueFast(const Message& message,
+                             const Reflection* reflection,
+                             const FieldDescriptor* field, int index,
+                             TextGenerator* generator) const;
+
     const FastFieldValuePrinter* GetFieldPrinter(
         const FieldDescriptor* field) const {
       auto it = custom_printers_.find(field);
@@ -553,6 +575,11 @@ class PROTOBUF_EXPORT TextFormat {
     bool expand_any_;
     int64_t truncate_string_field_longer_than_;
 
+    // Set by SetUseUtf8StringEscaping(), which installs one of the built-in
+    // printers, and cleared by SetDefaultFieldValuePrinter().
+    bool builtin_field_value_printer_;
+    bool utf8_string_escaping_;
+
     std::unique_ptr<const FastFieldValuePrinter> default_field_value_printer_;
     absl::flat_hash_map<const FieldDescriptor*,
                         std::unique_ptr<const FastFieldValuePrinter>>
@@ -682,6 +709,28 @@ class PROTOBUF_EXPORT TextFormat {
     // Like TextFormat::MergeFromString().
     bool MergeFromString(absl::string_view input, Message* output);
 
+    // Like Parse(), but rather than adding the elements of the repeated
+    // message field `field` of `output` to it, hands each of them to
+    // `callback` as soon as it has been parsed. Since the input is tokenized
+    // incrementally, memory use does not grow with the number of elements,
+    // which suits very large files made of one long list of records. All other
+    // fields are parsed into `output` as usual.
+    //
+    // If `arena` is null, one element is allocated on the heap and Clear()ed
+    // after each callback. Otherwise each element is created on `arena`, which
+    // is Reset() after each callback; `arena` must not own `output` or
+    // anything else that has to outlive the element. Either way `callback`
+    // must not hold on to the element. Parsing stops and returns false if
+    // `callback` returns false.
+    //
+    // Locations of the streamed elements are not written to the ParseInfoTree
+    // set by WriteLocationsTo(). Unless partial messages are allowed, each
+    // element is checked for missing required fields before it is handed out.
+    bool ParseStreaming(io::ZeroCopyInputStream* input, Message* output,
+                        const FieldDescriptor* field,
+                        absl::FunctionRef<bool(Message&)> callback,
+                        Arena* arena = nullptr);
+
     // Set where to report parse errors.  If nullptr (the default), errors will
     // be printed to stderr.
     void RecordErrorsTo(io::ErrorCollector* error_collector) {
@@ -36,6 +36,7 @@
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/substitute.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/io/tokenizer.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
@@ -602,6 +603,50 @@ TEST_F(TextFormatTest, PrintMessageSingleLine) {
       text);
 }
 
+TEST_F(TextFormatTest, PrintMatchesGeneralPrinter) {
+  // Printers that only use the built-in field value printers take a faster
+  // path; check that it prints exactly what the general one does.
+  protobuf_unittest::TestAllTypes all_types;
+  TestUtil::SetAllFields(&all_types);
+  all_types.add_repeated_string("tab\tquote\"\xc3\xa9\xff");
+  all_types.add_repeated_nested_message()->set_bb(-1);
+  all_types.mutable_unknown_fields()->AddVarint(12345, 6);
+  protobuf_unittest::TestAllExtensions extensions;
+  TestUtil::SetAllExtensions(&extensions);
+  protobuf_unittest::TestMap map;
+  (*map.mutable_map_int32_int32())[2] = 3;
+  (*map.mutable_map_int32_int32())[1] = 4;
+  (*map.mutable_map_string_string())["k"] = "v";
+  (*map.mutable_map_int32_foreign_message())[7].set_c(8);
+
+  for (int options = 0; options < 32; ++options) {
+    for (const Message* message :
+         std::vector<const Message*>{&all_types, &extensions, &map}) {
+      TextFormat::Printer fast;
+      TextFormat::Printer general;
+      for (TextFormat::Printer* printer : {&fast, &general}) {
+        printer->SetSingleLineMode(options & 1);
+        printer->SetUseShortRepeatedPrimitives(options & 2);
+        printer->SetUseUtf8StringEscaping(options & 4);
+        printer->SetUseFieldNumber(options & 8);
+        printer->SetPrintMessageFieldsInIndexOrder(options & 16);
+        printer->SetInitialIndentLevel(1);
+        printer->SetTruncateStringFieldLongerThan(options & 1 ? 2 : 0);
+      }
+      // Any registered printer, even for a field that is never printed,
+      // makes the printer take the general path.
+      general.RegisterFieldValuePrinter(
+          protobuf_unittest::TestRequired::descriptor()->FindFieldByName("a"),
+          new TextFormat::FastFieldValuePrinter());
+      std::string expected;
+      std::string actual;
+      EXPECT_TRUE(general.PrintToString(*message, &expected));
+      EXPECT_TRUE(fast.PrintToString(*message, &actual));
+      EXPECT_EQ(actual, expected) << "options: " << options;
+    }
+  }
+}
+
 TEST_F(TextFormatTest, PrintBufferTooSmall) {
   // Test printing a message to a buffer that is too small.
 
@@ -1582,6 +1627,37 @@ TEST_F(TextFormatTest, PrintFloatPrecision) {
             RemoveRedundantZeros(message.DebugString()));
 }
 
+TEST_F(TextFormatTest, PrintShortestRoundTrip) {
+  unittest::TestAllTypes message;
+
+  // Values that need more than FLT_DIG or DBL_DIG digits get only as many
+  // as it takes to round-trip, not FLT_DIG + 3 or DBL_DIG + 2.
+  message.add_repeated_float(123456.7f);
+  message.add_repeated_float(std::numeric_limits<float>::max());
+  message.add_repeated_float(16777216.0f);
+  message.add_repeated_double(0.7999999999999999);
+  message.add_repeated_double(0.30000000000000004);
+  message.add_repeated_double(std::numeric_limits<double>::denorm_min());
+
+  EXPECT_EQ(absl::StrCat(multi_line_debug_format_prefix_,
+                         "repeated_float: 123456.7\n"
+                         "repeated_float: 3.4028235e+38\n"
+                         "repeated_float: 16777216\n"
+                         "repeated_double: 0.7999999999999999\n"
+                         "repeated_double: 0.30000000000000004\n"
+                         "repeated_double: 5e-324\n"),
+            RemoveRedundantZeros(message.DebugString()));
+
+  std::string text;
+  ASSERT_TRUE(TextFormat::PrintToString(message, &text));
+  unittest::TestAllTypes parsed;
+  ASSERT_TRUE(TextFormat::ParseFromString(text, &parsed));
+  EXPECT_THAT(parsed.repeated_float(),
+              testing::ElementsAreArray(message.repeated_float()));
+  EXPECT_THAT(parsed.repeated_double(),
+              testing::ElementsAreArray(message.repeated_double()));
+}
+
 TEST_F(TextFormatTest, AllowPartial) {
   unittest::TestRequired message;
   TextFormat::Parser parser;
@@ -2256,6 +2332,91 @@ TEST_F(TextFormatParserTest, ExplicitDelimiters) {
   EXPECT_EQ(3, message.c());
 }
 
+TEST_F(TextFormatParserTest, ParseStreaming) {
+  std::string input =
+      "optional_int32: 1\n"
+      "repeated_nested_message { bb: 1 }\n"
+      "repeated_nested_message: [{ bb: 2 }, < bb: 3 >]\n"
+      "optional_string: \"x\"\n"
+      "repeated_nested_message { }\n";
+  io::ArrayInputStream stream(input.data(), static_cast<int>(input.size()),
+                              /*block_size=*/7);
+  unittest::TestAllTypes message;
+  std::vector<int> values;
+  EXPECT_TRUE(parser_.ParseStreaming(
+      &stream, &message,
+      message.GetDescriptor()->FindFieldByName("repeated_nested_message"),
+      [&](Message& element) {
+        auto& nested = static_cast<unittest::TestAllTypes::NestedMessage&>(
+            element);
+        values.push_back(nested.bb());
+        return true;
+      }));
+  EXPECT_EQ(values, std::vector<int>({1, 2, 3, 0}));
+  EXPECT_EQ(message.optional_int32(), 1);
+  EXPECT_EQ(message.optional_string(), "x");
+  EXPECT_EQ(message.repeated_nested_message_size(), 0);
+}
+
+TEST_F(TextFormatParserTest, ParseStreamingIntoArena) {
+  std::string input;
+  for (int i = 0; i < 100; ++i) {
+    absl::StrAppend(&input, "repeated_foreign_message { c: ", i, " }\n");
+  }
+  io::ArrayInputStream stream(input.data(), static_cast<int>(input.size()));
+  Arena arena;
+  unittest::TestAllTypes message;
+  int count = 0;
+  EXPECT_TRUE(parser_.ParseStreaming(
+      &stream, &message,
+      message.GetDescriptor()->FindFieldByName("repeated_foreign_message"),
+      [&](Message& element) {
+        EXPECT_EQ(element.GetArena(), &arena);
+        EXPECT_EQ(static_cast<unittest::ForeignMessage&>(element).c(), count);
+        ++count;
+        return true;
+      },
+      &arena));
+  EXPECT_EQ(count, 100);
+}
+
+TEST_F(TextFormatParserTest, ParseStreamingStopsWhenCallbackFails) {
+  std::string input =
+      "repeated_nested_message { bb: 1 } repeated_nested_message { bb: 2 }";
+  io::ArrayInputStream stream(input.data(), static_cast<int>(input.size()));
+  unittest::TestAllTypes message;
+  int count = 0;
+  EXPECT_FALSE(parser_.ParseStreaming(
+      &stream, &message,
+      message.GetDescriptor()->FindFieldByName("repeated_nested_message"),
+      [&](Message&) {
+        ++count;
+        return false;
+      }));
+  EXPECT_EQ(count, 1);
+}
+
+TEST_F(TextFormatParserTest, ParseStreamingMissingRequired) {
+  MockErrorCollector error_collector;
+  parser_.RecordErrorsTo(&error_collector);
+  std::string input =
+      "repeated_message { a: 1 b: 2 c: 3 }\n"
+      "repeated_message { a: 1 }\n";
+  io::ArrayInputStream stream(input.data(), static_cast<int>(input.size()));
+  unittest::TestRequiredForeign message;
+  int count = 0;
+  EXPECT_FALSE(parser_.ParseStreaming(
+      &stream, &message,
+      message.GetDescriptor()->FindFieldByName("repeated_message"),
+      [&](Message&) {
+        ++count;
+        return true;
+      }));
+  EXPECT_EQ(count, 1);
+  EXPECT_EQ(error_collector.text_,
+            "2:18: Message missing required fields: b, c\n");
+}
+
 TEST_F(TextFormatParserTest, PrintErrorsToStderr) {
   {
     absl::ScopedMockLog log(absl::MockLogDefault::kDisallowUnexpected);
@@ -62,6 +62,12 @@ class PROTOBUF_EXPORT ThreadSafeArena {
 
   uint64_t Reset();
 
+  // Makes the calling thread the owner of the first SerialArena, so a freshly
+  // Reset() arena that is handed to another thread (e.g. by ArenaPool) keeps
+  // allocating from its retained first block instead of creating a new
+  // SerialArena. Must not race with any other use of the arena.
+  void AdoptFirstSerialArena();
+
   uint64_t SpaceAllocated() const;
   uint64_t SpaceUsed() const;
 
@@ -7,6 +7,8 @@
 
 #include "google/protobuf/util/field_mask_util.h"
 
+#include <climits>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -21,7 +23,9 @@
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"
+#include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/message.h"
+#include "google/protobuf/wire_format_lite.h"
 
 // Must be included last.
 #include "google/protobuf/port_def.inc"
@@ -690,6 +694,148 @@ bool FieldMaskUtil::TrimMessage(const FieldMask& mask, Message* message,
   return tree.TrimMessage(ABSL_DIE_IF_NULL(message));
 }
 
+FieldMaskUtil::Projection::Projection(const Descriptor* descriptor,
+                                      const FieldDescriptor* field)
+    : descriptor_(descriptor), field_(field) {}
+
+FieldMaskUtil::Projection::~Projection() = default;
+
+FieldMaskUtil::Projection* FieldMaskUtil::Projection::Select(
+    const FieldDescriptor* field, bool whole) {
+  const int number = field->number();
+  const bool selected = IsSelected(number);
+  auto it = children_.find(number);
+  if (whole) {
+    // Selecting a field in whole supersedes selecting some of its fields.
+    if (it != children_.end()) children_.erase(it);
+  } else if (selected) {
+    return it == children_.end() ? nullptr : it->second.get();
+  }
+  if (!selected) {
+    const size_t n = static_cast<size_t>(number);
+    if (number < kDenseFieldNumbers) {
+      if (n / 64 >= selected_.size()) selected_.resize(n / 64 + 1);
+      selected_[n / 64] |= uint64_t{1} << (n % 64);
+    } else {
+      sparse_selected_.insert(number);
+    }
+  }
+  if (whole) return nullptr;
+  std::unique_ptr<Projection>& child = children_[number];
+  child = absl::WrapUnique(new Projection(field->message_type(), field));
+  return child.get();
+}
+
+bool FieldMaskUtil::Projection::Parse(io::CodedInputStream* input,
+                                      const char* base,
+                                      uint32_t end_group_tag,
+                                      Message* message) const {
+  using internal::WireFormatLite;
+  // Consecutive fields that are selected in whole are merged into 'message'
+  // straight from 'base', one run at a time.
+  int run_start = input->CurrentPosition();
+  int run_end = run_start;
+  auto flush_run = [&] {
+    if (run_end == run_start) return true;
+    io::CodedInputStream run(reinterpret_cast<const uint8_t*>(base) + run_start,
+                             run_end - run_start);
+    run.SetRecursionLimit(input->RecursionBudget());
+    run_start = run_end;
+    return message->MergePartialFromCodedStream(&run) &&
+           run.ConsumedEntireMessage();
+  };
+  while (true) {
+    const int start = input->CurrentPosition();
+    const uint32_t tag = input->ReadTag();
+    if (tag == 0) {
+      // Either the end of the input or a malformed tag.
+      return end_group_tag == 0 && input->CurrentPosition() == start &&
+             input->BytesUntilLimit() == 0 && flush_run();
+    }
+    if (tag == end_group_tag) return flush_run();
+    const int number = WireFormatLite::GetTagFieldNumber(tag);
+    if (!IsSelected(number)) {
+      if (!WireFormatLite::SkipField(input, tag)) return false;
+      continue;
+    }
+    const Projection* child = FindChild(number);
+    const WireFormatLite::WireType wire_type =
+        WireFormatLite::GetTagWireType(tag);
+    if (child != nullptr &&
+        (wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED ||
+         wire_type == WireFormatLite::WIRETYPE_START_GROUP)) {
+      // Fields must be merged in wire order, so finish the current run first.
+      if (!flush_run()) return false;
+      Message* submessage =
+          message->GetReflection()->MutableMessage(message, child->field_);
+      if (wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+        uint32_t length;
+        if (!input->ReadVarint32(&length) ||
+            length > static_cast<uint32_t>(input->BytesUntilLimit())) {
+          return false;
+        }
+        if (!input->IncrementRecursionDepth()) return false;
+        const io::CodedInputStream::Limit limit =
+            input->PushLimit(static_cast<int>(length));
+        if (!child->Parse(input, base, 0, submessage)) return false;
+        input->DecrementRecursionDepthAndPopLimit(limit);
+      } else {
+        const uint32_t end_tag =
+            WireFormatLite::MakeTag(number, WireFormatLite::WIRETYPE_END_GROUP);
+        if (!input->IncrementRecursionDepth()) return false;
+        if (!child->Parse(input, base, end_tag, submessage)) return false;
+        input->DecrementRecursionDepth();
+      }
+      run_start = run_end = input->CurrentPosition();
+    } else {
+      if (!WireFormatLite::SkipField(input, tag)) return false;
+      // Extend the current run, or start a new one after skipped fields.
+      if (start != run_end) {
+        if (!flush_run()) return false;
+        run_start = start;
+      }
+      run_end = input->CurrentPosition();
+    }
+  }
+}
+
+std::unique_ptr<FieldMaskUtil::Projection> FieldMaskUtil::CompileProjection(
+    const Descriptor* descriptor, const FieldMask& mask) {
+  auto projection = absl::WrapUnique(new Projection(descriptor, nullptr));
+  if (mask.paths_size() == 0) {
+    projection->select_all_ = true;
+    return projection;
+  }
+  std::vector<const FieldDescriptor*> fields;
+  for (const std::string& path : mask.paths()) {
+    if (!GetFieldDescriptors(descriptor, path, &fields)) return nullptr;
+    Projection* node = projection.get();
+    for (size_t i = 0; node != nullptr && i < fields.size(); ++i) {
+      node = node->Select(fields[i], /*whole=*/i + 1 == fields.size());
+    }
+  }
+  return projection;
+}
+
+bool FieldMaskUtil::ParseProjected(const Projection& projection,
+                                   absl::string_view data, Message* message) {
+  ABSL_CHECK_EQ(projection.descriptor(), message->GetDescriptor());
+  if (projection.select_all_) return message->ParsePartialFromString(data);
+  if (data.size() > static_cast<size_t>(INT_MAX)) return false;
+  message->Clear();
+  io::CodedInputStream input(reinterpret_cast<const uint8_t*>(data.data()),
+                             static_cast<int>(data.size()));
+  input.PushLimit(static_cast<int>(data.size()));
+  return projection.Parse(&input, data.data(), 0, message);
+}
+
+bool FieldMaskUtil::ParseProjected(const FieldMask& mask,
+                                   absl::string_view data, Message* message) {
+  std::unique_ptr<Projection> projection =
+      CompileProjection(message->GetDescriptor(), mask);
+  return projection != nullptr && ParseProjected(*projection, data, message);
+}
+
 }  // namespace util
 }  // namespace protobuf
 }  // namespace google
@@ -10,11 +10,15 @@
 #ifndef GOOGLE_PROTOBUF_UTIL_FIELD_MASK_UTIL_H__
 #define GOOGLE_PROTOBUF_UTIL_FIELD_MASK_UTIL_H__
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "google/protobuf/field_mask.pb.h"
+#include "absl/container/btree_map.h"
+#include "absl/container/btree_set.h"
 #include "absl/log/absl_check.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/descriptor.h"
@@ -24,6 +28,10 @@
 
 namespace google {
 namespace protobuf {
+namespace io {
+class CodedInputStream;
+}  // namespace io
+
 namespace util {
 
 class PROTOBUF_EXPORT FieldMaskUtil {
@@ -158,6 +166,30 @@ class PROTOBUF_EXPORT FieldMaskUtil {
   static bool TrimMessage(const FieldMask& mask, Message* message,
                           const TrimOptions& options);
 
+  class Projection;
+  // Compiles the given FieldMask into a Projection that ParseProjected() can
+  // apply to any number of messages of the given type. An empty FieldMask
+  // selects all fields. Returns nullptr if the FieldMask has an invalid path.
+  static std::unique_ptr<Projection> CompileProjection(
+      const Descriptor* descriptor, const FieldMask& mask);
+  template <typename T>
+  static std::unique_ptr<Projection> CompileProjection(const FieldMask& mask) {
+    return CompileProjection(T::descriptor(), mask);
+  }
+
+  // Parses 'data' into 'message' like ParsePartialFromString(), but only keeps
+  // the fields selected by 'projection'. Unselected fields, including unknown
+  // fields, are skipped on the wire: no submessages or strings are allocated
+  // for them. Required fields are not checked. Returns false if 'data' is
+  // malformed.
+  static bool ParseProjected(const Projection& projection,
+                             absl::string_view data, Message* message);
+  // This flavor compiles the FieldMask on every call. Prefer compiling a
+  // Projection once when parsing many messages. Also returns false if the
+  // FieldMask has an invalid path.
+  static bool ParseProjected(const FieldMask& mask, absl::string_view data,
+                             Message* message);
+
  private:
   friend class SnakeCaseCamelCaseTest;
   // Converts a field name from snake_case to camelCase:
@@ -233,6 +265,65 @@ class PROTOBUF_EXPORT FieldMaskUtil::TrimOptions {
   bool keep_required_fields_;
 };
 
+// A FieldMask compiled against a message type. Each message type reached by
+// the mask gets a bitmap indexed by field number, so deciding whether to keep
+// a field while parsing is a single lookup. Field numbers too large for the
+// bitmap to stay small are kept in a sorted set instead.
+class PROTOBUF_EXPORT FieldMaskUtil::Projection {
+ public:
+  Projection(const Projection&) = delete;
+  Projection& operator=(const Projection&) = delete;
+  ~Projection();
+
+  const Descriptor* descriptor() const { return descriptor_; }
+
+  // Returns true if the field with the given number is selected, in whole or
+  // in part.
+  bool IsSelected(int number) const {
+    if (select_all_) return true;
+    const size_t n = static_cast<size_t>(number);
+    if (n < selected_.size() * 64) return (selected_[n / 64] >> (n % 64)) & 1;
+    return !sparse_selected_.empty() && sparse_selected_.contains(number);
+  }
+
+  // Returns the projection of the given message field if only some of its
+  // fields are selected, or nullptr if it is selected in whole or not at all.
+  const Projection* FindChild(int number) const {
+    if (children_.empty()) return nullptr;
+    auto it = children_.find(number);
+    return it == children_.end() ? nullptr : it->second.get();
+  }
+
+ private:
+  friend class FieldMaskUtil;
+
+  // Field numbers below this are kept in the bitmap, which then takes at most
+  // 128 bytes per message type.
+  static constexpr int kDenseFieldNumbers = 1024;
+
+  // 'field' is the field of the parent message this projects, or null for the
+  // top-level message.
+  Projection(const Descriptor* descriptor, const FieldDescriptor* field);
+
+  // Selects 'field'. If 'whole' is true the field is selected in whole;
+  // otherwise returns the projection of the submessage to select fields in, or
+  // nullptr if the field is already selected in whole.
+  Projection* Select(const FieldDescriptor* field, bool whole);
+
+  // Merges the fields selected from 'input' into 'message' until the end of
+  // the current limit, or until 'end_group_tag' if nonzero. 'base' is the
+  // buffer 'input' reads from; selected fields are parsed from it directly.
+  bool Parse(io::CodedInputStream* input, const char* base,
+             uint32_t end_group_tag, Message* message) const;
+
+  const Descriptor* descriptor_;
+  const FieldDescriptor* field_;
+  bool select_all_ = false;
+  std::vector<uint64_t> selected_;
+  absl::btree_set<int> sparse_selected_;
+  absl::btree_map<int, std::unique_ptr<Projection>> children_;
+};
+
 }  // namespace util
 }  // namespace protobuf
 }  // namespace google
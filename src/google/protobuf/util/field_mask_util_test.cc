@@ -9,6 +9,8 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "google/protobuf/field_mask.pb.h"
@@ -93,6 +95,7 @@ TEST_F(SnakeCaseCamelCaseTest, RoundTripTest) {
 using google::protobuf::FieldMask;
 using protobuf_unittest::NestedTestAllTypes;
 using protobuf_unittest::TestAllTypes;
+using protobuf_unittest::TestReallyLargeTagNumber;
 using protobuf_unittest::TestRequired;
 using protobuf_unittest::TestRequiredMessage;
 
@@ -804,6 +807,129 @@ TEST(FieldMaskUtilTest, TrimMessageReturnValue) {
   // supported.
 }
 
+// Parsing with a projection must give the same result as parsing everything
+// and trimming it with the same FieldMask.
+void ExpectParseProjectedMatchesTrim(const Message& full,
+                                     absl::string_view paths) {
+  SCOPED_TRACE(paths);
+  FieldMask mask;
+  FieldMaskUtil::FromString(paths, &mask);
+  std::unique_ptr<Message> trimmed(full.New());
+  trimmed->CopyFrom(full);
+  FieldMaskUtil::TrimMessage(mask, trimmed.get());
+
+  std::unique_ptr<Message> parsed(full.New());
+  ASSERT_TRUE(FieldMaskUtil::ParseProjected(mask, full.SerializeAsString(),
+                                            parsed.get()));
+  EXPECT_EQ(parsed->DebugString(), trimmed->DebugString());
+}
+
+TEST(FieldMaskUtilTest, ParseProjected) {
+  TestAllTypes msg;
+  TestUtil::SetAllFields(&msg);
+  ExpectParseProjectedMatchesTrim(msg, "optional_int32");
+  ExpectParseProjectedMatchesTrim(msg, "optional_string,repeated_int64");
+  ExpectParseProjectedMatchesTrim(msg, "optional_nested_message.bb");
+  ExpectParseProjectedMatchesTrim(msg, "optionalgroup.a");
+  ExpectParseProjectedMatchesTrim(msg, "repeated_nested_message,oneof_bytes");
+  ExpectParseProjectedMatchesTrim(
+      msg, "optional_nested_message.bb,optional_nested_message");
+
+  NestedTestAllTypes nested;
+  nested.mutable_child()->mutable_payload()->set_optional_int32(1);
+  nested.mutable_child()->mutable_payload()->set_optional_string("a");
+  nested.mutable_child()->mutable_child()->mutable_payload()
+      ->set_optional_int32(2);
+  nested.mutable_payload()->set_optional_int64(3);
+  ExpectParseProjectedMatchesTrim(nested, "child.payload.optional_int32");
+  ExpectParseProjectedMatchesTrim(
+      nested, "child.child.payload.optional_int32,payload");
+  ExpectParseProjectedMatchesTrim(nested, "child.payload,child.child");
+}
+
+TEST(FieldMaskUtilTest, ParseProjectedSkipsUnselectedFields) {
+  TestAllTypes msg;
+  TestUtil::SetAllFields(&msg);
+  msg.GetReflection()->MutableUnknownFields(&msg)->AddVarint(12345, 1);
+  FieldMask mask;
+  FieldMaskUtil::FromString("optional_int32,optional_nested_message.bb", &mask);
+  auto projection = FieldMaskUtil::CompileProjection<TestAllTypes>(mask);
+  ASSERT_NE(projection, nullptr);
+  EXPECT_TRUE(projection->IsSelected(TestAllTypes::kOptionalInt32FieldNumber));
+  EXPECT_FALSE(projection->IsSelected(TestAllTypes::kOptionalInt64FieldNumber));
+  EXPECT_FALSE(projection->IsSelected(12345));
+  EXPECT_EQ(projection->FindChild(TestAllTypes::kOptionalInt32FieldNumber),
+            nullptr);
+  EXPECT_NE(
+      projection->FindChild(TestAllTypes::kOptionalNestedMessageFieldNumber),
+      nullptr);
+
+  // A projection is reusable across messages.
+  for (int i = 0; i < 2; ++i) {
+    TestAllTypes parsed;
+    parsed.set_optional_bytes("stale");
+    ASSERT_TRUE(FieldMaskUtil::ParseProjected(
+        *projection, msg.SerializeAsString(), &parsed));
+    EXPECT_EQ(parsed.optional_int32(), msg.optional_int32());
+    EXPECT_EQ(parsed.optional_nested_message().bb(),
+              msg.optional_nested_message().bb());
+    EXPECT_FALSE(parsed.has_optional_bytes());
+    EXPECT_FALSE(parsed.has_optional_foreign_message());
+    EXPECT_EQ(parsed.repeated_string_size(), 0);
+    EXPECT_EQ(
+        parsed.GetReflection()->GetUnknownFields(parsed).field_count(), 0);
+  }
+}
+
+TEST(FieldMaskUtilTest, ParseProjectedLargeFieldNumber) {
+  TestReallyLargeTagNumber msg;
+  msg.set_a(1);
+  msg.set_bb(2);
+  FieldMask mask;
+  FieldMaskUtil::FromString("bb", &mask);
+  auto projection =
+      FieldMaskUtil::CompileProjection<TestReallyLargeTagNumber>(mask);
+  ASSERT_NE(projection, nullptr);
+  EXPECT_TRUE(projection->IsSelected(268435455));
+  EXPECT_FALSE(projection->IsSelected(1));
+  EXPECT_FALSE(projection->IsSelected(268435454));
+  ExpectParseProjectedMatchesTrim(msg, "bb");
+  ExpectParseProjectedMatchesTrim(msg, "a,bb");
+}
+
+TEST(FieldMaskUtilTest, ParseProjectedWithEmptyMaskParsesEverything) {
+  TestAllTypes msg;
+  TestUtil::SetAllFields(&msg);
+  TestAllTypes parsed;
+  ASSERT_TRUE(FieldMaskUtil::ParseProjected(FieldMask(), msg.SerializeAsString(),
+                                            &parsed));
+  EXPECT_EQ(parsed.DebugString(), msg.DebugString());
+}
+
+TEST(FieldMaskUtilTest, ParseProjectedRejectsInvalidInput) {
+  FieldMask mask;
+  FieldMaskUtil::FromString("optional_nested_message.bb", &mask);
+  EXPECT_NE(FieldMaskUtil::CompileProjection<TestAllTypes>(mask), nullptr);
+  FieldMaskUtil::FromString("optional_int32.foo", &mask);
+  EXPECT_EQ(FieldMaskUtil::CompileProjection<TestAllTypes>(mask), nullptr);
+  TestAllTypes parsed;
+  EXPECT_FALSE(FieldMaskUtil::ParseProjected(mask, "", &parsed));
+
+  FieldMaskUtil::FromString("optional_nested_message.bb", &mask);
+  TestAllTypes msg;
+  msg.set_optional_int64(1);
+  msg.mutable_optional_nested_message()->set_bb(2);
+  const std::string bytes = msg.SerializeAsString();
+  // Truncating the input anywhere, including inside skipped fields and
+  // partially selected submessages, must be detected.
+  for (size_t size = 1; size < bytes.size(); ++size) {
+    if (size == 2) continue;  // Ends right after optional_int64.
+    SCOPED_TRACE(size);
+    EXPECT_FALSE(
+        FieldMaskUtil::ParseProjected(mask, bytes.substr(0, size), &parsed));
+  }
+}
+
 
 }  // namespace
 }  // namespace util
@@ -8,7 +8,9 @@
 /*
  * upb_table Implementation
  *
- * Implementation is heavily inspired by Lua's ltable.c.
+ * The hash part is an open-addressing "Swiss table": each entry has a one-byte
+ * control code in a separate array, and lookups compare a 16-entry group of
+ * control bytes against the hash at once (with SSE2 where available).
  */
 
 #include <string.h>
@@ -71,76 +73,172 @@ static lookupkey_t intkey(uintptr_t key) {
   return k;
 }
 
-typedef uint32_t hashfunc_t(upb_tabkey key);
 typedef bool eqlfunc_t(upb_tabkey k1, lookupkey_t k2);
 
 /* Base table (shared code) ***************************************************/
 
-static uint32_t upb_inthash(uintptr_t key) { return (uint32_t)key; }
+/* The control byte of a full entry is the low 7 bits of its hash (see
+ * upb_hash_h2()).  Every other value has the high bit set. */
+#define UPB_CTRL_EMPTY 0x80
+#define UPB_CTRL_DELETED 0xfe
+/* Pads the control bytes of tables smaller than a group out to a full group.
+ * It never matches a hash, and is never free for an insert. */
+#define UPB_CTRL_SENTINEL 0xff
 
-static const upb_tabent* upb_getentry(const upb_table* t, uint32_t hash) {
-  return t->entries + (hash & t->mask);
+#define UPB_GROUP_WIDTH 16
+
+/* The low 7 bits of the hash go in the control byte, and the rest pick the
+ * group to start probing at. */
+static uint8_t upb_hash_h2(uint64_t hash) { return hash & 0x7f; }
+static size_t upb_hash_h1(uint64_t hash) { return (size_t)(hash >> 7); }
+
+static int upb_ctz(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctz(x);
+#else
+  int ret = 0;
+  while (!(x & 1)) {
+    x >>= 1;
+    ret++;
+  }
+  return ret;
+#endif
+}
+
+/* Group operations return a bitmask with bit i set if control byte i of the
+ * group matches. */
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+
+static uint32_t group_match(const uint8_t* ctrl, uint8_t byte) {
+  __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)byte)));
+}
+
+/* Empty or deleted: the high bit is set, and it is not a sentinel. */
+static uint32_t group_match_free(const uint8_t* ctrl) {
+  __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+  uint32_t special = _mm_movemask_epi8(group);
+  return special & ~group_match(ctrl, UPB_CTRL_SENTINEL);
+}
+
+#else
+
+static uint32_t group_match(const uint8_t* ctrl, uint8_t byte) {
+  uint32_t mask = 0;
+  for (int i = 0; i < UPB_GROUP_WIDTH; i++) {
+    mask |= (uint32_t)(ctrl[i] == byte) << i;
+  }
+  return mask;
+}
+
+static uint32_t group_match_free(const uint8_t* ctrl) {
+  uint32_t mask = 0;
+  for (int i = 0; i < UPB_GROUP_WIDTH; i++) {
+    mask |= (uint32_t)(ctrl[i] >= UPB_CTRL_EMPTY &&
+                       ctrl[i] != UPB_CTRL_SENTINEL)
+            << i;
+  }
+  return mask;
+}
+
+#endif
+
+static size_t ctrl_size(const upb_table* t) {
+  return UPB_MAX(upb_table_size(t), UPB_GROUP_WIDTH);
+}
+
+/* Visits the groups of the table in triangular order (+1, +2, +3, ...), which
+ * reaches every group exactly once since the number of groups is a power of
+ * two.  `offset` is the index of the first entry in the current group. */
+typedef struct {
+  size_t offset;
+  size_t mask;
+  size_t step;
+} probeseq;
+
+static probeseq probe_start(const upb_table* t, uint64_t hash) {
+  probeseq seq;
+  seq.mask = ctrl_size(t) / UPB_GROUP_WIDTH - 1;
+  seq.offset = (upb_hash_h1(hash) & seq.mask) * UPB_GROUP_WIDTH;
+  seq.step = 0;
+  return seq;
+}
+
+static void probe_next(probeseq* seq) {
+  seq->step++;
+  seq->offset = (seq->offset + seq->step * UPB_GROUP_WIDTH) &
+                (seq->mask * UPB_GROUP_WIDTH + UPB_GROUP_WIDTH - 1);
 }
 
 static bool upb_arrhas(upb_tabval key) { return key.val != (uint64_t)-1; }
 
-static bool isfull(upb_table* t) { return t->count == t->max_count; }
+/* Deleted entries take up space for probing just like full ones, so they
+ * count towards the load limit until the next resize clears them. */
+static bool isfull(upb_table* t) {
+  return t->count + t->deleted >= t->max_count;
+}
+
+static void clear(upb_table* t) {
+  size_t size = upb_table_size(t);
+  t->count = 0;
+  t->deleted = 0;
+  if (size == 0) return;
+  memset(t->entries, 0, size * sizeof(upb_tabent));
+  memset(t->ctrl, UPB_CTRL_EMPTY, size);
+  memset(t->ctrl + size, UPB_CTRL_SENTINEL, ctrl_size(t) - size);
+}
 
 static bool init(upb_table* t, uint8_t size_lg2, upb_Arena* a) {
-  size_t bytes;
+  size_t entry_bytes;
+  char* mem;
 
-  t->count = 0;
   t->size_lg2 = size_lg2;
   t->mask = upb_table_size(t) ? upb_table_size(t) - 1 : 0;
   t->max_count = upb_table_size(t) * MAX_LOAD;
-  bytes = upb_table_size(t) * sizeof(upb_tabent);
-  if (bytes > 0) {
-    t->entries = upb_Arena_Malloc(a, bytes);
-    if (!t->entries) return false;
-    memset(t->entries, 0, bytes);
+  entry_bytes = upb_table_size(t) * sizeof(upb_tabent);
+  if (entry_bytes > 0) {
+    mem = upb_Arena_Malloc(a, entry_bytes + ctrl_size(t));
+    if (!mem) return false;
+    t->entries = (upb_tabent*)mem;
+    t->ctrl = (uint8_t*)mem + entry_bytes;
   } else {
     t->entries = NULL;
+    t->ctrl = NULL;
   }
+  clear(t);
   return true;
 }
 
-static upb_tabent* emptyent(upb_table* t, upb_tabent* e) {
-  upb_tabent* begin = t->entries;
-  upb_tabent* end = begin + upb_table_size(t);
-  for (e = e + 1; e < end; e++) {
-    if (upb_tabent_isempty(e)) return e;
-  }
-  for (e = begin; e < end; e++) {
-    if (upb_tabent_isempty(e)) return e;
-  }
-  UPB_ASSERT(false);
-  return NULL;
-}
-
-static upb_tabent* getentry_mutable(upb_table* t, uint32_t hash) {
-  return (upb_tabent*)upb_getentry(t, hash);
-}
-
-static const upb_tabent* findentry(const upb_table* t, lookupkey_t key,
-                                   uint32_t hash, eqlfunc_t* eql) {
-  const upb_tabent* e;
-
+/* Force-inlined so that `eql` is a direct call for each table type. */
+UPB_FORCEINLINE const upb_tabent* findentry(const upb_table* t,
+                                            lookupkey_t key, uint64_t hash,
+                                            eqlfunc_t* eql) {
   if (t->size_lg2 == 0) return NULL;
-  e = upb_getentry(t, hash);
-  if (upb_tabent_isempty(e)) return NULL;
-  while (1) {
-    if (eql(e->key, key)) return e;
-    if ((e = e->next) == NULL) return NULL;
+  uint8_t h2 = upb_hash_h2(hash);
+  probeseq seq = probe_start(t, hash);
+  while (true) {
+    const uint8_t* ctrl = t->ctrl + seq.offset;
+    for (uint32_t match = group_match(ctrl, h2); match; match &= match - 1) {
+      const upb_tabent* e = &t->entries[seq.offset + upb_ctz(match)];
+      if (eql(e->key, key)) return e;
+    }
+    /* An insert of the key would have stopped at the first group with room,
+     * so it can't be in any later group. */
+    if (group_match(ctrl, UPB_CTRL_EMPTY)) return NULL;
+    probe_next(&seq);
   }
 }
 
-static upb_tabent* findentry_mutable(upb_table* t, lookupkey_t key,
-                                     uint32_t hash, eqlfunc_t* eql) {
+UPB_FORCEINLINE upb_tabent* findentry_mutable(upb_table* t, lookupkey_t key,
+                                     uint64_t hash, eqlfunc_t* eql) {
   return (upb_tabent*)findentry(t, key, hash, eql);
 }
 
-static bool lookup(const upb_table* t, lookupkey_t key, upb_value* v,
-                   uint32_t hash, eqlfunc_t* eql) {
+UPB_FORCEINLINE bool lookup(const upb_table* t, lookupkey_t key, upb_value* v,
+                   uint64_t hash, eqlfunc_t* eql) {
   const upb_tabent* e = findentry(t, key, hash, eql);
   if (e) {
     if (v) {
@@ -152,90 +250,50 @@ static bool lookup(const upb_table* t, lookupkey_t key, upb_value* v,
   }
 }
 
-/* The given key must not already exist in the table. */
-static void insert(upb_table* t, lookupkey_t key, upb_tabkey tabkey,
-                   upb_value val, uint32_t hash, hashfunc_t* hashfunc,
-                   eqlfunc_t* eql) {
-  upb_tabent* mainpos_e;
-  upb_tabent* our_e;
-
-  UPB_ASSERT(findentry(t, key, hash, eql) == NULL);
+/* The key must not already exist in the table, and the table must not be
+ * full. */
+static void insert(upb_table* t, upb_tabkey tabkey, upb_value val,
+                   uint64_t hash) {
+  UPB_ASSERT(!isfull(t));
+  probeseq seq = probe_start(t, hash);
+  uint32_t free;
+  while (!(free = group_match_free(t->ctrl + seq.offset))) {
+    probe_next(&seq);
+  }
 
+  size_t i = seq.offset + upb_ctz(free);
+  if (t->ctrl[i] == UPB_CTRL_DELETED) t->deleted--;
   t->count++;
-  mainpos_e = getentry_mutable(t, hash);
-  our_e = mainpos_e;
-
-  if (upb_tabent_isempty(mainpos_e)) {
-    /* Our main position is empty; use it. */
-    our_e->next = NULL;
+  t->ctrl[i] = upb_hash_h2(hash);
+  t->entries[i].key = tabkey;
+  t->entries[i].val.val = val.val;
+}
+
+/* Removes the full entry at index i. */
+static void rm_at(upb_table* t, size_t i) {
+  const uint8_t* group = t->ctrl + (i & ~(size_t)(UPB_GROUP_WIDTH - 1));
+  UPB_ASSERT(t->ctrl[i] < UPB_CTRL_EMPTY);
+  /* If the group still has an empty entry, it has never been full, so no
+   * probe sequence has gone past it and the entry can simply become empty.
+   * Otherwise lookups may need to keep going past it. */
+  if (group_match(group, UPB_CTRL_EMPTY)) {
+    t->ctrl[i] = UPB_CTRL_EMPTY;
   } else {
-    /* Collision. */
-    upb_tabent* new_e = emptyent(t, mainpos_e);
-    /* Head of collider's chain. */
-    upb_tabent* chain = getentry_mutable(t, hashfunc(mainpos_e->key));
-    if (chain == mainpos_e) {
-      /* Existing ent is in its main position (it has the same hash as us, and
-       * is the head of our chain).  Insert to new ent and append to this chain.
-       */
-      new_e->next = mainpos_e->next;
-      mainpos_e->next = new_e;
-      our_e = new_e;
-    } else {
-      /* Existing ent is not in its main position (it is a node in some other
-       * chain).  This implies that no existing ent in the table has our hash.
-       * Evict it (updating its chain) and use its ent for head of our chain. */
-      *new_e = *mainpos_e; /* copies next. */
-      while (chain->next != mainpos_e) {
-        chain = (upb_tabent*)chain->next;
-        UPB_ASSERT(chain);
-      }
-      chain->next = new_e;
-      our_e = mainpos_e;
-      our_e->next = NULL;
-    }
+    t->ctrl[i] = UPB_CTRL_DELETED;
+    t->deleted++;
   }
-  our_e->key = tabkey;
-  our_e->val.val = val.val;
-  UPB_ASSERT(findentry(t, key, hash, eql) == our_e);
+  t->count--;
+  t->entries[i].key = 0;
 }
 
 static bool rm(upb_table* t, lookupkey_t key, upb_value* val,
-               upb_tabkey* removed, uint32_t hash, eqlfunc_t* eql) {
-  upb_tabent* chain = getentry_mutable(t, hash);
-  if (upb_tabent_isempty(chain)) return false;
-  if (eql(chain->key, key)) {
-    /* Element to remove is at the head of its chain. */
-    t->count--;
-    if (val) _upb_value_setval(val, chain->val.val);
-    if (removed) *removed = chain->key;
-    if (chain->next) {
-      upb_tabent* move = (upb_tabent*)chain->next;
-      *chain = *move;
-      move->key = 0; /* Make the slot empty. */
-    } else {
-      chain->key = 0; /* Make the slot empty. */
-    }
-    return true;
-  } else {
-    /* Element to remove is either in a non-head position or not in the
-     * table. */
-    while (chain->next && !eql(chain->next->key, key)) {
-      chain = (upb_tabent*)chain->next;
-    }
-    if (chain->next) {
-      /* Found element to remove. */
-      upb_tabent* rm = (upb_tabent*)chain->next;
-      t->count--;
-      if (val) _upb_value_setval(val, chain->next->val.val);
-      if (removed) *removed = rm->key;
-      rm->key = 0; /* Make the slot empty. */
-      chain->next = rm->next;
-      return true;
-    } else {
-      /* Element to remove is not in the table. */
-      return false;
-    }
-  }
+               upb_tabkey* removed, uint64_t hash, eqlfunc_t* eql) {
+  upb_tabent* e = findentry_mutable(t, key, hash, eql);
+  if (!e) return false;
+  if (val) _upb_value_setval(val, e->val.val);
+  if (removed) *removed = e->key;
+  rm_at(t, e - t->entries);
+  return true;
 }
 
 static size_t next(const upb_table* t, size_t i) {
@@ -402,14 +460,17 @@ uint32_t _upb_Hash(const void* p, size_t n, uint64_t seed) {
   return Wyhash(p, n, seed, kWyhashSalt);
 }
 
-static uint32_t _upb_Hash_NoSeed(const char* p, size_t n) {
-  return _upb_Hash(p, n, 0);
+/* The tables use all 64 bits of the hash: the low 7 go in the control bytes,
+ * and the rest choose the group. */
+static uint64_t strhash(const char* p, size_t n) {
+  return Wyhash(p, n, 0, kWyhashSalt);
 }
 
-static uint32_t strhash(upb_tabkey key) {
-  uint32_t len;
-  char* str = upb_tabstr(key, &len);
-  return _upb_Hash_NoSeed(str, len);
+/* Integer keys are often small and dense, so they need mixing before their
+ * low bits are usable as a control byte. */
+static uint64_t upb_inthash(uintptr_t key) {
+  uint64_t h = (uint64_t)key * 0x9E3779B97F4A7C15ULL;
+  return h ^ (h >> 32);
 }
 
 static bool streql(upb_tabkey k1, lookupkey_t k2) {
@@ -427,11 +488,7 @@ bool upb_strtable_init(upb_strtable* t, size_t expected_size, upb_Arena* a) {
   return init(&t->t, size_lg2, a);
 }
 
-void upb_strtable_clear(upb_strtable* t) {
-  size_t bytes = upb_table_size(&t->t) * sizeof(upb_tabent);
-  t->t.count = 0;
-  memset((char*)t->t.entries, 0, bytes);
-}
+void upb_strtable_clear(upb_strtable* t) { clear(&t->t); }
 
 bool upb_strtable_resize(upb_strtable* t, size_t size_lg2, upb_Arena* a) {
   upb_strtable new_table;
@@ -451,11 +508,14 @@ bool upb_strtable_insert(upb_strtable* t, const char* k, size_t len,
                          upb_value v, upb_Arena* a) {
   lookupkey_t key;
   upb_tabkey tabkey;
-  uint32_t hash;
+  uint64_t hash;
 
   if (isfull(&t->t)) {
-    /* Need to resize.  New table of double the size, add old elements to it. */
-    if (!upb_strtable_resize(t, t->t.size_lg2 + 1, a)) {
+    /* Need to resize.  If deleted entries make up much of the load, they can
+     * be cleared out at the same size, otherwise double the table. */
+    size_t size_lg2 = t->t.size_lg2;
+    if (t->t.deleted <= t->t.count) size_lg2++;
+    if (!upb_strtable_resize(t, size_lg2, a)) {
       return false;
     }
   }
@@ -464,20 +524,20 @@ bool upb_strtable_insert(upb_strtable* t, const char* k, size_t len,
   tabkey = strcopy(key, a);
   if (tabkey == 0) return false;
 
-  hash = _upb_Hash_NoSeed(key.str.str, key.str.len);
-  insert(&t->t, key, tabkey, v, hash, &strhash, &streql);
+  hash = strhash(key.str.str, key.str.len);
+  insert(&t->t, tabkey, v, hash);
   return true;
 }
 
 bool upb_strtable_lookup2(const upb_strtable* t, const char* key, size_t len,
                           upb_value* v) {
-  uint32_t hash = _upb_Hash_NoSeed(key, len);
+  uint64_t hash = strhash(key, len);
   return lookup(&t->t, strkey2(key, len), v, hash, &streql);
 }
 
 bool upb_strtable_remove2(upb_strtable* t, const char* key, size_t len,
                           upb_value* val) {
-  uint32_t hash = _upb_Hash_NoSeed(key, len);
+  uint64_t hash = strhash(key, len);
   upb_tabkey tabkey;
   return rm(&t->t, strkey2(key, len), val, &tabkey, hash, &streql);
 }
@@ -529,8 +589,6 @@ bool upb_strtable_iter_isequal(const upb_strtable_iter* i1,
 /* For inttables we use a hybrid structure where small keys are kept in an
  * array and large keys are put in the hash table. */
 
-static uint32_t inthash(upb_tabkey key) { return upb_inthash(key); }
-
 static bool inteql(upb_tabkey k1, lookupkey_t k2) { return k1 == k2.num; }
 
 static upb_tabval* mutable_array(upb_inttable* t) {
@@ -612,26 +670,28 @@ bool upb_inttable_insert(upb_inttable* t, uintptr_t key, upb_value val,
       /* Need to resize the hash part, but we re-use the array part. */
       size_t i;
       upb_table new_table;
+      size_t size_lg2 = t->t.size_lg2;
 
-      if (!init(&new_table, t->t.size_lg2 + 1, a)) {
+      /* Clear out deleted entries at the same size if there are many of them.
+       */
+      if (t->t.deleted <= t->t.count) size_lg2++;
+      if (!init(&new_table, size_lg2, a)) {
         return false;
       }
 
       for (i = begin(&t->t); i < upb_table_size(&t->t); i = next(&t->t, i)) {
         const upb_tabent* e = &t->t.entries[i];
-        uint32_t hash;
         upb_value v;
 
         _upb_value_setval(&v, e->val.val);
-        hash = upb_inthash(e->key);
-        insert(&new_table, intkey(e->key), e->key, v, hash, &inthash, &inteql);
+        insert(&new_table, e->key, v, upb_inthash(e->key));
       }
 
       UPB_ASSERT(t->t.count == new_table.count);
 
       t->t = new_table;
     }
-    insert(&t->t, intkey(key), key, val, upb_inthash(key), &inthash, &inteql);
+    insert(&t->t, key, val, upb_inthash(key));
   }
   check(t);
   return true;
@@ -769,25 +829,7 @@ void upb_inttable_removeiter(upb_inttable* t, intptr_t* iter) {
     t->array_count--;
     mutable_array(t)[i].val = -1;
   } else {
-    upb_tabent* ent = &t->t.entries[i - t->array_size];
-    upb_tabent* prev = NULL;
-
-    // Linear search, not great.
-    upb_tabent* end = &t->t.entries[upb_table_size(&t->t)];
-    for (upb_tabent* e = t->t.entries; e != end; e++) {
-      if (e->next == ent) {
-        prev = e;
-        break;
-      }
-    }
-
-    if (prev) {
-      prev->next = ent->next;
-    }
-
-    t->t.count--;
-    ent->key = 0;
-    ent->next = NULL;
+    rm_at(&t->t, i - t->array_size);
   }
 }
 
@@ -808,26 +850,7 @@ bool upb_strtable_next2(const upb_strtable* t, upb_StringView* key,
 }
 
 void upb_strtable_removeiter(upb_strtable* t, intptr_t* iter) {
-  intptr_t i = *iter;
-  upb_tabent* ent = &t->t.entries[i];
-  upb_tabent* prev = NULL;
-
-  // Linear search, not great.
-  upb_tabent* end = &t->t.entries[upb_table_size(&t->t)];
-  for (upb_tabent* e = t->t.entries; e != end; e++) {
-    if (e->next == ent) {
-      prev = e;
-      break;
-    }
-  }
-
-  if (prev) {
-    prev->next = ent->next;
-  }
-
-  t->t.count--;
-  ent->key = 0;
-  ent->next = NULL;
+  rm_at(&t->t, *iter);
 }
 
 void upb_strtable_setentryvalue(upb_strtable* t, intptr_t iter, upb_value v) {
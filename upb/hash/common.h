@@ -12,9 +12,11 @@
  * This file defines very fast int->upb_value (inttable) and string->upb_value
  * (strtable) hash tables.
  *
- * The table uses chained scatter with Brent's variation (inspired by the Lua
- * implementation of hash tables).  The hash function for strings is Austin
- * Appleby's "MurmurHash."
+ * The table is an open-addressing "Swiss table": next to the entries is an
+ * array of one-byte control words, each holding 7 bits of the entry's hash or
+ * marking it empty or deleted.  Lookups probe a group of 16 control bytes at
+ * a time (with SSE2 where available), and only compare keys whose control
+ * byte matches.  Strings are hashed with wyhash.
  *
  * The inttable uses uintptr_t as its key, which guarantees it can be used to
  * store pointers or integers of at least 32 bits (upb isn't really useful on
@@ -136,22 +138,20 @@ typedef struct upb_tabval {
 
 /* upb_table ******************************************************************/
 
+/* An entry is empty if and only if its key is 0, so entries can be scanned
+ * without looking at the control bytes. */
 typedef struct _upb_tabent {
   upb_tabkey key;
   upb_tabval val;
-
-  /* Internal chaining.  This is const so we can create static initializers for
-   * tables.  We cast away const sometimes, but *only* when the containing
-   * upb_table is known to be non-const.  This requires a bit of care, but
-   * the subtlety is confined to table.c. */
-  const struct _upb_tabent* next;
 } upb_tabent;
 
 typedef struct {
   size_t count;       /* Number of entries in the hash part. */
   uint32_t mask;      /* Mask to turn hash value -> bucket. */
-  uint32_t max_count; /* Max count before we hit our load limit. */
+  uint32_t max_count; /* Max count (including deleted) before we resize. */
+  uint32_t deleted;   /* Number of control bytes marked deleted. */
   uint8_t size_lg2;   /* Size of the hashtable part is 2^size_lg2 entries. */
+  uint8_t* ctrl;      /* One control byte per entry, in groups of 16. */
   upb_tabent* entries;
 } upb_table;
 
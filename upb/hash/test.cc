@@ -191,7 +191,7 @@ TEST_P(IntTableTest, TestIntTable) {
 }
 
 INSTANTIATE_TEST_SUITE_P(IntTableParams, IntTableTest,
-                         testing::Values(8, 64, 512, -32));
+                         testing::Values(8, 64, 512, 100000, -32));
 
 /*
  * This test can't pass right now because the table can't store a value of
@@ -229,6 +229,122 @@ TEST(Table, Delete) {
   }
 }
 
+TEST(Table, IntTableChurn) {
+  // Repeatedly inserting and removing keys leaves deleted entries behind in
+  // the hash part, which must not break lookups or make the table grow
+  // without bound.
+  upb::Arena arena;
+  upb_inttable t;
+  upb_inttable_init(&t, arena.ptr());
+  absl::flat_hash_map<uintptr_t, uint32_t> hm;
+  uint32_t x = 1;
+  for (uint32_t i = 0; i < 200000; i++) {
+    x = x * 1103515245 + 12345;
+    uintptr_t key = 1000 + (x >> 8) % 5000;
+    if (hm.contains(key)) {
+      upb_value val;
+      EXPECT_TRUE(upb_inttable_remove(&t, key, &val));
+      EXPECT_EQ(val.val, hm[key]);
+      hm.erase(key);
+    } else {
+      EXPECT_TRUE(upb_inttable_insert(&t, key, upb_value_uint32(i),
+                                      arena.ptr()));
+      hm[key] = i;
+    }
+  }
+  EXPECT_EQ(hm.size(), upb_inttable_count(&t));
+  EXPECT_LE(upb_table_size(&t.t), 16384);
+  for (uintptr_t key = 1000; key < 6000; key++) {
+    upb_value val;
+    bool ok = upb_inttable_lookup(&t, key, &val);
+    EXPECT_EQ(ok, hm.contains(key));
+    if (ok) EXPECT_EQ(val.val, hm[key]);
+  }
+}
+
+TEST(Table, IntTableRemoveIter) {
+  upb::Arena arena;
+  upb_inttable t;
+  upb_inttable_init(&t, arena.ptr());
+  for (uintptr_t key = 0; key < 10000; key += 3) {
+    upb_inttable_insert(&t, key, upb_value_uint32(key), arena.ptr());
+  }
+
+  intptr_t iter = UPB_INTTABLE_BEGIN;
+  uintptr_t key;
+  upb_value val;
+  while (upb_inttable_next(&t, &key, &val, &iter)) {
+    if (key % 2 == 0) upb_inttable_removeiter(&t, &iter);
+  }
+
+  size_t count = 0;
+  for (uintptr_t key = 0; key < 10000; key++) {
+    bool ok = upb_inttable_lookup(&t, key, &val);
+    EXPECT_EQ(ok, key % 3 == 0 && key % 2 != 0) << key;
+    if (ok) count++;
+  }
+  EXPECT_EQ(count, upb_inttable_count(&t));
+}
+
+TEST(Table, StrTableRemoveIter) {
+  upb::Arena arena;
+  upb_strtable t;
+  upb_strtable_init(&t, 0, arena.ptr());
+  absl::flat_hash_map<std::string, uint32_t> hm;
+  for (uint32_t i = 0; i < 10000; i++) {
+    std::string key = std::to_string(i);
+    upb_strtable_insert(&t, key.data(), key.size(), upb_value_uint32(i),
+                        arena.ptr());
+    hm[key] = i;
+  }
+
+  intptr_t iter = UPB_STRTABLE_BEGIN;
+  upb_StringView key;
+  upb_value val;
+  while (upb_strtable_next2(&t, &key, &val, &iter)) {
+    std::string str(key.data, key.size);
+    ASSERT_TRUE(hm.contains(str));
+    EXPECT_EQ(val.val, hm[str]);
+    if (val.val % 2 == 0) {
+      upb_strtable_removeiter(&t, &iter);
+      hm.erase(str);
+    }
+  }
+  EXPECT_EQ(hm.size(), upb_strtable_count(&t));
+
+  // Reinsert the removed keys, which can reuse the deleted entries.
+  for (uint32_t i = 0; i < 10000; i += 2) {
+    std::string key = std::to_string(i);
+    upb_strtable_insert(&t, key.data(), key.size(), upb_value_uint32(i),
+                        arena.ptr());
+    hm[key] = i;
+  }
+  for (const auto& [str, i] : hm) {
+    EXPECT_TRUE(upb_strtable_lookup2(&t, str.data(), str.size(), &val));
+    EXPECT_EQ(val.val, i);
+  }
+  EXPECT_EQ(hm.size(), upb_strtable_count(&t));
+}
+
+TEST(Table, StrTableClear) {
+  upb::Arena arena;
+  upb_strtable t;
+  upb_strtable_init(&t, 0, arena.ptr());
+  for (int i = 0; i < 100; i++) {
+    std::string key = std::to_string(i);
+    upb_strtable_insert(&t, key.data(), key.size(), upb_value_int32(i),
+                        arena.ptr());
+  }
+  upb_strtable_clear(&t);
+  EXPECT_EQ(0, upb_strtable_count(&t));
+  for (int i = 0; i < 100; i++) {
+    std::string key = std::to_string(i);
+    EXPECT_FALSE(upb_strtable_lookup2(&t, key.data(), key.size(), nullptr));
+  }
+  upb_strtable_insert(&t, "x", 1, upb_value_int32(1), arena.ptr());
+  EXPECT_TRUE(upb_strtable_lookup2(&t, "x", 1, nullptr));
+}
+
 TEST(Table, Init) {
   for (int i = 0; i < 2048; i++) {
     /* Tests that the size calculations in init() (lg2 size for target load)
@@ -14,6 +14,15 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define UPB_ARENA_PTHREAD_KEY
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && \
+    !defined(__STDC_NO_THREADS__)
+#include <threads.h>
+#define UPB_ARENA_C11_TSS
+#endif
+
 #include "upb/mem/alloc.h"
 #include "upb/mem/internal/arena.h"
 #include "upb/port/atomic.h"
@@ -39,11 +48,11 @@ typedef struct upb_ArenaInternal {
 
   // When multiple arenas are fused together, each arena points to a parent
   // arena (root points to itself). The root tracks how many live arenas
-  // reference it.
+  // reference it, and the rank of its tree for union-by-rank.
 
   // The low bit is tagged:
   //   0: pointer to parent
-  //   1: count, left shifted by one
+  //   1: count and rank, see _upb_Arena_TaggedFromRefcountAndRank()
   UPB_ATOMIC(uintptr_t) parent_or_count;
 
   // All nodes that are fused together are in a singly-linked list.
@@ -88,17 +97,47 @@ static bool _upb_Arena_IsTaggedPointer(uintptr_t parent_or_count) {
   return (parent_or_count & 1) == 0;
 }
 
+// A root's tagged word packs the refcount above the rank of its tree:
+//
+//   | refcount | rank (6 bits) | 1 |
+//
+// Keeping the rank in the same word as the refcount lets a single CAS check
+// that a root is unchanged, both its refs and its rank, before it is fused.
+static const uint32_t kUpb_Arena_MaxRank = 63;
+static const int kUpb_Arena_RefCountShift = 7;  // Tag bit + 6 rank bits.
+
 static uintptr_t _upb_Arena_RefCountFromTagged(uintptr_t parent_or_count) {
   UPB_ASSERT(_upb_Arena_IsTaggedRefcount(parent_or_count));
-  return parent_or_count >> 1;
+  return parent_or_count >> kUpb_Arena_RefCountShift;
 }
 
-static uintptr_t _upb_Arena_TaggedFromRefcount(uintptr_t refcount) {
-  uintptr_t parent_or_count = (refcount << 1) | 1;
+static uint32_t _upb_Arena_RankFromTagged(uintptr_t parent_or_count) {
+  UPB_ASSERT(_upb_Arena_IsTaggedRefcount(parent_or_count));
+  return (parent_or_count >> 1) & kUpb_Arena_MaxRank;
+}
+
+static uintptr_t _upb_Arena_TaggedFromRefcountAndRank(uintptr_t refcount,
+                                                      uint32_t rank) {
+  UPB_ASSERT(rank <= kUpb_Arena_MaxRank);
+  uintptr_t parent_or_count =
+      (refcount << kUpb_Arena_RefCountShift) | ((uintptr_t)rank << 1) | 1;
   UPB_ASSERT(_upb_Arena_IsTaggedRefcount(parent_or_count));
   return parent_or_count;
 }
 
+static uintptr_t _upb_Arena_TaggedFromRefcount(uintptr_t refcount) {
+  return _upb_Arena_TaggedFromRefcountAndRank(refcount, 0);
+}
+
+// Returns the tagged word with its refcount adjusted by |delta|, keeping the
+// rank.
+static uintptr_t _upb_Arena_TaggedAddRefs(uintptr_t parent_or_count,
+                                          intptr_t delta) {
+  return _upb_Arena_TaggedFromRefcountAndRank(
+      _upb_Arena_RefCountFromTagged(parent_or_count) + delta,
+      _upb_Arena_RankFromTagged(parent_or_count));
+}
+
 static upb_ArenaInternal* _upb_Arena_PointerFromTagged(
     uintptr_t parent_or_count) {
   UPB_ASSERT(_upb_Arena_IsTaggedPointer(parent_or_count));
@@ -170,7 +209,8 @@ static upb_ArenaRoot _upb_Arena_FindRoot(upb_Arena* a) {
       // To keep complexity down, we lazily collapse levels of the tree.  This
       // keeps it flat in the final case, but doesn't cost much incrementally.
       //
-      // Path splitting keeps time complexity down, see:
+      // Path halving (together with union-by-rank in _upb_Arena_DoFuse())
+      // keeps time complexity down, see:
       //   https://en.wikipedia.org/wiki/Disjoint-set_data_structure
       //
       // We can safely use a relaxed atomic here because all threads doing this
@@ -188,6 +228,11 @@ static upb_ArenaRoot _upb_Arena_FindRoot(upb_Arena* a) {
       // required.
       UPB_ASSERT(ai != _upb_Arena_PointerFromTagged(next_poc));
       upb_Atomic_Store(&ai->parent_or_count, next_poc, memory_order_relaxed);
+
+      // Skip straight to the grandparent we just linked to.
+      ai = _upb_Arena_PointerFromTagged(next_poc);
+      poc = upb_Atomic_Load(&ai->parent_or_count, memory_order_acquire);
+      continue;
     }
     ai = next;
     poc = next_poc;
@@ -241,6 +286,256 @@ uint32_t upb_Arena_DebugRefCount(upb_Arena* a) {
   return _upb_Arena_RefCountFromTagged(poc);
 }
 
+// Freed blocks from upb_alloc_global may be kept for reuse by later arenas,
+// see upb_Arena_SetBlockCacheLimits(). Each thread has its own cache, so an
+// arena that is created and freed on the same thread never takes a lock. When
+// a thread's cache fills up, half of it spills over to a global cache, which
+// threads whose own cache is empty refill from. Where the platform has
+// thread-specific storage with destructors, a thread's cache is spilled when
+// the thread exits.
+//
+// Cached blocks are linked through their `next` field, and their `size` is the
+// full size that was allocated.
+typedef struct {
+  upb_MemBlock* head;
+  size_t count;
+  size_t bytes;
+} upb_BlockCache;
+
+static UPB_ATOMIC(size_t) block_cache_max_count = 0;
+static UPB_ATOMIC(size_t) block_cache_max_bytes = 0;
+
+// The global cache is guarded by a spinlock; it is only touched when a
+// thread's own cache misses or overflows. `global_block_count` mirrors
+// `global_block_cache.count` so that misses can skip the lock when it's empty.
+static upb_BlockCache global_block_cache;
+static UPB_ATOMIC(uintptr_t) global_block_cache_lock = 0;
+static UPB_ATOMIC(size_t) global_block_count = 0;
+
+#ifdef UPB_THREAD_LOCAL
+static UPB_THREAD_LOCAL upb_BlockCache thread_block_cache;
+static UPB_THREAD_LOCAL bool thread_block_cache_registered;
+#endif
+
+static void _upb_BlockCache_Lock(void) {
+  uintptr_t unlocked = 0;
+  while (!upb_Atomic_CompareExchangeWeak(&global_block_cache_lock, &unlocked,
+                                         1, memory_order_acquire,
+                                         memory_order_relaxed)) {
+    unlocked = 0;
+  }
+}
+
+static void _upb_BlockCache_Unlock(void) {
+  upb_Atomic_Store(&global_block_cache_lock, 0, memory_order_release);
+}
+
+static bool _upb_BlockCache_HasRoom(const upb_BlockCache* c, size_t size,
+                                    size_t max_count, size_t max_bytes) {
+  return c->count < max_count && c->bytes + size <= max_bytes;
+}
+
+static void _upb_BlockCache_Push(upb_BlockCache* c, upb_MemBlock* block,
+                                 size_t size) {
+  block->size = (uint32_t)size;
+  upb_Atomic_Store(&block->next, c->head, memory_order_relaxed);
+  c->head = block;
+  c->count++;
+  c->bytes += size;
+}
+
+static upb_MemBlock* _upb_BlockCache_PopHead(upb_BlockCache* c) {
+  upb_MemBlock* block = c->head;
+  c->head = upb_Atomic_Load(&block->next, memory_order_relaxed);
+  c->count--;
+  c->bytes -= block->size;
+  return block;
+}
+
+// Removes and returns the first block that can hold |size| bytes without
+// wasting more than half of it, or NULL if there is none.
+static upb_MemBlock* _upb_BlockCache_Take(upb_BlockCache* c, size_t size) {
+  upb_MemBlock* prev = NULL;
+  upb_MemBlock* block = c->head;
+  while (block != NULL) {
+    upb_MemBlock* next = upb_Atomic_Load(&block->next, memory_order_relaxed);
+    if (block->size >= size && block->size / 2 < size) {
+      if (prev) {
+        upb_Atomic_Store(&prev->next, next, memory_order_relaxed);
+      } else {
+        c->head = next;
+      }
+      c->count--;
+      c->bytes -= block->size;
+      return block;
+    }
+    prev = block;
+    block = next;
+  }
+  return NULL;
+}
+
+static void _upb_BlockCache_FreeBlock(upb_MemBlock* block) {
+  UPB_UNPOISON_MEMORY_REGION(block, block->size);
+  upb_gfree(block);
+}
+
+// Frees a list of blocks linked through their `next` field.
+static void _upb_BlockCache_FreeList(upb_MemBlock* block) {
+  while (block != NULL) {
+    upb_MemBlock* next = upb_Atomic_Load(&block->next, memory_order_relaxed);
+    _upb_BlockCache_FreeBlock(block);
+    block = next;
+  }
+}
+
+// Moves blocks from |c| to the global cache until |c| is within the given
+// limits, freeing the blocks that the global cache has no room for. The frees
+// happen after the lock is released.
+static void _upb_BlockCache_Spill(upb_BlockCache* c, size_t count,
+                                  size_t bytes) {
+  size_t max_count = block_cache_max_count;
+  size_t max_bytes = block_cache_max_bytes;
+  upb_MemBlock* overflow = NULL;
+  _upb_BlockCache_Lock();
+  while (c->count > count || c->bytes > bytes) {
+    upb_MemBlock* block = _upb_BlockCache_PopHead(c);
+    if (_upb_BlockCache_HasRoom(&global_block_cache, block->size, max_count,
+                                max_bytes)) {
+      _upb_BlockCache_Push(&global_block_cache, block, block->size);
+    } else {
+      upb_Atomic_Store(&block->next, overflow, memory_order_relaxed);
+      overflow = block;
+    }
+  }
+  upb_Atomic_Store(&global_block_count, global_block_cache.count,
+                   memory_order_relaxed);
+  _upb_BlockCache_Unlock();
+  _upb_BlockCache_FreeList(overflow);
+}
+
+void upb_Arena_SetBlockCacheLimits(size_t max_count, size_t max_bytes) {
+  block_cache_max_count = max_count;
+  block_cache_max_bytes = max_bytes;
+  upb_MemBlock* overflow = NULL;
+  _upb_BlockCache_Lock();
+  while (global_block_cache.count > max_count ||
+         global_block_cache.bytes > max_bytes) {
+    upb_MemBlock* block = _upb_BlockCache_PopHead(&global_block_cache);
+    upb_Atomic_Store(&block->next, overflow, memory_order_relaxed);
+    overflow = block;
+  }
+  upb_Atomic_Store(&global_block_count, global_block_cache.count,
+                   memory_order_relaxed);
+  _upb_BlockCache_Unlock();
+  _upb_BlockCache_FreeList(overflow);
+}
+
+void upb_Arena_FlushThreadBlockCache(void) {
+#ifdef UPB_THREAD_LOCAL
+  _upb_BlockCache_Spill(&thread_block_cache, 0, 0);
+#endif
+}
+
+#if defined(UPB_THREAD_LOCAL) && \
+    (defined(UPB_ARENA_PTHREAD_KEY) || defined(UPB_ARENA_C11_TSS))
+// Runs at thread exit with the exiting thread's cache.
+static void _upb_BlockCache_ThreadExit(void* cache) {
+  // A later thread-exit destructor may still free arenas on this thread, so
+  // let the next push register again.
+  thread_block_cache_registered = false;
+  _upb_BlockCache_Spill(cache, 0, 0);
+}
+#endif
+
+#ifdef UPB_THREAD_LOCAL
+#if defined(UPB_ARENA_PTHREAD_KEY)
+static pthread_key_t block_cache_key;
+static pthread_once_t block_cache_key_once = PTHREAD_ONCE_INIT;
+static bool block_cache_key_ok;
+
+static void _upb_BlockCache_CreateKey(void) {
+  block_cache_key_ok =
+      pthread_key_create(&block_cache_key, &_upb_BlockCache_ThreadExit) == 0;
+}
+
+static void _upb_BlockCache_RegisterThreadExit(void) {
+  pthread_once(&block_cache_key_once, &_upb_BlockCache_CreateKey);
+  if (block_cache_key_ok) {
+    pthread_setspecific(block_cache_key, &thread_block_cache);
+  }
+}
+#elif defined(UPB_ARENA_C11_TSS)
+static tss_t block_cache_key;
+static once_flag block_cache_key_once = ONCE_FLAG_INIT;
+static bool block_cache_key_ok;
+
+static void _upb_BlockCache_CreateKey(void) {
+  block_cache_key_ok =
+      tss_create(&block_cache_key, &_upb_BlockCache_ThreadExit) == thrd_success;
+}
+
+static void _upb_BlockCache_RegisterThreadExit(void) {
+  call_once(&block_cache_key_once, &_upb_BlockCache_CreateKey);
+  if (block_cache_key_ok) tss_set(block_cache_key, &thread_block_cache);
+}
+#else
+// No thread-exit hook: threads must call upb_Arena_FlushThreadBlockCache().
+static void _upb_BlockCache_RegisterThreadExit(void) {}
+#endif
+#endif  // UPB_THREAD_LOCAL
+
+// Allocates a block of at least |*size| bytes from |alloc|, updating |*size|
+// if a larger block was taken from the cache.
+static void* _upb_Arena_MallocBlock(upb_alloc* alloc, size_t* size) {
+#ifdef UPB_THREAD_LOCAL
+  if (alloc == &upb_alloc_global && block_cache_max_count != 0) {
+    upb_MemBlock* block = _upb_BlockCache_Take(&thread_block_cache, *size);
+    if (!block &&
+        upb_Atomic_Load(&global_block_count, memory_order_relaxed) != 0) {
+      _upb_BlockCache_Lock();
+      block = _upb_BlockCache_Take(&global_block_cache, *size);
+      upb_Atomic_Store(&global_block_count, global_block_cache.count,
+                       memory_order_relaxed);
+      _upb_BlockCache_Unlock();
+    }
+    if (block) {
+      *size = block->size;
+      UPB_UNPOISON_MEMORY_REGION(block, *size);
+      return block;
+    }
+  }
+#endif
+  return upb_malloc(alloc, *size);
+}
+
+// Frees a block of |size| bytes to |alloc|, or keeps it in the calling thread's
+// cache.
+static void _upb_Arena_FreeBlock(upb_alloc* alloc, upb_MemBlock* block,
+                                 size_t size) {
+#ifdef UPB_THREAD_LOCAL
+  size_t max_count = block_cache_max_count;
+  size_t max_bytes = block_cache_max_bytes;
+  if (alloc == &upb_alloc_global && max_count != 0 && size <= max_bytes &&
+      size <= max_block_size + kUpb_MemblockReserve) {
+    upb_BlockCache* c = &thread_block_cache;
+    if (!thread_block_cache_registered) {
+      _upb_BlockCache_RegisterThreadExit();
+      thread_block_cache_registered = true;
+    }
+    if (!_upb_BlockCache_HasRoom(c, size, max_count, max_bytes)) {
+      _upb_BlockCache_Spill(c, max_count / 2,
+                            UPB_MIN(max_bytes / 2, max_bytes - size));
+    }
+    _upb_BlockCache_Push(c, block, size);
+    UPB_POISON_MEMORY_REGION(UPB_PTR_AT(block, kUpb_MemblockReserve, char),
+                             size - kUpb_MemblockReserve);
+    return;
+  }
+#endif
+  upb_free(alloc, block);
+}
+
 static void _upb_Arena_AddBlock(upb_Arena* a, void* ptr, size_t size) {
   upb_ArenaInternal* ai = upb_Arena_Internal(a);
   upb_MemBlock* block = ptr;
@@ -271,7 +566,7 @@ static bool _upb_Arena_AllocBlock(upb_Arena* a, size_t size) {
   size_t block_size = UPB_MAX(size, clamped_size) + kUpb_MemblockReserve;
 
   upb_MemBlock* block =
-      upb_malloc(_upb_ArenaInternal_BlockAlloc(ai), block_size);
+      _upb_Arena_MallocBlock(_upb_ArenaInternal_BlockAlloc(ai), &block_size);
 
   if (!block) return false;
   _upb_Arena_AddBlock(a, block, block_size);
@@ -292,9 +587,11 @@ static upb_Arena* _upb_Arena_InitSlow(upb_alloc* alloc) {
   // We need to malloc the initial block.
   char* mem;
   size_t n = first_block_overhead + 256;
-  if (!alloc || !(mem = upb_malloc(alloc, n))) {
+  if (!alloc || !(mem = _upb_Arena_MallocBlock(alloc, &n))) {
     return NULL;
   }
+  // A block from the cache may be larger than we asked for.
+  n = UPB_ALIGN_DOWN(n, UPB_ALIGN_OF(upb_ArenaState));
 
   a = UPB_PTR_AT(mem, n - sizeof(upb_ArenaState), upb_ArenaState);
   n -= sizeof(upb_ArenaState);
@@ -359,12 +656,21 @@ static void _upb_Arena_DoFree(upb_ArenaInternal* ai) {
     upb_ArenaInternal* next_arena =
         (upb_ArenaInternal*)upb_Atomic_Load(&ai->next, memory_order_acquire);
     upb_alloc* block_alloc = _upb_ArenaInternal_BlockAlloc(ai);
+    // Without an initial block, the arena itself lives at the end of its
+    // first block, past the block's recorded size.
+    char* state = _upb_ArenaInternal_HasInitialBlock(ai)
+                      ? NULL
+                      : (char*)ai - offsetof(upb_ArenaState, body);
     upb_MemBlock* block = upb_Atomic_Load(&ai->blocks, memory_order_acquire);
     while (block != NULL) {
       // Load first since we are deleting block.
       upb_MemBlock* next_block =
           upb_Atomic_Load(&block->next, memory_order_acquire);
-      upb_free(block_alloc, block);
+      size_t size = block->size;
+      if (UPB_PTR_AT(block, size, char) == state) {
+        size += sizeof(upb_ArenaState);
+      }
+      _upb_Arena_FreeBlock(block_alloc, block, size);
       block = next_block;
     }
     ai = next_arena;
@@ -383,7 +689,7 @@ retry:
   // compare_exchange or fetch_sub are RMW operations, which are more
   // expensive then direct loads.  As an optimization, we only do RMW ops
   // when we need to update things for other threads to see.
-  if (poc == _upb_Arena_TaggedFromRefcount(1)) {
+  if (_upb_Arena_RefCountFromTagged(poc) == 1) {
 #ifdef UPB_TRACING_ENABLED
     upb_Arena_LogFree(a);
 #endif
@@ -392,8 +698,7 @@ retry:
   }
 
   if (upb_Atomic_CompareExchangeWeak(
-          &ai->parent_or_count, &poc,
-          _upb_Arena_TaggedFromRefcount(_upb_Arena_RefCountFromTagged(poc) - 1),
+          &ai->parent_or_count, &poc, _upb_Arena_TaggedAddRefs(poc, -1),
           memory_order_release, memory_order_acquire)) {
     // We were >1 and we decremented it successfully, so we are done.
     return;
@@ -404,31 +709,37 @@ retry:
   goto retry;
 }
 
+// Appends `child`'s list of arenas to `parent`'s. The root keeps a pointer to
+// the tail of its list, so this is O(1) unless racing fuses left it stale.
+//
+// The loads and exchange of `next` and `tail` are acquire/release because they
+// are what publishes a newly fused arena's fields to other threads walking the
+// list.
 static void _upb_Arena_DoFuseArenaLists(upb_ArenaInternal* const parent,
                                         upb_ArenaInternal* child) {
   upb_ArenaInternal* parent_tail =
-      upb_Atomic_Load(&parent->tail, memory_order_relaxed);
+      upb_Atomic_Load(&parent->tail, memory_order_acquire);
 
   do {
     // Our tail might be stale, but it will always converge to the true tail.
     upb_ArenaInternal* parent_tail_next =
-        upb_Atomic_Load(&parent_tail->next, memory_order_relaxed);
+        upb_Atomic_Load(&parent_tail->next, memory_order_acquire);
     while (parent_tail_next != NULL) {
       parent_tail = parent_tail_next;
       parent_tail_next =
-          upb_Atomic_Load(&parent_tail->next, memory_order_relaxed);
+          upb_Atomic_Load(&parent_tail->next, memory_order_acquire);
     }
 
     upb_ArenaInternal* displaced =
-        upb_Atomic_Exchange(&parent_tail->next, child, memory_order_relaxed);
-    parent_tail = upb_Atomic_Load(&child->tail, memory_order_relaxed);
+        upb_Atomic_Exchange(&parent_tail->next, child, memory_order_acq_rel);
+    parent_tail = upb_Atomic_Load(&child->tail, memory_order_acquire);
 
     // If we displaced something that got installed racily, we can simply
     // reinstall it on our new tail.
     child = displaced;
   } while (child != NULL);
 
-  upb_Atomic_Store(&parent->tail, parent_tail, memory_order_relaxed);
+  upb_Atomic_Store(&parent->tail, parent_tail, memory_order_release);
 }
 
 static upb_ArenaInternal* _upb_Arena_DoFuse(upb_Arena* a1, upb_Arena* a2,
@@ -445,12 +756,26 @@ static upb_ArenaInternal* _upb_Arena_DoFuse(upb_Arena* a1, upb_Arena* a2,
 
   if (r1.root == r2.root) return r1.root;  // Already fused.
 
-  // Avoid cycles by always fusing into the root with the lower address.
-  if ((uintptr_t)r1.root > (uintptr_t)r2.root) {
+  // Union by rank: fuse the shallower tree into the deeper one, so that
+  // repeatedly fusing small arenas into a large group doesn't grow the tree.
+  // Ties go to the root with the lower address.
+  //
+  // This cannot create cycles: a root's rank only ever grows, and the CAS that
+  // reparents `r2` below checks that its rank is still the one we compared, so
+  // every parent pointer leads to a strictly greater (rank, -address).
+  uint32_t rank1 = _upb_Arena_RankFromTagged(r1.tagged_count);
+  uint32_t rank2 = _upb_Arena_RankFromTagged(r2.tagged_count);
+  if (rank1 < rank2 ||
+      (rank1 == rank2 && (uintptr_t)r1.root > (uintptr_t)r2.root)) {
     upb_ArenaRoot tmp = r1;
     r1 = r2;
     r2 = tmp;
+    uint32_t tmp_rank = rank1;
+    rank1 = rank2;
+    rank2 = tmp_rank;
   }
+  uint32_t new_rank =
+      rank1 == rank2 ? UPB_MIN(rank1 + 1, kUpb_Arena_MaxRank) : rank1;
 
   // The moment we install `r1` as the parent for `r2` all racing frees may
   // immediately begin decrementing `r1`'s refcount (including pending
@@ -465,8 +790,9 @@ static upb_ArenaInternal* _upb_Arena_DoFuse(upb_Arena* a1, upb_Arena* a2,
   // different node, during a previous and failed DoFuse() attempt. But we will
   // not lose track of these refs because we always add them to our overall
   // delta.
-  uintptr_t r2_untagged_count = r2.tagged_count & ~1;
-  uintptr_t with_r2_refs = r1.tagged_count + r2_untagged_count;
+  uintptr_t r2_refs = _upb_Arena_RefCountFromTagged(r2.tagged_count);
+  uintptr_t with_r2_refs = _upb_Arena_TaggedFromRefcountAndRank(
+      _upb_Arena_RefCountFromTagged(r1.tagged_count) + r2_refs, new_rank);
   if (!upb_Atomic_CompareExchangeStrong(
           &r1.root->parent_or_count, &r1.tagged_count, with_r2_refs,
           memory_order_release, memory_order_acquire)) {
@@ -480,7 +806,7 @@ static upb_ArenaInternal* _upb_Arena_DoFuse(upb_Arena* a1, upb_Arena* a2,
           _upb_Arena_TaggedFromPointer(r1.root), memory_order_release,
           memory_order_acquire)) {
     // We'll need to remove the excess refs we added to r1 previously.
-    *ref_delta += r2_untagged_count;
+    *ref_delta += r2_refs;
     return NULL;
   }
 
@@ -496,8 +822,7 @@ static bool _upb_Arena_FixupRefs(upb_ArenaInternal* new_root,
   uintptr_t poc =
       upb_Atomic_Load(&new_root->parent_or_count, memory_order_relaxed);
   if (_upb_Arena_IsTaggedPointer(poc)) return false;
-  uintptr_t with_refs = poc - ref_delta;
-  UPB_ASSERT(!_upb_Arena_IsTaggedPointer(with_refs));
+  uintptr_t with_refs = _upb_Arena_TaggedAddRefs(poc, -(intptr_t)ref_delta);
   return upb_Atomic_CompareExchangeStrong(&new_root->parent_or_count, &poc,
                                           with_refs, memory_order_relaxed,
                                           memory_order_relaxed);
@@ -539,9 +864,8 @@ retry:
   r = _upb_Arena_FindRoot(a);
   if (upb_Atomic_CompareExchangeWeak(
           &r.root->parent_or_count, &r.tagged_count,
-          _upb_Arena_TaggedFromRefcount(
-              _upb_Arena_RefCountFromTagged(r.tagged_count) + 1),
-          memory_order_release, memory_order_acquire)) {
+          _upb_Arena_TaggedAddRefs(r.tagged_count, 1), memory_order_release,
+          memory_order_acquire)) {
     // We incremented it successfully, so we are done.
     return true;
   }
@@ -67,6 +67,26 @@ UPB_API_INLINE void* upb_Arena_Realloc(upb_Arena* a, void* ptr, size_t oldsize,
 // the future.
 void upb_Arena_SetMaxBlockSize(size_t max);
 
+// Enables a cache of freed arena blocks, so that new arenas can reuse them
+// instead of calling malloc(). Only blocks from upb_alloc_global are cached.
+// Each thread keeps up to |max_count| blocks totalling at most |max_bytes|;
+// when that fills up, half of it spills over to a global cache with the same
+// limits, and blocks that do not fit there are freed. Passing 0 disables the
+// cache, which is the default.
+//
+// On platforms with POSIX or C11 threads, a thread's cache is moved to the
+// global cache when the thread exits. Elsewhere, a thread that used the cache
+// should call upb_Arena_FlushThreadBlockCache() before it exits, otherwise the
+// blocks in its cache are leaked.
+//
+// This API is meant for experimentation only. It will likely be removed in
+// the future.
+void upb_Arena_SetBlockCacheLimits(size_t max_count, size_t max_bytes);
+
+// Moves the calling thread's cached blocks to the global cache, freeing the
+// ones that do not fit.
+void upb_Arena_FlushThreadBlockCache(void);
+
 // Shrinks the last alloc from arena.
 // REQUIRES: (ptr, oldsize) was the last malloc/realloc from this arena.
 // We could also add a upb_Arena_TryShrinkLast() which is simply a no-op if
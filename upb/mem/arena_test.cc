@@ -8,6 +8,7 @@
 #include "upb/mem/arena.h"
 
 #include <stddef.h>
+#include <string.h>
 
 #include <array>
 #include <atomic>
@@ -37,6 +38,33 @@ TEST(ArenaTest, ArenaFuse) {
   upb_Arena_Free(arena2);
 }
 
+TEST(ArenaTest, FuseManyKeepsRefCount) {
+  // Fuse in both unbalanced and balanced shapes, so that roots of every rank
+  // get reparented, and check that no refs are lost along the way.
+  std::vector<upb_Arena*> arenas(1000);
+  for (auto& arena : arenas) arena = upb_Arena_New();
+  for (size_t i = 1; i < arenas.size() / 2; ++i) {
+    EXPECT_TRUE(upb_Arena_Fuse(arenas[0], arenas[i]));
+  }
+  for (size_t step = 1; step < arenas.size() / 2; step *= 2) {
+    for (size_t i = arenas.size() / 2; i + step < arenas.size();
+         i += step * 2) {
+      EXPECT_TRUE(upb_Arena_Fuse(arenas[i], arenas[i + step]));
+    }
+  }
+  EXPECT_TRUE(upb_Arena_Fuse(arenas.back(), arenas[1]));
+
+  size_t fused_count;
+  upb_Arena_SpaceAllocated(arenas[0], &fused_count);
+  EXPECT_EQ(fused_count, arenas.size());
+  EXPECT_EQ(upb_Arena_DebugRefCount(arenas[0]), arenas.size());
+  EXPECT_TRUE(upb_Arena_IncRefFor(arenas[500], nullptr));
+  EXPECT_EQ(upb_Arena_DebugRefCount(arenas[999]), arenas.size() + 1);
+  upb_Arena_DecRefFor(arenas[500], nullptr);
+
+  for (auto& arena : arenas) upb_Arena_Free(arena);
+}
+
 // Do-nothing allocator for testing.
 extern "C" void* TestAllocFunc(upb_alloc* alloc, void* ptr, size_t oldsize,
                                size_t size) {
@@ -197,6 +225,32 @@ TEST(ArenaTest, MaxBlockSize) {
   upb_Arena_Free(arena);
 }
 
+TEST(ArenaTest, BlockCache) {
+  upb_Arena_SetBlockCacheLimits(4, 64 << 10);
+
+  // A new arena reuses the block of the arena freed just before it.
+  upb_Arena* arena1 = upb_Arena_New();
+  void* ptr1 = upb_Arena_Malloc(arena1, 16);
+  upb_Arena_Free(arena1);
+  upb_Arena* arena2 = upb_Arena_New();
+  void* ptr2 = upb_Arena_Malloc(arena2, 16);
+  EXPECT_EQ(ptr1, ptr2);
+
+  // Grown arenas are still usable and account for all of their blocks.
+  for (int i = 0; i < 100; ++i) upb_Arena_Malloc(arena2, 1024);
+  size_t before = upb_Arena_SpaceAllocated(arena2, nullptr);
+  upb_Arena_Free(arena2);
+  upb_Arena* arena3 = upb_Arena_New();
+  for (int i = 0; i < 100; ++i) {
+    memset(upb_Arena_Malloc(arena3, 1024), i, 1024);
+  }
+  EXPECT_LE(upb_Arena_SpaceAllocated(arena3, nullptr), 2 * before);
+  upb_Arena_Free(arena3);
+
+  upb_Arena_FlushThreadBlockCache();
+  upb_Arena_SetBlockCacheLimits(0, 0);
+}
+
 #ifdef UPB_USE_C11_ATOMICS
 
 TEST(ArenaTest, FuzzFuseFreeRace) {
@@ -245,6 +299,58 @@ TEST(ArenaTest, FuzzFuseFuseRace) {
   for (auto& t : threads) t.join();
 }
 
+TEST(ArenaTest, FuzzBlockCacheRace) {
+  // Small limits, so that blocks keep moving between the threads' caches and
+  // the global one.
+  upb_Arena_SetBlockCacheLimits(8, 8 << 10);
+  {
+    Environment env;
+
+    absl::Notification done;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 10; ++i) {
+      threads.emplace_back([&]() {
+        absl::BitGen gen;
+        while (!done.HasBeenNotified()) {
+          env.RandomPoke(gen);
+        }
+        // No upb_Arena_FlushThreadBlockCache(): the cache is spilled when
+        // the thread exits.
+      });
+    }
+
+    absl::BitGen gen;
+    auto end = absl::Now() + absl::Seconds(2);
+    while (absl::Now() < end) {
+      env.RandomPoke(gen);
+    }
+    done.Notify();
+    for (auto& t : threads) t.join();
+  }
+  upb_Arena_FlushThreadBlockCache();
+  upb_Arena_SetBlockCacheLimits(0, 0);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST(ArenaTest, BlockCacheSpillsOnThreadExit) {
+  upb_Arena_SetBlockCacheLimits(4, 64 << 10);
+  void* ptr1;
+  std::thread([&]() {
+    upb_Arena* arena = upb_Arena_New();
+    ptr1 = upb_Arena_Malloc(arena, 16);
+    upb_Arena_Free(arena);
+  }).join();
+
+  // The exited thread's block went to the global cache.
+  upb_Arena* arena = upb_Arena_New();
+  EXPECT_EQ(upb_Arena_Malloc(arena, 16), ptr1);
+  upb_Arena_Free(arena);
+
+  upb_Arena_FlushThreadBlockCache();
+  upb_Arena_SetBlockCacheLimits(0, 0);
+}
+#endif
+
 TEST(ArenaTest, ArenaIncRef) {
   upb_Arena* arena1 = upb_Arena_New();
   EXPECT_EQ(upb_Arena_DebugRefCount(arena1), 1);
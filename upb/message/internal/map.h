@@ -35,6 +35,10 @@ struct upb_Map {
   bool UPB_PRIVATE(is_frozen);
 
   upb_strtable table;
+
+  // The entries of a map frozen by upb_Map_FreezeSorted(), sorted by key, or
+  // NULL.  Integer keys are sorted as unsigned regardless of the key type.
+  const upb_tabent* const* UPB_PRIVATE(sorted);
 };
 
 #ifdef __cplusplus
@@ -166,6 +170,9 @@ UPB_INLINE size_t _upb_Map_CTypeSize(upb_CType ctype) {
 // Creates a new map on the given arena with this key/value type.
 struct upb_Map* _upb_Map_New(upb_Arena* a, size_t key_size, size_t value_size);
 
+// Sorts the entries of a frozen map and stores the order in the map.
+bool UPB_PRIVATE(_upb_Map_CacheSortedOrder)(struct upb_Map* map, upb_Arena* a);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -34,6 +34,8 @@ typedef struct {
   void const** entries;
   int size;
   int cap;
+  void* scratch;  // Sort keys, reused across maps.
+  size_t scratch_size;
 } _upb_mapsorter;
 
 typedef struct {
@@ -46,10 +48,13 @@ UPB_INLINE void _upb_mapsorter_init(_upb_mapsorter* s) {
   s->entries = NULL;
   s->size = 0;
   s->cap = 0;
+  s->scratch = NULL;
+  s->scratch_size = 0;
 }
 
 UPB_INLINE void _upb_mapsorter_destroy(_upb_mapsorter* s) {
   if (s->entries) upb_gfree(s->entries);
+  if (s->scratch) upb_gfree(s->scratch);
 }
 
 UPB_INLINE bool _upb_sortedmap_next(_upb_mapsorter* s,
@@ -132,6 +132,16 @@ void upb_Map_Freeze(upb_Map* map, const upb_MiniTable* m) {
   }
 }
 
+bool upb_Map_FreezeSorted(upb_Map* map, const upb_MiniTable* m,
+                          upb_Arena* a) {
+  bool was_frozen = upb_Map_IsFrozen(map);
+  upb_Map_Freeze(map, m);
+  if (map->UPB_PRIVATE(sorted)) return true;
+  // A map that was already frozen may be shared with other threads.
+  if (was_frozen) return true;
+  return UPB_PRIVATE(_upb_Map_CacheSortedOrder)(map, a);
+}
+
 // EVERYTHING BELOW THIS LINE IS INTERNAL - DO NOT USE /////////////////////////
 
 upb_Map* _upb_Map_New(upb_Arena* a, size_t key_size, size_t value_size) {
@@ -142,6 +152,7 @@ upb_Map* _upb_Map_New(upb_Arena* a, size_t key_size, size_t value_size) {
   map->key_size = key_size;
   map->val_size = value_size;
   map->UPB_PRIVATE(is_frozen) = false;
+  map->UPB_PRIVATE(sorted) = NULL;
 
   return map;
 }
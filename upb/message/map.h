@@ -111,6 +111,14 @@ UPB_API upb_MessageValue upb_MapIterator_Value(const upb_Map* map, size_t iter);
 // those messages. Otherwise |m| must be NULL.
 UPB_API void upb_Map_Freeze(upb_Map* map, const upb_MiniTable* m);
 
+// Like upb_Map_Freeze(), but also records the map's entries in sorted order, so
+// that deterministic serialization of the frozen map doesn't sort them again.
+// The order is allocated from |a|, which must outlive the map. A map that was
+// already frozen is left as it is. Returns false if allocation fails, in which
+// case the map is still frozen.
+UPB_API bool upb_Map_FreezeSorted(upb_Map* map, const upb_MiniTable* m,
+                                  upb_Arena* a);
+
 // Returns whether a map has been frozen.
 UPB_API_INLINE bool upb_Map_IsFrozen(const upb_Map* map);
 
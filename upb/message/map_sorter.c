@@ -14,6 +14,7 @@
 #include "upb/base/internal/log2.h"
 #include "upb/base/string_view.h"
 #include "upb/mem/alloc.h"
+#include "upb/mem/arena.h"
 #include "upb/message/map.h"
 #include "upb/message/message.h"
 #include "upb/mini_table/extension.h"
@@ -21,76 +22,301 @@
 // Must be last.
 #include "upb/port/def.inc"
 
-static void _upb_mapsorter_getkeys(const void* _a, const void* _b, void* a_key,
-                                   void* b_key, size_t size) {
-  const upb_tabent* const* a = _a;
-  const upb_tabent* const* b = _b;
-  upb_StringView a_tabkey = upb_tabstrview((*a)->key);
-  upb_StringView b_tabkey = upb_tabstrview((*b)->key);
-  _upb_map_fromkey(a_tabkey, a_key, size);
-  _upb_map_fromkey(b_tabkey, b_key, size);
+// Map entries are sorted by a 64-bit sort key, which orders entries the same
+// way as the map's key type.  Integer keys fit in a sort key directly, and
+// strings are sorted 7 bytes at a time (see _upb_mapsorter_strkey()).
+typedef struct {
+  uint64_t key;
+  const upb_tabent* ent;
+} _upb_mapsorter_elem;
+
+// Below this many entries, an insertion sort beats the radix sort's
+// histogram passes.
+#define UPB_MAPSORTER_RADIX_MIN 32
+
+static upb_StringView _upb_mapsorter_strview(const upb_tabent* ent) {
+  return upb_tabstrview(ent->key);
 }
 
-static int _upb_mapsorter_cmpi64(const void* _a, const void* _b) {
-  int64_t a, b;
-  _upb_mapsorter_getkeys(_a, _b, &a, &b, 8);
-  return a < b ? -1 : a > b;
+// The order of string keys: a key sorts before any longer key that it is a
+// prefix of, and otherwise keys are ordered by the first differing byte, from
+// high to low.
+static bool _upb_mapsorter_strless(const upb_tabent* a, const upb_tabent* b) {
+  upb_StringView a_key = _upb_mapsorter_strview(a);
+  upb_StringView b_key = _upb_mapsorter_strview(b);
+  size_t common_size = UPB_MIN(a_key.size, b_key.size);
+  int cmp = memcmp(a_key.data, b_key.data, common_size);
+  if (cmp) return cmp > 0;
+  return a_key.size < b_key.size;
 }
 
-static int _upb_mapsorter_cmpu64(const void* _a, const void* _b) {
-  uint64_t a, b;
-  _upb_mapsorter_getkeys(_a, _b, &a, &b, 8);
-  return a < b ? -1 : a > b;
+// Returns the sort key for bytes [ofs, ofs + 7) of a string key.  Each byte
+// becomes a 9-bit symbol that maps bytes 255...0 to 1...256, and 0 marks the
+// end of the string.  Comparing sort keys therefore matches
+// _upb_mapsorter_strless(), as long as the keys share their first `ofs` bytes.
+static uint64_t _upb_mapsorter_strkey(const upb_tabent* ent, size_t ofs) {
+  upb_StringView str = _upb_mapsorter_strview(ent);
+  uint64_t key = 0;
+  for (size_t i = ofs; i < ofs + 7; i++) {
+    uint64_t sym = i < str.size ? 256 - (uint8_t)str.data[i] : 0;
+    key = (key << 9) | sym;
+  }
+  return key;
 }
 
-static int _upb_mapsorter_cmpi32(const void* _a, const void* _b) {
-  int32_t a, b;
-  _upb_mapsorter_getkeys(_a, _b, &a, &b, 4);
-  return a < b ? -1 : a > b;
+static uint64_t _upb_mapsorter_intkey(const upb_tabent* ent,
+                                      upb_FieldType key_type) {
+  upb_StringView key = _upb_mapsorter_strview(ent);
+  switch (key_type) {
+    case kUpb_FieldType_Int64:
+    case kUpb_FieldType_SFixed64:
+    case kUpb_FieldType_SInt64: {
+      uint64_t val;
+      memcpy(&val, key.data, 8);
+      return val ^ (1ULL << 63);  // Moves negative values first.
+    }
+    case kUpb_FieldType_UInt64:
+    case kUpb_FieldType_Fixed64: {
+      uint64_t val;
+      memcpy(&val, key.data, 8);
+      return val;
+    }
+    case kUpb_FieldType_Int32:
+    case kUpb_FieldType_SInt32:
+    case kUpb_FieldType_SFixed32:
+    case kUpb_FieldType_Enum: {
+      uint32_t val;
+      memcpy(&val, key.data, 4);
+      return val ^ (1U << 31);
+    }
+    case kUpb_FieldType_UInt32:
+    case kUpb_FieldType_Fixed32: {
+      uint32_t val;
+      memcpy(&val, key.data, 4);
+      return val;
+    }
+    case kUpb_FieldType_Bool: {
+      bool val;
+      memcpy(&val, key.data, 1);
+      return val;
+    }
+    default:
+      UPB_UNREACHABLE();
+  }
 }
 
-static int _upb_mapsorter_cmpu32(const void* _a, const void* _b) {
-  uint32_t a, b;
-  _upb_mapsorter_getkeys(_a, _b, &a, &b, 4);
-  return a < b ? -1 : a > b;
+static void _upb_mapsorter_insertionsort(_upb_mapsorter_elem* elems, size_t n,
+                                         bool is_string) {
+  for (size_t i = 1; i < n; i++) {
+    _upb_mapsorter_elem elem = elems[i];
+    size_t j = i;
+    for (; j > 0; j--) {
+      const _upb_mapsorter_elem* prev = &elems[j - 1];
+      bool less =
+          elem.key != prev->key
+              ? elem.key < prev->key
+              : is_string && _upb_mapsorter_strless(elem.ent, prev->ent);
+      if (!less) break;
+      elems[j] = *prev;
+    }
+    elems[j] = elem;
+  }
 }
 
-static int _upb_mapsorter_cmpbool(const void* _a, const void* _b) {
-  bool a, b;
-  _upb_mapsorter_getkeys(_a, _b, &a, &b, 1);
-  return a < b ? -1 : a > b;
+// LSD radix sort on the sort keys, a byte at a time.  Bytes that are the same
+// for every element are skipped, so small integer keys only take a pass or
+// two.  `tmp` must have room for `n` elements.
+static void _upb_mapsorter_radixsort(_upb_mapsorter_elem* elems,
+                                     _upb_mapsorter_elem* tmp, size_t n) {
+  size_t counts[8][256] = {{0}};
+  for (size_t i = 0; i < n; i++) {
+    uint64_t key = elems[i].key;
+    for (int b = 0; b < 8; b++) {
+      counts[b][(key >> (b * 8)) & 0xff]++;
+    }
+  }
+
+  _upb_mapsorter_elem* src = elems;
+  _upb_mapsorter_elem* dst = tmp;
+  for (int b = 0; b < 8; b++) {
+    size_t* count = counts[b];
+    size_t offset = 0;
+    bool skip = false;
+    for (int i = 0; i < 256; i++) {
+      size_t c = count[i];
+      if (c == n) {
+        skip = true;
+        break;
+      }
+      count[i] = offset;
+      offset += c;
+    }
+    if (skip) continue;
+
+    for (size_t i = 0; i < n; i++) {
+      dst[count[(src[i].key >> (b * 8)) & 0xff]++] = src[i];
+    }
+    _upb_mapsorter_elem* swap = src;
+    src = dst;
+    dst = swap;
+  }
+
+  if (src != elems) memcpy(elems, src, n * sizeof(*elems));
 }
 
-static int _upb_mapsorter_cmpstr(const void* _a, const void* _b) {
-  upb_StringView a, b;
-  _upb_mapsorter_getkeys(_a, _b, &a, &b, UPB_MAPTYPE_STRING);
-  size_t common_size = UPB_MIN(a.size, b.size);
-  int cmp = memcmp(a.data, b.data, common_size);
-  if (cmp) return -cmp;
-  return a.size < b.size ? -1 : a.size > b.size;
+static void _upb_mapsorter_sortints(_upb_mapsorter_elem* elems,
+                                    _upb_mapsorter_elem* tmp, size_t n) {
+  if (n < UPB_MAPSORTER_RADIX_MIN) {
+    _upb_mapsorter_insertionsort(elems, n, false);
+  } else {
+    _upb_mapsorter_radixsort(elems, tmp, n);
+  }
 }
 
-static int (*const compar[kUpb_FieldType_SizeOf])(const void*, const void*) = {
-    [kUpb_FieldType_Int64] = _upb_mapsorter_cmpi64,
-    [kUpb_FieldType_SFixed64] = _upb_mapsorter_cmpi64,
-    [kUpb_FieldType_SInt64] = _upb_mapsorter_cmpi64,
+// Sorts string keys that share their first `ofs` bytes by the next 7 bytes,
+// then sorts each run of keys that share those too by the 7 after that.
+static void _upb_mapsorter_sortstrs(_upb_mapsorter_elem* elems,
+                                    _upb_mapsorter_elem* tmp, size_t n,
+                                    size_t ofs) {
+  if (n < UPB_MAPSORTER_RADIX_MIN) {
+    for (size_t i = 0; i < n; i++) elems[i].key = 0;
+    _upb_mapsorter_insertionsort(elems, n, true);
+    return;
+  }
 
-    [kUpb_FieldType_UInt64] = _upb_mapsorter_cmpu64,
-    [kUpb_FieldType_Fixed64] = _upb_mapsorter_cmpu64,
+  // Skip any further prefix that all of the keys share, which is common for
+  // keys like "prefix.1234".
+  upb_StringView first = _upb_mapsorter_strview(elems[0].ent);
+  size_t common = first.size;
+  for (size_t i = 1; i < n && common > ofs; i++) {
+    upb_StringView str = _upb_mapsorter_strview(elems[i].ent);
+    size_t j = ofs;
+    size_t end = UPB_MIN(common, str.size);
+    while (j < end && str.data[j] == first.data[j]) j++;
+    common = j;
+  }
+  ofs = UPB_MAX(ofs, common);
 
-    [kUpb_FieldType_Int32] = _upb_mapsorter_cmpi32,
-    [kUpb_FieldType_SInt32] = _upb_mapsorter_cmpi32,
-    [kUpb_FieldType_SFixed32] = _upb_mapsorter_cmpi32,
-    [kUpb_FieldType_Enum] = _upb_mapsorter_cmpi32,
+  for (size_t i = 0; i < n; i++) {
+    elems[i].key = _upb_mapsorter_strkey(elems[i].ent, ofs);
+  }
+  _upb_mapsorter_radixsort(elems, tmp, n);
 
-    [kUpb_FieldType_UInt32] = _upb_mapsorter_cmpu32,
-    [kUpb_FieldType_Fixed32] = _upb_mapsorter_cmpu32,
+  // Map keys are unique, so keys that share these 7 bytes continue past them.
+  size_t run = 0;
+  for (size_t i = 1; i <= n; i++) {
+    if (i == n || elems[i].key != elems[run].key) {
+      if (i - run > 1) {
+        _upb_mapsorter_sortstrs(elems + run, tmp, i - run, ofs + 7);
+      }
+      run = i;
+    }
+  }
+}
 
-    [kUpb_FieldType_Bool] = _upb_mapsorter_cmpbool,
+// Fills `out` with the map's entries in sorted order.  `elems` must have room
+// for 2 * count(map) elements.
+static void _upb_mapsorter_sort(const upb_Map* map, upb_FieldType key_type,
+                                _upb_mapsorter_elem* elems,
+                                const void** out) {
+  const size_t n = _upb_Map_Size(map);
+  const bool is_string = map->key_size == UPB_MAPTYPE_STRING;
 
-    [kUpb_FieldType_String] = _upb_mapsorter_cmpstr,
-    [kUpb_FieldType_Bytes] = _upb_mapsorter_cmpstr,
-};
+  const upb_tabent* src = map->table.t.entries;
+  const upb_tabent* end = src + upb_table_size(&map->table.t);
+  _upb_mapsorter_elem* dst = elems;
+  for (; src < end; src++) {
+    if (!upb_tabent_isempty(src)) {
+      dst->key = is_string ? 0 : _upb_mapsorter_intkey(src, key_type);
+      dst->ent = src;
+      dst++;
+    }
+  }
+  UPB_ASSERT(dst == elems + n);
+
+  if (is_string) {
+    _upb_mapsorter_sortstrs(elems, elems + n, n, 0);
+  } else {
+    _upb_mapsorter_sortints(elems, elems + n, n);
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    out[i] = elems[i].ent;
+  }
+}
+
+// The order that upb_Map_FreezeSorted() caches only depends on the size of the
+// key: its integer keys are sorted as unsigned.
+static upb_FieldType _upb_mapsorter_cachedtype(const upb_Map* map) {
+  switch (map->key_size) {
+    case 1:
+      return kUpb_FieldType_Bool;
+    case 4:
+      return kUpb_FieldType_UInt32;
+    case 8:
+      return kUpb_FieldType_UInt64;
+    default:
+      return kUpb_FieldType_String;
+  }
+}
+
+static bool _upb_mapsorter_issigned(upb_FieldType key_type) {
+  switch (key_type) {
+    case kUpb_FieldType_Int64:
+    case kUpb_FieldType_SFixed64:
+    case kUpb_FieldType_SInt64:
+    case kUpb_FieldType_Int32:
+    case kUpb_FieldType_SInt32:
+    case kUpb_FieldType_SFixed32:
+    case kUpb_FieldType_Enum:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns whether a signed integer key of |key_size| bytes is negative.  Keys
+// are stored in native byte order, so the sign is read from the whole value.
+static bool _upb_mapsorter_isnegative(const upb_tabent* ent, size_t key_size) {
+  upb_StringView key = _upb_mapsorter_strview(ent);
+  if (key_size == 8) {
+    uint64_t val;
+    memcpy(&val, key.data, 8);
+    return val >> 63;
+  }
+  uint32_t val;
+  memcpy(&val, key.data, 4);
+  return val >> 31;
+}
+
+// Copies the cached order of a frozen map into `out`.  In the cache, signed
+// integer keys are sorted as unsigned, which puts the negative keys last
+// instead of first, so those are rotated to the front.
+static void _upb_mapsorter_copycached(const upb_Map* map,
+                                      upb_FieldType key_type,
+                                      const void** out) {
+  const upb_tabent* const* sorted = map->UPB_PRIVATE(sorted);
+  const size_t n = _upb_Map_Size(map);
+  size_t split = n;
+
+  if (_upb_mapsorter_issigned(key_type)) {
+    // Binary search for the first key with the sign bit set.
+    size_t lo = 0;
+    size_t hi = n;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (_upb_mapsorter_isnegative(sorted[mid], map->key_size)) {
+        hi = mid;
+      } else {
+        lo = mid + 1;
+      }
+    }
+    split = lo;
+  }
+
+  memcpy(out, sorted + split, (n - split) * sizeof(*out));
+  memcpy(out + (n - split), sorted, split * sizeof(*out));
+}
 
 static bool _upb_mapsorter_resize(_upb_mapsorter* s, _upb_sortedmap* sorted,
                                   int size) {
@@ -110,28 +336,50 @@ static bool _upb_mapsorter_resize(_upb_mapsorter* s, _upb_sortedmap* sorted,
   return true;
 }
 
+static bool _upb_mapsorter_reservescratch(_upb_mapsorter* s, size_t count) {
+  const size_t size = 2 * count * sizeof(_upb_mapsorter_elem);
+  if (size > s->scratch_size) {
+    const size_t new_size = upb_Log2CeilingSize(size);
+    void* scratch = upb_grealloc(s->scratch, s->scratch_size, new_size);
+    if (!scratch) return false;
+    s->scratch = scratch;
+    s->scratch_size = new_size;
+  }
+  return true;
+}
+
 bool _upb_mapsorter_pushmap(_upb_mapsorter* s, upb_FieldType key_type,
                             const upb_Map* map, _upb_sortedmap* sorted) {
   int map_size = _upb_Map_Size(map);
   UPB_ASSERT(map_size);
 
   if (!_upb_mapsorter_resize(s, sorted, map_size)) return false;
+  const void** out = &s->entries[sorted->start];
 
-  // Copy non-empty entries from the table to s->entries.
-  const void** dst = &s->entries[sorted->start];
-  const upb_tabent* src = map->table.t.entries;
-  const upb_tabent* end = src + upb_table_size(&map->table.t);
-  for (; src < end; src++) {
-    if (!upb_tabent_isempty(src)) {
-      *dst = src;
-      dst++;
-    }
+  if (map->UPB_PRIVATE(sorted)) {
+    _upb_mapsorter_copycached(map, key_type, out);
+    return true;
   }
-  UPB_ASSERT(dst == &s->entries[sorted->end]);
 
-  // Sort entries according to the key type.
-  qsort(&s->entries[sorted->start], map_size, sizeof(*s->entries),
-        compar[key_type]);
+  if (!_upb_mapsorter_reservescratch(s, map_size)) return false;
+  _upb_mapsorter_sort(map, key_type, s->scratch, out);
+  return true;
+}
+
+bool UPB_PRIVATE(_upb_Map_CacheSortedOrder)(upb_Map* map, upb_Arena* a) {
+  const size_t n = _upb_Map_Size(map);
+  if (n == 0) return true;
+
+  const upb_tabent** sorted = upb_Arena_Malloc(a, n * sizeof(*sorted));
+  if (!sorted) return false;
+
+  _upb_mapsorter_elem* elems = upb_gmalloc(2 * n * sizeof(*elems));
+  if (!elems) return false;
+  _upb_mapsorter_sort(map, _upb_mapsorter_cachedtype(map), elems,
+                      (const void**)sorted);
+  upb_gfree(elems);
+
+  map->UPB_PRIVATE(sorted) = sorted;
   return true;
 }
 
@@ -7,9 +7,20 @@
 
 #include "upb/message/map.h"
 
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
 #include <gtest/gtest.h>
+#include "upb/base/descriptor_constants.h"
 #include "upb/base/string_view.h"
 #include "upb/mem/arena.hpp"
+#include "upb/message/internal/map_entry.h"
+#include "upb/message/internal/map_sorter.h"
 
 TEST(MapTest, DeleteRegression) {
   upb::Arena arena;
@@ -31,3 +42,108 @@ TEST(MapTest, DeleteRegression) {
   EXPECT_TRUE(
       upb_StringView_IsEqual(insert_value.str_val, delete_value.str_val));
 }
+
+// Returns the keys of `map` in the order that deterministic serialization
+// visits them.
+template <typename T>
+std::vector<T> SortedKeys(const upb_Map* map, upb_FieldType key_type) {
+  _upb_mapsorter sorter;
+  _upb_mapsorter_init(&sorter);
+  _upb_sortedmap sorted;
+  EXPECT_TRUE(_upb_mapsorter_pushmap(&sorter, key_type, map, &sorted));
+  std::vector<T> keys;
+  upb_MapEntry ent;
+  while (_upb_sortedmap_next(&sorter, map, &sorted, &ent)) {
+    T key;
+    memcpy(&key, &ent.k, sizeof(key));
+    keys.push_back(key);
+  }
+  _upb_mapsorter_popmap(&sorter, &sorted);
+  _upb_mapsorter_destroy(&sorter);
+  return keys;
+}
+
+template <typename T>
+void TestSortedIntKeys(upb_CType ctype, upb_FieldType key_type, int n) {
+  upb::Arena arena;
+  upb_Map* map = upb_Map_New(arena.ptr(), ctype, kUpb_CType_Int32);
+  std::mt19937_64 rng(n);
+  std::vector<T> keys;
+  for (int i = 0; i < n; i++) {
+    // Mix small keys, which share their high bytes, with arbitrary ones.
+    T key = static_cast<T>(i % 2 ? rng() : rng() % 1000 - 500);
+    upb_MessageValue key_val, val;
+    memcpy(&key_val, &key, sizeof(key));
+    val.int32_val = i;
+    if (upb_Map_Insert(map, key_val, val, arena.ptr()) ==
+        kUpb_MapInsertStatus_Inserted) {
+      keys.push_back(key);
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+
+  EXPECT_EQ(keys, SortedKeys<T>(map, key_type));
+  ASSERT_TRUE(upb_Map_FreezeSorted(map, nullptr, arena.ptr()));
+  EXPECT_EQ(keys, SortedKeys<T>(map, key_type));
+}
+
+class MapSorterTest : public testing::TestWithParam<int> {};
+
+TEST_P(MapSorterTest, IntKeys) {
+  TestSortedIntKeys<int32_t>(kUpb_CType_Int32, kUpb_FieldType_Int32,
+                             GetParam());
+  TestSortedIntKeys<int32_t>(kUpb_CType_Int32, kUpb_FieldType_SFixed32,
+                             GetParam());
+  TestSortedIntKeys<uint32_t>(kUpb_CType_UInt32, kUpb_FieldType_UInt32,
+                              GetParam());
+  TestSortedIntKeys<int64_t>(kUpb_CType_Int64, kUpb_FieldType_SInt64,
+                             GetParam());
+  TestSortedIntKeys<uint64_t>(kUpb_CType_UInt64, kUpb_FieldType_Fixed64,
+                              GetParam());
+  TestSortedIntKeys<bool>(kUpb_CType_Bool, kUpb_FieldType_Bool, GetParam());
+}
+
+TEST_P(MapSorterTest, StringKeys) {
+  upb::Arena arena;
+  upb_Map* map = upb_Map_New(arena.ptr(), kUpb_CType_String, kUpb_CType_Int32);
+  std::mt19937 rng(GetParam());
+  std::vector<std::string> keys;
+  for (int i = 0; i < GetParam(); i++) {
+    // Long shared prefixes and keys that are prefixes of each other exercise
+    // the later chunks of the sort.
+    std::string key(rng() % 3 ? "" : "some.long.shared.prefix.");
+    int len = rng() % 12;
+    for (int j = 0; j < len; j++) key.push_back("ab\xff\0"[rng() % 4]);
+    upb_MessageValue key_val, val;
+    key_val.str_val = upb_StringView_FromDataAndSize(key.data(), key.size());
+    val.int32_val = i;
+    if (upb_Map_Insert(map, key_val, val, arena.ptr()) ==
+        kUpb_MapInsertStatus_Inserted) {
+      keys.push_back(key);
+    }
+  }
+  // Differing bytes sort from high to low, but a prefix of a key sorts first.
+  std::sort(keys.begin(), keys.end(),
+            [](const std::string& a, const std::string& b) {
+              size_t common = std::min(a.size(), b.size());
+              int cmp = memcmp(a.data(), b.data(), common);
+              if (cmp) return cmp > 0;
+              return a.size() < b.size();
+            });
+
+  auto sorted_keys = [&]() {
+    std::vector<std::string> ret;
+    for (upb_StringView key :
+         SortedKeys<upb_StringView>(map, kUpb_FieldType_String)) {
+      ret.emplace_back(key.data, key.size);
+    }
+    return ret;
+  };
+  EXPECT_EQ(keys, sorted_keys());
+  ASSERT_TRUE(upb_Map_FreezeSorted(map, nullptr, arena.ptr()));
+  EXPECT_TRUE(upb_Map_IsFrozen(map));
+  EXPECT_EQ(keys, sorted_keys());
+}
+
+INSTANTIATE_TEST_SUITE_P(MapSorterParams, MapSorterTest,
+                         testing::Values(1, 10, 31, 32, 1000, 20000));
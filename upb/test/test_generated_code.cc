@@ -18,9 +18,11 @@
 #include "google/protobuf/test_messages_proto3.upb.h"
 #include "upb/base/status.h"
 #include "upb/base/string_view.h"
+#include "upb/base/upcast.h"
 #include "upb/mem/arena.hpp"
 #include "upb/message/array.h"
 #include "upb/message/map.h"
+#include "upb/message/message.h"
 #include "upb/test/test.upb.h"
 
 // Must be last.
@@ -497,6 +499,59 @@ TEST(GeneratedCode, UTF8) {
   upb_Arena_Free(arena);
 }
 
+TEST(GeneratedCode, ClosedEnumUnknownValues) {
+  // Values outside of a closed enum must be preserved as unknown fields, both
+  // for plain enum fields and for map entries whose value is a closed enum.
+  const char serialized[] = {
+      '\xa8', '\x01', '\x02',  // optional_nested_enum: BAZ
+      '\xa8', '\x01', '\x07',  // optional_nested_enum: 7 (unknown)
+      '\x98', '\x03', '\x01',  // repeated_nested_enum: BAR
+      '\x98', '\x03', '\x07',  // repeated_nested_enum: 7 (unknown)
+      '\x98', '\x03', '\x02',  // repeated_nested_enum: BAZ
+      '\xca', '\x04', '\x05',  // map_string_nested_enum entry
+      '\x0a', '\x01', 'a',    //   key: "a"
+      '\x10', '\x01',         //   value: BAR
+      '\xca', '\x04', '\x05',  // map_string_nested_enum entry
+      '\x0a', '\x01', 'b',    //   key: "b"
+      '\x10', '\x07',         //   value: 7 (unknown)
+  };
+  upb::Arena arena;
+  protobuf_test_messages_proto2_TestAllTypesProto2* msg =
+      protobuf_test_messages_proto2_TestAllTypesProto2_parse(
+          serialized, sizeof(serialized), arena.ptr());
+  ASSERT_NE(nullptr, msg);
+
+  EXPECT_EQ(
+      protobuf_test_messages_proto2_TestAllTypesProto2_BAZ,
+      protobuf_test_messages_proto2_TestAllTypesProto2_optional_nested_enum(
+          msg));
+
+  size_t size;
+  const int32_t* repeated =
+      protobuf_test_messages_proto2_TestAllTypesProto2_repeated_nested_enum(
+          msg, &size);
+  ASSERT_EQ(2, size);
+  EXPECT_EQ(protobuf_test_messages_proto2_TestAllTypesProto2_BAR, repeated[0]);
+  EXPECT_EQ(protobuf_test_messages_proto2_TestAllTypesProto2_BAZ, repeated[1]);
+
+  int32_t val;
+  EXPECT_EQ(
+      1,
+      protobuf_test_messages_proto2_TestAllTypesProto2_map_string_nested_enum_size(
+          msg));
+  EXPECT_TRUE(
+      protobuf_test_messages_proto2_TestAllTypesProto2_map_string_nested_enum_get(
+          msg, upb_StringView_FromString("a"), &val));
+  EXPECT_EQ(protobuf_test_messages_proto2_TestAllTypesProto2_BAR, val);
+  EXPECT_FALSE(
+      protobuf_test_messages_proto2_TestAllTypesProto2_map_string_nested_enum_get(
+          msg, upb_StringView_FromString("b"), &val));
+
+  // The unknown values and the map entry were kept as unknown fields.
+  upb_Message_GetUnknown(UPB_UPCAST(msg), &size);
+  EXPECT_EQ(3 + 3 + 8, size);
+}
+
 static void check_string_map_empty(
     protobuf_test_messages_proto3_TestAllTypesProto3* msg) {
   size_t iter = kUpb_Map_Begin;
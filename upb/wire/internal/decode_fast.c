@@ -19,6 +19,10 @@
 
 #include "upb/message/array.h"
 #include "upb/message/internal/array.h"
+#include "upb/message/internal/map_entry.h"
+#include "upb/message/map.h"
+#include "upb/mini_table/enum.h"
+#include "upb/mini_table/internal/message.h"
 #include "upb/mini_table/sub.h"
 #include "upb/wire/internal/decoder.h"
 
@@ -469,6 +473,90 @@ TAGBYTES(p)
 #undef F
 #undef TYPES
 #undef TAGBYTES
+
+/* closed enum fields *********************************************************/
+
+// Values that are not in the enum have to go to unknown fields, so for those we
+// leave the tag unconsumed and let the generic parser handle the field.
+
+#define FASTDECODE_ENUM(d, ptr, msg, table, hasbits, data, tagbytes, card)   \
+  uint64_t val;                                                              \
+  void* dst;                                                                 \
+  fastdecode_arr farr;                                                       \
+  const char* next;                                                          \
+                                                                             \
+  if (UPB_UNLIKELY(!fastdecode_checktag(data, tagbytes))) {                  \
+    RETURN_GENERIC("enum field tag mismatch\n");                             \
+  }                                                                          \
+                                                                             \
+  const upb_MiniTable* tablep = decode_totablep(table);                      \
+  const upb_MiniTableEnum* e =                                               \
+      tablep->UPB_PRIVATE(subs)[(data >> 16) & 0xff].UPB_PRIVATE(subenum);   \
+                                                                             \
+  if (card != CARD_r) {                                                      \
+    next = fastdecode_varint64(ptr + tagbytes, &val);                        \
+    if (next == NULL) {                                                      \
+      _upb_FastDecoder_ErrorJmp(d, kUpb_DecodeStatus_Malformed);             \
+    }                                                                        \
+    if (UPB_UNLIKELY(!upb_MiniTableEnum_CheckValue(e, (uint32_t)val))) {     \
+      RETURN_GENERIC("enum value not in enum\n");                            \
+    }                                                                        \
+    dst = fastdecode_getfield(d, ptr, msg, &data, &hasbits, &farr, 4, card); \
+    memcpy(dst, &val, 4);                                                    \
+    ptr = next;                                                              \
+    UPB_MUSTTAIL return fastdecode_dispatch(UPB_PARSE_ARGS);                 \
+  }                                                                          \
+                                                                             \
+  dst = fastdecode_getfield(d, ptr, msg, &data, &hasbits, &farr, 4, CARD_r); \
+                                                                             \
+  again:                                                                     \
+  dst = fastdecode_resizearr(d, dst, &farr, 4);                              \
+                                                                             \
+  next = fastdecode_varint64(ptr + tagbytes, &val);                          \
+  if (next == NULL) {                                                        \
+    _upb_FastDecoder_ErrorJmp(d, kUpb_DecodeStatus_Malformed);               \
+  }                                                                          \
+  if (UPB_UNLIKELY(!upb_MiniTableEnum_CheckValue(e, (uint32_t)val))) {       \
+    fastdecode_commitarr(dst, &farr, 4);                                     \
+    RETURN_GENERIC("enum value not in enum\n");                              \
+  }                                                                          \
+  memcpy(dst, &val, 4);                                                      \
+  ptr = next;                                                                \
+                                                                             \
+  fastdecode_nextret ret =                                                   \
+      fastdecode_nextrepeated(d, dst, &ptr, &farr, data, tagbytes, 4);       \
+  switch (ret.next) {                                                        \
+    case FD_NEXT_SAMEFIELD:                                                  \
+      dst = ret.dst;                                                         \
+      goto again;                                                            \
+    case FD_NEXT_OTHERFIELD:                                                 \
+      data = ret.tag;                                                        \
+      UPB_MUSTTAIL return _upb_FastDecoder_TagDispatch(UPB_PARSE_ARGS);      \
+    case FD_NEXT_ATLIMIT:                                                    \
+      return ptr;                                                            \
+  }                                                                          \
+  UPB_UNREACHABLE();
+
+/* Generate all combinations:
+ * {s,o,r} x {1bt,2bt} */
+
+#define F(card, tagbytes)                                                     \
+  UPB_NOINLINE                                                                \
+  const char* upb_p##card##e4_##tagbytes##bt(UPB_PARSE_PARAMS) {              \
+    FASTDECODE_ENUM(d, ptr, msg, table, hasbits, data, tagbytes, CARD_##card); \
+  }
+
+#define TAGBYTES(card) \
+  F(card, 1)           \
+  F(card, 2)
+
+TAGBYTES(s)
+TAGBYTES(o)
+TAGBYTES(r)
+
+#undef F
+#undef TAGBYTES
+#undef FASTDECODE_ENUM
 #undef FASTDECODE_UNPACKEDVARINT
 #undef FASTDECODE_PACKEDVARINT
 #undef FASTDECODE_VARINT
@@ -766,6 +854,11 @@ void fastdecode_docopy(upb_Decoder* d, const char* ptr, uint32_t size, int copy,
     RETURN_GENERIC("string field tag mismatch\n");                            \
   }                                                                           \
                                                                               \
+  if (!validate_utf8 &&                                                       \
+      UPB_UNLIKELY(d->options & kUpb_DecodeOption_AlwaysValidateUtf8)) {      \
+    RETURN_GENERIC("bytes field needs UTF-8 validation\n");                   \
+  }                                                                           \
+                                                                              \
   if (UPB_UNLIKELY(                                                           \
           !upb_EpsCopyInputStream_AliasingAvailable(&d->input, ptr, 0))) {    \
     UPB_MUSTTAIL return copyfunc(UPB_PARSE_ARGS);                             \
@@ -914,8 +1007,8 @@ const char* fastdecode_tosubmsg(upb_EpsCopyInputStream* e, const char* ptr,
   upb_Message** dst;                                                      \
   uint32_t submsg_idx = (data >> 16) & 0xff;                              \
   const upb_MiniTable* tablep = decode_totablep(table);                   \
-  const upb_MiniTable* subtablep = upb_MiniTableSub_Message(              \
-      *UPB_PRIVATE(_upb_MiniTable_GetSubByIndex)(tablep, submsg_idx));    \
+  const upb_MiniTable* subtablep =                                        \
+      UPB_PRIVATE(_upb_MiniTable_GetSubTableByIndex)(tablep, submsg_idx); \
   fastdecode_submsgdata submsg = {decode_totable(subtablep)};             \
   fastdecode_arr farr;                                                    \
                                                                           \
@@ -997,4 +1090,74 @@ TAGBYTES(r)
 #undef F
 #undef FASTDECODE_SUBMSG
 
+/* map fields *****************************************************************/
+
+// Each map entry is parsed as a sub-message through the entry's own fast table,
+// then handed to decode.c for insertion (or for preservation as an unknown
+// field if the entry had unknown fields, eg. a closed enum value).
+
+#define FASTDECODE_MAP(d, ptr, msg, table, hasbits, data, tagbytes)        \
+  if (UPB_UNLIKELY(!fastdecode_checktag(data, tagbytes))) {                \
+    RETURN_GENERIC("map field tag mismatch\n");                            \
+  }                                                                        \
+                                                                           \
+  const upb_MiniTable* tablep = decode_totablep(table);                    \
+  uint32_t entry_idx = (data >> 16) & 0xff;                                \
+  const upb_MiniTable* entry =                                             \
+      UPB_PRIVATE(_upb_MiniTable_GetSubTableByIndex)(tablep, entry_idx);   \
+                                                                           \
+  if (entry->UPB_PRIVATE(table_mask) == (uint8_t)-1) {                     \
+    RETURN_GENERIC("map entry doesn't have fast tables.\n");               \
+  }                                                                        \
+                                                                           \
+  if (--d->depth == 0) {                                                   \
+    _upb_FastDecoder_ErrorJmp(d, kUpb_DecodeStatus_MaxDepthExceeded);      \
+  }                                                                        \
+                                                                           \
+  /* |data| has had the tag xor'd out, so reload it from the input. */     \
+  uint32_t tag = _upb_FastDecoder_LoadTag(ptr);                            \
+  uint32_t number =                                                        \
+      tagbytes == 1 ? (tag & 0x7f) >> 3                                    \
+                    : ((tag & 0x7f) | ((tag >> 8) & 0x7f) << 7) >> 3;      \
+  upb_Map** map_p = fastdecode_fieldmem(msg, data);                        \
+  upb_Map* map = *map_p;                                                   \
+  upb_MapEntry ent;                                                        \
+  fastdecode_submsgdata submsg = {decode_totable(entry), &ent.message};    \
+                                                                           \
+  if (UPB_UNLIKELY(!map)) {                                                \
+    *map_p = map = _upb_Decoder_CreateMap(d, entry);                       \
+  }                                                                        \
+                                                                           \
+  again:                                                                   \
+  _upb_Decoder_InitMapEntry(d, entry, &ent);                               \
+                                                                           \
+  ptr += tagbytes;                                                         \
+  ptr = fastdecode_delimited(d, ptr, fastdecode_tosubmsg, &submsg);        \
+                                                                           \
+  if (UPB_UNLIKELY(ptr == NULL || d->end_group != DECODE_NOGROUP)) {       \
+    _upb_FastDecoder_ErrorJmp(d, kUpb_DecodeStatus_Malformed);             \
+  }                                                                        \
+                                                                           \
+  _upb_Decoder_AddMapEntry(d, msg, map, entry, number, &ent);              \
+                                                                           \
+  if (UPB_LIKELY(!_upb_Decoder_IsDone(d, &ptr)) &&                         \
+      fastdecode_tagmatch(_upb_FastDecoder_LoadTag(ptr), tag, tagbytes)) { \
+    goto again;                                                            \
+  }                                                                        \
+                                                                           \
+  d->depth++;                                                              \
+  UPB_MUSTTAIL return fastdecode_dispatch(d, ptr, msg, table, hasbits, 0);
+
+#define F(tagbytes)                                              \
+  UPB_NOINLINE                                                   \
+  const char* upb_pM_##tagbytes##bt(UPB_PARSE_PARAMS) {          \
+    FASTDECODE_MAP(d, ptr, msg, table, hasbits, data, tagbytes); \
+  }
+
+F(1)
+F(2)
+
+#undef F
+#undef FASTDECODE_MAP
+
 #endif /* UPB_FASTTABLE */
@@ -22,6 +22,7 @@
 //   - 'o' for oneof
 //   - 'r' for non-packed repeated
 //   - 'p' for packed repeated
+//   - 'M' for map (no type, the map entry's own table parses key and value)
 //
 // In position 3 (type):
 //   - 'b1' for bool
@@ -29,6 +30,7 @@
 //   - 'v8' for 8-byte varint
 //   - 'z4' for zig-zag-encoded 4-byte varint
 //   - 'z8' for zig-zag-encoded 8-byte varint
+//   - 'e4' for closed enum (4-byte varint checked against the enum)
 //   - 'f4' for 4-byte fixed
 //   - 'f8' for 8-byte fixed
 //   - 'm' for sub-message
@@ -91,6 +93,22 @@ TAGBYTES(p)
 #undef TYPES
 #undef TAGBYTES
 
+/* closed enum fields *********************************************************/
+
+#define F(card, tagbytes) \
+  const char* upb_p##card##e4_##tagbytes##bt(UPB_PARSE_PARAMS);
+
+#define TAGBYTES(card) \
+  F(card, 1)           \
+  F(card, 2)
+
+TAGBYTES(s)
+TAGBYTES(o)
+TAGBYTES(r)
+
+#undef F
+#undef TAGBYTES
+
 /* string fields **************************************************************/
 
 #define F(card, tagbytes, type)                                     \
@@ -137,6 +155,11 @@ TAGBYTES(r)
 #undef SIZES
 #undef TAGBYTES
 
+/* map fields *****************************************************************/
+
+const char* upb_pM_1bt(UPB_PARSE_PARAMS);
+const char* upb_pM_2bt(UPB_PARSE_PARAMS);
+
 #undef UPB_PARSE_PARAMS
 
 #ifdef __cplusplus
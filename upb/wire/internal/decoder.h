@@ -14,7 +14,9 @@
 #define UPB_WIRE_INTERNAL_DECODER_H_
 
 #include "upb/mem/internal/arena.h"
+#include "upb/message/internal/map_entry.h"
 #include "upb/message/internal/message.h"
+#include "upb/message/map.h"
 #include "upb/wire/decode.h"
 #include "upb/wire/eps_copy_input_stream.h"
 #include "utf8_range.h"
@@ -66,6 +68,20 @@ const char* _upb_Decoder_CheckRequired(upb_Decoder* d, const char* ptr,
                                        const upb_Message* msg,
                                        const upb_MiniTable* m);
 
+// Map field helpers, shared so that the fast decoder can parse map entries
+// itself and only defer to decode.c for creating and inserting them.
+upb_Map* _upb_Decoder_CreateMap(upb_Decoder* d, const upb_MiniTable* entry);
+
+// Zeroes |ent| and creates its value up front if the value is a sub-message.
+void _upb_Decoder_InitMapEntry(upb_Decoder* d, const upb_MiniTable* entry,
+                               upb_MapEntry* ent);
+
+// Inserts a parsed entry into |map|, or preserves it as an unknown field of
+// |msg| (under field |number|) if the entry itself had unknown fields.
+void _upb_Decoder_AddMapEntry(upb_Decoder* d, upb_Message* msg, upb_Map* map,
+                              const upb_MiniTable* entry, uint32_t number,
+                              upb_MapEntry* ent);
+
 /* x86-64 pointers always have the high 16 bits matching. So we can shift
  * left 8 and right 8 without loss of information. */
 UPB_INLINE intptr_t decode_totable(const upb_MiniTable* tablep) {
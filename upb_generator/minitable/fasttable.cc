@@ -124,16 +124,19 @@ bool TryFillTableEntry(const DefPoolPair& pools, upb::FieldDefPtr field,
       upb_MiniTable_FindFieldByNumber(mt, field.number());
   std::string type = "";
   std::string cardinality = "";
-  switch (upb_MiniTableField_Type(mt_f)) {
+  // Switch on the stored type rather than upb_MiniTableField_Type(): strings
+  // that don't require UTF-8 validation are stored as bytes, and open enums as
+  // int32, which is exactly how the fast parser needs to treat them.
+  switch (mt_f->UPB_PRIVATE(descriptortype)) {
     case kUpb_FieldType_Bool:
       type = "b1";
       break;
     case kUpb_FieldType_Enum:
-      if (upb_MiniTableField_IsClosedEnum(mt_f)) {
-        // We don't have the means to test proto2 enum fields for valid values.
-        return false;
-      }
-      [[fallthrough]];
+      // Packed closed enums still go to the generic parser, which can move
+      // unknown values out of the middle of the packed run.
+      if (upb_MiniTableField_IsPacked(mt_f)) return false;
+      type = "e4";
+      break;
     case kUpb_FieldType_Int32:
     case kUpb_FieldType_UInt32:
       type = "v4";
@@ -175,6 +178,9 @@ bool TryFillTableEntry(const DefPoolPair& pools, upb::FieldDefPtr field,
     cardinality = upb_MiniTableField_IsPacked(mt_f) ? "p" : "r";
   } else if (upb_MiniTableField_IsScalar(mt_f)) {
     cardinality = upb_MiniTableField_IsInOneof(mt_f) ? "o" : "s";
+  } else if (upb_MiniTableField_IsMap(mt_f)) {
+    cardinality = "M";
+    type = "";
   } else {
     return false;  // Not supported yet (ever?).
   }
@@ -189,6 +195,7 @@ bool TryFillTableEntry(const DefPoolPair& pools, upb::FieldDefPtr field,
   // |--------|--------|--------|--------|--------|--------|--------|--------|
   //
   // - |presence| is either hasbit index or field number for oneofs.
+  // - |submsg| is the sub-table index for messages, maps and closed enums.
 
   uint64_t data =
       static_cast<uint64_t>(mt_f->UPB_PRIVATE(offset)) << 48 | expected_tag;
@@ -204,17 +211,22 @@ bool TryFillTableEntry(const DefPoolPair& pools, upb::FieldDefPtr field,
   } else {
     uint64_t hasbit_index = 63;  // No hasbit (set a high, unused bit).
     if (mt_f->presence) {
-      hasbit_index = mt_f->presence;
+      // The fast parser only tracks the 32 hasbits right after the 8-byte
+      // message header, so the index is relative to that word.
+      hasbit_index = mt_f->presence - 64;
       if (hasbit_index > 31) return false;
     }
     data |= hasbit_index << 24;
   }
 
-  if (field.ctype() == kUpb_CType_Message) {
+  if (field.ctype() == kUpb_CType_Message ||
+      upb_MiniTableField_IsClosedEnum(mt_f)) {
     uint64_t idx = mt_f->UPB_PRIVATE(submsg_index);
     if (idx > 255) return false;
     data |= idx << 16;
+  }
 
+  if (field.ctype() == kUpb_CType_Message && !upb_MiniTableField_IsMap(mt_f)) {
     std::string size_ceil = "max";
     size_t size = SIZE_MAX;
     if (field.message_type().file() == field.file()) {